@@ -21,6 +21,7 @@
 #include "arch/io/disk/conflict_resolving.hpp"
 #include "arch/io/disk/stats.hpp"
 #include "arch/io/disk/accounting.hpp"
+#include "arch/io/disk/uring.hpp"
 #include "backtrace.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
@@ -46,14 +47,31 @@ public:
     linux_disk_manager_t(linux_event_queue_t *queue,
                          int batch_factor,
                          int max_concurrent_io_requests,
+                         file_io_backend_t io_backend,
                          perfmon_collection_t *stats) :
         stack_stats(stats, "stack"),
         conflict_resolver(stats),
         accounter(batch_factor),
         backend_stats(stats, "backend", accounter.producer),
-        backend(queue, backend_stats.producer, max_concurrent_io_requests),
         outstanding_txn(0)
     {
+        switch (io_backend) {
+        case file_io_backend_t::blocker_pool:
+            pool_backend.init(new pool_diskmgr_t(queue, backend_stats.producer,
+                                                 max_concurrent_io_requests));
+            pool_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                               &backend_stats, ph::_1);
+            break;
+        case file_io_backend_t::io_uring:
+            uring_backend.init(new uring_diskmgr_t(queue, backend_stats.producer,
+                                                   max_concurrent_io_requests));
+            uring_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                                &backend_stats, ph::_1);
+            break;
+        default:
+            unreachable();
+        }
+
         /* Hook up the `submit_fun`s of the parts of the IO stack that are above the
         queue. (The parts below the queue use the `passive_producer_t` interface instead
         of a callback function.) */
@@ -62,8 +80,7 @@ public:
         conflict_resolver.submit_fun = std::bind(&accounting_diskmgr_t::submit,
                                                  &accounter, ph::_1);
 
-        /* Hook up everything's `done_fun`. */
-        backend.done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
+        /* Hook up everything's `done_fun`. (The backend's was set up above.) */
         backend_stats.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
         accounter.done_fun = std::bind(&conflict_resolving_diskmgr_t::done,
                                        &conflict_resolver, ph::_1);
@@ -181,7 +198,9 @@ private:
     holding back operations that must be run after other, currently-running, operations.
     Then it goes to the account manager, which queues up running IO operations according
     to which account they are part of. Finally the "backend" pops the IO operations
-    from the queue.
+    from the queue. The backend is either a blocker thread pool or an io_uring,
+    depending on the `file_io_backend_t` the `io_backender_t` was created with;
+    exactly one of `pool_backend` and `uring_backend` is set.
 
     At two points in the process--once as soon as it is submitted, and again right
     as the backend pops it off the queue--its statistics are recorded. The "stack stats"
@@ -194,7 +213,8 @@ private:
     conflict_resolving_diskmgr_t conflict_resolver;
     accounting_diskmgr_t accounter;
     stats_diskmgr_2_t backend_stats;
-    pool_diskmgr_t backend;
+    scoped_ptr_t<pool_diskmgr_t> pool_backend;
+    scoped_ptr_t<uring_diskmgr_t> uring_backend;
 
 
     intptr_t outstanding_txn;
@@ -203,17 +223,22 @@ private:
 };
 
 io_backender_t::io_backender_t(file_direct_io_mode_t _direct_io_mode,
-                               int max_concurrent_io_requests)
+                               int max_concurrent_io_requests,
+                               file_io_backend_t _io_backend)
     : direct_io_mode(_direct_io_mode),
+      io_backend(_io_backend),
       diskmgr(new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
                                        DEFAULT_IO_BATCH_FACTOR,
                                        max_concurrent_io_requests,
+                                       io_backend,
                                        &stats)) { }
 
 io_backender_t::~io_backender_t() { }
 
 file_direct_io_mode_t io_backender_t::get_direct_io_mode() const { return direct_io_mode; }
 
+file_io_backend_t io_backender_t::get_io_backend() const { return io_backend; }
+
 
 /* Disk file object */
 
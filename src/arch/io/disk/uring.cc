@@ -0,0 +1,416 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/io/disk/uring.hpp"
+
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "arch/runtime/system_event/eventfd_event.hpp"
+#include "config/args.hpp"
+#include "logger.hpp"
+
+/* Each action needs at most three submission queue entries (datasync, writev,
+datasync). We don't let more than `queue_depth` actions be in flight, so a ring
+with `3 * queue_depth` entries can never run out of room. The kernel caps the
+ring at 32768 entries. */
+const int MAX_URING_QUEUE_DEPTH = 4096;
+const int URING_ENTRIES_PER_ACTION = 3;
+
+int uring_queue_depth(int max_concurrent_io_requests) {
+    guarantee(max_concurrent_io_requests > 0);
+    guarantee(max_concurrent_io_requests < MAXIMUM_MAX_CONCURRENT_IO_REQUESTS);
+    // Same as `blocker_pool_queue_depth`, but there are no threads to keep busy,
+    // so this is only the limit on operations in flight in the kernel.
+    return std::min(max_concurrent_io_requests * 2, MAX_URING_QUEUE_DEPTH);
+}
+
+enum class uring_entry_kind_t {
+    data = 0,
+    pre_sync = 1,
+    post_sync = 2
+};
+
+#if USE_IO_URING
+
+/* `ring_t` owns the ring file descriptor, the three shared memory regions the
+kernel exposes for it, and the eventfd the kernel pokes whenever it posts a
+completion. We drive the ring with raw system calls so that we don't pick up a
+dependency on liburing. */
+struct uring_diskmgr_t::ring_t {
+    ring_t()
+        : ring_fd(-1), sq_ptr(MAP_FAILED), sq_len(0), cq_ptr(MAP_FAILED), cq_len(0),
+          sqes(static_cast<io_uring_sqe *>(MAP_FAILED)), sqes_len(0),
+          local_sq_tail(0) { }
+
+    ~ring_t() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_len);
+        }
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_len);
+        }
+        if (sq_ptr != MAP_FAILED) {
+            munmap(sq_ptr, sq_len);
+        }
+        if (ring_fd != -1) {
+            int res = close(ring_fd);
+            guarantee_err(res == 0, "Could not close io_uring file descriptor");
+        }
+    }
+
+    // Returns 0 on success or an errno value.
+    int init(unsigned int entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+        if (ring_fd == -1) {
+            return get_errno();
+        }
+
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        }
+
+        sq_ptr = mmap(NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            return get_errno();
+        }
+        if (single_mmap) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = mmap(NULL, cq_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                return get_errno();
+            }
+        }
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(
+            mmap(NULL, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ring_fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return get_errno();
+        }
+
+        char *sq = static_cast<char *>(sq_ptr);
+        sq_head = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        sq_array = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+        local_sq_tail = *sq_tail;
+
+        char *cq = static_cast<char *>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        int notify_fd = completion_event.get_notify_fd();
+        int res = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_EVENTFD,
+                          &notify_fd, 1);
+        if (res == -1) {
+            return get_errno();
+        }
+        return 0;
+    }
+
+    // Returns a zeroed submission queue entry. It becomes visible to the kernel on
+    // the next call to `submit()`.
+    io_uring_sqe *next_sqe() {
+        unsigned int head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        guarantee(local_sq_tail - head < sq_entries,
+                  "io_uring submission queue overflow");
+        unsigned int index = local_sq_tail & sq_mask;
+        io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        ++local_sq_tail;
+        return sqe;
+    }
+
+    void submit() {
+        __atomic_store_n(sq_tail, local_sq_tail, __ATOMIC_RELEASE);
+        unsigned int to_submit = local_sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        while (to_submit > 0) {
+            int res = syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, NULL, 0);
+            if (res == -1) {
+                // EAGAIN and EBUSY mean the kernel is temporarily out of resources.
+                // The entries stay on the ring and get submitted with the next
+                // batch, which at the latest happens when a completion arrives.
+                if (get_errno() == EAGAIN || get_errno() == EBUSY) {
+                    return;
+                }
+                guarantee_err(get_errno() == EINTR, "io_uring_enter failed");
+                continue;
+            }
+            to_submit -= res;
+        }
+    }
+
+    // Calls `fun` on each completion queue entry currently posted and removes it
+    // from the queue.
+    template <class callable_t>
+    void reap(const callable_t &fun) {
+        unsigned int head = *cq_head;
+        unsigned int tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            fun(cqes[head & cq_mask]);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    fd_t ring_fd;
+
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    io_uring_sqe *sqes;
+    size_t sqes_len;
+
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int *sq_array;
+    // Our copy of the submission queue tail, published by `submit()`.
+    unsigned int local_sq_tail;
+
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int cq_mask;
+    io_uring_cqe *cqes;
+
+    eventfd_event_t completion_event;
+
+private:
+    DISABLE_COPYING(ring_t);
+};
+
+uring_diskmgr_t::ring_t *uring_diskmgr_t::create_ring(int max_concurrent_io_requests) {
+    const int entries = uring_queue_depth(max_concurrent_io_requests)
+        * URING_ENTRIES_PER_ACTION;
+    scoped_ptr_t<ring_t> ring(new ring_t());
+    int errsv = ring->init(entries);
+    if (errsv != 0) {
+        logWRN("Could not set up io_uring for disk I/O (%s), falling back to the "
+               "blocker thread pool.", errno_string(errsv).c_str());
+        return NULL;
+    }
+    return ring.release();
+}
+
+#else  // USE_IO_URING
+
+struct uring_diskmgr_t::ring_t { };
+
+uring_diskmgr_t::ring_t *uring_diskmgr_t::create_ring(UNUSED int max_concurrent_io_requests) {
+    logWRN("This build does not support io_uring, falling back to the blocker "
+           "thread pool for disk I/O.");
+    return NULL;
+}
+
+#endif  // USE_IO_URING
+
+uring_diskmgr_t::uring_diskmgr_t(linux_event_queue_t *_queue,
+                                 passive_producer_t<action_t *> *_source,
+                                 int max_concurrent_io_requests)
+    : queue(_queue),
+      source(_source),
+      ring(create_ring(max_concurrent_io_requests)),
+      queue_depth(ring.has() ? uring_queue_depth(max_concurrent_io_requests) : 0),
+      ops(queue_depth),
+      // Without a ring the pool takes over completely and pulls from `source`
+      // itself, so that it respects the accounting queue's ordering.
+      fallback(queue,
+               ring.has() ? &fallback_queue : source,
+               ring.has() ? 1 : max_concurrent_io_requests) {
+    fallback.done_fun = std::bind(&uring_diskmgr_t::on_fallback_done, this, ph::_1);
+    if (!ring.has()) {
+        return;
+    }
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        free_ops.push_back(&ops[i]);
+    }
+#if USE_IO_URING
+    queue->watch_resource(ring->completion_event.get_notify_fd(), poll_event_in, this);
+#endif
+    if (source->available->get()) { pump(); }
+    source->available->set_callback(this);
+}
+
+uring_diskmgr_t::~uring_diskmgr_t() {
+    assert_thread();
+    if (!ring.has()) {
+        return;
+    }
+
+    source->available->unset_callback();
+    rassert(free_ops.size() == ops.size(),
+            "Destroying uring_diskmgr_t with operations in flight");
+#if USE_IO_URING
+    queue->forget_resource(ring->completion_event.get_notify_fd(), this);
+#endif
+}
+
+void uring_diskmgr_t::on_source_availability_changed() {
+    assert_thread();
+    if (source->available->get()) pump();
+}
+
+#if USE_IO_URING
+
+void uring_diskmgr_t::pump() {
+    assert_thread();
+    bool submitted_any = false;
+    while (source->available->get() && !free_ops.empty()) {
+        action_t *a = source->pop();
+        iovec *vecs;
+        size_t vecs_len;
+        a->get_bufs(&vecs, &vecs_len);
+        if (a->type == action_t::ACTION_RESIZE || vecs_len > IOV_MAX) {
+            fallback_queue.push(a);
+        } else {
+            submit_to_ring(a);
+            submitted_any = true;
+        }
+    }
+    if (submitted_any) {
+        ring->submit();
+    }
+}
+
+void uring_diskmgr_t::submit_to_ring(action_t *a) {
+    op_t *op = free_ops.back();
+    free_ops.pop_back();
+    op->action = a;
+    op->outstanding_entries = 0;
+    op->data_res = 0;
+    op->pre_sync_res = 0;
+    op->post_sync_res = 0;
+
+    // Entries of one action are linked, so that a datasync-wrapped write only starts
+    // once the first datasync is done, and is only followed by the second datasync
+    // if it succeeded.
+    const uintptr_t op_bits = reinterpret_cast<uintptr_t>(op);
+    rassert((op_bits & 3) == 0);
+
+    if (a->wrap_in_datasyncs) {
+        io_uring_sqe *sqe = ring->next_sqe();
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = a->fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = op_bits | static_cast<uintptr_t>(uring_entry_kind_t::pre_sync);
+        ++op->outstanding_entries;
+    }
+
+    {
+        iovec *vecs;
+        size_t vecs_len;
+        a->get_bufs(&vecs, &vecs_len);
+        io_uring_sqe *sqe = ring->next_sqe();
+        sqe->opcode = a->type == action_t::ACTION_READ
+            ? IORING_OP_READV
+            : IORING_OP_WRITEV;
+        sqe->fd = a->fd;
+        sqe->off = a->offset;
+        sqe->addr = reinterpret_cast<uintptr_t>(vecs);
+        sqe->len = vecs_len;
+        sqe->flags = a->wrap_in_datasyncs ? IOSQE_IO_LINK : 0;
+        sqe->user_data = op_bits | static_cast<uintptr_t>(uring_entry_kind_t::data);
+        ++op->outstanding_entries;
+    }
+
+    if (a->wrap_in_datasyncs) {
+        io_uring_sqe *sqe = ring->next_sqe();
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = a->fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = op_bits | static_cast<uintptr_t>(uring_entry_kind_t::post_sync);
+        ++op->outstanding_entries;
+    }
+}
+
+void uring_diskmgr_t::on_event(DEBUG_VAR int events) {
+    assert_thread();
+    rassert(events == poll_event_in);
+    ring->completion_event.consume_wakey_wakeys();
+
+    // Release all completion queue entries before calling anything, since the
+    // `done_fun`s may submit new actions and re-enter `pump()`.
+    std::vector<op_t *> finished;
+    ring->reap([&](const io_uring_cqe &cqe) {
+        op_t *op = reinterpret_cast<op_t *>(cqe.user_data & ~static_cast<uint64_t>(3));
+        switch (static_cast<uring_entry_kind_t>(cqe.user_data & 3)) {
+        case uring_entry_kind_t::data: op->data_res = cqe.res; break;
+        case uring_entry_kind_t::pre_sync: op->pre_sync_res = cqe.res; break;
+        case uring_entry_kind_t::post_sync: op->post_sync_res = cqe.res; break;
+        default: unreachable();
+        }
+        --op->outstanding_entries;
+        rassert(op->outstanding_entries >= 0);
+        if (op->outstanding_entries == 0) {
+            finished.push_back(op);
+        }
+    });
+
+    for (auto it = finished.begin(); it != finished.end(); ++it) {
+        finish_op(*it);
+    }
+    pump();
+    // Submits anything left over from an earlier EAGAIN.
+    ring->submit();
+}
+
+#else  // USE_IO_URING
+
+void uring_diskmgr_t::pump() { unreachable(); }
+void uring_diskmgr_t::submit_to_ring(UNUSED action_t *a) { unreachable(); }
+void uring_diskmgr_t::on_event(UNUSED int events) { unreachable(); }
+
+#endif  // USE_IO_URING
+
+void uring_diskmgr_t::finish_op(op_t *op) {
+    action_t *a = op->action;
+    op->action = NULL;
+    free_ops.push_back(op);
+
+    // This mirrors the error handling in `pool_diskmgr_action_t::run()`.
+    if (op->pre_sync_res < 0) {
+        a->io_result = op->pre_sync_res;
+    } else if (op->data_res < 0) {
+        a->io_result = op->data_res;
+    } else if (op->data_res != static_cast<int64_t>(a->get_count())
+               && a->type == action_t::ACTION_WRITE) {
+        // See the comment in `pool_diskmgr_action_t::run()`.
+        a->io_result = -ENOSPC;
+        logERR("Failed I/O: lensum (%zu) != res (%" PRIi64 ")."
+               " Assuming we ran out of disk space.", a->get_count(), op->data_res);
+    } else if (op->post_sync_res < 0) {
+        a->io_result = op->post_sync_res;
+    } else {
+        a->io_result = op->data_res;
+    }
+    done_fun(a);
+}
+
+void uring_diskmgr_t::on_fallback_done(action_t *a) {
+    done_fun(a);
+}
@@ -0,0 +1,86 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_URING_HPP_
+#define ARCH_IO_DISK_URING_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "arch/runtime/event_queue.hpp"
+#include "arch/io/disk/pool.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "containers/scoped.hpp"
+
+#if defined(__linux) && !defined(NO_IO_URING) && !defined(NO_EVENTFD) && !defined(LEGACY_LINUX)
+#define USE_IO_URING 1
+#else
+#define USE_IO_URING 0
+#endif
+
+/* The io_uring disk manager submits reads, writes and datasyncs directly from the
+event loop thread through a Linux io_uring. Completions are signalled through an
+eventfd that is registered with the ring and watched by the event queue, so unlike
+`pool_diskmgr_t` an operation never has to be handed to another thread and back.
+
+It consumes the same `pool_diskmgr_action_t`s as `pool_diskmgr_t` does, so it sits
+under the accounting and conflict resolving layers in exactly the same way.
+Operations that io_uring cannot express (resizes, and writevs with more than
+IOV_MAX buffers) are passed on to a small internal `pool_diskmgr_t`. If the kernel
+refuses to create a ring (too old, or io_uring is disabled), every operation goes
+to that pool instead, and it is sized like a regular `pool_diskmgr_t`. */
+
+class uring_diskmgr_t : private availability_callback_t,
+                        private linux_event_callback_t,
+                        public home_thread_mixin_debug_only_t {
+public:
+    typedef pool_diskmgr_action_t action_t;
+
+    /* The `uring_diskmgr_t` will draw actions to run from `source`. It will call
+    `done_fun` on each one when it's done. */
+    uring_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
+                    int max_concurrent_io_requests);
+    std::function<void(action_t *)> done_fun;
+    ~uring_diskmgr_t();
+
+    // False if we could not set up a ring and are running everything in the pool.
+    bool is_using_ring() const { return ring.has(); }
+
+private:
+    struct ring_t;
+
+    // The state of one action while its submission queue entries are in flight.
+    // A datasync-wrapped write uses three linked entries, everything else one.
+    struct op_t {
+        action_t *action;
+        int outstanding_entries;
+        int64_t data_res;
+        int pre_sync_res;
+        int post_sync_res;
+    };
+
+    static ring_t *create_ring(int max_concurrent_io_requests);
+
+    void on_source_availability_changed();
+    void on_event(int events);
+
+    void pump();
+    void submit_to_ring(action_t *a);
+    void finish_op(op_t *op);
+    void on_fallback_done(action_t *a);
+
+    linux_event_queue_t *const queue;
+    passive_producer_t<action_t *> *const source;
+
+    // Empty if the ring could not be created.
+    scoped_ptr_t<ring_t> ring;
+    const int queue_depth;
+    std::vector<op_t> ops;
+    std::vector<op_t *> free_ops;
+
+    unlimited_fifo_queue_t<action_t *> fallback_queue;
+    pool_diskmgr_t fallback;
+
+    DISABLE_COPYING(uring_diskmgr_t);
+};
+
+#endif /* ARCH_IO_DISK_URING_HPP_ */
@@ -4,6 +4,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
@@ -11,6 +12,9 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
 
 #include "utils.hpp"
 #include <boost/bind.hpp>
@@ -337,7 +341,9 @@ linux_tcp_conn_t::write_handler_t::write_handler_t(linux_tcp_conn_t *_parent) :
 { }
 
 void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *operation, UNUSED signal_t *interruptor) {
-    if (operation->buffer != NULL) {
+    if (operation->iov != NULL) {
+        parent->perform_writev(operation->iov, operation->iovcnt);
+    } else if (operation->buffer != NULL) {
         parent->perform_write(operation->buffer, operation->size);
         if (operation->dealloc != NULL) {
             parent->release_write_buffer(operation->dealloc);
@@ -363,6 +369,7 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
     op->buffer = current_write_buffer->buffer;
     op->size = current_write_buffer->size;
     op->dealloc = current_write_buffer.release();
+    op->iov = NULL;
     op->cond = NULL;
     op->keepalive = auto_drainer_t::lock_t(drainer.get());
     current_write_buffer.init(get_write_buffer());
@@ -377,6 +384,13 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
 }
 
 void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
+    iovec iov;
+    iov.iov_base = const_cast<void *>(buf);
+    iov.iov_len = size;
+    perform_writev(&iov, 1);
+}
+
+void linux_tcp_conn_t::perform_writev(const iovec *iov_in, size_t iovcnt) {
     assert_thread();
 
     if (write_closed.is_pulsed()) {
@@ -386,8 +400,17 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         return;
     }
 
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    /* `::writev()` may write only part of the data, so we keep track of what's left
+    in our own copy of the `iovec`s. */
+    std::vector<iovec> iov(iov_in, iov_in + iovcnt);
+    size_t first = 0;
+    while (first < iov.size() && iov[first].iov_len == 0) {
+        ++first;
+    }
+
+    while (first < iov.size()) {
+        ssize_t res = ::writev(sock.get(), iov.data() + first,
+                               std::min<size_t>(iov.size() - first, IOV_MAX));
 
         if (res == -1 && (get_errno() == EAGAIN || get_errno() == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
@@ -425,10 +448,17 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) write_perfmon->record(res);
+            size_t written = res;
+            while (first < iov.size() && written >= iov[first].iov_len) {
+                written -= iov[first].iov_len;
+                ++first;
+            }
+            if (written > 0) {
+                rassert(first < iov.size());
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
         }
     }
 }
@@ -448,6 +478,7 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     /* Enqueue the write so it will happen eventually */
     op.buffer = buf;
     op.size = size;
+    op.iov = NULL;
     op.dealloc = NULL;
     op.cond = &to_signal_when_done;
     write_queue.push(&op);
@@ -460,6 +491,30 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
 }
 
+void linux_tcp_conn_t::writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    write_op_wrapper_t sentry(this, closer);
+
+    write_queue_op_t op;
+    cond_t to_signal_when_done;
+
+    /* Flush out any data that's been buffered, so that things don't get out of order */
+    if (current_write_buffer->size > 0) internal_flush_write_buffer();
+
+    /* As in `write()`, we don't acquire the write semaphore because we block until
+    the write is done. */
+    op.buffer = NULL;
+    op.size = 0;
+    op.iov = iov;
+    op.iovcnt = iovcnt;
+    op.dealloc = NULL;
+    op.cond = &to_signal_when_done;
+    write_queue.push(&op);
+
+    to_signal_when_done.wait();
+
+    if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
+}
+
 void linux_tcp_conn_t::write_buffered(const void *vbuf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
 
@@ -507,6 +562,7 @@ void linux_tcp_conn_t::flush_buffer(signal_t *closer) THROWS_ONLY(tcp_conn_write
     write_queue_op_t op;
     cond_t to_signal_when_done;
     op.buffer = NULL;
+    op.iov = NULL;
     op.dealloc = NULL;
     op.cond = &to_signal_when_done;
     write_queue.push(&op);
@@ -8,6 +8,7 @@
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 
 #include <functional>
 #include <set>
@@ -105,6 +106,10 @@ public:
     pipe and throws `tcp_conn_write_closed_exc_t`. */
     void write(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* writev() is like write(), but gathers the data from `iovcnt` buffers, which
+    saves copying them into one place first. */
+    void writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     /* write_buffered() is like write(), but it might not send the data until
     flush_buffer*() or write() is called. Internally, it bundles together the
     buffered writes; this may improve performance. */
@@ -244,6 +249,9 @@ private:
         write_buffer_t *dealloc;
         const void *buffer;
         size_t size;
+        // If `iov` isn't NULL, the op writes these buffers instead of `buffer`.
+        const iovec *iov;
+        size_t iovcnt;
         cond_t *cond;
         auto_drainer_t::lock_t keepalive;
     };
@@ -301,6 +309,7 @@ private:
     /* Used to actually perform a write. If the write end of the connection is open, then writes
     `size` bytes from `buffer` to the socket. */
     void perform_write(const void *buffer, size_t size);
+    void perform_writev(const iovec *iov, size_t iovcnt);
 
     scoped_ptr_t<auto_drainer_t> drainer;
 };
@@ -21,6 +21,8 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
     : queue_(queue),
       thread_pool_(thread_pool),
       is_woken_up_(false),
+      incoming_tail_(&incoming_stub_),
+      incoming_head_(&incoming_stub_),
       current_thread_(current_thread) {
 
 #ifndef NDEBUG
@@ -35,7 +37,7 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
 
 linux_message_hub_t::~linux_message_hub_t() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
-        guarantee(queues_[i].msg_local_list.empty());
+        guarantee(queues_[i].local_head == NULL);
     }
     for (int p = MESSAGE_SCHEDULER_MIN_PRIORITY;
          p <= MESSAGE_SCHEDULER_MAX_PRIORITY;
@@ -44,12 +46,20 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(get_priority_msg_list(p).empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(!incoming_might_be_nonempty());
 }
 
 void linux_message_hub_t::do_store_message(threadnum_t nthread, linux_thread_message_t *msg) {
     rassert(0 <= nthread.threadnum && nthread.threadnum < thread_pool_->n_threads);
-    queues_[nthread.threadnum].msg_local_list.push_back(msg);
+    rassert(msg->hub_next_ == NULL);
+    rassert(!msg->in_a_list());
+    thread_queue_t *queue = &queues_[nthread.threadnum];
+    if (queue->local_tail == NULL) {
+        queue->local_head = msg;
+    } else {
+        queue->local_tail->hub_next_ = msg;
+    }
+    queue->local_tail = msg;
 }
 
 // Collects a message for a given thread onto a local list.
@@ -91,19 +101,65 @@ void linux_message_hub_t::store_message_sometime(threadnum_t nthread, linux_thre
 
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    bool do_wake_up;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        do_wake_up = !check_and_set_is_woken_up();
-        incoming_messages_.push_back(msg);
-    }
+    rassert(msg->hub_next_ == NULL);
+    push_incoming(msg, msg);
 
     // Wakey wakey eggs and bakey
-    if (do_wake_up) {
+    if (!check_and_set_is_woken_up()) {
         event_.wakey_wakey();
     }
 }
 
+void linux_message_hub_t::push_incoming(linux_thread_message_t *first,
+                                        linux_thread_message_t *last) {
+    // `last->hub_next_` is NULL except when we re-push the stub.
+    __atomic_store_n(&last->hub_next_, static_cast<linux_thread_message_t *>(NULL),
+                     __ATOMIC_RELAXED);
+    linux_thread_message_t *prev =
+        __atomic_exchange_n(&incoming_tail_, last, __ATOMIC_ACQ_REL);
+    // Until this store the consumer can't see past `prev`, which is why
+    // `pop_incoming()` can return NULL on a non-empty queue.
+    __atomic_store_n(&prev->hub_next_, first, __ATOMIC_RELEASE);
+}
+
+linux_thread_message_t *linux_message_hub_t::pop_incoming() {
+    linux_thread_message_t *head = incoming_head_;
+    linux_thread_message_t *next = __atomic_load_n(&head->hub_next_, __ATOMIC_ACQUIRE);
+    if (head == &incoming_stub_) {
+        if (next == NULL) {
+            return NULL;
+        }
+        incoming_head_ = next;
+        head = next;
+        next = __atomic_load_n(&head->hub_next_, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        incoming_head_ = next;
+        head->hub_next_ = NULL;
+        return head;
+    }
+    // `head` is the last message we can see.  We can only hand it out if it's also
+    // the tail, after putting the stub back behind it so that the queue never
+    // becomes empty.
+    if (head != __atomic_load_n(&incoming_tail_, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    push_incoming(&incoming_stub_, &incoming_stub_);
+    next = __atomic_load_n(&head->hub_next_, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        incoming_head_ = next;
+        head->hub_next_ = NULL;
+        return head;
+    }
+    return NULL;
+}
+
+bool linux_message_hub_t::incoming_might_be_nonempty() {
+    return incoming_head_ != &incoming_stub_
+        || __atomic_load_n(&incoming_stub_.hub_next_, __ATOMIC_ACQUIRE) != NULL
+        || __atomic_load_n(&incoming_tail_, __ATOMIC_ACQUIRE) != &incoming_stub_;
+}
+
 linux_message_hub_t::msg_list_t &linux_message_hub_t::get_priority_msg_list(int priority) {
     rassert(priority >= MESSAGE_SCHEDULER_MIN_PRIORITY);
     rassert(priority <= MESSAGE_SCHEDULER_MAX_PRIORITY);
@@ -168,43 +224,32 @@ void linux_message_hub_t::on_event(int events) {
         }
     }
 
-    // We might have left some messages unprocessed.
-    // Check if that is the case, and if yes, make sure we are called again.
-    for (int i = 0; i < NUM_SCHEDULER_PRIORITIES; ++i) {
-        if (!priority_msg_lists_[i].empty()) {
-            // Place wakey_wakey and then yield to the event processing.
-            // It will wake us up again immediately, but can handle a few
-            // OS events (such as timers, network messages etc.) in the meantime.
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&incoming_messages_lock_);
-                do_wake_up = !check_and_set_is_woken_up();
-            }
-            if (do_wake_up) {
-                event_.wakey_wakey();
-            }
-            break;
+    // Other threads haven't been waking us up while we were busy, so now that we
+    // stop counting as woken up we have to check for messages they pushed in the
+    // meantime.  We might also have left some messages unprocessed.  If either is
+    // the case, make sure we are called again.  (The exchange synchronizes with
+    // the exchanges in `check_and_set_is_woken_up()`, so we see every message
+    // pushed by a thread that didn't wake us up.)
+    UNUSED bool was_woken_up =
+        __atomic_exchange_n(&is_woken_up_, false, __ATOMIC_SEQ_CST);
+    bool more_to_do = incoming_might_be_nonempty();
+    for (int i = 0; i < NUM_SCHEDULER_PRIORITIES && !more_to_do; ++i) {
+        more_to_do = !priority_msg_lists_[i].empty();
+    }
+    if (more_to_do) {
+        // Place wakey_wakey and then yield to the event processing.
+        // It will wake us up again immediately, but can handle a few
+        // OS events (such as timers, network messages etc.) in the meantime.
+        if (!check_and_set_is_woken_up()) {
+            event_.wakey_wakey();
         }
     }
 }
 
 void linux_message_hub_t::sort_incoming_messages_by_priority() {
-    // We do this in two steps to release the spinlock faster.
-    // append_and_clear is a very cheap operation, while
-    // assigning each message to a different priority queue
-    // is more expensive.
-
-    // 1. Pull the messages
-    msg_list_t new_messages;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        new_messages.append_and_clear(&incoming_messages_);
-        is_woken_up_ = false;
-    }
-
-    // 2. Sort the messages into their respective priority queues
-    while (linux_thread_message_t *m = new_messages.head()) {
-        new_messages.remove(m);
+    // We stay marked as woken up until the end of `on_event()`, so nobody wakes us
+    // up for the messages that arrive while we're doing this.
+    while (linux_thread_message_t *m = pop_incoming()) {
         int effective_priority = m->priority;
         if (m->is_ordered) {
             // Ordered messages are treated as if they had
@@ -219,36 +264,27 @@ void linux_message_hub_t::sort_incoming_messages_by_priority() {
 }
 
 bool linux_message_hub_t::check_and_set_is_woken_up() {
-    const bool was_woken_up = is_woken_up_;
-    is_woken_up_ = true;
-    return was_woken_up;
+    return __atomic_exchange_n(&is_woken_up_, true, __ATOMIC_SEQ_CST);
 }
 
 // Pushes messages collected locally global lists available to all
 // threads.
 void linux_message_hub_t::push_messages() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Append the local list for ith thread to that thread's global
-        // message list.
+        // Append the local list for ith thread to that thread's incoming
+        // queue.
         thread_queue_t *queue = &queues_[i];
-        if (!queue->msg_local_list.empty()) {
+        if (queue->local_head != NULL) {
             // Transfer messages to the other core
-
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                // We only need to do a wake up if we're the first people to do a
-                // wake up.
-                do_wake_up =
-                    !thread_pool_->threads[i]->message_hub.check_and_set_is_woken_up();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
-
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.event_.wakey_wakey();
+            linux_message_hub_t *target = &thread_pool_->threads[i]->message_hub;
+            target->push_incoming(queue->local_head, queue->local_tail);
+            queue->local_head = NULL;
+            queue->local_tail = NULL;
+
+            // We only need to do a wake up if we're the first people to do a
+            // wake up.  Wakey wakey, perhaps eggs and bakey
+            if (!target->check_and_set_is_woken_up()) {
+                target->event_.wakey_wakey();
             }
         }
     }
@@ -8,7 +8,6 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
-#include "arch/spinlock.hpp"
 #include "config/args.hpp"
 #include "containers/intrusive_list.hpp"
 #include "threading.hpp"
@@ -24,7 +23,14 @@ class linux_thread_pool_t;
 /* There is one message hub per thread, NOT one message hub for the entire program.
 
 Each message hub stores messages that are going from that message hub's home thread to
-other threads. It keeps a separate queue for messages destined for each other thread. */
+other threads. It keeps a separate queue for messages destined for each other thread.
+
+Messages arriving from other threads go through a lock-free intrusive multi-producer,
+single-consumer queue (Dmitry Vyukov's design): a sending thread appends its whole
+batch for us with a single atomic exchange, and only our own thread ever pops.  The
+eventfd is only written to by the sender that finds us not already woken up, and we
+don't count as woken down again until we're done with the batch we're processing, so
+a busy thread doesn't get a syscall per incoming batch. */
 
 class linux_message_hub_t : private linux_event_callback_t {
 public:
@@ -56,7 +62,7 @@ private:
     // debug mode.
     void do_store_message(threadnum_t nthread, linux_thread_message_t *msg);
 
-    // Moves messages from incoming_messages_ into the respective entries of
+    // Moves messages from the incoming queue into the respective entries of
     // priority_msg_lists, depending on the messages' priorities.
     void sort_incoming_messages_by_priority();
 
@@ -67,18 +73,38 @@ private:
 
     /* Queue for messages going from this->current_thread to other threads */
     struct thread_queue_t {
-        //TODO this doesn't need to be a class anymore
+        thread_queue_t() : local_head(NULL), local_tail(NULL) { }
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
-        msg_list_t msg_local_list;
+        /* Messages are cached here, linked through `hub_next_`, before being pushed
+        to the other thread's incoming queue so that we only do one atomic exchange
+        per batch */
+        linux_thread_message_t *local_head;
+        linux_thread_message_t *local_tail;
     } queues_[MAX_THREADS];
 
-    // Must only be used with acquired incoming_messages_lock_
+    // Appends the chain `first`..`last` (linked through `hub_next_`) to
+    // our incoming queue.  Can be called from any thread.
+    void push_incoming(linux_thread_message_t *first, linux_thread_message_t *last);
+    // Pops the oldest message off our incoming queue.  Returns NULL if there is none,
+    // or if the next one is still being pushed by another thread (that thread will
+    // wake us up when it's done).  Must only be called on our own thread.
+    linux_thread_message_t *pop_incoming();
+    bool incoming_might_be_nonempty();
+
+    // Returns whether we had already been woken up.  Can be called from any thread.
     bool check_and_set_is_woken_up();
-    bool is_woken_up_;
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+    bool is_woken_up_;  // Only accessed atomically.
+
+    // Vyukov's queue needs a node of its own that stays in it when it's empty.
+    class stub_message_t : public linux_thread_message_t {
+    public:
+        void on_thread_switch() { unreachable(); }
+    };
+    stub_message_t incoming_stub_;
+    // Producers exchange themselves onto the tail; only accessed atomically.
+    linux_thread_message_t *incoming_tail_;
+    // Only accessed by our own thread.
+    linux_thread_message_t *incoming_head_;
 
     // Use `sort_incoming_messages_by_priority()` to sort incoming_messages_ into
     // these lists.
@@ -91,7 +117,7 @@ private:
     void on_event(int events);
 
     // The eventfd (or pipe-based alternative) notified after the first incoming
-    // message is put onto incoming_messages_.
+    // message is put onto our incoming queue.
     system_event_t event_;
 
     /* The thread that we queue messages originating from. (Recall that there is one
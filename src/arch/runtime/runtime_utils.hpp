@@ -15,14 +15,16 @@ class linux_thread_message_t : public intrusive_list_node_t<linux_thread_message
 public:
     explicit linux_thread_message_t(int _priority)
         : priority(_priority),
-        is_ordered(false)
+        is_ordered(false),
+        hub_next_(NULL)
 #ifndef NDEBUG
         , reloop_count_(0)
 #endif
         { }
     linux_thread_message_t()
         : priority(MESSAGE_SCHEDULER_DEFAULT_PRIORITY),
-        is_ordered(false)
+        is_ordered(false),
+        hub_next_(NULL)
 #ifndef NDEBUG
         , reloop_count_(0)
 #endif
@@ -37,6 +39,9 @@ private:
     friend class linux_message_hub_t;
     int priority;
     bool is_ordered; // Used internally by the message hub
+    // Links the message into the message hub's singly-linked queues while it's in
+    // transit between threads (the intrusive list node is used once it's arrived).
+    linux_thread_message_t *hub_next_;
 #ifndef NDEBUG
     int reloop_count_;
 #endif
@@ -12,6 +12,7 @@
 #include "arch/runtime/system_event.hpp"
 #include "arch/runtime/message_hub.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/spinlock.hpp"
 #include "arch/io/blocker_pool.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/timer.hpp"
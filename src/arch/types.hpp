@@ -101,6 +101,13 @@ enum class file_direct_io_mode_t {
     buffered_desired
 };
 
+// Which disk manager actually runs the I/O operations.  `io_uring` falls back to
+// `blocker_pool` at runtime if the kernel doesn't support it.
+enum class file_io_backend_t {
+    blocker_pool,
+    io_uring
+};
+
 
 
 class semantic_checking_file_t {
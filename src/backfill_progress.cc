@@ -56,3 +56,52 @@ progress_completion_fraction_t traversal_progress_combiner_t::guess_completion()
 
     return progress_completion_fraction_t(released, total);
 }
+
+sequential_traversal_progress_t::sequential_traversal_progress_t(int _num_parts)
+    : num_parts(_num_parts), parts_done(0), nodes_done(0), current_part(NULL) {
+    guarantee(num_parts > 0);
+}
+
+sequential_traversal_progress_t::~sequential_traversal_progress_t() {
+    delete current_part;
+}
+
+void sequential_traversal_progress_t::start_part(
+        scoped_ptr_t<traversal_progress_t> *part) {
+    assert_thread();
+    if (current_part != NULL) {
+        progress_completion_fraction_t fraction = current_part->guess_completion();
+        if (!fraction.invalid()) {
+            nodes_done += fraction.estimate_of_total_nodes;
+        }
+        delete current_part;
+        ++parts_done;
+    }
+    guarantee(parts_done < num_parts);
+    current_part = part->release();
+    current_part->assert_thread();
+}
+
+progress_completion_fraction_t
+sequential_traversal_progress_t::guess_completion() const {
+    assert_thread();
+
+    progress_completion_fraction_t current(0, 0);
+    int known_parts = parts_done;
+    if (current_part != NULL) {
+        progress_completion_fraction_t fraction = current_part->guess_completion();
+        if (!fraction.invalid()) {
+            current = fraction;
+            ++known_parts;
+        }
+    }
+    if (known_parts == 0) {
+        return progress_completion_fraction_t();
+    }
+
+    const int64_t known_nodes = nodes_done + current.estimate_of_total_nodes;
+    const int64_t total =
+        known_nodes + (num_parts - known_parts) * known_nodes / known_parts;
+    return progress_completion_fraction_t(
+        nodes_done + current.estimate_of_released_nodes, total);
+}
@@ -64,4 +64,29 @@ private:
 
     DISABLE_COPYING(traversal_progress_combiner_t);
 };
+
+/* Reports the progress of a traversal that is done in `num_parts` consecutive parts,
+such as a backfill that checkpoints after each slice of keys.  Parts that haven't
+started yet are guessed to be as large as the average of the ones we know about. */
+class sequential_traversal_progress_t : public traversal_progress_t {
+public:
+    explicit sequential_traversal_progress_t(int num_parts);
+    ~sequential_traversal_progress_t();
+
+    // Ends the current part, if any, and starts the next one.  `part` must have the
+    // same home thread as this.
+    void start_part(scoped_ptr_t<traversal_progress_t> *part);
+    progress_completion_fraction_t guess_completion() const;
+
+private:
+    const int num_parts;
+
+    // How many parts ended, and their total number of nodes.
+    int parts_done;
+    int64_t nodes_done;
+
+    traversal_progress_t *current_part;
+
+    DISABLE_COPYING(sequential_traversal_progress_t);
+};
 #endif  // BACKFILL_PROGRESS_HPP_
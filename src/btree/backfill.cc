@@ -19,7 +19,7 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
                         int * /*population_change_out*/)
         THROWS_ONLY(interrupted_exc_t) {
         assert_thread();
-        buf_read_t read(leaf_node_buf);
+        buf_read_t read(leaf_node_buf, alt_access_hint_t::no_promote);
         const leaf_node_t *data = static_cast<const leaf_node_t *>(read.get_data_read());
 
         key_range_t clipped_range(
@@ -29,10 +29,15 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
             right_inclusive_or_null ? store_key_t(right_inclusive_or_null) : store_key_t());
         clipped_range = clipped_range.intersection(key_range_);
 
+        /* If the leaf has lost deletions that the backfillee might not have seen,
+        it has to replace its copy of `range` wholesale.  We send the whole leaf as
+        one image for that, rather than a `on_delete_range()` followed by the
+        pairs, so that the backfillee can load it in bulk. */
         struct our_cb_t : public leaf::entry_reception_callback_t {
-            explicit our_cb_t(buf_parent_t _parent) : parent(_parent) { }
+            explicit our_cb_t(buf_parent_t _parent)
+                : parent(_parent), lost_deletions_seen(false), image_sent(false) { }
             void lost_deletions() {
-                cb->on_delete_range(range, interruptor);
+                lost_deletions_seen = true;
             }
 
             void deletion(const btree_key_t *k, repli_timestamp_t tstamp) {
@@ -61,16 +66,47 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
                     }
                 }
 
-                if (!filtered_keys.empty()) {
+                if (lost_deletions_seen) {
+                    send_image(filtered_tstamps, filtered_keys, filtered_values);
+                } else if (!filtered_keys.empty()) {
                     cb->on_pairs(parent, filtered_tstamps, filtered_keys,
                                  filtered_values, interruptor);
                 }
             }
 
+            void send_image(const std::vector<repli_timestamp_t> &tstamps,
+                            const std::vector<const btree_key_t *> &keys,
+                            const std::vector<const void *> &values) {
+                // The entries come in timestamp order.
+                std::vector<size_t> order(keys.size());
+                for (size_t i = 0; i < order.size(); ++i) {
+                    order[i] = i;
+                }
+                std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                    return btree_key_cmp(keys[a], keys[b]) < 0;
+                });
+                std::vector<const btree_key_t *> sorted_keys;
+                std::vector<const void *> sorted_values;
+                std::vector<repli_timestamp_t> sorted_tstamps;
+                sorted_keys.reserve(order.size());
+                sorted_values.reserve(order.size());
+                sorted_tstamps.reserve(order.size());
+                for (auto it = order.begin(); it != order.end(); ++it) {
+                    sorted_keys.push_back(keys[*it]);
+                    sorted_values.push_back(values[*it]);
+                    sorted_tstamps.push_back(tstamps[*it]);
+                }
+                cb->on_leaf_image(parent, range, sorted_tstamps, sorted_keys,
+                                  sorted_values, interruptor);
+                image_sent = true;
+            }
+
             agnostic_backfill_callback_t *cb;
             buf_parent_t parent;
             key_range_t range;
             signal_t *interruptor;
+            bool lost_deletions_seen;
+            bool image_sent;
         };
 
         our_cb_t x((buf_parent_t(leaf_node_buf)));
@@ -79,6 +115,12 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         x.interruptor = interruptor;
 
         leaf::dump_entries_since_time(sizer_, data, since_when_, leaf_node_buf->get_recency(), &x);
+        if (x.lost_deletions_seen && !x.image_sent) {
+            // The leaf has no live entries in `range`.
+            x.send_image(std::vector<repli_timestamp_t>(),
+                         std::vector<const btree_key_t *>(),
+                         std::vector<const void *>());
+        }
     }
 
     void postprocess_internal_node(UNUSED buf_lock_t *internal_node_buf) {
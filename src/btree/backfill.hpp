@@ -10,9 +10,9 @@
 #include "containers/uuid.hpp"
 #include "concurrency/interruptor.hpp"
 
-// Implementations of agnostic_backfill_callback_t::on_pairs() should use
-// this limit to split up large chunks of key/value pairs into smaller chunks,
-// each not too much larger than this value.
+// Implementations of agnostic_backfill_callback_t::on_pairs() and on_leaf_image()
+// should use this limit to split up large chunks of key/value pairs into smaller
+// chunks, each not too much larger than this value.
 #define BACKFILL_MAX_KVPAIRS_SIZE (1024 * 64)
 
 class buf_parent_t;
@@ -36,6 +36,15 @@ public:
                           const std::vector<const btree_key_t *> &keys,
                           const std::vector<const void *> &values,
                           signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    // Called instead of `on_delete_range()` and `on_pairs()` for a leaf whose
+    // deletion history doesn't reach back to `since_when`, with all of the live
+    // entries of the leaf that lie in `range`, sorted by key.
+    virtual void on_leaf_image(buf_parent_t leaf_node,
+                               const key_range_t &range,
+                               const std::vector<repli_timestamp_t> &recencies,
+                               const std::vector<const btree_key_t *> &keys,
+                               const std::vector<const void *> &values,
+                               signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual ~agnostic_backfill_callback_t() { }
 };
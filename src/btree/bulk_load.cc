@@ -0,0 +1,188 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/bulk_load.hpp"
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+
+// Locks the right edge of the tree under `path->back()` with `access`, pushing the
+// locks onto `path`, and returns whether the tree has any keys.  If it does, sets
+// `*last_key_out` to the greatest one.
+static bool lock_right_edge(access_t access, std::vector<buf_lock_t> *path,
+                            store_key_t *last_key_out) {
+    for (;;) {
+        block_id_t child_id;
+        {
+            buf_read_t read(&path->back());
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            if (node::is_leaf(node)) {
+                const leaf_node_t *leaf = reinterpret_cast<const leaf_node_t *>(node);
+                auto it = leaf::rbegin(*leaf);
+                if (it == leaf::rend(*leaf)) {
+                    return false;
+                }
+                last_key_out->assign((*it).first);
+                return true;
+            }
+            const internal_node_t *internal
+                = reinterpret_cast<const internal_node_t *>(node);
+            child_id = internal_node::get_pair_by_index(internal,
+                                                        internal->npairs - 1)->lnode;
+        }
+        buf_lock_t child(&path->back(), child_id, access);
+        path->push_back(std::move(child));
+    }
+}
+
+bool can_append_to_btree(superblock_t *superblock, const btree_key_t *key) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID) {
+        return true;
+    }
+    std::vector<buf_lock_t> path;
+    path.push_back(buf_lock_t(superblock->expose_buf(), root_id, access_t::read));
+    store_key_t last_key;
+    return !lock_right_edge(access_t::read, &path, &last_key)
+        || btree_key_cmp(last_key.btree_key(), key) < 0;
+}
+
+btree_appender_t::btree_appender_t(value_sizer_t *sizer,
+                                   superblock_t *superblock)
+    : sizer_(sizer),
+      superblock_(superblock),
+      num_appended_(0) {
+    path_.push_back(get_root(sizer_, superblock_));
+    has_last_key_ = lock_right_edge(access_t::write, &path_, &last_key_);
+}
+
+btree_appender_t::~btree_appender_t() {
+    if (path_.size() > 1) {
+        update_child_count(node_at_height(0), node_at_height(1));
+    }
+
+    // See `apply_keyvalue_change()`.
+    const block_id_t stat_block_id = superblock_->get_stat_block_id();
+    if (num_appended_ != 0 && stat_block_id != NULL_BLOCK_ID) {
+        buf_lock_t stat_block(buf_parent_t(path_.back().txn()),
+                              stat_block_id, access_t::write);
+        buf_write_t stat_block_write(&stat_block);
+        auto stat_block_buf = static_cast<btree_statblock_t *>(
+                stat_block_write.get_data_write(BTREE_STATBLOCK_SIZE));
+        stat_block_buf->population += num_appended_;
+    }
+}
+
+bool btree_appender_t::can_append(const btree_key_t *key) const {
+    return !has_last_key_ || btree_key_cmp(last_key_.btree_key(), key) < 0;
+}
+
+buf_parent_t btree_appender_t::rightmost_leaf() {
+    return buf_parent_t(node_at_height(0));
+}
+
+bool btree_appender_t::fits(const btree_key_t *key, const void *value) {
+    buf_read_t read(node_at_height(0));
+    return !leaf::is_full(
+        sizer_, static_cast<const leaf_node_t *>(read.get_data_read()), key, value);
+}
+
+void btree_appender_t::start_new_leaf() {
+    // The leaf is full, so it isn't empty, and `last_key_` is its greatest key.
+    guarantee(has_last_key_);
+    add_right_sibling(0, last_key_.btree_key());
+}
+
+void btree_appender_t::append(const btree_key_t *key, const void *value,
+                              repli_timestamp_t timestamp) {
+    guarantee(can_append(key),
+              "Keys appended to a btree must be in increasing order.");
+
+    if (!fits(key, value)) {
+        start_new_leaf();
+    }
+
+    {
+        buf_write_t write(node_at_height(0));
+        leaf::insert(sizer_, static_cast<leaf_node_t *>(write.get_data_write()),
+                     key, value, timestamp, key_modification_proof_t::real_proof());
+    }
+    last_key_.assign(key);
+    has_last_key_ = true;
+    ++num_appended_;
+}
+
+void btree_appender_t::add_right_sibling(size_t height,
+                                         const btree_key_t *separator) {
+    const block_size_t block_size = sizer_->block_size();
+
+    if (height + 1 == path_.size()) {
+        // The node is the root, so the tree grows by a level.  The new root is
+        // empty until we insert the node and its sibling into it below.
+        buf_lock_t *old_root = node_at_height(height);
+        superblock_->expose_buf().detach_child(old_root->block_id());
+        buf_lock_t root(superblock_->expose_buf(), alt_create_t::create);
+        {
+            buf_write_t write(&root);
+            internal_node::init(block_size,
+                                static_cast<internal_node_t *>(write.get_data_write()));
+        }
+        root.manually_touch_recency(old_root->get_recency());
+        superblock_->set_root_block_id(root.block_id());
+        path_.insert(path_.begin(), std::move(root));
+    }
+
+    bool parent_is_full;
+    {
+        buf_read_t read(node_at_height(height + 1));
+        parent_is_full = internal_node::is_full(
+            static_cast<const internal_node_t *>(read.get_data_read()));
+    }
+    if (parent_is_full) {
+        // Rather than splitting the parent, we move the node into a new sibling of
+        // the parent, so that the parent stays packed too.
+        buf_lock_t *parent = node_at_height(height + 1);
+        store_key_t parent_separator;
+        {
+            buf_write_t write(parent);
+            internal_node_t *node
+                = static_cast<internal_node_t *>(write.get_data_write());
+            parent_separator.assign(
+                &internal_node::get_pair_by_index(node, node->npairs - 2)->key);
+            internal_node::remove(block_size, node, separator);
+        }
+        parent->detach_child(node_at_height(height)->block_id());
+        add_right_sibling(height + 1, parent_separator.btree_key());
+    }
+
+    buf_lock_t *parent = node_at_height(height + 1);
+    buf_lock_t *node = node_at_height(height);
+    buf_lock_t sibling(parent, alt_create_t::create);
+    {
+        buf_write_t write(&sibling);
+        if (height == 0) {
+            leaf::init(sizer_, static_cast<leaf_node_t *>(write.get_data_write()));
+        } else {
+            // The caller fills it in right away.
+            internal_node::init(block_size,
+                                static_cast<internal_node_t *>(write.get_data_write()));
+        }
+    }
+    sibling.manually_touch_recency(node->get_recency());
+    {
+        buf_write_t write(parent);
+        internal_node_t *parent_node
+            = static_cast<internal_node_t *>(write.get_data_write());
+        DEBUG_VAR bool success
+            = internal_node::insert(block_size, parent_node, separator,
+                                    node->block_id(), sibling.block_id());
+        rassert(success, "could not insert internal btree node");
+    }
+    update_child_count(node, parent);
+    *node = std::move(sibling);
+}
+
+buf_lock_t *btree_appender_t::node_at_height(size_t height) {
+    rassert(height < path_.size());
+    return &path_[path_.size() - 1 - height];
+}
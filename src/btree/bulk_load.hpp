@@ -0,0 +1,76 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_BULK_LOAD_HPP_
+#define BTREE_BULK_LOAD_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/alt/alt.hpp"
+#include "repli_timestamp.hpp"
+
+class superblock_t;
+class value_sizer_t;
+
+/* `btree_appender_t` builds a btree bottom-up from keys that arrive in sorted
+order, all of them greater than every key already in the tree.  Inserting such keys
+one at a time re-descends from the superblock for every key and splits each leaf in
+half when it fills up, so the tree ends up half empty.  The appender instead keeps
+the right edge of the tree write-locked, fills the rightmost leaf completely, and
+then starts a new leaf to its right; internal nodes are filled the same way.
+
+The tree is valid between any two calls to `append()`, so a large load can be split
+across several transactions by using one appender per transaction. */
+class btree_appender_t {
+public:
+    // `superblock` must be write-locked, and stay locked for as long as the appender
+    // exists.  Creates a root leaf if the tree is empty.
+    btree_appender_t(value_sizer_t *sizer, superblock_t *superblock);
+    // Records the key count of the last leaf in its parent and updates the
+    // population in the stat block.
+    ~btree_appender_t();
+
+    // Whether `key` is greater than every key in the tree.
+    bool can_append(const btree_key_t *key) const;
+
+    // The leaf that `append()` adds to, unless the key and value don't fit in it.
+    // Values with blocks of their own must create them as its children; if the
+    // value then doesn't fit, create it again under the leaf `start_new_leaf()`
+    // makes.
+    buf_parent_t rightmost_leaf();
+    bool fits(const btree_key_t *key, const void *value);
+    void start_new_leaf();
+
+    // `key` must be greater than every key in the tree.  Starts a new leaf if `key`
+    // and `value` don't fit in the rightmost one.
+    void append(const btree_key_t *key, const void *value,
+                repli_timestamp_t timestamp);
+
+private:
+    // Starts a new node to the right of the node on the right edge at `height`
+    // (leaves are at height zero), all of whose keys are at most `separator`.
+    void add_right_sibling(size_t height, const btree_key_t *separator);
+    buf_lock_t *node_at_height(size_t height);
+
+    value_sizer_t *const sizer_;
+    superblock_t *const superblock_;
+
+    // The right edge of the tree, from the root down to the rightmost leaf.
+    std::vector<buf_lock_t> path_;
+
+    // The greatest key in the tree, if the tree isn't empty.
+    store_key_t last_key_;
+    bool has_last_key_;
+
+    int64_t num_appended_;
+
+    DISABLE_COPYING(btree_appender_t);
+};
+
+// Whether `key` is greater than every key in the tree.  Only read-locks the right
+// edge of the tree, so callers can check this before they create an appender, which
+// write-locks it.
+bool can_append_to_btree(superblock_t *superblock, const btree_key_t *key);
+
+#endif  // BTREE_BULK_LOAD_HPP_
@@ -0,0 +1,94 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/count.hpp"
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/operations.hpp"
+
+// Whether all the keys in (`left_exclusive_or_null`, `right_inclusive_or_null`] are
+// in `range`.
+static bool range_contains(const key_range_t &range,
+                           const btree_key_t *left_exclusive_or_null,
+                           const btree_key_t *right_inclusive_or_null) {
+    if (left_exclusive_or_null == NULL
+        ? range.left != store_key_t::min()
+        : btree_key_cmp(left_exclusive_or_null, range.left.btree_key()) < 0) {
+        return false;
+    }
+    return range.right.unbounded
+        || (right_inclusive_or_null != NULL
+            && btree_key_cmp(right_inclusive_or_null, range.right.key.btree_key()) < 0);
+}
+
+static uint64_t count_keys_in_leaf(const leaf_node_t *node, const key_range_t &range) {
+    uint64_t count = 0;
+    for (auto it = leaf::inclusive_lower_bound(range.left.btree_key(), *node);
+         it != leaf::end(*node); ++it) {
+        if (!range.right.unbounded &&
+            btree_key_cmp((*it).first, range.right.key.btree_key()) >= 0) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+// The keys in `block` are in (`left_exclusive_or_null`, `right_inclusive_or_null`].
+static uint64_t count_keys_in_subtree(buf_lock_t *block,
+                                      const key_range_t &range,
+                                      const btree_key_t *left_exclusive_or_null,
+                                      const btree_key_t *right_inclusive_or_null) {
+    buf_read_t read(block, alt_access_hint_t::no_promote);
+    const node_t *node = static_cast<const node_t *>(read.get_data_read());
+    if (!node::is_internal(node)) {
+        return count_keys_in_leaf(reinterpret_cast<const leaf_node_t *>(node), range);
+    }
+
+    const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
+    const int start_index = internal_node::get_offset_index(inode, range.left.btree_key());
+    int end_index;
+    if (range.right.unbounded) {
+        end_index = inode->npairs;
+    } else {
+        store_key_t r = range.right.key;
+        r.decrement();
+        end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
+    }
+
+    uint64_t count = 0;
+    for (int i = start_index; i < end_index; ++i) {
+        const btree_key_t *child_left = i == 0
+            ? left_exclusive_or_null
+            : &internal_node::get_pair_by_index(inode, i - 1)->key;
+        const btree_key_t *child_right = i == inode->npairs - 1
+            ? right_inclusive_or_null
+            : &internal_node::get_pair_by_index(inode, i)->key;
+        const uint32_t child_count = internal_node::get_child_count(inode, i);
+        if (child_count != internal_node::UNKNOWN_CHILD_COUNT
+            && range_contains(range, child_left, child_right)) {
+            count += child_count;
+        } else {
+            buf_lock_t child(block, internal_node::get_pair_by_index(inode, i)->lnode,
+                             access_t::read);
+            count += count_keys_in_subtree(&child, range, child_left, child_right);
+        }
+    }
+    return count;
+}
+
+uint64_t btree_count_keys(superblock_t *superblock,
+                          const key_range_t &range,
+                          release_superblock_t release_superblock) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID || range.is_empty()) {
+        if (release_superblock == release_superblock_t::RELEASE) {
+            superblock->release();
+        }
+        return 0;
+    }
+    buf_lock_t root(superblock->expose_buf(), root_id, access_t::read);
+    if (release_superblock == release_superblock_t::RELEASE) {
+        superblock->release();
+    }
+    return count_keys_in_subtree(&root, range, NULL, NULL);
+}
@@ -0,0 +1,19 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_COUNT_HPP_
+#define BTREE_COUNT_HPP_
+
+#include "btree/keys.hpp"
+#include "btree/types.hpp"
+
+class superblock_t;
+
+/* Returns the number of keys in `range`.  A leaf that lies entirely inside `range`
+isn't read if its parent knows how many keys it has (see
+`internal_node::get_child_count()`), so usually only the internal nodes above the
+range and the two leaves at its ends are read. */
+uint64_t btree_count_keys(superblock_t *superblock,
+                          const key_range_t &range,
+                          release_superblock_t release_superblock
+                              = release_superblock_t::RELEASE);
+
+#endif /* BTREE_COUNT_HPP_ */
@@ -101,7 +101,10 @@ bool btree_depth_first_traversal(counted_t<counted_buf_lock_t> block,
                                  const key_range_t &range,
                                  depth_first_traversal_callback_t *cb,
                                  direction_t direction) {
-    auto read = make_counted<counted_buf_read_t>(block.get());
+    // Traversals read lots of blocks once, so they mustn't promote them in the
+    // cache.
+    auto read = make_counted<counted_buf_read_t>(block.get(),
+                                                 alt_access_hint_t::no_promote);
     const node_t *node = static_cast<const node_t *>(read->get_data_read());
     if (node::is_internal(node)) {
         const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
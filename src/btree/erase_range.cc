@@ -2,6 +2,7 @@
 #include "btree/erase_range.hpp"
 
 #include "buffer_cache/alt/alt.hpp"
+#include "btree/internal_node.hpp"
 #include "btree/leaf_node.hpp"
 #include "btree/node.hpp"
 #include "btree/operations.hpp"
@@ -71,8 +72,20 @@ public:
         *population_change_out = population_change;
     }
 
-    void postprocess_internal_node(UNUSED buf_lock_t *internal_node_buf) {
-        // We don't want to do anything here.
+    void postprocess_internal_node(buf_lock_t *internal_node_buf) {
+        // We erase keys from the leaves without holding their parent, so we can't
+        // keep their counts up to date.
+        {
+            buf_read_t read(internal_node_buf);
+            if (!internal_node::has_child_counts(
+                    static_cast<const internal_node_t *>(read.get_data_read()))) {
+                return;
+            }
+        }
+        buf_write_t write(internal_node_buf);
+        internal_node::invalidate_child_counts(
+            static_cast<internal_node_t *>(write.get_data_write()),
+            left_exclusive_or_null_, right_inclusive_or_null_);
     }
 
     void filter_interesting_children(buf_parent_t,
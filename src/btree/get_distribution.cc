@@ -2,8 +2,9 @@
 #include "btree/get_distribution.hpp"
 
 #include "btree/internal_node.hpp"
-#include "btree/node.hpp"
 #include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
 #include "btree/parallel_traversal.hpp"
 #include "buffer_cache/alt/alt.hpp"
 #include "utils.hpp"
@@ -98,3 +99,22 @@ void get_btree_key_distribution(superblock_t *superblock, int depth_limit,
     btree_parallel_traversal(superblock, &helper, &non_interruptor);
     *key_count_out = helper.key_count;
 }
+
+void get_btree_root_split_keys(superblock_t *superblock,
+                               std::vector<store_key_t> *keys_out) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID) {
+        return;
+    }
+    buf_lock_t root(superblock->expose_buf(), root_id, access_t::read);
+    buf_read_t read(&root);
+    const node_t *node = static_cast<const node_t *>(read.get_data_read());
+    if (node::is_internal(node)) {
+        const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
+        // As in `postprocess_internal_node()`, the last pair has no key.
+        for (int i = 0; i < inode->npairs - 1; ++i) {
+            const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, i);
+            keys_out->push_back(store_key_t(pair->key.size, pair->key.contents));
+        }
+    }
+}
@@ -13,4 +13,9 @@ void get_btree_key_distribution(superblock_t *superblock, int depth_limit,
                                 int64_t *key_count_out,
                                 std::vector<store_key_t> *keys_out);
 
+/* Appends the keys that separate the children of the root node to `keys_out`, in
+order.  Unlike `get_btree_key_distribution()`, this doesn't release `superblock`. */
+void get_btree_root_split_keys(superblock_t *superblock,
+                               std::vector<store_key_t> *keys_out);
+
 #endif /* BTREE_GET_DISTRIBUTION_HPP_ */
@@ -13,15 +13,21 @@ class ibuf_t;
 
 // We can't use "internal" for internal stuff obviously.
 namespace impl {
-size_t pair_size_with_key(const btree_key_t *key);
-size_t pair_size_with_key_size(uint8_t size);
+size_t pair_size_with_key(const internal_node_t *node, const btree_key_t *key);
+size_t pair_size_with_key_size(const internal_node_t *node, uint8_t size);
+
+uint32_t get_count(const internal_node_t *node, const btree_internal_pair *pair);
+void set_count(internal_node_t *node, btree_internal_pair *pair, uint32_t count);
 
 void delete_pair(internal_node_t *node, uint16_t offset);
-uint16_t insert_pair(internal_node_t *node, const btree_internal_pair *pair);
-uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key);
+uint16_t insert_pair(internal_node_t *node, const internal_node_t *source,
+                     const btree_internal_pair *pair);
+uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key,
+                     uint32_t count);
 void delete_offset(internal_node_t *node, int index);
 void insert_offset(internal_node_t *node, uint16_t offset, int index);
 void make_last_pair_special(internal_node_t *node);
+void convert(block_size_t block_size, internal_node_t *node, bool with_counts);
 bool is_equal(const btree_key_t *key1, const btree_key_t *key2);
 }  // namespace internal_node::impl
 
@@ -33,9 +39,11 @@ void init(block_size_t block_size, internal_node_t *node) {
 
 void init(block_size_t block_size, internal_node_t *node, const internal_node_t *lnode, const uint16_t *offsets, int numpairs) {
     init(block_size, node);
+    // The new node gets the format of `lnode`, so that its pairs still fit.
+    node->magic = lnode->magic;
     rassert(get_pair_by_index(lnode, lnode->npairs-1)->key.size == 0);
     for (int i = 0; i < numpairs; i++) {
-        node->pair_offsets[i] = impl::insert_pair(node, get_pair(lnode, offsets[i]));
+        node->pair_offsets[i] = impl::insert_pair(node, lnode, get_pair(lnode, offsets[i]));
     }
     node->npairs = numpairs;
     std::sort(node->pair_offsets, node->pair_offsets+node->npairs-1, internal_key_comp(node));
@@ -56,17 +64,21 @@ bool insert(UNUSED block_size_t block_size, internal_node_t *node, const btree_k
         btree_key_t special;
         special.size = 0;
 
-        const uint16_t special_offset = impl::insert_pair(node, rnode, &special);
+        const uint16_t special_offset
+            = impl::insert_pair(node, rnode, &special, UNKNOWN_CHILD_COUNT);
         impl::insert_offset(node, special_offset, 0);
     }
 
     int index = get_offset_index(node, key);
     rassert(!impl::is_equal(&get_pair_by_index(node, index)->key, key),
         "tried to insert duplicate key into internal node!");
-    const uint16_t offset = impl::insert_pair(node, lnode, key);
+    const uint16_t offset = impl::insert_pair(node, lnode, key, UNKNOWN_CHILD_COUNT);
     impl::insert_offset(node, offset, index);
 
-    get_pair_by_index(node, index + 1)->lnode = rnode;
+    // `lnode` has just been split, so neither of the two halves has a known count.
+    btree_internal_pair *rpair = get_pair_by_index(node, index + 1);
+    rpair->lnode = rnode;
+    impl::set_count(node, rpair, UNKNOWN_CHILD_COUNT);
     return true;
 }
 
@@ -88,7 +100,7 @@ void split(block_size_t block_size, internal_node_t *node, internal_node_t *rnod
     uint16_t first_pairs = 0;
     int index = 0;
     while (first_pairs < total_pairs/2) { // finds the median index
-        first_pairs += pair_size(get_pair_by_index(node, index));
+        first_pairs += pair_size(node, get_pair_by_index(node, index));
         index++;
     }
     int median_index = index;
@@ -120,6 +132,12 @@ void merge(block_size_t block_size, const internal_node_t *node, internal_node_t
     // get the key in parent which points to node
     const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(node, 0)->key))->key;
 
+    // If only `rnode` has counts we drop them, so that `node`'s pairs don't grow
+    // when they're copied into it.
+    if (!has_child_counts(node) && has_child_counts(rnode)) {
+        impl::convert(block_size, rnode, false);
+    }
+
     guarantee(sizeof(internal_node_t) + (node->npairs + rnode->npairs)*sizeof(*node->pair_offsets) +
         (block_size.value() - node->frontmost_offset) + (block_size.value() - rnode->frontmost_offset) + key_from_parent->size < block_size.value(),
         "internal nodes too full to merge");
@@ -127,10 +145,14 @@ void merge(block_size_t block_size, const internal_node_t *node, internal_node_t
     memmove(rnode->pair_offsets + node->npairs, rnode->pair_offsets, rnode->npairs * sizeof(*rnode->pair_offsets));
 
     for (int i = 0; i < node->npairs-1; i++) { // the last pair is special
-        const uint16_t new_offset = impl::insert_pair(rnode, get_pair_by_index(node, i));
+        const uint16_t new_offset
+            = impl::insert_pair(rnode, node, get_pair_by_index(node, i));
         rnode->pair_offsets[i] = new_offset;
     }
-    const uint16_t new_offset = impl::insert_pair(rnode, get_pair_by_index(node, node->npairs-1)->lnode, key_from_parent);
+    const btree_internal_pair *special_pair = get_pair_by_index(node, node->npairs-1);
+    const uint16_t new_offset
+        = impl::insert_pair(rnode, special_pair->lnode, key_from_parent,
+                            impl::get_count(node, special_pair));
     rnode->pair_offsets[node->npairs - 1] = new_offset;
 
     const uint16_t new_npairs = rnode->npairs + node->npairs;
@@ -149,13 +171,20 @@ bool level(block_size_t block_size, internal_node_t *node,
         moved_children_out->reserve(sibling->npairs);
     }
 
+    // Pairs move between the two nodes, so they must have the same format.
+    if (has_child_counts(node) != has_child_counts(sibling)) {
+        impl::convert(block_size, has_child_counts(node) ? node : sibling, false);
+    }
+
     if (nodecmp(node, sibling) < 0) {
         const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(node, 0)->key))->key;
-        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(key_from_parent) >= node->frontmost_offset)
+        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(node, key_from_parent) >= node->frontmost_offset)
             return false;
         uint16_t special_pair_offset = node->pair_offsets[node->npairs-1];
         block_id_t last_offset = get_pair(node, special_pair_offset)->lnode;
-        uint16_t new_pair_offset = impl::insert_pair(node, last_offset, key_from_parent);
+        uint16_t new_pair_offset
+            = impl::insert_pair(node, last_offset, key_from_parent,
+                                impl::get_count(node, get_pair(node, special_pair_offset)));
         node->pair_offsets[node->npairs - 1] = new_pair_offset;
 
         uint16_t new_npairs = node->npairs;
@@ -164,12 +193,12 @@ bool level(block_size_t block_size, internal_node_t *node,
         // and increase efficiency.
         for (;;) {
             const btree_internal_pair *pair_to_move = get_pair_by_index(sibling, 0);
-            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(pair_to_move);
+            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(sibling, pair_to_move);
             if (new_npairs * sizeof(*node->pair_offsets) + (block_size.value() - node->frontmost_offset) + size_change >= sibling->npairs * sizeof(*sibling->pair_offsets) + (block_size.value() - sibling->frontmost_offset) - size_change) {
                 break;
             }
 
-            const uint16_t new_offset = impl::insert_pair(node, pair_to_move);
+            const uint16_t new_offset = impl::insert_pair(node, sibling, pair_to_move);
             node->pair_offsets[new_npairs] = new_offset;
             ++new_npairs;
             if (moved_children_out != NULL) {
@@ -189,6 +218,7 @@ bool level(block_size_t block_size, internal_node_t *node,
 
         btree_internal_pair *special_pair = get_pair(node, special_pair_offset);
         special_pair->lnode = pair_for_parent->lnode;
+        impl::set_count(node, special_pair, impl::get_count(sibling, pair_for_parent));
 
         keycpy(replacement_key, &pair_for_parent->key);
 
@@ -200,10 +230,13 @@ bool level(block_size_t block_size, internal_node_t *node,
     } else {
         uint16_t offset;
         const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(sibling, 0)->key))->key;
-        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(key_from_parent) >= node->frontmost_offset)
+        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(node, key_from_parent) >= node->frontmost_offset)
             return false;
-        block_id_t first_child = get_pair_by_index(sibling, sibling->npairs-1)->lnode;
-        offset = impl::insert_pair(node, first_child, key_from_parent);
+        const btree_internal_pair *sibling_special_pair
+            = get_pair_by_index(sibling, sibling->npairs-1);
+        block_id_t first_child = sibling_special_pair->lnode;
+        offset = impl::insert_pair(node, first_child, key_from_parent,
+                                   impl::get_count(sibling, sibling_special_pair));
         impl::insert_offset(node, offset, 0);
         if (moved_children_out != NULL) {
             moved_children_out->push_back(first_child);
@@ -215,12 +248,12 @@ bool level(block_size_t block_size, internal_node_t *node,
         // drastically reduce the number and increase efficiency.
         for (;;) {
             const btree_internal_pair *pair_to_move = get_pair_by_index(sibling, sibling->npairs-1);
-            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(pair_to_move);
+            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(sibling, pair_to_move);
             if (node->npairs * sizeof(*node->pair_offsets) + (block_size.value() - node->frontmost_offset) + size_change >= sibling->npairs * sizeof(*sibling->pair_offsets) + (block_size.value() - sibling->frontmost_offset) - size_change) {
                 break;
             }
 
-            offset = impl::insert_pair(node, pair_to_move);
+            offset = impl::insert_pair(node, sibling, pair_to_move);
             impl::insert_offset(node, offset, 0);
             if (moved_children_out != NULL) {
                 moved_children_out->push_back(pair_to_move->lnode);
@@ -276,12 +309,14 @@ void update_key(internal_node_t *node, const btree_key_t *key_to_replace, const
 
     const int index = get_offset_index(node, key_to_replace);
     const block_id_t tmp_lnode = get_pair_by_index(node, index)->lnode;
+    const uint32_t tmp_count = impl::get_count(node, get_pair_by_index(node, index));
     impl::delete_pair(node, node->pair_offsets[index]);
 
-    guarantee(sizeof(internal_node_t) + (node->npairs) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(replacement_key) < node->frontmost_offset,
+    guarantee(sizeof(internal_node_t) + (node->npairs) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(node, replacement_key) < node->frontmost_offset,
         "cannot fit updated key in internal node");
 
-    const uint16_t new_offset = impl::insert_pair(node, tmp_lnode, replacement_key);
+    const uint16_t new_offset
+        = impl::insert_pair(node, tmp_lnode, replacement_key, tmp_count);
     node->pair_offsets[index] = new_offset;
 
     rassert(is_sorted(node->pair_offsets, node->pair_offsets+node->npairs-1, internal_key_comp(node)),
@@ -290,7 +325,7 @@ void update_key(internal_node_t *node, const btree_key_t *key_to_replace, const
 }
 
 bool is_full(const internal_node_t *node) {
-    return sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key_size(MAX_KEY_SIZE) >=  node->frontmost_offset;
+    return sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key_size(node, MAX_KEY_SIZE) >=  node->frontmost_offset;
 }
 
 bool change_unsafe(const internal_node_t *node) {
@@ -331,7 +366,7 @@ bool is_mergable(block_size_t block_size, const internal_node_t *node, const int
         (node->npairs + sibling->npairs + 1)*sizeof(*node->pair_offsets) +
         (block_size.value() - node->frontmost_offset) +
         (block_size.value() - sibling->frontmost_offset) + key_from_parent->size +
-        impl::pair_size_with_key_size(MAX_KEY_SIZE) +
+        impl::pair_size_with_key_size(node, MAX_KEY_SIZE) +
         INTERNAL_EPSILON < block_size.value(); // must still have enough room for an arbitrary key  // TODO: we can't be tighter?
 }
 
@@ -339,8 +374,8 @@ bool is_singleton(const internal_node_t *node) {
     return node->npairs == 2;
 }
 
-size_t pair_size(const btree_internal_pair *pair) {
-    return impl::pair_size_with_key_size(pair->key.size);
+size_t pair_size(const internal_node_t *node, const btree_internal_pair *pair) {
+    return impl::pair_size_with_key_size(node, pair->key.size);
 }
 
 const btree_internal_pair *get_pair(const internal_node_t *node, uint16_t offset) {
@@ -362,6 +397,60 @@ int get_offset_index(const internal_node_t *node, const btree_key_t *key) {
     return std::lower_bound(node->pair_offsets, node->pair_offsets+node->npairs-1, (uint16_t) internal_key_comp::faux_offset, internal_key_comp(node, key)) - node->pair_offsets;
 }
 
+bool has_child_counts(const internal_node_t *node) {
+    return node->magic == internal_node_t::expected_magic;
+}
+
+bool can_add_child_counts(const internal_node_t *node) {
+    rassert(!has_child_counts(node));
+    // Converting the node adds a count to each pair.  We only do it if the node
+    // isn't full afterwards, because it may just have been checked not to be.
+    return sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets)
+        + impl::pair_size_with_key_size(node, MAX_KEY_SIZE)
+        + (node->npairs + 1) * sizeof(uint32_t) < node->frontmost_offset;
+}
+
+void add_child_counts(block_size_t block_size, internal_node_t *node) {
+    guarantee(can_add_child_counts(node));
+    impl::convert(block_size, node, true);
+    validate(block_size, node);
+}
+
+int find_child(const internal_node_t *node, block_id_t child_id) {
+    for (int i = 0; i < node->npairs; ++i) {
+        if (get_pair_by_index(node, i)->lnode == child_id) {
+            return i;
+        }
+    }
+    unreachable("Block %" PR_BLOCK_ID " is not a child of the internal node.", child_id);
+}
+
+uint32_t get_child_count(const internal_node_t *node, int index) {
+    return impl::get_count(node, get_pair_by_index(node, index));
+}
+
+void set_child_count(internal_node_t *node, int index, uint32_t count) {
+    rassert(has_child_counts(node));
+    impl::set_count(node, get_pair_by_index(node, index), count);
+}
+
+void invalidate_child_counts(internal_node_t *node,
+                             const btree_key_t *left_exclusive_or_null,
+                             const btree_key_t *right_inclusive_or_null) {
+    if (!has_child_counts(node)) {
+        return;
+    }
+    // The child that contains `left_exclusive_or_null` may also contain keys after
+    // it, so it's included.
+    const int begin = left_exclusive_or_null == NULL
+        ? 0 : get_offset_index(node, left_exclusive_or_null);
+    const int end = right_inclusive_or_null == NULL
+        ? node->npairs : get_offset_index(node, right_inclusive_or_null) + 1;
+    for (int i = begin; i < end; ++i) {
+        impl::set_count(node, get_pair_by_index(node, i), UNKNOWN_CHILD_COUNT);
+    }
+}
+
 int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
     const btree_key_t *key1 = &get_pair_by_index(node1, 0)->key;
     const btree_key_t *key2 = &get_pair_by_index(node2, 0)->key;
@@ -371,23 +460,39 @@ int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
 
 namespace impl {
 
-size_t pair_size_with_key(const btree_key_t *key) {
-    return pair_size_with_key_size(key->size);
+size_t pair_size_with_key(const internal_node_t *node, const btree_key_t *key) {
+    return pair_size_with_key_size(node, key->size);
+}
+
+size_t pair_size_with_key_size(const internal_node_t *node, uint8_t size) {
+    return offsetof(btree_internal_pair, key) + offsetof(btree_key_t, contents) + size
+        + (has_child_counts(node) ? sizeof(uint32_t) : 0);
 }
 
-size_t pair_size_with_key_size(uint8_t size) {
-    return offsetof(btree_internal_pair, key) + offsetof(btree_key_t, contents) + size;
+uint32_t get_count(const internal_node_t *node, const btree_internal_pair *pair) {
+    if (!has_child_counts(node)) {
+        return UNKNOWN_CHILD_COUNT;
+    }
+    uint32_t count;
+    memcpy(&count, pair->key.contents + pair->key.size, sizeof(count));
+    return count;
+}
+
+void set_count(internal_node_t *node, btree_internal_pair *pair, uint32_t count) {
+    if (has_child_counts(node)) {
+        memcpy(pair->key.contents + pair->key.size, &count, sizeof(count));
+    }
 }
 
 void delete_pair(internal_node_t *node, uint16_t offset) {
     btree_internal_pair *pair_to_delete = get_pair(node, offset);
     btree_internal_pair *front_pair = get_pair(node, node->frontmost_offset);
-    const size_t shift = pair_size(pair_to_delete);
+    const size_t shift = pair_size(node, pair_to_delete);
     const size_t size = offset - node->frontmost_offset;
 
-    rassert(node->magic == internal_node_t::expected_magic);
+    rassert(node::is_internal(reinterpret_cast<const node_t *>(node)));
     memmove(reinterpret_cast<char *>(front_pair) + shift, front_pair, size);
-    rassert(node->magic == internal_node_t::expected_magic);
+    rassert(node::is_internal(reinterpret_cast<const node_t *>(node)));
 
 
     node->frontmost_offset = node->frontmost_offset + shift;
@@ -403,31 +508,40 @@ void delete_pair(internal_node_t *node, uint16_t offset) {
     memcpy(node->pair_offsets, new_pair_offsets.data(), sizeof(uint16_t) * node->npairs);
 }
 
-uint16_t insert_pair(internal_node_t *node, const btree_internal_pair *pair) {
-    const uint16_t frontmost_offset = node->frontmost_offset - pair_size(pair);
-    node->frontmost_offset = frontmost_offset;
+// `source` and `node` may have different formats, in which case the count is
+// dropped or set to `UNKNOWN_CHILD_COUNT`.
+uint16_t insert_pair(internal_node_t *node, const internal_node_t *source,
+                     const btree_internal_pair *pair) {
+    if (has_child_counts(node) == has_child_counts(source)) {
+        const uint16_t frontmost_offset = node->frontmost_offset - pair_size(node, pair);
+        node->frontmost_offset = frontmost_offset;
 
-    // insert contents
-    memcpy(get_pair(node, frontmost_offset), pair, pair_size(pair));
-    return frontmost_offset;
+        // insert contents
+        memcpy(get_pair(node, frontmost_offset), pair, pair_size(node, pair));
+        return frontmost_offset;
+    } else {
+        return insert_pair(node, pair->lnode, &pair->key, get_count(source, pair));
+    }
 }
 
-uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key) {
-    const uint16_t frontmost_offset = node->frontmost_offset - pair_size_with_key(key);
+uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key,
+                     uint32_t count) {
+    const uint16_t frontmost_offset = node->frontmost_offset - pair_size_with_key(node, key);
     node->frontmost_offset = frontmost_offset;
 
     btree_internal_pair *new_pair = get_pair(node, frontmost_offset);
 
     // Use a buffer to prepare the key/value pair which we can then use to generate a patch
-    scoped_array_t<char> pair_buf(pair_size_with_key(key));
+    scoped_array_t<char> pair_buf(pair_size_with_key(node, key));
     btree_internal_pair *new_buf_pair = reinterpret_cast<btree_internal_pair *>(pair_buf.data());
 
     // insert contents
     new_buf_pair->lnode = lnode;
     keycpy(&new_buf_pair->key, key);
+    set_count(node, new_buf_pair, count);
 
     // Patch the new pair into node_buf
-    memcpy(new_pair, new_buf_pair, pair_size_with_key(key));
+    memcpy(new_pair, new_buf_pair, pair_size_with_key(node, key));
 
     return frontmost_offset;
 }
@@ -452,11 +566,26 @@ void make_last_pair_special(internal_node_t *node) {
     const uint16_t old_offset = node->pair_offsets[index];
     btree_key_t tmp;
     tmp.size = 0;
-    const uint16_t new_offset = insert_pair(node, get_pair(node, old_offset)->lnode, &tmp);
+    const btree_internal_pair *old_pair = get_pair(node, old_offset);
+    const uint16_t new_offset
+        = insert_pair(node, old_pair->lnode, &tmp, get_count(node, old_pair));
     node->pair_offsets[index] = new_offset;
     delete_pair(node, old_offset);
 }
 
+// Rewrites `node` with or without child counts.  Counts that are added are unknown.
+void convert(block_size_t block_size, internal_node_t *node, bool with_counts) {
+    scoped_malloc_t<internal_node_t> old(block_size.value());
+    memcpy(old.get(), node, block_size.value());
+    node->magic = with_counts
+        ? internal_node_t::expected_magic
+        : internal_node_t::legacy_magic;
+    node->frontmost_offset = block_size.value();
+    for (int i = 0; i < old->npairs; ++i) {
+        node->pair_offsets[i] = insert_pair(node, old.get(), get_pair_by_index(old.get(), i));
+    }
+}
+
 
 bool is_equal(const btree_key_t *key1, const btree_key_t *key2) {
     return sized_strcmp(key1->contents, key1->size, key2->contents, key2->size) == 0;
@@ -16,6 +16,8 @@ struct internal_node_t;
 #define INTERNAL_EPSILON (sizeof(btree_key_t) + MAX_KEY_SIZE + sizeof(block_id_t))
 
 //Note: This struct is stored directly on disk.  Changing it invalidates old data.
+// In nodes with `internal_node_t::expected_magic` the key is followed by the
+// (unaligned) `uint32_t` count of the child, see `get_child_count()`.
 struct btree_internal_pair {
     block_id_t lnode;
     btree_key_t key;
@@ -49,7 +51,7 @@ bool is_singleton(const internal_node_t *node);
 
 void validate(block_size_t block_size, const internal_node_t *node);
 
-size_t pair_size(const btree_internal_pair *pair);
+size_t pair_size(const internal_node_t *node, const btree_internal_pair *pair);
 const btree_internal_pair *get_pair(const internal_node_t *node, uint16_t offset);
 btree_internal_pair *get_pair(internal_node_t *node, uint16_t offset);
 
@@ -58,6 +60,27 @@ btree_internal_pair *get_pair_by_index(internal_node_t *node, int index);
 
 int get_offset_index(const internal_node_t *node, const btree_key_t *key);
 
+/* Internal nodes store, for each child that is a leaf, the number of live keys in
+the child, so that counting a range of keys doesn't have to read the leaves that
+lie entirely inside it (see `btree/count.hpp`).  `btree/operations.cc` updates the
+count whenever it modifies a leaf, which it only does while holding the leaf's
+parent.  The count is `UNKNOWN_CHILD_COUNT` for internal children, for children of
+nodes that have the legacy magic, and for leaves modified by `erase_range`. */
+const uint32_t UNKNOWN_CHILD_COUNT = 0xFFFFFFFF;
+
+// False for nodes with `internal_node_t::legacy_magic`, which store no counts.
+bool has_child_counts(const internal_node_t *node);
+// Whether a legacy node has room to be converted by `add_child_counts()`.
+bool can_add_child_counts(const internal_node_t *node);
+void add_child_counts(block_size_t block_size, internal_node_t *node);
+int find_child(const internal_node_t *node, block_id_t child_id);
+uint32_t get_child_count(const internal_node_t *node, int index);
+void set_child_count(internal_node_t *node, int index, uint32_t count);
+// Forgets the counts of the children that may have keys in the given range.
+void invalidate_child_counts(internal_node_t *node,
+                             const btree_key_t *left_exclusive_or_null,
+                             const btree_key_t *right_inclusive_or_null);
+
 }  // namespace internal_node
 
 class internal_key_comp {
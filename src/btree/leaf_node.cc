@@ -515,6 +515,16 @@ bool is_empty(const leaf_node_t *node) {
     return node->num_pairs == 0;
 }
 
+int num_live_entries(const leaf_node_t *node) {
+    int count = 0;
+    for (int i = 0; i < node->num_pairs; ++i) {
+        if (entry_is_live(get_entry(node, node->pair_offsets[i]))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
 bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value) {
 
     // Upon an insertion, we preserve `MANDATORY_TIMESTAMPS - 1`
@@ -122,6 +122,9 @@ void init(value_sizer_t *sizer, leaf_node_t *node);
 
 bool is_empty(const leaf_node_t *node);
 
+// The number of keys in the node, which doesn't include its deletion entries.
+int num_live_entries(const leaf_node_t *node);
+
 bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value);
 
 bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node);
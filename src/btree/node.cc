@@ -5,7 +5,8 @@
 #include "btree/internal_node.hpp"
 
 const block_magic_t btree_superblock_t::expected_magic = { { 's', 'u', 'p', 'e' } };
-const block_magic_t internal_node_t::expected_magic = { { 'i', 'n', 't', 'e' } };
+const block_magic_t internal_node_t::expected_magic = { { 'i', 'n', 't', 'E' } };
+const block_magic_t internal_node_t::legacy_magic = { { 'i', 'n', 't', 'e' } };
 
 void btree_superblock_ct_asserts() {
     // Just some place to put the CT_ASSERTs
@@ -57,7 +58,7 @@ void validate(DEBUG_VAR value_sizer_t *sizer, DEBUG_VAR const node_t *node) {
 #ifndef NDEBUG
     if (node->magic == sizer->btree_leaf_magic()) {
         leaf::validate(sizer, reinterpret_cast<const leaf_node_t *>(node));
-    } else if (node->magic == internal_node_t::expected_magic) {
+    } else if (is_internal(node)) {
         internal_node::validate(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node));
     } else {
         unreachable("Invalid leaf node type.");
@@ -68,6 +68,10 @@ struct internal_node_t {
     uint16_t pair_offsets[0];
 
     static const block_magic_t expected_magic;
+    // The magic of internal nodes written before they stored the key counts of
+    // their children (see internal_node.hpp).  They're still readable, and are
+    // converted the next time one of their children's counts is set.
+    static const block_magic_t legacy_magic;
 } __attribute__((__packed__));
 
 // A node_t is either a btree_internal_node or a btree_leaf_node.
@@ -78,7 +82,8 @@ struct node_t {
 namespace node {
 
 inline bool is_internal(const node_t *node) {
-    if (node->magic == internal_node_t::expected_magic) {
+    if (node->magic == internal_node_t::expected_magic
+        || node->magic == internal_node_t::legacy_magic) {
         return true;
     }
     return false;
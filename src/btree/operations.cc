@@ -431,6 +431,45 @@ void detach_all_children(const node_t *node, buf_parent_t parent,
     }
 }
 
+void update_child_count(buf_lock_t *buf, buf_lock_t *last_buf) {
+    if (last_buf->empty()) {
+        return;
+    }
+    uint32_t count;
+    {
+        buf_read_t read(buf);
+        const node_t *node = static_cast<const node_t *>(read.get_data_read());
+        if (node::is_internal(node)) {
+            return;
+        }
+        count = leaf::num_live_entries(reinterpret_cast<const leaf_node_t *>(node));
+    }
+    {
+        // Don't dirty the parent if the count hasn't changed (e.g. a value was
+        // replaced), or if the parent is a legacy node that can't store counts.
+        buf_read_t last_read(last_buf);
+        const internal_node_t *parent
+            = static_cast<const internal_node_t *>(last_read.get_data_read());
+        if (internal_node::has_child_counts(parent)) {
+            const int index = internal_node::find_child(parent, buf->block_id());
+            if (internal_node::get_child_count(parent, index) == count) {
+                return;
+            }
+        } else if (!internal_node::can_add_child_counts(parent)) {
+            return;
+        }
+    }
+    buf_write_t last_write(last_buf);
+    internal_node_t *parent
+        = static_cast<internal_node_t *>(last_write.get_data_write());
+    if (!internal_node::has_child_counts(parent)) {
+        internal_node::add_child_counts(buf->cache()->max_block_size(), parent);
+    }
+    internal_node::set_child_count(parent,
+                                   internal_node::find_child(parent, buf->block_id()),
+                                   count);
+}
+
 // Split the node if necessary. If the node is a leaf_node, provide the new
 // value that will be inserted; if it's an internal node, provide NULL (we
 // split internal nodes proactively).
@@ -522,6 +561,8 @@ void check_and_handle_split(value_sizer_t *sizer,
                                     buf->block_id(), rbuf.block_id());
         rassert(success, "could not insert internal btree node");
     }
+    update_child_count(buf, last_buf);
+    update_child_count(&rbuf, last_buf);
 
     // We've split the node; now figure out where the key goes and release the other buf (since we're done with it).
     if (0 >= sized_strcmp(key->contents, key->size, median->contents, median->size)) {
@@ -652,10 +693,13 @@ void check_and_handle_underfull(value_sizer_t *sizer,
             buf->manually_touch_recency(superceding_recency(buf_recency, sib_buf_recency));
 
             if (!parent_is_singleton) {
-                buf_write_t last_buf_write(last_buf);
-                internal_node::remove(sizer->block_size(),
-                                      static_cast<internal_node_t *>(last_buf_write.get_data_write()),
-                                      key_in_middle.btree_key());
+                {
+                    buf_write_t last_buf_write(last_buf);
+                    internal_node::remove(sizer->block_size(),
+                                          static_cast<internal_node_t *>(last_buf_write.get_data_write()),
+                                          key_in_middle.btree_key());
+                }
+                update_child_count(buf, last_buf);
             } else {
                 // The parent has only 1 key after the merge (which means that
                 // it's the root and our node is its only child). Insert our
@@ -720,10 +764,14 @@ void check_and_handle_underfull(value_sizer_t *sizer,
                                                             buf->get_recency()));
 
             if (leveled) {
-                buf_write_t last_buf_write(last_buf);
-                internal_node::update_key(static_cast<internal_node_t *>(last_buf_write.get_data_write()),
-                                          key_in_middle.btree_key(),
-                                          replacement_key);
+                {
+                    buf_write_t last_buf_write(last_buf);
+                    internal_node::update_key(static_cast<internal_node_t *>(last_buf_write.get_data_write()),
+                                              key_in_middle.btree_key(),
+                                              replacement_key);
+                }
+                update_child_count(buf, last_buf);
+                update_child_count(&sib_buf, last_buf);
             }
         }
     }
@@ -926,6 +974,15 @@ void find_keyvalue_location_for_read(
     }
 #endif  // NDEBUG
 
+    // If the leaf has a key filter in the cache we might not need to load it at all.
+    // Otherwise, if the key turns out to be missing, we build one for the next time.
+    // (See `cache_t::key_filter()`.)  Snapshotted reads can't use the filters,
+    // which describe the current version of the leaf.
+    cache_t *const cache = buf.cache();
+    bool had_key_filter = false;
+    cache_t::key_filter_token_t key_filter_token = 0;
+    bool can_use_key_filter = false;
+
     for (;;) {
         block_id_t node_id;
         {
@@ -940,6 +997,21 @@ void find_keyvalue_location_for_read(
         }
         rassert(node_id != NULL_BLOCK_ID && node_id != SUPERBLOCK_ID);
 
+        // Only leaves have filters.  Everybody who's going to write to the leaf
+        // before us has already gotten in line for it (and dropped its filter),
+        // since we hold its parent.
+        can_use_key_filter = LEAF_KEY_FILTER_MEMORY_LIMIT > 0 && !buf.is_snapshotted();
+        if (can_use_key_filter) {
+            const bloom_filter_t *key_filter = cache->key_filter(node_id);
+            if (key_filter != NULL
+                && !key_filter->may_contain(key->contents, key->size)) {
+                stats->pm_total_leaf_filter_skips += 1;
+                return;
+            }
+            had_key_filter = key_filter != NULL;
+            key_filter_token = cache->key_filter_token(node_id);
+        }
+
         {
             profile::starter_t starter("Acquire a block for read.", trace);
             buf_lock_t tmp(&buf, node_id, access_t::read);
@@ -963,6 +1035,21 @@ void find_keyvalue_location_for_read(
         const leaf_node_t *leaf
             = static_cast<const leaf_node_t *>(read.get_data_read());
         value_found = leaf::lookup(sizer, leaf, key, value.get());
+
+        if (can_use_key_filter && !value_found) {
+            if (had_key_filter) {
+                stats->pm_total_leaf_filter_false_positives += 1;
+            } else {
+                stats->pm_total_leaf_filter_misses += 1;
+                bloom_filter_t new_filter(leaf->num_pairs);
+                for (auto it = leaf::begin(*leaf); it != leaf::end(*leaf); ++it) {
+                    const btree_key_t *leaf_key = (*it).first;
+                    new_filter.add(leaf_key->contents, leaf_key->size);
+                }
+                cache->set_key_filter(buf.block_id(), key_filter_token,
+                                      std::move(new_filter));
+            }
+        }
     }
     if (value_found) {
         keyvalue_location_out->buf = std::move(buf);
@@ -1043,6 +1130,10 @@ void apply_keyvalue_change(
         }
     }
 
+    if (population_change != 0) {
+        update_child_count(&kv_loc->buf, &kv_loc->last_buf);
+    }
+
     // Check to see if the leaf is underfull (following a change in
     // size or a deletion, and merge/level if it is.
     check_and_handle_underfull(sizer, &kv_loc->buf, &kv_loc->last_buf,
@@ -213,6 +213,11 @@ void check_and_handle_underfull(value_sizer_t *sizer,
                                 const btree_key_t *key,
                                 const value_deleter_t *detacher);
 
+/* Stores the number of keys in the leaf `buf` in its parent `last_buf` (see
+`internal_node::get_child_count()`).  Must be called after changing the keys in a
+leaf.  Does nothing if `buf` is the root or an internal node. */
+void update_child_count(buf_lock_t *buf, buf_lock_t *last_buf);
+
 // Metainfo functions
 bool get_superblock_metainfo(buf_lock_t *superblock,
                              const std::vector<char> &key,
@@ -35,7 +35,11 @@ public:
               &pm_keys_read, "keys_read",
               &pm_total_keys_read, "total_keys_read",
               &pm_keys_set, "keys_set",
-              &pm_total_keys_set, "total_keys_set") {
+              &pm_total_keys_set, "total_keys_set",
+              &pm_total_leaf_filter_skips, "total_leaf_filter_skips",
+              &pm_total_leaf_filter_misses, "total_leaf_filter_misses",
+              &pm_total_leaf_filter_false_positives,
+              "total_leaf_filter_false_positives") {
         if (parent != NULL) {
             rename(parent, identifier, index_type);
         }
@@ -64,6 +68,13 @@ public:
     perfmon_counter_t
         pm_total_keys_read,
         pm_total_keys_set;
+    // Point reads for missing keys that a leaf's key filter answered without loading
+    // the leaf; point misses in leaves that had no filter (so one got built); and
+    // misses the filter let through.
+    perfmon_counter_t
+        pm_total_leaf_filter_skips,
+        pm_total_leaf_filter_misses,
+        pm_total_leaf_filter_false_positives;
     perfmon_multi_membership_t pm_keys_membership;
 };
 
@@ -86,18 +86,77 @@ void alt_txn_throttler_t::inform_memory_limit_change(uint64_t memory_limit,
 cache_t::cache_t(serializer_t *serializer,
                  cache_balancer_t *balancer,
                  perfmon_collection_t *perfmon_collection)
-    : stats_(make_scoped<alt_cache_stats_t>(perfmon_collection)),
-      throttler_(MINIMUM_SOFT_UNWRITTEN_CHANGES_LIMIT),
-      page_cache_(serializer, balancer, &throttler_) { }
+    : throttler_(MINIMUM_SOFT_UNWRITTEN_CHANGES_LIMIT),
+      page_cache_(serializer, balancer, &throttler_),
+      key_filters_memory_(0),
+      key_filter_eviction_cursor_(0) {
+    std::fill(key_filter_invalidations_,
+              key_filter_invalidations_ + KEY_FILTER_INVALIDATION_BUCKETS, 0);
+    // The stats refer to perfmons owned by the evicter, so they're set up after
+    // the page cache.
+    stats_.init(new alt_cache_stats_t(perfmon_collection, &page_cache_.evicter()));
+}
 
 cache_t::~cache_t() {
     guarantee(snapshot_nodes_by_block_id_.empty());
+    stats_.reset();
 }
 
 cache_account_t cache_t::create_cache_account(int priority) {
     return page_cache_.create_cache_account(priority);
 }
 
+const bloom_filter_t *cache_t::key_filter(block_id_t block_id) const {
+    assert_thread();
+    auto it = key_filters_.find(block_id);
+    return it == key_filters_.end() ? NULL : &it->second;
+}
+
+cache_t::key_filter_token_t cache_t::key_filter_token(block_id_t block_id) const {
+    assert_thread();
+    return key_filter_invalidations_[block_id % KEY_FILTER_INVALIDATION_BUCKETS];
+}
+
+void cache_t::set_key_filter(block_id_t block_id, key_filter_token_t token,
+                             bloom_filter_t &&filter) {
+    assert_thread();
+    if (token != key_filter_token(block_id)) {
+        // The block (or one that shares its bucket) has been acquired for write
+        // since the token was taken, so the filter might be missing keys.
+        return;
+    }
+    const size_t size = filter.memory_size();
+    if (size > LEAF_KEY_FILTER_MEMORY_LIMIT) {
+        return;
+    }
+    drop_key_filter(block_id);
+    // Make room by dropping other filters, sweeping through the block ids like a
+    // clock hand.  They're cheap to rebuild the next time their leaf is loaded.
+    while (key_filters_memory_ + size > LEAF_KEY_FILTER_MEMORY_LIMIT) {
+        auto it = key_filters_.lower_bound(key_filter_eviction_cursor_);
+        if (it == key_filters_.end()) {
+            it = key_filters_.begin();
+        }
+        key_filter_eviction_cursor_ = it->first + 1;
+        drop_key_filter(it->first);
+    }
+    key_filters_memory_ += size;
+    key_filters_.insert(std::make_pair(block_id, std::move(filter)));
+}
+
+void cache_t::note_write_acquisition(block_id_t block_id) {
+    ++key_filter_invalidations_[block_id % KEY_FILTER_INVALIDATION_BUCKETS];
+    drop_key_filter(block_id);
+}
+
+void cache_t::drop_key_filter(block_id_t block_id) {
+    auto it = key_filters_.find(block_id);
+    if (it != key_filters_.end()) {
+        key_filters_memory_ -= it->second.memory_size();
+        key_filters_.erase(it);
+    }
+}
+
 alt_snapshot_node_t *
 cache_t::matching_snapshot_node_or_null(block_id_t block_id,
                                         block_version_t block_version) {
@@ -417,6 +476,9 @@ void buf_lock_t::help_construct(buf_parent_t parent, block_id_t block_id,
                   block_id, parent_lock->block_id());
         ++snapshot_node_->ref_count_;
     } else {
+        if (access == access_t::write) {
+            txn_->cache()->note_write_acquisition(block_id);
+        }
         if (access == access_t::write && parent.lock_or_null_ != NULL) {
             create_child_snapshot_attachments(txn_->cache(),
                                               parent.lock_or_null_->current_page_acq()->block_version(),
@@ -471,6 +533,7 @@ void buf_lock_t::help_construct(buf_parent_t parent, block_id_t block_id,
                                                   block_id,
                                                   access_t::write,
                                                   alt::page_create_t::yes));
+    txn_->cache()->note_write_acquisition(block_id);
 
     if (parent.lock_or_null_ != NULL) {
         create_empty_child_snapshot_attachments(txn_->cache(),
@@ -544,6 +607,7 @@ void buf_lock_t::help_construct(buf_parent_t parent, alt_create_t) {
 
     current_page_acq_.init(new current_page_acq_t(txn_->page_txn(),
                                                   alt_create_t::create));
+    txn_->cache()->note_write_acquisition(current_page_acq_->block_id());
 
     if (parent.lock_or_null_ != NULL) {
         create_empty_child_snapshot_attachments(txn_->cache(),
@@ -748,8 +812,8 @@ page_t *buf_lock_t::get_held_page_for_write() {
     return current_page_acq_->current_page_for_write(txn()->account());
 }
 
-buf_read_t::buf_read_t(buf_lock_t *lock)
-    : lock_(lock) {
+buf_read_t::buf_read_t(buf_lock_t *lock, alt_access_hint_t hint)
+    : lock_(lock), hint_(hint) {
     guarantee(!lock_->empty());
     lock_->access_ref_count_++;
 }
@@ -763,7 +827,7 @@ const void *buf_read_t::get_data_read(uint32_t *block_size_out) {
     page_t *page = lock_->get_held_page_for_read();
     if (!page_acq_.has()) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
-                       lock_->txn()->account());
+                       lock_->txn()->account(), hint_);
     }
     page_acq_.buf_ready_signal()->wait();
     *block_size_out = page_acq_.get_buf_size().value();
@@ -785,7 +849,7 @@ void *buf_write_t::get_data_write(uint32_t block_size) {
     page_t *page = lock_->get_held_page_for_write();
     if (!page_acq_.has()) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
-                       lock_->txn()->account());
+                       lock_->txn()->account(), alt_access_hint_t::normal);
     }
     page_acq_.buf_ready_signal()->wait();
     return page_acq_.get_buf_write(block_size_t::make_from_cache(block_size));
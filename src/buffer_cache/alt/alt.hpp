@@ -8,6 +8,7 @@
 
 #include "buffer_cache/alt/page_cache.hpp"
 #include "buffer_cache/types.hpp"
+#include "containers/bloom_filter.hpp"
 #include "containers/two_level_array.hpp"
 #include "repli_timestamp.hpp"
 
@@ -54,6 +55,20 @@ public:
     // might consider supporting a mem_cap paremeter.
     cache_account_t create_cache_account(int priority);
 
+    // The btree keeps Bloom filters of the keys in its leaf nodes here, so that
+    // point reads for keys a leaf doesn't contain don't have to load it.  The cache
+    // just stores them: a block's filter is dropped whenever the block is acquired
+    // for write, and `set_key_filter()` ignores filters built from a version of the
+    // block that was older than that.  (Only use them from non-snapshotted reads.)
+
+    // Returns NULL if there's no filter for `block_id`.
+    const bloom_filter_t *key_filter(block_id_t block_id) const;
+    typedef uint64_t key_filter_token_t;
+    // Get the token before acquiring the block you'll build the filter from.
+    key_filter_token_t key_filter_token(block_id_t block_id) const;
+    void set_key_filter(block_id_t block_id, key_filter_token_t token,
+                        bloom_filter_t &&filter);
+
 private:
     friend class txn_t;
     friend class buf_read_t;
@@ -75,6 +90,19 @@ private:
     std::map<block_id_t, intrusive_list_t<alt_snapshot_node_t> >
         snapshot_nodes_by_block_id_;
 
+    // Called by buf_lock_t whenever a block is acquired for write (or created).
+    void note_write_acquisition(block_id_t block_id);
+    void drop_key_filter(block_id_t block_id);
+
+    static const size_t KEY_FILTER_INVALIDATION_BUCKETS = 256;
+
+    std::map<block_id_t, bloom_filter_t> key_filters_;
+    size_t key_filters_memory_;
+    block_id_t key_filter_eviction_cursor_;
+    // Counts the write acquisitions of the blocks that hash to each bucket; tokens
+    // are these counts.
+    key_filter_token_t key_filter_invalidations_[KEY_FILTER_INVALIDATION_BUCKETS];
+
     DISABLE_COPYING(cache_t);
 };
 
@@ -190,6 +218,9 @@ public:
     }
 
     void snapshot_subdag();
+    bool is_snapshotted() const {
+        return snapshot_node_ != NULL;
+    }
 
     void detach_child(block_id_t child_id);
 
@@ -311,7 +342,10 @@ private:
 
 class buf_read_t {
 public:
-    explicit buf_read_t(buf_lock_t *lock);
+    // Range traversals and backfills should pass alt_access_hint_t::no_promote, so
+    // that they don't push frequently used blocks out of the cache.
+    explicit buf_read_t(buf_lock_t *lock,
+                        alt_access_hint_t hint = alt_access_hint_t::normal);
     ~buf_read_t();
 
     const void *get_data_read(uint32_t *block_size_out);
@@ -324,6 +358,7 @@ public:
 
 private:
     buf_lock_t *lock_;
+    const alt_access_hint_t hint_;
     alt::page_acq_t page_acq_;
 
     DISABLE_COPYING(buf_read_t);
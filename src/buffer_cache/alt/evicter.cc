@@ -7,6 +7,26 @@
 
 namespace alt {
 
+ghost_list_t::ghost_list_t() : next_sequence_number_(0) { }
+
+void ghost_list_t::add(block_id_t block_id, size_t capacity) {
+    const uint64_t sequence_number = next_sequence_number_++;
+    queue_.push_back(std::make_pair(block_id, sequence_number));
+    sequence_numbers_[block_id] = sequence_number;
+
+    while (queue_.size() > capacity) {
+        auto it = sequence_numbers_.find(queue_.front().first);
+        if (it != sequence_numbers_.end() && it->second == queue_.front().second) {
+            sequence_numbers_.erase(it);
+        }
+        queue_.pop_front();
+    }
+}
+
+bool ghost_list_t::take(block_id_t block_id) {
+    return sequence_numbers_.erase(block_id) != 0;
+}
+
 evicter_t::evicter_t()
     : initialized_(false),
       page_cache_(NULL),
@@ -135,7 +155,9 @@ void evicter_t::add_to_evictable_unbacked(page_t *page) {
 void evicter_t::add_to_evictable_disk_backed(page_t *page) {
     assert_thread();
     guarantee(initialized_);
-    evictable_disk_backed_.add(page, page->hypothetical_memory_usage(page_cache_));
+    rassert(!page->protected_);
+    evictable_disk_backed_probation_.add(page,
+                                         page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
     notify_bytes_loading(page->hypothetical_memory_usage(page_cache_));
 }
@@ -146,7 +168,8 @@ void evicter_t::move_unevictable_to_evictable(page_t *page) {
     rassert(unevictable_.has_page(page));
     unevictable_.remove(page, page->hypothetical_memory_usage(page_cache_));
     eviction_bag_t *new_bag = correct_eviction_category(page);
-    rassert(new_bag == &evictable_disk_backed_
+    rassert(new_bag == &evictable_disk_backed_probation_
+            || new_bag == &evictable_disk_backed_protected_
             || new_bag == &evictable_unbacked_);
     new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
@@ -171,7 +194,9 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     } else if (!page->is_loaded()) {
         return &evicted_;
     } else if (page->is_disk_backed()) {
-        return &evictable_disk_backed_;
+        return page->protected_
+            ? &evictable_disk_backed_protected_
+            : &evictable_disk_backed_probation_;
     } else {
         return &evictable_unbacked_;
     }
@@ -186,14 +211,70 @@ void evicter_t::remove_page(page_t *page) {
     notify_bytes_loading(-static_cast<int64_t>(page->hypothetical_memory_usage(page_cache_)));
 }
 
+void evicter_t::record_access(page_t *page, alt_access_hint_t hint) {
+    assert_thread();
+    guarantee(initialized_);
+    rassert(unevictable_.has_page(page));
+
+    if (page->is_loaded()) {
+        ++pm_hits;
+    } else {
+        ++pm_misses;
+    }
+
+    if (hint == alt_access_hint_t::no_promote || page->protected_) {
+        return;
+    }
+
+    if (page->accessed_) {
+        page->protected_ = true;
+        ++pm_promotions;
+    } else if (ghosts_.take(page->block_id())) {
+        page->protected_ = true;
+        ++pm_ghost_hits;
+    } else {
+        page->accessed_ = true;
+    }
+}
+
 uint64_t evicter_t::in_memory_size() const {
     assert_thread();
     guarantee(initialized_);
     return unevictable_.size()
-        + evictable_disk_backed_.size()
+        + evictable_disk_backed_probation_.size()
+        + evictable_disk_backed_protected_.size()
         + evictable_unbacked_.size();
 }
 
+bool evicter_t::remove_victim(page_t **page_out) {
+    eviction_bag_t *first = &evictable_disk_backed_protected_;
+    eviction_bag_t *second = &evictable_disk_backed_probation_;
+    if (evictable_disk_backed_probation_.size()
+        > memory_limit_ / PROBATION_SHARE_DIVISOR) {
+        std::swap(first, second);
+    }
+
+    page_t *page;
+    if (!first->remove_oldish(&page, access_time_counter_, page_cache_)
+        && !second->remove_oldish(&page, access_time_counter_, page_cache_)) {
+        return false;
+    }
+
+    // An evicted page starts over on probation if it's loaded again -- unless
+    // that happens while it's still on the ghost list.
+    if (page->protected_) {
+        page->protected_ = false;
+    } else {
+        const uint64_t ghost_capacity
+            = memory_limit_ / page_cache_->max_block_size().ser_value() / 2;
+        ghosts_.add(page->block_id(), std::max<uint64_t>(ghost_capacity, 1));
+    }
+    page->accessed_ = false;
+
+    *page_out = page;
+    return true;
+}
+
 void evicter_t::evict_if_necessary() THROWS_NOTHING {
     assert_thread();
     guarantee(initialized_);
@@ -211,9 +292,7 @@ void evicter_t::evict_if_necessary() THROWS_NOTHING {
 
     evict_if_necessary_active_ = true;
     page_t *page;
-    while (in_memory_size() > memory_limit_
-           && evictable_disk_backed_.remove_oldish(&page, access_time_counter_,
-                                                   page_cache_)) {
+    while (in_memory_size() > memory_limit_ && remove_victim(&page)) {
         evicted_.add(page, page->hypothetical_memory_usage(page_cache_));
         page->evict_self(page_cache_);
         page_cache_->consider_evicting_current_page(page->block_id());
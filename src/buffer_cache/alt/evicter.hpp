@@ -3,20 +3,58 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <functional>
+#include <unordered_map>
+#include <utility>
 
 #include "buffer_cache/alt/eviction_bag.hpp"
 #include "concurrency/cache_line_padded.hpp"
 #include "concurrency/pubsub.hpp"
+#include "perfmon/perfmon.hpp"
+#include "serializer/types.hpp"
 #include "threading.hpp"
 
 class cache_balancer_t;
 class alt_txn_throttler_t;
+enum class alt_access_hint_t;
 
 namespace alt {
 
 class page_cache_t;
 
+// Remembers the block ids of the most recently evicted probationary pages, so that
+// we can tell when a page that gets loaded again was evicted too early.
+class ghost_list_t {
+public:
+    ghost_list_t();
+
+    // Remembers block_id, forgetting the oldest block ids beyond `capacity`.
+    void add(block_id_t block_id, size_t capacity);
+
+    // Returns true if block_id is remembered, and forgets it.
+    bool take(block_id_t block_id);
+
+private:
+    uint64_t next_sequence_number_;
+    // Block ids in the order they were added, with the sequence number of the
+    // add.  Entries that were taken or added again stay here until they reach the
+    // front, and still count against the capacity.
+    std::deque<std::pair<block_id_t, uint64_t> > queue_;
+    // The sequence number of each remembered block id's latest add.
+    std::unordered_map<block_id_t, uint64_t> sequence_numbers_;
+
+    DISABLE_COPYING(ghost_list_t);
+};
+
+// The evicter uses a scan resistant replacement policy in the style of 2Q.  Disk
+// backed evictable pages start out on probation, and get protected once they're
+// accessed a second time, or once they're loaded again soon after having been
+// evicted from probation (which the ghost list keeps track of).  We evict from the
+// probationary pages as long as they use more than a fixed share of the memory
+// limit, so that a large scan can only push out the pages it loaded itself, and
+// not the working set that has been accessed repeatedly.  Within each set, victims
+// are chosen by sampling access times.
 class evicter_t : public home_thread_mixin_debug_only_t {
 public:
     void add_not_yet_loaded(page_t *page);
@@ -34,6 +72,10 @@ public:
     void remove_page(page_t *page);
     void reloading_page(page_t *page);
 
+    // Called for every page_acq_t, after the page has become unevictable.  Updates
+    // the hit rate stats and possibly promotes the page.
+    void record_access(page_t *page, alt_access_hint_t hint);
+
     // Evicter will be unusable until initialize is called
     explicit evicter_t();
     ~evicter_t();
@@ -61,6 +103,16 @@ public:
     // rollovers.
     static const uint64_t INITIAL_ACCESS_TIME = UINT64_MAX - 100;
 
+    // Probationary pages get to use 1/PROBATION_SHARE_DIVISOR of the memory limit
+    // before we evict protected pages.
+    static const uint64_t PROBATION_SHARE_DIVISOR = 4;
+
+    // These are exposed through alt_cache_stats_t.
+    perfmon_counter_t pm_hits;
+    perfmon_counter_t pm_misses;
+    perfmon_counter_t pm_promotions;
+    perfmon_counter_t pm_ghost_hits;
+
 private:
     friend class usage_adjuster_t;
 
@@ -70,6 +122,10 @@ private:
     // Evicts any evictable pages until under the memory limit
     void evict_if_necessary() THROWS_NOTHING;
 
+    // Removes the next page to evict from its evictable bag.  Returns false if
+    // there are no evictable disk backed pages.
+    bool remove_victim(page_t **page_out);
+
     bool initialized_;
     page_cache_t *page_cache_;
     cache_balancer_t *balancer_;
@@ -92,10 +148,13 @@ private:
 
     // These track every page's eviction status.
     eviction_bag_t unevictable_;
-    eviction_bag_t evictable_disk_backed_;
+    eviction_bag_t evictable_disk_backed_probation_;
+    eviction_bag_t evictable_disk_backed_protected_;
     eviction_bag_t evictable_unbacked_;
     eviction_bag_t evicted_;
 
+    ghost_list_t ghosts_;
+
     DISABLE_COPYING(evicter_t);
 };
 
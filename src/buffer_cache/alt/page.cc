@@ -43,6 +43,8 @@ page_t::page_t(block_id_t block_id, page_cache_t *page_cache)
     : block_id_(block_id),
       loader_(NULL),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_(false),
+      protected_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_deferred_loaded(this);
 
@@ -57,6 +59,8 @@ page_t::page_t(block_id_t block_id, page_cache_t *page_cache,
     : block_id_(block_id),
       loader_(NULL),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_(false),
+      protected_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
 
@@ -73,6 +77,8 @@ page_t::page_t(block_id_t block_id, buf_ptr_t buf,
       loader_(NULL),
       buf_(std::move(buf)),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_(false),
+      protected_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_unbacked(this);
@@ -87,6 +93,8 @@ page_t::page_t(block_id_t block_id,
       buf_(std::move(buf)),
       block_token_(block_token),
       access_time_(READ_AHEAD_ACCESS_TIME),
+      accessed_(false),
+      protected_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_disk_backed(this);
@@ -96,6 +104,8 @@ page_t::page_t(page_t *copyee, page_cache_t *page_cache, cache_account_t *accoun
     : block_id_(copyee->block_id_),
       loader_(NULL),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_(copyee->accessed_),
+      protected_(copyee->protected_),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
     coro_t::spawn_now_dangerously(std::bind(&page_t::load_from_copyee,
@@ -133,7 +143,8 @@ void page_t::load_from_copyee(page_t *page, page_t *copyee,
     // Okay, it's safe to block.
     {
         page_acq_t acq;
-        acq.init(copyee, page_cache, account);
+        // Copying the page for a writer isn't an access of the old version.
+        acq.init(copyee, page_cache, account, alt_access_hint_t::no_promote);
         acq.buf_ready_signal()->wait();
 
         ASSERT_FINITE_CORO_WAITING;
@@ -562,13 +573,16 @@ page_acq_t::page_acq_t() : page_(NULL), page_cache_(NULL) {
 }
 
 void page_acq_t::init(page_t *page, page_cache_t *page_cache,
-                      cache_account_t *account) {
+                      cache_account_t *account, alt_access_hint_t hint) {
     rassert(page_ == NULL);
     rassert(page_cache_ == NULL);
     rassert(!buf_ready_signal_.is_pulsed());
     page_ = page;
     page_cache_ = page_cache;
     page_->add_waiter(this, account);
+    // Now that we're a waiter, the page is unevictable, so the evicter may change
+    // which evictable bag it'll go back to.
+    page_cache_->evicter().record_access(page_, hint);
 }
 
 page_acq_t::~page_acq_t() {
@@ -9,6 +9,11 @@
 
 class cache_account_t;
 
+// Passed by readers that go through lots of blocks they're unlikely to come back
+// to soon (range traversals, backfills), so that their accesses don't promote
+// pages out of the evicter's probationary set.  See evicter_t.
+enum class alt_access_hint_t { normal, no_promote };
+
 namespace alt {
 
 class page_cache_t;
@@ -82,6 +87,7 @@ public:
 private:
     friend class page_ptr_t;
     friend class deferred_page_loader_t;
+    friend class evicter_t;  // for accessed_ and protected_.
     static bool loader_is_loading(page_loader_t *loader);
     void add_snapshotter();
     void remove_snapshotter(page_cache_t *page_cache);
@@ -131,6 +137,15 @@ private:
 
     uint64_t access_time_;
 
+    // The evicter's replacement policy state.  accessed_ says the page has been
+    // accessed since it was loaded, and protected_ says it has been accessed
+    // again after that, which moves it from the probationary to the protected
+    // set of evictable pages.  protected_ only changes while the page is in the
+    // unevictable bag (or is being evicted), since it determines which evictable
+    // bag the page belongs in.
+    bool accessed_;
+    bool protected_;
+
     // How many page_ptr_t's point at this page, expecting nothing to modify it,
     // other than themselves.
     size_t snapshot_refcount_;
@@ -146,7 +161,8 @@ private:
     // if loader_ is non-null:  unevictable_pages_
     // else if waiters_ is non-empty: unevictable_pages_
     // else if buf_ is null: evicted_pages_ (and block_token_ is non-null)
-    // else if block_token_ is non-null: evictable_disk_backed_pages_
+    // else if block_token_ is non-null: evictable_disk_backed_probation_pages_,
+    //     or evictable_disk_backed_protected_pages_ if protected_ is set
     // else: evictable_unbacked_pages_ (buf_ is non-null, block_token_ is null)
     //
     // So, when loader_, waiters_, buf_, or block_token_ is touched, we might
@@ -227,7 +243,8 @@ public:
     page_acq_t();
     ~page_acq_t();
 
-    void init(page_t *page, page_cache_t *page_cache, cache_account_t *account);
+    void init(page_t *page, page_cache_t *page_cache, cache_account_t *account,
+              alt_access_hint_t hint);
 
     page_cache_t *page_cache() const {
         rassert(page_cache_ != NULL);
@@ -1,10 +1,16 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "buffer_cache/alt/stats.hpp"
 
+#include "buffer_cache/alt/evicter.hpp"
 #include "perfmon/perfmon.hpp"
 
-alt_cache_stats_t::alt_cache_stats_t(perfmon_collection_t *parent)
+alt_cache_stats_t::alt_cache_stats_t(perfmon_collection_t *parent,
+                                     alt::evicter_t *evicter)
     : cache_collection(),
       cache_membership(parent, &cache_collection, "cache"),
-      cache_collection_membership(&cache_collection) { }
+      cache_collection_membership(&cache_collection,
+                                  &evicter->pm_hits, "page_hits",
+                                  &evicter->pm_misses, "page_misses",
+                                  &evicter->pm_promotions, "page_promotions",
+                                  &evicter->pm_ghost_hits, "page_ghost_hits") { }
 
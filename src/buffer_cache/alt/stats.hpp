@@ -4,9 +4,11 @@
 
 #include "perfmon/perfmon.hpp"
 
+namespace alt { class evicter_t; }
+
 class alt_cache_stats_t {
 public:
-    explicit alt_cache_stats_t(perfmon_collection_t *parent);
+    alt_cache_stats_t(perfmon_collection_t *parent, alt::evicter_t *evicter);
 
     perfmon_collection_t cache_collection;
     perfmon_membership_t cache_membership;
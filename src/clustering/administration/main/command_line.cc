@@ -681,6 +681,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
                           const name_string_t &machine_name,
                           const file_direct_io_mode_t direct_io_mode,
                           const int max_concurrent_io_requests,
+                          const file_io_backend_t io_backend,
                           bool *const result_out) {
     machine_id_t our_machine_id = generate_uuid();
 
@@ -692,7 +693,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
     machine_semilattice_metadata.datacenter = vclock_t<datacenter_id_t>(nil_uuid(), our_machine_id);
     cluster_metadata.machines.machines.insert(std::make_pair(our_machine_id, make_deletable(machine_semilattice_metadata)));
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests, io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -777,6 +778,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                          serve_info_t *serve_info,
                          const file_direct_io_mode_t direct_io_mode,
                          const int max_concurrent_io_requests,
+                         const file_io_backend_t io_backend,
                          const uint64_t total_cache_size,
                          const machine_id_t *our_machine_id,
                          const cluster_semilattice_metadata_t *cluster_metadata,
@@ -807,7 +809,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 
     logINF("Loading data from directory %s\n", base_path.path().c_str());
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests, io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -867,6 +869,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const name_string_t &machine_name,
                              const file_direct_io_mode_t direct_io_mode,
                              const int max_concurrent_io_requests,
+                             const file_io_backend_t io_backend,
                              const uint64_t total_cache_size,
                              const bool new_directory,
                              serve_info_t *serve_info,
@@ -874,7 +877,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              bool *const result_out) {
     if (!new_directory) {
         run_rethinkdb_serve(base_path, serve_info, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, io_backend, total_cache_size,
                             NULL, NULL, data_directory_lock,
                             result_out);
     } else {
@@ -907,7 +910,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
         }
 
         run_rethinkdb_serve(base_path, serve_info, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, io_backend, total_cache_size,
                             &our_machine_id, &cluster_metadata,
                             data_directory_lock, result_out);
     }
@@ -961,6 +964,17 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
     options_out->push_back(options::option_t(options::names_t("--no-direct-io"),
                                              options::OPTIONAL_NO_PARAMETER));
     help.add("--no-direct-io", "disable direct I/O");
+    options_out->push_back(options::option_t(options::names_t("--io-backend"),
+                                             options::OPTIONAL,
+                                             "pool"));
+    help.add("--io-backend {pool|io_uring}",
+             "how I/O operations are issued: by a pool of blocking threads, or "
+             "directly from the event loop through io_uring (Linux only)");
+    options_out->push_back(options::option_t(options::names_t("--block-compression"),
+                                             options::OPTIONAL,
+                                             "none"));
+    help.add("--block-compression {none|zlib}",
+             "whether the data files of newly created tables compress their blocks");
     options_out->push_back(options::option_t(options::names_t("--cache-size"),
                                              options::OPTIONAL));
     help.add("--cache-size mb", "total cache size (in megabytes) for the process");
@@ -1085,6 +1099,13 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              join_required ? options::MANDATORY_REPEAT : options::OPTIONAL_REPEAT));
     help.add("-j [ --join ] host:port", "host and port of a rethinkdb node to connect to");
 
+    options_out->push_back(options::option_t(options::names_t("--cluster-compression"),
+                                             options::OPTIONAL,
+                                             "none"));
+    help.add("--cluster-compression {none|zlib}",
+             "whether connections to other nodes compress the data they send; only "
+             "used if the node at the other end asks for it too");
+
     options_out->push_back(options::option_t(options::names_t("--reql-http-proxy"),
                                              options::OPTIONAL));
     help.add("--reql-http-proxy [protocol://]host[:port]", "HTTP proxy to use for performing `r.http(...)` queries, default port is 1080");
@@ -1291,6 +1312,51 @@ MUST_USE bool parse_io_threads_option(const std::map<std::string, options::value
     return true;
 }
 
+MUST_USE bool parse_io_backend_option(const std::map<std::string, options::values_t> &opts,
+                                      file_io_backend_t *io_backend_out) {
+    const std::string io_backend = get_single_option(opts, "--io-backend");
+    if (io_backend == "pool") {
+        *io_backend_out = file_io_backend_t::blocker_pool;
+    } else if (io_backend == "io_uring") {
+        *io_backend_out = file_io_backend_t::io_uring;
+    } else {
+        fprintf(stderr, "ERROR: io-backend must be either 'pool' or 'io_uring'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_block_compression_option(
+        const std::map<std::string, options::values_t> &opts,
+        block_compression_t *block_compression_out) {
+    const std::string block_compression = get_single_option(opts, "--block-compression");
+    if (block_compression == "none") {
+        *block_compression_out = block_compression_t::none;
+    } else if (block_compression == "zlib") {
+        *block_compression_out = block_compression_t::zlib;
+    } else {
+        fprintf(stderr, "ERROR: block-compression must be either 'none' or 'zlib'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_cluster_compression_option(
+        const std::map<std::string, options::values_t> &opts,
+        cluster_compression_t *cluster_compression_out) {
+    const std::string cluster_compression
+        = get_single_option(opts, "--cluster-compression");
+    if (cluster_compression == "none") {
+        *cluster_compression_out = cluster_compression_t::none;
+    } else if (cluster_compression == "zlib") {
+        *cluster_compression_out = cluster_compression_t::zlib;
+    } else {
+        fprintf(stderr, "ERROR: cluster-compression must be either 'none' or 'zlib'\n");
+        return false;
+    }
+    return true;
+}
+
 file_direct_io_mode_t parse_direct_io_mode_option(const std::map<std::string, options::values_t> &opts) {
     return exists_option(opts, "--no-direct-io") ?
         file_direct_io_mode_t::buffered_desired :
@@ -1325,6 +1391,11 @@ int main_rethinkdb_create(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        file_io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         const int num_workers = get_cpu_count();
 
         bool is_new_directory = false;
@@ -1348,6 +1419,7 @@ int main_rethinkdb_create(int argc, char *argv[]) {
                                      machine_name,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      &result),
                            num_workers);
 
@@ -1438,6 +1510,11 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        file_io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         uint64_t total_cache_size = get_total_cache_size(opts);
 
         // Open and lock the directory, but do not create it
@@ -1465,11 +1542,23 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
 
         extproc_spawner_t extproc_spawner;
 
+        block_compression_t block_compression;
+        if (!parse_block_compression_option(opts, &block_compression)) {
+            return EXIT_FAILURE;
+        }
+
+        cluster_compression_t cluster_compression;
+        if (!parse_cluster_compression_option(opts, &cluster_compression)) {
+            return EXIT_FAILURE;
+        }
+
         serve_info_t serve_info(std::move(joins),
                                 get_reql_http_proxy_option(opts),
                                 std::move(web_path),
                                 address_ports,
-                                get_optional_option(opts, "--config-file"));
+                                get_optional_option(opts, "--config-file"),
+                                block_compression,
+                                cluster_compression);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -1479,6 +1568,7 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      &serve_info,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
                                      static_cast<machine_id_t*>(NULL),
                                      static_cast<cluster_semilattice_metadata_t*>(NULL),
@@ -1586,11 +1676,18 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
 
         extproc_spawner_t extproc_spawner;
 
+        cluster_compression_t cluster_compression;
+        if (!parse_cluster_compression_option(opts, &cluster_compression)) {
+            return EXIT_FAILURE;
+        }
+
         serve_info_t serve_info(std::move(joins),
                                 get_reql_http_proxy_option(opts),
                                 std::move(web_path),
                                 address_ports,
-                                get_optional_option(opts, "--config-file"));
+                                get_optional_option(opts, "--config-file"),
+                                block_compression_t::none,
+                                cluster_compression);
 
         bool result;
         run_in_thread_pool(std::bind(&run_rethinkdb_proxy, &serve_info, &result),
@@ -1706,6 +1803,11 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        file_io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         uint64_t total_cache_size = get_total_cache_size(opts);
 
         // Attempt to create the directory early so that the log file can use it.
@@ -1743,11 +1845,23 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
 
         extproc_spawner_t extproc_spawner;
 
+        block_compression_t block_compression;
+        if (!parse_block_compression_option(opts, &block_compression)) {
+            return EXIT_FAILURE;
+        }
+
+        cluster_compression_t cluster_compression;
+        if (!parse_cluster_compression_option(opts, &cluster_compression)) {
+            return EXIT_FAILURE;
+        }
+
         serve_info_t serve_info(std::move(joins),
                                 get_reql_http_proxy_option(opts),
                                 std::move(web_path),
                                 address_ports,
-                                get_optional_option(opts, "--config-file"));
+                                get_optional_option(opts, "--config-file"),
+                                block_compression,
+                                cluster_compression);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -1757,6 +1871,7 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      machine_name,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
                                      is_new_directory,
                                      &serve_info,
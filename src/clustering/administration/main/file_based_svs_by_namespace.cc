@@ -171,8 +171,9 @@ file_based_svs_by_namespace_t::get_svs(
                                          stores_out_stores, store_views.data()));
             mptr.init(new multistore_ptr_t(store_views.data(), num_stores));
         } else {
-            standard_serializer_t::create(&file_opener,
-                                          standard_serializer_t::static_config_t());
+            standard_serializer_t::static_config_t static_config;
+            static_config.block_compression_ = block_compression_;
+            standard_serializer_t::create(&file_opener, static_config);
             {
                 scoped_ptr_t<serializer_t> ser
                     = make_scoped<standard_serializer_t>(
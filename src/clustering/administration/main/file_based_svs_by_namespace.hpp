@@ -6,6 +6,7 @@
 
 #include "clustering/administration/reactor_driver.hpp"
 #include "clustering/administration/issues/outdated_index.hpp"
+#include "serializer/log/config.hpp"
 
 class cache_balancer_t;
 class rdb_context_t;
@@ -15,9 +16,11 @@ public:
     file_based_svs_by_namespace_t(io_backender_t *io_backender,
                                   cache_balancer_t *balancer,
                                   const base_path_t& base_path,
+                                  block_compression_t block_compression,
                                   outdated_index_issue_client_t *_outdated_index_client)
         : io_backender_(io_backender), balancer_(balancer),
-          base_path_(base_path), thread_counter_(0),
+          base_path_(base_path), block_compression_(block_compression),
+          thread_counter_(0),
           outdated_index_client(_outdated_index_client) { }
 
     void get_svs(perfmon_collection_t *serializers_perfmon_collection,
@@ -34,6 +37,8 @@ private:
     io_backender_t *io_backender_;
     cache_balancer_t *balancer_;
     const base_path_t base_path_;
+    // Used for the serializer files of tables we create.
+    const block_compression_t block_compression_;
 
     threadnum_t next_thread(int num_db_threads);
     int thread_counter_; // should only be used by `next_thread`
@@ -168,7 +168,8 @@ bool do_serve(io_backender_t *io_backender,
                 serve_info.ports.local_addresses,
                 serve_info.ports.canonical_addresses,
                 serve_info.ports.port,
-                serve_info.ports.client_port));
+                serve_info.ports.client_port,
+                serve_info.cluster_compression));
 
             // Update the directory with the ip addresses that we are passing to peers
             std::set<ip_and_port_t> ips = connectivity_cluster_run->get_ips();
@@ -240,7 +241,9 @@ bool do_serve(io_backender_t *io_backender,
                               NULL,
                               auth_manager_cluster.get_root_view(),
                               &get_global_perfmon_collection(),
-                              serve_info.reql_http_proxy);
+                              serve_info.reql_http_proxy,
+                              io_backender,
+                              base_path);
 
         real_reql_cluster_interface_t reql_cluster_interface(
                 &mailbox_manager,
@@ -272,6 +275,7 @@ bool do_serve(io_backender_t *io_backender,
             if (i_am_a_server) {
                 rdb_svs_source.init(new file_based_svs_by_namespace_t(
                     io_backender, cache_balancer.get(), base_path,
+                    serve_info.block_compression,
                     &admin_tracker.outdated_index_client));
                 rdb_reactor_driver.init(new reactor_driver_t(
                         base_path,
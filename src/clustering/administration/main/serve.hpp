@@ -10,6 +10,8 @@
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/persist.hpp"
 #include "arch/address.hpp"
+#include "rpc/connectivity/compression.hpp"
+#include "serializer/log/config.hpp"
 
 class os_signal_cond_t;
 
@@ -92,12 +94,16 @@ public:
                  std::string &&_reql_http_proxy,
                  std::string &&_web_assets,
                  service_address_ports_t _ports,
-                 boost::optional<std::string> _config_file) :
+                 boost::optional<std::string> _config_file,
+                 block_compression_t _block_compression,
+                 cluster_compression_t _cluster_compression) :
         joins(std::move(_joins)),
         reql_http_proxy(std::move(_reql_http_proxy)),
         web_assets(std::move(_web_assets)),
         ports(_ports),
-        config_file(_config_file)
+        config_file(_config_file),
+        block_compression(_block_compression),
+        cluster_compression(_cluster_compression)
     { }
 
     void look_up_peers() {
@@ -110,6 +116,10 @@ public:
     std::string web_assets;
     service_address_ports_t ports;
     boost::optional<std::string> config_file;
+    // How the serializer files of newly created tables store their blocks.
+    block_compression_t block_compression;
+    // Whether our connections to other nodes ask to be compressed.
+    cluster_compression_t cluster_compression;
 };
 
 /* This has been factored out from `command_line.hpp` because it takes a very
@@ -61,10 +61,11 @@ class chunk_callback_t : public coro_pool_callback_t<backfill_queue_entry_t>,
 public:
     chunk_callback_t(store_view_t *_svs,
                      fifo_enforcer_queue_t<backfill_queue_entry_t> *_chunk_queue, mailbox_manager_t *_mbox_manager,
-                     mailbox_addr_t<void(int)> _allocation_mailbox) :
+                     mailbox_addr_t<void(int)> _allocation_mailbox,
+                     const region_map_t<version_range_t> *_end_point) :
         svs(_svs), chunk_queue(_chunk_queue), mbox_manager(_mbox_manager),
-        allocation_mailbox(_allocation_mailbox), unacked_chunks(0),
-        done_message_arrived(false), num_outstanding_chunks(0)
+        allocation_mailbox(_allocation_mailbox), end_point(_end_point),
+        unacked_chunks(0), done_message_arrived(false), num_outstanding_chunks(0)
     { }
 
     void apply_backfill_chunk(fifo_enforcer_write_token_t chunk_token, const backfill_chunk_t& chunk, signal_t *interruptor) {
@@ -78,6 +79,26 @@ public:
             throw;
         }
 
+        const backfill_chunk_t::checkpoint_t *checkpoint =
+            boost::get<backfill_chunk_t::checkpoint_t>(&chunk.val);
+        if (checkpoint != NULL) {
+            /* Everything in `checkpoint->region` has been applied (or at least
+            ordered before us on the store), so it has reached the end point. If
+            the backfill is interrupted, the next one will start from there. */
+            object_buffer_t<fifo_enforcer_sink_t::exit_write_t> write_token;
+            svs->new_write_token(&write_token);
+            chunk_queue->finish_write(chunk_token);
+
+            svs->set_metainfo(
+                region_map_transform<version_range_t, binary_blob_t>(
+                    end_point->mask(checkpoint->region),
+                    &binary_blob_t::make<version_range_t>),
+                order_token_t::ignore,
+                &write_token,
+                interruptor);
+            return;
+        }
+
         write_token_pair_t token_pair;
         svs->new_write_token_pair(&token_pair);
         chunk_queue->finish_write(chunk_token);
@@ -141,7 +162,8 @@ public:
                before the queue drains. That can only happen if we are
                being interrupted or if we lost contact with the backfiller.
                In either case, abort; the store will be left in a
-               half-backfilled state. */
+               half-backfilled state, except for the regions that the
+               backfiller checkpointed. */
         }
     }
 
@@ -152,6 +174,7 @@ private:
     fifo_enforcer_queue_t<backfill_queue_entry_t> *chunk_queue;
     mailbox_manager_t *mbox_manager;
     mailbox_addr_t<void(int)> allocation_mailbox;
+    const region_map_t<version_range_t> *end_point;
     int unacked_chunks;
     bool done_message_arrived;
     int num_outstanding_chunks;
@@ -297,7 +320,8 @@ void backfillee(
         /* Indicate in the metadata that a backfill is happening. We do this by
         marking every region as indeterminate between the current state and the
         backfill end state, since we don't know whether the backfill has reached
-        that region yet. */
+        that region yet. As the backfiller sends checkpoints, `chunk_callback_t`
+        marks the regions that it's done with as having reached the end state. */
 
         typedef region_map_t<version_range_t> version_map_t;
 
@@ -338,7 +362,8 @@ void backfillee(
             &write_token,
             interruptor);
 
-        chunk_callback_t chunk_callback(svs, &chunk_queue, mailbox_manager, allocation_mailbox);
+        chunk_callback_t chunk_callback(svs, &chunk_queue, mailbox_manager,
+                                        allocation_mailbox, &end_point);
 
         coro_pool_t<backfill_queue_entry_t> backfill_workers(CHUNK_PROCESSING_CONCURRENCY,
                                                              &chunk_queue, &chunk_callback);
@@ -184,7 +184,9 @@ void backfiller_t::on_backfill(backfill_session_id_t session_id,
         backfiller_send_backfill_callback_t
             send_backfill_cb(&start_point, end_point_cont, mailbox_manager, chunk_cont, &fifo_src, &chunk_semaphore, this);
 
-        /* Actually perform the backfill */
+        /* Actually perform the backfill. If an earlier backfill into this
+        backfillee was interrupted, `start_point` has the regions that it
+        checkpointed at that backfill's end point, so it resumes from there. */
         svs->send_backfill(
                      region_map_transform<version_range_t, state_timestamp_t>(
                                                       start_point,
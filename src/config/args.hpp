@@ -83,6 +83,11 @@
 // Ratio of free ram to use for the cache by default
 #define DEFAULT_MAX_CACHE_RATIO                   2
 
+// How much memory each cache may use for the Bloom filters of the keys in btree
+// leaf nodes, which let point reads for missing keys skip loading the leaf.  (Set
+// this to 0 to turn the filters off.)
+#define LEAF_KEY_FILTER_MEMORY_LIMIT              (4 * MEGABYTE)
+
 // The maximum number of concurrently active
 // index writes per merger serializer.
 // The smaller the number, the more effective
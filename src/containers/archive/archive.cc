@@ -76,6 +76,10 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
+void write_message_t::splice(write_message_t *other) {
+    buffers_.append_and_clear(&other->buffers_);
+}
+
 size_t write_message_t::size() const {
     size_t ret = 0;
     for (write_buffer_t *h = buffers_.head(); h != NULL; h = buffers_.next(h)) {
@@ -96,6 +100,14 @@ int send_write_message(write_stream_t *s, const write_message_t *wm) {
     return 0;
 }
 
+int send_write_message(write_stream_t *s, write_message_t &&wm) {
+    return s->take_message(&wm);
+}
+
+int write_stream_t::take_message(write_message_t *wm) {
+    return send_write_message(this, const_cast<const write_message_t *>(wm));
+}
+
 // You MUST NOT change the behavior of serialize_universal and deserialize_universal
 // functions!  (You could find a way to remove their callers and remove them though.)
 void serialize_universal(write_message_t *wm, const uuid_u &uuid) {
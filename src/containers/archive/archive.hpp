@@ -80,11 +80,17 @@ private:
 // non-negative value less than n upon EOF.
 MUST_USE int64_t force_read(read_stream_t *s, void *p, int64_t n);
 
+class write_message_t;
+
 class write_stream_t {
 public:
     write_stream_t() { }
     // Returns n, or -1 upon error. Blocks until all bytes are written.
     virtual MUST_USE int64_t write(const void *p, int64_t n) = 0;
+    // Writes the contents of `wm`, possibly by taking its buffers instead of copying
+    // them.  Returns 0, or -1 upon error.  The default calls `write()` on each
+    // buffer.  (Use `send_write_message()` instead of calling this.)
+    virtual MUST_USE int take_message(write_message_t *wm);
 protected:
     virtual ~write_stream_t() { }
 private:
@@ -116,6 +122,10 @@ public:
 
     void append(const void *p, int64_t n);
 
+    // Moves the buffers of `other` to the end of this message, without copying
+    // them, and leaves `other` empty.
+    void splice(write_message_t *other);
+
     size_t size() const;
 
     intrusive_list_t<write_buffer_t> *unsafe_expose_buffers() { return &buffers_; }
@@ -130,6 +140,9 @@ private:
 
 // Returns 0 upon success, -1 upon failure.
 MUST_USE int send_write_message(write_stream_t *s, const write_message_t *wm);
+// Like the above, but the stream may take `wm`'s buffers and send them without
+// copying them (see `write_stream_t::take_message()`).
+MUST_USE int send_write_message(write_stream_t *s, write_message_t &&wm);
 
 template <class T>
 T *deserialize_deref(T &val) {  // NOLINT(runtime/references)
@@ -1,6 +1,8 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "containers/archive/tcp_conn_stream.hpp"
 
+#include <vector>
+
 #include "arch/io/network.hpp"
 
 tcp_conn_stream_t::tcp_conn_stream_t(const ip_address_t &host, int port, signal_t *interruptor, int local_port)
@@ -39,6 +41,26 @@ int64_t tcp_conn_stream_t::write(const void *p, int64_t n) {
     }
 }
 
+int tcp_conn_stream_t::take_message(write_message_t *wm) {
+    intrusive_list_t<write_buffer_t> *buffers = wm->unsafe_expose_buffers();
+    std::vector<iovec> iov;
+    iov.reserve(buffers->size());
+    for (write_buffer_t *b = buffers->head(); b != NULL; b = buffers->next(b)) {
+        iovec v;
+        v.iov_base = b->data;
+        v.iov_len = b->size;
+        iov.push_back(v);
+    }
+    try {
+        // writev writes everything or throws an exception.
+        cond_t non_closer;
+        conn_->writev(iov.data(), iov.size(), &non_closer);
+        return 0;
+    } catch (const tcp_conn_write_closed_exc_t &) {
+        return -1;
+    }
+}
+
 void tcp_conn_stream_t::rethread(threadnum_t new_thread) {
     conn_->rethread(new_thread);
 }
@@ -98,6 +120,14 @@ int64_t keepalive_tcp_conn_stream_t::write(const void *p, int64_t n) {
     return tcp_conn_stream_t::write(p, n);
 }
 
+int keepalive_tcp_conn_stream_t::take_message(write_message_t *wm) {
+    if (keepalive_callback != NULL) {
+        keepalive_callback->keepalive_write();
+    }
+
+    return tcp_conn_stream_t::take_message(wm);
+}
+
 rethread_tcp_conn_stream_t::rethread_tcp_conn_stream_t(tcp_conn_stream_t *conn, threadnum_t thread)
     : conn_(conn), old_thread_(conn->home_thread()), new_thread_(thread) {
     conn->rethread(thread);
@@ -19,6 +19,8 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    // Sends `wm`'s buffers with one `writev()`.
+    virtual MUST_USE int take_message(write_message_t *wm);
 
     void rethread(threadnum_t new_thread);
 
@@ -58,6 +60,7 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    virtual MUST_USE int take_message(write_message_t *wm);
 
 private:
     keepalive_callback_t *keepalive_callback;
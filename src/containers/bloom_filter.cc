@@ -0,0 +1,81 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "containers/bloom_filter.hpp"
+
+#include <algorithm>
+
+bloom_filter_t::bloom_filter_t() : num_bits_(0), num_hashes_(0) { }
+
+bloom_filter_t::bloom_filter_t(size_t expected_elements, int bits_per_element) {
+    guarantee(bits_per_element > 0);
+    const uint64_t words =
+        (std::max<uint64_t>(expected_elements, 1) * bits_per_element + 63) / 64;
+    bits_.resize(words, 0);
+    num_bits_ = words * 64;
+    // k = ln(2) * bits per element minimizes the false positive rate.
+    num_hashes_ = std::max(1, static_cast<int>(bits_per_element * 0.69 + 0.5));
+}
+
+bloom_filter_t::bloom_filter_t(bloom_filter_t &&movee)
+    : bits_(std::move(movee.bits_)),
+      num_bits_(movee.num_bits_),
+      num_hashes_(movee.num_hashes_) {
+    movee.num_bits_ = 0;
+    movee.num_hashes_ = 0;
+}
+
+bloom_filter_t &bloom_filter_t::operator=(bloom_filter_t &&movee) {
+    bits_ = std::move(movee.bits_);
+    num_bits_ = movee.num_bits_;
+    num_hashes_ = movee.num_hashes_;
+    movee.num_bits_ = 0;
+    movee.num_hashes_ = 0;
+    return *this;
+}
+
+// The k bit positions are derived from the two halves of a single 64-bit hash
+// (Kirsch and Mitzenmacher's double hashing), so we only hash the data once.
+
+void bloom_filter_t::add(const void *data, size_t size) {
+    guarantee(num_bits_ != 0);
+    const uint64_t h = hash(data, size);
+    const uint64_t h1 = h & 0xFFFFFFFFu;
+    const uint64_t h2 = (h >> 32) | 1;
+    for (int i = 0; i < num_hashes_; ++i) {
+        const uint64_t bit = (h1 + i * h2) % num_bits_;
+        bits_[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool bloom_filter_t::may_contain(const void *data, size_t size) const {
+    guarantee(num_bits_ != 0);
+    const uint64_t h = hash(data, size);
+    const uint64_t h1 = h & 0xFFFFFFFFu;
+    const uint64_t h2 = (h >> 32) | 1;
+    for (int i = 0; i < num_hashes_; ++i) {
+        const uint64_t bit = (h1 + i * h2) % num_bits_;
+        if ((bits_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t bloom_filter_t::memory_size() const {
+    return sizeof(*this) + bits_.capacity() * sizeof(uint64_t);
+}
+
+uint64_t bloom_filter_t::hash(const void *data, size_t size) {
+    // FNV-1a, followed by a finalizer so that both halves are well mixed.
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,42 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_BLOOM_FILTER_HPP_
+#define CONTAINERS_BLOOM_FILTER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "errors.hpp"
+
+/* A Bloom filter over byte strings: `may_contain()` is true for everything that was
+`add()`ed, and false for most other strings.  With the default of 10 bits per
+element about 1% of the strings that weren't added get a false positive. */
+class bloom_filter_t {
+public:
+    static const int DEFAULT_BITS_PER_ELEMENT = 10;
+
+    bloom_filter_t();
+    explicit bloom_filter_t(size_t expected_elements,
+                            int bits_per_element = DEFAULT_BITS_PER_ELEMENT);
+
+    bloom_filter_t(bloom_filter_t &&movee);
+    bloom_filter_t &operator=(bloom_filter_t &&movee);
+
+    void add(const void *data, size_t size);
+    bool may_contain(const void *data, size_t size) const;
+
+    // The number of bytes the filter occupies in memory.
+    size_t memory_size() const;
+
+private:
+    static uint64_t hash(const void *data, size_t size);
+
+    std::vector<uint64_t> bits_;
+    uint64_t num_bits_;
+    int num_hashes_;
+
+    DISABLE_COPYING(bloom_filter_t);
+};
+
+#endif  // CONTAINERS_BLOOM_FILTER_HPP_
@@ -40,9 +40,37 @@ protected:
     DISABLE_COPYING(buffer_group_viewer_t);
 };
 
+/* The file, serializer and cache that disk backed queues store their blocks in.
+Each queue normally has its own, but several queues can share one, so that a user
+that needs many short queues at once doesn't pay for a serializer and a cache per
+queue. */
+class disk_backed_queue_file_t {
+public:
+    disk_backed_queue_file_t(io_backender_t *io_backender,
+                             const serializer_filepath_t &filename,
+                             perfmon_collection_t *stats_parent);
+    ~disk_backed_queue_file_t();
+
+private:
+    friend class internal_disk_backed_queue_t;
+
+    perfmon_collection_t perfmon_collection;
+    perfmon_membership_t perfmon_membership;
+
+    scoped_ptr_t<standard_serializer_t> serializer;
+    scoped_ptr_t<cache_balancer_t> balancer;
+    scoped_ptr_t<cache_t> cache;
+    scoped_ptr_t<cache_conn_t> cache_conn;
+
+    DISABLE_COPYING(disk_backed_queue_file_t);
+};
+
 class internal_disk_backed_queue_t {
 public:
     internal_disk_backed_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent);
+    // Stores the queue in `file`, which must outlive it.  Blocks the queue still
+    // holds when it's destroyed aren't freed until `file` is.
+    explicit internal_disk_backed_queue_t(disk_backed_queue_file_t *file);
     ~internal_disk_backed_queue_t();
 
     void push(const write_message_t &value);
@@ -63,8 +91,6 @@ private:
 
     // Serves more as sanity-checking for the cache than this type's ordering.
     order_source_t cache_order_source;
-    perfmon_collection_t perfmon_collection;
-    perfmon_membership_t perfmon_membership;
 
     int64_t queue_size;
 
@@ -72,10 +98,10 @@ private:
     block_id_t head_block_id;
     // The end we pop from.
     block_id_t tail_block_id;
-    scoped_ptr_t<standard_serializer_t> serializer;
-    scoped_ptr_t<cache_balancer_t> balancer;
-    scoped_ptr_t<cache_t> cache;
-    scoped_ptr_t<cache_conn_t> cache_conn;
+
+    // Set if the queue has a file of its own.
+    scoped_ptr_t<disk_backed_queue_file_t> own_file;
+    disk_backed_queue_file_t *const file;
 
     DISABLE_COPYING(internal_disk_backed_queue_t);
 };
@@ -106,6 +132,8 @@ class disk_backed_queue_t {
 public:
     disk_backed_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent)
         : internal_(io_backender, filename, stats_parent) { }
+    explicit disk_backed_queue_t(disk_backed_queue_file_t *file)
+        : internal_(file) { }
 
     void push(const T &t) {
         // TODO: There's an unnecessary copying of data here (which would require a
@@ -119,6 +147,15 @@ public:
         internal_.push(wm);
     }
 
+    // Pushes all of `ts` in a single transaction.
+    void push(const std::vector<T> &ts) {
+        scoped_array_t<write_message_t> wms(ts.size());
+        for (size_t i = 0; i < ts.size(); ++i) {
+            serialize<cluster_version_t::LATEST_OVERALL>(&wms[i], ts[i]);
+        }
+        internal_.push(wms);
+    }
+
     void pop(T *out) {
         deserializing_viewer_t<T> viewer(out);
         internal_.pop(&viewer);
@@ -12,6 +12,7 @@
 #include "containers/archive/stl_types.hpp"
 #include "extproc/extproc_job.hpp"
 #include "http/http_parser.hpp"
+#include "rdb_protocol/datum_json.hpp"
 #include "rdb_protocol/env.hpp"
 
 #define RETHINKDB_USER_AGENT (SOFTWARE_NAME_STRING "/" RETHINKDB_VERSION)
@@ -821,9 +822,9 @@ void json_to_datum(const std::string &json,
                    const ql::configured_limits_t &limits,
                    attach_json_to_error_t attach_json,
                    http_result_t *res_out) {
-    scoped_cJSON_t cjson(cJSON_Parse(json.c_str()));
-    if (cjson.get() != NULL) {
-        res_out->body = ql::to_datum(cjson.get(), limits);
+    ql::datum_t parsed = ql::parse_json(json, limits);
+    if (parsed.has()) {
+        res_out->body = std::move(parsed);
     } else {
         res_out->error.assign("failed to parse JSON response");
         if (attach_json == attach_json_to_error_t::YES) {
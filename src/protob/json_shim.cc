@@ -174,6 +174,11 @@ void extract(cJSON *json, Query *q) {
     transfer_arr(cJSON_slow_GetArrayItem(json, 2), q, &Query::add_global_optargs);
 }
 
+// This still goes through cJSON rather than `ql::parse_json`.  The query is a
+// term tree, not data: its arrays are [type, args, optargs] triples that become
+// protobuf messages, so the datum builder doesn't fit, and the datum rules (array
+// size limit, no duplicate keys) mustn't apply to it.  Going through datums would
+// also add a conversion pass.
 bool parse_json_pb(Query *q, int64_t token, const char *str) THROWS_NOTHING {
     try {
         q->Clear();
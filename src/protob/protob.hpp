@@ -18,6 +18,7 @@
 #include "containers/archive/archive.hpp"
 #include "http/http.hpp"
 
+#include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/counted_term.hpp"
 
@@ -35,6 +36,7 @@ public:
     // Holy shit, this field gets MODIFIED!
     signal_t *interruptor;
     ql::stream_cache_t stream_cache;
+    ql::query_cache_t query_cache;
 };
 
 class http_conn_cache_t : public repeating_timer_callback_t {
@@ -11,14 +11,18 @@
 #include <boost/optional.hpp>
 
 #include "btree/backfill.hpp"
+#include "btree/bulk_load.hpp"
 #include "btree/concurrent_traversal.hpp"
+#include "btree/count.hpp"
 #include "btree/erase_range.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
 #include "btree/parallel_traversal.hpp"
 #include "btree/slice.hpp"
+#include "btree/superblock.hpp"
 #include "buffer_cache/alt/serialize_onto_blob.hpp"
 #include "concurrency/coro_pool.hpp"
+#include "concurrency/new_mutex.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
@@ -27,6 +31,7 @@
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/indexing.hpp"
 #include "rdb_protocol/blob_wrapper.hpp"
+#include "rdb_protocol/external_sort.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/geo_traversal.hpp"
 #include "rdb_protocol/lazy_json.hpp"
@@ -105,6 +110,43 @@ void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
     }
 }
 
+void rdb_batched_get(const std::vector<store_key_t> &keys, btree_slice_t *slice,
+                     superblock_t *superblock,
+                     batched_point_read_response_t *response,
+                     profile::trace_t *trace) {
+    guarantee(!keys.empty());
+    profile::starter_t starter("Perform batched point read.", trace);
+    // All the lookups acquire the root through the same superblock, which is
+    // released once the last of them has done so.
+    refcount_superblock_t refcount_wrapper(superblock, keys.size());
+    std::vector<point_read_response_t> rows(keys.size());
+    {
+        unlimited_fifo_queue_t<std::function<void()> > coro_queue;
+        struct callback_t : public coro_pool_callback_t<std::function<void()> > {
+            virtual void coro_pool_callback(std::function<void()> f, signal_t *) {
+                f();
+            }
+        } callback;
+        const size_t MAX_CONCURRENT_GETS = 8;
+        coro_pool_t<std::function<void()> > coro_pool(
+            MAX_CONCURRENT_GETS, &coro_queue, &callback);
+        // Destroyed first, so we wait for all the lookups before the pool goes away.
+        auto_drainer_t drainer;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto_drainer_t::lock_t lock(&drainer);
+            coro_queue.push([&, i, lock]() {
+                // The lookups run in parallel, so they can't share the trace.
+                rdb_get(keys[i], slice, &refcount_wrapper, &rows[i], NULL);
+            });
+        }
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (rows[i].data.get_type() != ql::datum_t::R_NULL) {
+            response->rows.insert(std::make_pair(keys[i], std::move(rows[i].data)));
+        }
+    }
+}
+
 void kv_location_delete(keyvalue_location_t *kv_location,
                         const store_key_t &key,
                         repli_timestamp_t timestamp,
@@ -527,12 +569,118 @@ void rdb_set(const store_key_t &key,
         (had_value ? point_write_result_t::DUPLICATE : point_write_result_t::STORED);
 }
 
+scoped_malloc_t<rdb_value_t> rdb_value_from_serialized_data(buf_parent_t parent,
+                                                           const std::string &data) {
+    scoped_malloc_t<rdb_value_t> value(blob::btree_maxreflen);
+    memset(value.get(), 0, blob::btree_maxreflen);
+    blob_t blob(parent.cache()->max_block_size(), value->value_ref(),
+                blob::btree_maxreflen);
+    write_message_t wm;
+    wm.append(data.data(), data.size());
+    write_onto_blob(parent, &blob, wm);
+    return value;
+}
+
+void rdb_set_serialized(const store_key_t &key,
+                        const std::string &data,
+                        btree_slice_t *slice,
+                        repli_timestamp_t timestamp,
+                        superblock_t *superblock,
+                        const deletion_context_t *deletion_context,
+                        rdb_modification_info_t *mod_info,
+                        promise_t<superblock_t *> *pass_back_superblock) {
+    keyvalue_location_t kv_location;
+    const max_block_size_t block_size = superblock->cache()->max_block_size();
+    rdb_value_sizer_t sizer(block_size);
+    find_keyvalue_location_for_write(&sizer, superblock, key.btree_key(),
+                                     deletion_context->balancing_detacher(),
+                                     &kv_location, &slice->stats,
+                                     static_cast<profile::trace_t *>(NULL),
+                                     pass_back_superblock);
+
+    scoped_malloc_t<rdb_value_t> new_value
+        = rdb_value_from_serialized_data(buf_parent_t(&kv_location.buf), data);
+    if (mod_info != NULL) {
+        mod_info->added.first = get_data(new_value.get(),
+                                         buf_parent_t(&kv_location.buf));
+        mod_info->added.second.assign(new_value->value_ref(),
+            new_value->value_ref() + new_value->inline_size(block_size));
+    }
+
+    if (kv_location.value.has()) {
+        const rdb_value_t *old_value = kv_location.value_as<rdb_value_t>();
+        if (mod_info != NULL) {
+            mod_info->deleted.first = get_data(old_value,
+                                               buf_parent_t(&kv_location.buf));
+            mod_info->deleted.second.assign(old_value->value_ref(),
+                old_value->value_ref() + old_value->inline_size(block_size));
+        }
+        deletion_context->in_tree_deleter()->delete_value(
+                buf_parent_t(&kv_location.buf), kv_location.value.get());
+    }
+
+    kv_location.value = std::move(new_value);
+    null_key_modification_callback_t null_cb;
+    apply_keyvalue_change(&sizer, &kv_location, key.btree_key(), timestamp,
+                          deletion_context->balancing_detacher(), &null_cb);
+}
+
+void rdb_set_sindex_entries(
+        const store_t::sindex_access_t *sindex,
+        const std::vector<std::pair<store_key_t, std::vector<char> > > &entries,
+        const deletion_context_t *deletion_context) {
+    if (entries.empty()) {
+        return;
+    }
+    superblock_t *super_block = sindex->super_block.get();
+    rdb_value_sizer_t sizer(super_block->cache()->max_block_size());
+    if (can_append_to_btree(super_block, entries.front().first.btree_key())) {
+        {
+            btree_appender_t appender(&sizer, super_block);
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                appender.append(it->first.btree_key(), it->second.data(),
+                                repli_timestamp_t::distant_past);
+            }
+        }
+        sindex->btree->stats.pm_keys_set.record(entries.size());
+        sindex->btree->stats.pm_total_keys_set += entries.size();
+        return;
+    }
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        promise_t<superblock_t *> return_superblock_local;
+        {
+            keyvalue_location_t kv_location;
+            find_keyvalue_location_for_write(&sizer,
+                                             super_block,
+                                             it->first.btree_key(),
+                                             deletion_context->balancing_detacher(),
+                                             &kv_location,
+                                             &sindex->btree->stats,
+                                             static_cast<profile::trace_t *>(NULL),
+                                             &return_superblock_local);
+            ql::serialization_result_t res
+                = kv_location_set(&kv_location, it->first, it->second,
+                                  repli_timestamp_t::distant_past, deletion_context);
+            guarantee(!bad(res));
+        }
+        super_block = return_superblock_local.wait();
+    }
+}
+
 class agnostic_rdb_backfill_callback_t : public agnostic_backfill_callback_t {
 public:
     agnostic_rdb_backfill_callback_t(rdb_backfill_callback_t *cb,
                                      const key_range_t &kr,
-                                     btree_slice_t *slice) :
-        cb_(cb), kr_(kr), slice_(slice) { }
+                                     btree_slice_t *slice,
+                                     const std::map<std::string, secondary_index_t>
+                                         &shipped_sindexes) :
+        cb_(cb), kr_(kr), slice_(slice) {
+        for (auto it = shipped_sindexes.begin(); it != shipped_sindexes.end(); ++it) {
+            shipped_sindexes_.insert(
+                std::make_pair(it->first, it->second.opaque_definition));
+        }
+    }
 
     void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         rassert(kr_.is_superset(range));
@@ -587,6 +735,50 @@ public:
         }
     }
 
+    void on_leaf_image(buf_parent_t leaf_node,
+                       const key_range_t &range,
+                       const std::vector<repli_timestamp_t> &recencies,
+                       const std::vector<const btree_key_t *> &keys,
+                       const std::vector<const void *> &vals,
+                       signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        rassert(kr_.is_superset(range));
+
+        // Each chunk covers the keys from the end of the previous one up to its
+        // last key, and the last one covers the rest of `range`.
+        key_range_t rest = range;
+        std::vector<backfill_raw_atom_t> chunk_atoms;
+        size_t current_chunk_size = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            rassert(range.contains_key(keys[i]->contents, keys[i]->size));
+            const rdb_value_t *value = static_cast<const rdb_value_t *>(vals[i]);
+
+            chunk_atoms.push_back(backfill_raw_atom_t(
+                store_key_t(keys[i]->size, keys[i]->contents),
+                get_serialized_data(value, leaf_node),
+                recencies[i]));
+            current_chunk_size += static_cast<size_t>(keys[i]->size)
+                + chunk_atoms.back().value.size();
+
+            if (current_chunk_size >= BACKFILL_MAX_KVPAIRS_SIZE
+                && i + 1 < keys.size()) {
+                // See `on_pairs()`.
+                key_range_t chunk_range(key_range_t::closed, rest.left,
+                                        key_range_t::closed, chunk_atoms.back().key);
+                rest.left = chunk_range.right.key;
+                slice_->stats.pm_keys_read.record(chunk_atoms.size());
+                slice_->stats.pm_total_keys_read += chunk_atoms.size();
+                cb_->on_leaf_image(chunk_range, shipped_sindexes_,
+                                   std::move(chunk_atoms), interruptor);
+                chunk_atoms = std::vector<backfill_raw_atom_t>();
+                current_chunk_size = 0;
+            }
+        }
+        slice_->stats.pm_keys_read.record(chunk_atoms.size());
+        slice_->stats.pm_total_keys_read += chunk_atoms.size();
+        cb_->on_leaf_image(rest, shipped_sindexes_, std::move(chunk_atoms),
+                           interruptor);
+    }
+
     void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         cb_->on_sindexes(sindexes, interruptor);
     }
@@ -594,20 +786,143 @@ public:
     rdb_backfill_callback_t *cb_;
     key_range_t kr_;
     btree_slice_t *slice_;
+    std::map<std::string, std::vector<char> > shipped_sindexes_;
 };
 
+/* Sends the entries of a secondary index whose primary keys lie in any of
+`pkey_ranges`, in index order.  The value of an entry that refers to the document
+is left empty, because the backfillee has to point it at its own copy of the
+document; compact entries (see `make_compact_sindex_entry()`) are sent as they
+are. */
+class sindex_backfill_traversal_cb_t : public depth_first_traversal_callback_t {
+public:
+    sindex_backfill_traversal_cb_t(rdb_backfill_callback_t *cb,
+                                   const std::vector<key_range_t> &pkey_ranges,
+                                   const std::string &sindex_name,
+                                   const secondary_index_t &sindex,
+                                   signal_t *interruptor)
+        : cb_(cb), pkey_ranges_(pkey_ranges), sindex_name_(sindex_name),
+          sindex_(sindex), current_chunk_size_(0), interruptor_(interruptor) {
+        sindex_disk_info_t sindex_info;
+        try {
+            deserialize_sindex_info(sindex_.opaque_definition, &sindex_info);
+        } catch (const archive_exc_t &e) {
+            crash("%s", e.what());
+        }
+        is_compact_ = static_cast<bool>(sindex_info.cover);
+    }
+
+    done_traversing_t handle_pair(scoped_key_value_t &&keyvalue) {
+        store_key_t key(keyvalue.key());
+        if (!in_pkey_ranges(store_key_t(ql::datum_t::extract_primary(key)))) {
+            return done_traversing_t::NO;
+        }
+
+        std::string value;
+        const rdb_value_t *rdb_value
+            = static_cast<const rdb_value_t *>(keyvalue.value());
+        if (is_compact_ && rdb_value->value_size() < blob::btree_maxreflen) {
+            // Compact entries are small enough to be stored inline, so reading
+            // this value doesn't acquire any blocks.  An entry that refers to a
+            // document has the document's blob, and documents are objects, so
+            // only compact entries have an array's type tag.
+            std::string data = get_serialized_data(rdb_value, keyvalue.expose_buf());
+            if (!data.empty() && ql::datum_serialized_type_is_array(data[0])) {
+                value = std::move(data);
+            }
+        }
+        keyvalue.reset();
+
+        current_chunk_size_ += static_cast<size_t>(key.size()) + value.size();
+        chunk_atoms_.push_back(backfill_raw_atom_t(
+            key, std::move(value), repli_timestamp_t::distant_past));
+        if (current_chunk_size_ >= BACKFILL_MAX_KVPAIRS_SIZE) {
+            flush();
+        }
+        return done_traversing_t::NO;
+    }
+
+    void flush() THROWS_ONLY(interrupted_exc_t) {
+        if (!chunk_atoms_.empty()) {
+            cb_->on_sindex_keyvalues(sindex_name_, sindex_.opaque_definition,
+                                     std::move(chunk_atoms_), interruptor_);
+            chunk_atoms_ = std::vector<backfill_raw_atom_t>();
+            current_chunk_size_ = 0;
+        }
+    }
+
+private:
+    bool in_pkey_ranges(const store_key_t &pkey) const {
+        for (auto it = pkey_ranges_.begin(); it != pkey_ranges_.end(); ++it) {
+            if (it->contains_key(pkey)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    rdb_backfill_callback_t *const cb_;
+    const std::vector<key_range_t> pkey_ranges_;
+    const std::string sindex_name_;
+    const secondary_index_t sindex_;
+    bool is_compact_;
+    std::vector<backfill_raw_atom_t> chunk_atoms_;
+    size_t current_chunk_size_;
+    signal_t *const interruptor_;
+};
+
+void rdb_get_shipped_sindexes(buf_lock_t *sindex_block, repli_timestamp_t since_when,
+                              std::map<std::string, secondary_index_t> *sindexes_out) {
+    // A backfill from scratch sends every leaf as a leaf image, so the backfillee
+    // would have to compute the index entries of every document.  Instead we send
+    // it the entries that our ready indexes already have.
+    sindexes_out->clear();
+    if (since_when != repli_timestamp_t::distant_past) {
+        return;
+    }
+    std::map<sindex_name_t, secondary_index_t> sindexes;
+    get_secondary_indexes(sindex_block, &sindexes);
+    for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+        if (it->second.is_ready()) {
+            sindexes_out->insert(std::make_pair(it->first.name, it->second));
+        }
+    }
+}
+
 void rdb_backfill(btree_slice_t *slice, const key_range_t& key_range,
                   repli_timestamp_t since_when, rdb_backfill_callback_t *callback,
                   superblock_t *superblock,
                   buf_lock_t *sindex_block,
+                  const std::map<std::string, secondary_index_t> &shipped_sindexes,
                   parallel_traversal_progress_t *p, signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t) {
-    agnostic_rdb_backfill_callback_t agnostic_cb(callback, key_range, slice);
+    agnostic_rdb_backfill_callback_t agnostic_cb(callback, key_range, slice,
+                                                 shipped_sindexes);
     rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
     do_agnostic_btree_backfill(&sizer, key_range, since_when, &agnostic_cb,
                                superblock, sindex_block, p, interruptor);
 }
 
+void rdb_backfill_sindexes(const std::vector<key_range_t> &pkey_ranges,
+                           const std::map<std::string, secondary_index_t>
+                               &shipped_sindexes,
+                           rdb_backfill_callback_t *callback,
+                           buf_lock_t *sindex_block, signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    // The sindex block is snapshotted along with the superblock, so the entries
+    // come from the same state as the documents.
+    for (auto it = shipped_sindexes.begin(); it != shipped_sindexes.end(); ++it) {
+        buf_lock_t sindex_superblock_lock(sindex_block, it->second.superblock,
+                                          access_t::read);
+        real_superblock_t sindex_superblock(std::move(sindex_superblock_lock));
+        sindex_backfill_traversal_cb_t cb(callback, pkey_ranges, it->first,
+                                          it->second, interruptor);
+        btree_depth_first_traversal(&sindex_superblock, key_range_t::universe(), &cb,
+                                    FORWARD);
+        cb.flush();
+    }
+}
+
 void rdb_delete(const store_key_t &key, btree_slice_t *slice,
                 repli_timestamp_t timestamp,
                 superblock_t *superblock,
@@ -732,7 +1047,8 @@ void rdb_erase_small_range(key_tester_t *tester,
                            superblock_t *superblock,
                            const deletion_context_t *deletion_context,
                            signal_t *interruptor,
-                           std::vector<rdb_modification_report_t> *mod_reports_out) {
+                           std::vector<rdb_modification_report_t> *mod_reports_out,
+                           release_superblock_t release_superblock) {
     rassert(mod_reports_out != NULL);
     mod_reports_out->clear();
 
@@ -772,7 +1088,7 @@ void rdb_erase_small_range(key_tester_t *tester,
     btree_erase_range_generic(&sizer, tester, deletion_context->in_tree_deleter(),
         left_key_supplied ? left_key_exclusive.btree_key() : NULL,
         right_key_supplied ? right_key_inclusive.btree_key() : NULL,
-        superblock, interruptor, release_superblock_t::RELEASE,
+        superblock, interruptor, release_superblock,
         std::bind(&on_erase_cb_t::on_erase,
                   ph::_1, ph::_2, ph::_3, mod_reports_out));
 }
@@ -781,14 +1097,29 @@ void rdb_erase_small_range(key_tester_t *tester,
 typedef ql::transform_variant_t transform_variant_t;
 typedef ql::terminal_variant_t terminal_variant_t;
 
+// The primary btree, for reading the documents of a compact index.
+class rget_primary_data_t {
+public:
+    rget_primary_data_t(btree_slice_t *_slice, superblock_t *_superblock,
+                        bool _needs_document)
+        : slice(_slice), superblock(_superblock), needs_document(_needs_document) { }
+private:
+    friend class rget_cb_t;
+    btree_slice_t *slice;
+    superblock_t *superblock;
+    // False if the query only looks at the covered fields.
+    bool needs_document;
+};
+
 class rget_sindex_data_t {
 public:
     rget_sindex_data_t(const key_range_t &_pkey_range, const datum_range_t &_range,
                        reql_version_t wire_func_reql_version,
-                       ql::map_wire_func_t wire_func, sindex_multi_bool_t _multi)
+                       ql::map_wire_func_t wire_func, sindex_multi_bool_t _multi,
+                       const boost::optional<rget_primary_data_t> &_primary)
         : pkey_range(_pkey_range), range(_range),
           func_reql_version(wire_func_reql_version),
-          func(wire_func.compile_wire_func()), multi(_multi) { }
+          func(wire_func.compile_wire_func()), multi(_multi), primary(_primary) { }
 private:
     friend class rget_cb_t;
     const key_range_t pkey_range;
@@ -796,6 +1127,8 @@ private:
     const reql_version_t func_reql_version;
     const counted_t<const ql::func_t> func;
     const sindex_multi_bool_t multi;
+    // Only set for compact indexes.
+    const boost::optional<rget_primary_data_t> primary;
 };
 
 class job_data_t {
@@ -915,6 +1248,32 @@ THROWS_ONLY(interrupted_exc_t) {
     }
     guarantee(!row.references_parent());
     keyvalue.reset();
+
+    // A compact index entry has the index value and the covered fields, and we
+    // only read the document if the query needs more than those.  The reads of
+    // concurrently handled pairs overlap, since we haven't waited on `waiter` yet.
+    ql::datum_t compact_sindex_val;
+    if (sindex && sindex->primary && val->get_type() == ql::datum_t::R_ARRAY) {
+        compact_sindex_val = val->get(0);
+        if (!sindex->range.contains(sindex->func_reql_version, compact_sindex_val)) {
+            // We skip the pair below, after updating `last_key`.
+        } else if (sindex->primary->needs_document) {
+            // The lookup releases the superblock once, which leaves it acquired
+            // for the other lookups.
+            refcount_superblock_t primary_superblock(sindex->primary->superblock, 2);
+            point_read_response_t doc;
+            rdb_get(ql::datum_t::extract_primary(key), sindex->primary->slice,
+                    &primary_superblock, &doc, job.env->trace);
+            if (doc.data->get_type() == ql::datum_t::R_NULL) {
+                // We read both btrees from the same snapshot, so this shouldn't
+                // happen, but it's harmless to skip the entry.
+                return done_traversing_t::NO;
+            }
+            val = doc.data;
+        } else {
+            val = val->get(1);
+        }
+    }
     waiter.wait_interruptible();
 
     try {
@@ -926,7 +1285,12 @@ THROWS_ONLY(interrupted_exc_t) {
 
         // Check whether we're out of sindex range.
         ql::datum_t sindex_val; // NULL if no sindex.
-        if (sindex) {
+        if (compact_sindex_val.has()) {
+            sindex_val = compact_sindex_val;
+            if (!sindex->range.contains(sindex->func_reql_version, sindex_val)) {
+                return done_traversing_t::NO;
+            }
+        } else if (sindex) {
             // Secondary index functions are deterministic (so no need for an
             // rdb_context_t) and evaluated in a pristine environment (without global
             // optargs).
@@ -983,6 +1347,21 @@ void rdb_rget_slice(
         rget_read_response_t *response) {
 
     r_sanity_check(boost::get<ql::exc_t>(&response->result) == NULL);
+    // `count` doesn't look at the rows, so we can use the key counts stored in the
+    // btree instead of traversing the range.
+    if (terminal && boost::get<ql::count_wire_func_t>(&*terminal) != NULL
+        && transforms.empty()) {
+        profile::starter_t starter("Count keys on primary index.", ql_env->trace);
+        const uint64_t count = btree_count_keys(superblock, range);
+        ql::grouped_t<uint64_t> counts;
+        // Like `count_terminal_t`, we only have a group if there were any rows.
+        if (count != 0) {
+            counts[ql::datum_t()] = count;
+        }
+        response->result = std::move(counts);
+        response->last_key = !reversed(sorting) ? store_key_t::max() : store_key_t::min();
+        return;
+    }
     profile::starter_t starter("Do range scan on primary index.", ql_env->trace);
     rget_cb_t callback(
         rget_io_data_t(response, slice),
@@ -999,6 +1378,8 @@ void rdb_rget_secondary_slice(
         const datum_range_t &sindex_range,
         const region_t &sindex_region,
         superblock_t *superblock,
+        btree_slice_t *primary_slice,
+        superblock_t *primary_superblock,
         ql::env_t *ql_env,
         const ql::batchspec_t &batchspec,
         const std::vector<transform_variant_t> &transforms,
@@ -1012,13 +1393,23 @@ void rdb_rget_secondary_slice(
     guarantee(sindex_info.geo == sindex_geo_bool_t::REGULAR);
     profile::starter_t starter("Do range scan on secondary index.", ql_env->trace);
 
+    boost::optional<rget_primary_data_t> primary;
+    if (sindex_info.cover) {
+        guarantee(primary_superblock != NULL);
+        const std::set<std::string> covered(sindex_info.cover->begin(),
+                                            sindex_info.cover->end());
+        primary = rget_primary_data_t(
+            primary_slice, primary_superblock,
+            !ql::reads_only_fields(transforms, terminal, covered));
+    }
+
     const reql_version_t sindex_func_reql_version =
         sindex_info.mapping_version_info.latest_compatible_reql_version;
     rget_cb_t callback(
         rget_io_data_t(response, slice),
         job_data_t(ql_env, batchspec, transforms, terminal, sorting),
         rget_sindex_data_t(pk_range, sindex_range, sindex_func_reql_version,
-                           sindex_info.mapping, sindex_info.multi),
+                           sindex_info.mapping, sindex_info.multi, primary),
         sindex_region.inner);
     btree_concurrent_traversal(
         superblock, sindex_region.inner, &callback,
@@ -1207,12 +1598,9 @@ void rdb_modification_report_cb_t::on_mod_report(
                       mod_report,
                       &sindexes_updated_cond));
         if (store_->changefeed_server.has()) {
-            store_->changefeed_server->send_all(
-                ql::changefeed::msg_t(
-                    ql::changefeed::msg_t::change_t(
-                        mod_report.info.deleted.first,
-                        mod_report.info.added.first)),
-                mod_report.primary_key);
+            store_->changefeed_server->send_all(mod_report.info.deleted.first,
+                                                mod_report.info.added.first,
+                                                mod_report.primary_key);
         }
 
         sindexes_updated_cond.wait_lazily_unordered();
@@ -1273,10 +1661,16 @@ std::vector<std::string> expand_geo_key(
     }
 }
 
+/* `index_values_out`, if not NULL, gets the index value each key was computed from.
+ * It's only supported for non-geo indexes. */
 void compute_keys(const store_key_t &primary_key, ql::datum_t doc,
                   const sindex_disk_info_t &index_info,
-                  std::vector<store_key_t> *keys_out) {
+                  std::vector<store_key_t> *keys_out,
+                  std::vector<ql::datum_t> *index_values_out) {
     guarantee(keys_out->empty());
+    guarantee(index_values_out == NULL
+              || (index_values_out->empty()
+                  && index_info.geo == sindex_geo_bool_t::REGULAR));
 
     const reql_version_t reql_version =
         index_info.mapping_version_info.latest_compatible_reql_version;
@@ -1305,6 +1699,9 @@ void compute_keys(const store_key_t &primary_key, ql::datum_t doc,
                 keys_out->push_back(store_key_t(skey->print_secondary(reql_version,
                                                                       primary_key,
                                                                       i)));
+                if (index_values_out != NULL) {
+                    index_values_out->push_back(skey);
+                }
             }
         }
     } else {
@@ -1320,6 +1717,9 @@ void compute_keys(const store_key_t &primary_key, ql::datum_t doc,
             keys_out->push_back(store_key_t(index->print_secondary(reql_version,
                                                                    primary_key,
                                                                    boost::none)));
+            if (index_values_out != NULL) {
+                index_values_out->push_back(index);
+            }
         }
     }
 }
@@ -1341,6 +1741,11 @@ void serialize_sindex_info(write_message_t *wm,
     serialize<cluster_version_t::LATEST_DISK>(wm, info.mapping);
     serialize<cluster_version_t::LATEST_DISK>(wm, info.multi);
     serialize<cluster_version_t::LATEST_DISK>(wm, info.geo);
+    // The covered fields are only written for compact indexes, so that the
+    // descriptions of the other indexes don't change.
+    if (info.cover) {
+        serialize<cluster_version_t::LATEST_DISK>(wm, *info.cover);
+    }
 }
 
 void deserialize_sindex_info(const std::vector<char> &data,
@@ -1365,7 +1770,8 @@ void deserialize_sindex_info(const std::vector<char> &data,
             reql_version_t::v1_13;
         break;
     case cluster_version_t::v1_14:
-    case cluster_version_t::v1_15_is_latest:
+    case cluster_version_t::v1_15:
+    case cluster_version_t::v1_16_is_latest:
         success = deserialize_for_version(
                 cluster_version,
                 &read_stream,
@@ -1400,10 +1806,39 @@ void deserialize_sindex_info(const std::vector<char> &data,
         throw_if_bad_deserialization(success, "sindex description");
     }
 
+    if (static_cast<size_t>(read_stream.tell()) < data.size()) {
+        std::vector<std::string> cover;
+        success = deserialize_for_version(cluster_version, &read_stream, &cover);
+        throw_if_bad_deserialization(success, "sindex description");
+        info_out->cover = cover;
+    } else {
+        info_out->cover = boost::none;
+    }
+
     guarantee(static_cast<size_t>(read_stream.tell()) == data.size(),
               "An sindex description was incompletely deserialized.");
 }
 
+ql::datum_t make_compact_sindex_entry(ql::datum_t index_value, ql::datum_t doc,
+                                      const std::vector<std::string> &cover) {
+    ql::datum_object_builder_t covered;
+    for (auto it = cover.begin(); it != cover.end(); ++it) {
+        ql::datum_t field = doc->get_field(datum_string_t(*it), ql::NOTHROW);
+        if (field.has()) {
+            covered.overwrite(datum_string_t(*it), field);
+        }
+    }
+    ql::datum_array_builder_t entry(ql::configured_limits_t::unlimited);
+    entry.add(index_value);
+    entry.add(std::move(covered).to_datum());
+    ql::datum_t res = std::move(entry).to_datum();
+    // Small blobs hold up to `btree_maxreflen - 1` bytes inline.
+    if (datum_serialized_size(res) >= static_cast<size_t>(blob::btree_maxreflen)) {
+        return ql::datum_t();
+    }
+    return res;
+}
+
 /* Used below by rdb_update_sindexes. */
 void rdb_update_single_sindex(
         const store_t::sindex_access_t *sindex,
@@ -1435,7 +1870,8 @@ void rdb_update_single_sindex(
 
             std::vector<store_key_t> keys;
 
-            compute_keys(modification->primary_key, deleted, sindex_info, &keys);
+            compute_keys(modification->primary_key, deleted, sindex_info, &keys,
+                         NULL);
 
             for (auto it = keys.begin(); it != keys.end(); ++it) {
                 promise_t<superblock_t *> return_superblock_local;
@@ -1476,10 +1912,18 @@ void rdb_update_single_sindex(
             ql::datum_t added = modification->info.added.first;
 
             std::vector<store_key_t> keys;
+            std::vector<ql::datum_t> index_values;
 
-            compute_keys(modification->primary_key, added, sindex_info, &keys);
+            compute_keys(modification->primary_key, added, sindex_info, &keys,
+                         sindex_info.cover ? &index_values : NULL);
+
+            for (size_t i = 0; i < keys.size(); ++i) {
+                ql::datum_t compact_entry;
+                if (sindex_info.cover) {
+                    compact_entry = make_compact_sindex_entry(index_values[i], added,
+                                                              *sindex_info.cover);
+                }
 
-            for (auto it = keys.begin(); it != keys.end(); ++it) {
                 promise_t<superblock_t *> return_superblock_local;
                 {
                     keyvalue_location_t kv_location;
@@ -1487,18 +1931,21 @@ void rdb_update_single_sindex(
                     rdb_value_sizer_t sizer(super_block->cache()->max_block_size());
                     find_keyvalue_location_for_write(&sizer,
                                                      super_block,
-                                                     it->btree_key(),
+                                                     keys[i].btree_key(),
                                                      deletion_context->balancing_detacher(),
                                                      &kv_location,
                                                      &sindex->btree->stats,
                                                      trace,
                                                      &return_superblock_local);
 
-                    ql::serialization_result_t res =
-                        kv_location_set(&kv_location, *it,
-                                        modification->info.added.second,
-                                        repli_timestamp_t::distant_past,
-                                        deletion_context);
+                    ql::serialization_result_t res = compact_entry.has()
+                        ? kv_location_set(&kv_location, keys[i], compact_entry,
+                                          repli_timestamp_t::distant_past,
+                                          deletion_context, NULL)
+                        : kv_location_set(&kv_location, keys[i],
+                                          modification->info.added.second,
+                                          repli_timestamp_t::distant_past,
+                                          deletion_context);
                     // this particular context cannot fail AT THE MOMENT.
                     guarantee(!bad(res));
                     // The keyvalue location gets destroyed here.
@@ -1666,6 +2113,374 @@ public:
     signal_t *interruptor_;
 };
 
+// How many index entries we sort in memory before spilling them to disk, and how
+// many we append to an index per write transaction.
+static const size_t SINDEX_BULK_LOAD_RUN_SIZE = 100000;
+static const size_t SINDEX_BULK_LOAD_CHUNK_SIZE = 256;
+
+/* Builds a secondary index that is still empty bottom-up.  The traversal of the
+primary index passes every row to `add()`, which computes the index entries and
+feeds them to an external sort.  `load()` then appends the sorted entries to the
+index through `btree_appender_t`, which leaves the index's nodes packed instead of
+half full.
+
+An entry is sorted as `[key, value]`, where `key` is the index key in binary, and
+`value` is either the row's `value_ref` in binary, or the compact index entry (see
+`make_compact_sindex_entry()`), which gets serialized when it's appended. */
+class sindex_bulk_loader_t {
+public:
+    sindex_bulk_loader_t(store_t *store, uuid_u sindex_id,
+                         const sindex_disk_info_t &sindex_info,
+                         ql::env_t *env)
+        : store_(store),
+          sindex_id_(sindex_id),
+          sindex_info_(sindex_info),
+          env_(env),
+          sorter_(store->io_backender_, store->base_path_, &entry_lt),
+          num_entries_(0),
+          num_loaded_(0),
+          dropped_(false) { }
+
+    uuid_u sindex_id() const { return sindex_id_; }
+
+    // Once the index is dropped, we stop computing its entries.
+    void mark_dropped() { dropped_ = true; }
+    bool is_dropped() const { return dropped_; }
+
+    // How many entries `add()` computed, and how many of them `load()` appended so
+    // far.
+    int64_t num_entries() const { return num_entries_; }
+    int64_t num_loaded() const { return num_loaded_; }
+
+    void add(const store_key_t &primary_key, ql::datum_t doc,
+             const std::vector<char> &value_ref) {
+        if (dropped_) {
+            return;
+        }
+        std::vector<ql::datum_t> entries;
+        try {
+            std::vector<store_key_t> keys;
+            std::vector<ql::datum_t> index_values;
+            compute_keys(primary_key, doc, sindex_info_, &keys,
+                         sindex_info_.cover ? &index_values : NULL);
+            for (size_t i = 0; i < keys.size(); ++i) {
+                ql::datum_t value;
+                if (sindex_info_.cover) {
+                    value = make_compact_sindex_entry(index_values[i], doc,
+                                                      *sindex_info_.cover);
+                }
+                if (!value.has()) {
+                    value = ql::datum_t::binary(
+                        datum_string_t(value_ref.size(), value_ref.data()));
+                }
+                std::vector<ql::datum_t> entry;
+                entry.push_back(ql::datum_t::binary(
+                    datum_string_t(keys[i].size(),
+                                   reinterpret_cast<const char *>(keys[i].contents()))));
+                entry.push_back(value);
+                entries.push_back(ql::datum_t(std::move(entry),
+                                              ql::configured_limits_t::unlimited));
+            }
+        } catch (const ql::base_exc_t &) {
+            // Do nothing (we just drop the row from the index).
+        }
+
+        num_entries_ += entries.size();
+        run_.insert(run_.end(), std::make_move_iterator(entries.begin()),
+                    std::make_move_iterator(entries.end()));
+        if (run_.size() >= SINDEX_BULK_LOAD_RUN_SIZE) {
+            std::vector<ql::datum_t> run;
+            run.swap(run_);
+            // The traversal adds rows from several coroutines.
+            new_mutex_in_line_t acq(&spill_mutex_);
+            acq.acq_signal()->wait();
+            sorter_.add_run(env_, std::move(run));
+        }
+    }
+
+    // Stops early if the index gets dropped.
+    void load(signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        if (dropped_) {
+            return;
+        }
+        {
+            new_mutex_in_line_t acq(&spill_mutex_);
+            acq.acq_signal()->wait();
+            sorter_.finish(env_, std::move(run_));
+        }
+
+        std::set<uuid_u> sindex_ids;
+        sindex_ids.insert(sindex_id_);
+        store_key_t last_key;
+        bool has_last_key = false;
+        for (;;) {
+            // We read the next chunk before we acquire the index, because reading
+            // it might block on the spill files.
+            std::vector<std::pair<store_key_t, ql::datum_t> > chunk;
+            int64_t chunk_entries = 0;
+            while (chunk.size() < SINDEX_BULK_LOAD_CHUNK_SIZE) {
+                ql::datum_t entry = sorter_.next(env_, NULL);
+                if (!entry.has()) {
+                    break;
+                }
+                ++chunk_entries;
+                const ql::datum_t key_datum = entry.get(0);
+                const datum_string_t &key_str = key_datum.as_binary();
+                store_key_t key(key_str.size(),
+                                reinterpret_cast<const uint8_t *>(key_str.data()));
+                if (has_last_key && key == last_key) {
+                    continue;
+                }
+                last_key = key;
+                has_last_key = true;
+                chunk.push_back(std::make_pair(std::move(key), entry.get(1)));
+            }
+            if (chunk.empty()) {
+                return;
+            }
+
+            // See `post_construct_traversal_helper_t` about the transactions we use.
+            write_token_pair_t token_pair;
+            store_->new_write_token_pair(&token_pair);
+            scoped_ptr_t<txn_t> wtxn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            store_->acquire_superblock_for_write(
+                    repli_timestamp_t::distant_past,
+                    2 + chunk.size(),
+                    write_durability_t::HARD,
+                    &token_pair,
+                    &wtxn,
+                    &superblock,
+                    interruptor);
+            buf_lock_t sindex_block
+                = store_->acquire_sindex_block_for_write(
+                    superblock->expose_buf(), superblock->get_sindex_block_id());
+            superblock.reset();
+            store_t::sindex_access_vector_t sindexes;
+            store_->acquire_sindex_superblocks_for_write(sindex_ids, &sindex_block,
+                                                         &sindexes);
+            if (sindexes.empty() || sindexes[0]->sindex.being_deleted) {
+                dropped_ = true;
+                return;
+            }
+
+            const max_block_size_t block_size = wtxn->cache()->max_block_size();
+            rdb_value_sizer_t sizer(block_size);
+            btree_appender_t appender(&sizer, sindexes[0]->super_block.get());
+            for (auto it = chunk.begin(); it != chunk.end(); ++it) {
+                if (it->second.get_type() == ql::datum_t::R_BINARY) {
+                    const datum_string_t &value_ref = it->second.as_binary();
+                    appender.append(it->first.btree_key(), value_ref.data(),
+                                    repli_timestamp_t::distant_past);
+                } else {
+                    scoped_malloc_t<rdb_value_t> value(blob::btree_maxreflen);
+                    memset(value.get(), 0, blob::btree_maxreflen);
+                    blob_t blob(block_size, value->value_ref(), blob::btree_maxreflen);
+                    // Compact entries are small enough to be stored inline, so the
+                    // blob doesn't need a parent.
+                    ql::serialization_result_t res = datum_serialize_onto_blob(
+                        buf_parent_t(wtxn.get()), &blob, it->second);
+                    guarantee(!bad(res));
+                    appender.append(it->first.btree_key(), value.get(),
+                                    repli_timestamp_t::distant_past);
+                }
+                store_->btree->stats.pm_keys_set.record();
+                store_->btree->stats.pm_total_keys_set += 1;
+            }
+            num_loaded_ += chunk_entries;
+        }
+    }
+
+private:
+    static bool entry_lt(ql::env_t *, profile::sampler_t *,
+                         const ql::datum_t &a, const ql::datum_t &b) {
+        const ql::datum_t a_datum = a.get(0);
+        const ql::datum_t b_datum = b.get(0);
+        const datum_string_t &a_key = a_datum.as_binary();
+        const datum_string_t &b_key = b_datum.as_binary();
+        return sized_strcmp(reinterpret_cast<const uint8_t *>(a_key.data()),
+                            a_key.size(),
+                            reinterpret_cast<const uint8_t *>(b_key.data()),
+                            b_key.size()) < 0;
+    }
+
+    store_t *const store_;
+    const uuid_u sindex_id_;
+    const sindex_disk_info_t sindex_info_;
+    ql::env_t *const env_;
+
+    std::vector<ql::datum_t> run_;
+    new_mutex_t spill_mutex_;
+    ql::external_sorter_t sorter_;
+
+    int64_t num_entries_;
+    int64_t num_loaded_;
+    bool dropped_;
+
+    DISABLE_COPYING(sindex_bulk_loader_t);
+};
+
+/* Reports how far the loaders got with appending their entries, counting a chunk of
+entries as one node. */
+class sindex_bulk_load_progress_t : public traversal_progress_t {
+public:
+    explicit sindex_bulk_load_progress_t(
+            const std::vector<scoped_ptr_t<sindex_bulk_loader_t> > *loaders)
+        : loaders_(loaders) { }
+
+    progress_completion_fraction_t guess_completion() const {
+        int64_t loaded = 0;
+        int64_t total = 0;
+        for (auto it = loaders_->begin(); it != loaders_->end(); ++it) {
+            loaded += (*it)->num_loaded() / SINDEX_BULK_LOAD_CHUNK_SIZE;
+            total += ceil_divide((*it)->num_entries(), SINDEX_BULK_LOAD_CHUNK_SIZE);
+        }
+        return progress_completion_fraction_t(loaded, total);
+    }
+
+private:
+    const std::vector<scoped_ptr_t<sindex_bulk_loader_t> > *loaders_;
+};
+
+class post_construct_bulk_traversal_helper_t : public btree_traversal_helper_t {
+public:
+    post_construct_bulk_traversal_helper_t(
+            store_t *store,
+            const std::vector<scoped_ptr_t<sindex_bulk_loader_t> > *loaders,
+            cond_t *interrupt_myself,
+            signal_t *interruptor)
+        : store_(store), loaders_(loaders),
+          interrupt_myself_(interrupt_myself), interruptor_(interruptor) { }
+
+    void process_a_leaf(buf_lock_t *leaf_node_buf,
+                        const btree_key_t *, const btree_key_t *,
+                        signal_t *, int *) THROWS_ONLY(interrupted_exc_t) {
+        // Like `post_construct_traversal_helper_t`, we stop the traversal once all
+        // the indexes have been dropped.
+        try {
+            if (!mark_dropped_sindexes()) {
+                interrupt_myself_->pulse_if_not_already_pulsed();
+                return;
+            }
+        } catch (const interrupted_exc_t &) {
+            return;
+        }
+
+        buf_read_t leaf_read(leaf_node_buf);
+        const leaf_node_t *leaf_node
+            = static_cast<const leaf_node_t *>(leaf_read.get_data_read());
+        const max_block_size_t block_size = leaf_node_buf->cache()->max_block_size();
+        for (auto it = leaf::begin(*leaf_node); it != leaf::end(*leaf_node); ++it) {
+            store_->btree->stats.pm_keys_read.record();
+            store_->btree->stats.pm_total_keys_read += 1;
+
+            const btree_key_t *key = (*it).first;
+            guarantee(key);
+            const rdb_value_t *rdb_value
+                = static_cast<const rdb_value_t *>((*it).second);
+            const ql::datum_t doc = get_data(rdb_value, buf_parent_t(leaf_node_buf));
+            const std::vector<char> value_ref(
+                rdb_value->value_ref(),
+                rdb_value->value_ref() + rdb_value->inline_size(block_size));
+            for (auto jt = loaders_->begin(); jt != loaders_->end(); ++jt) {
+                (*jt)->add(store_key_t(key), doc, value_ref);
+            }
+        }
+    }
+
+    void postprocess_internal_node(buf_lock_t *) { }
+
+    void filter_interesting_children(buf_parent_t,
+                                     ranged_block_ids_t *ids_source,
+                                     interesting_children_callback_t *cb) {
+        for (int i = 0, e = ids_source->num_block_ids(); i < e; ++i) {
+            cb->receive_interesting_child(i);
+        }
+        cb->no_more_interesting_children();
+    }
+
+    access_t btree_superblock_mode() { return access_t::read; }
+    access_t btree_node_mode() { return access_t::read; }
+
+private:
+    // Checks which of the indexes have been dropped since the last leaf, and
+    // returns whether any of them are left.
+    bool mark_dropped_sindexes() THROWS_ONLY(interrupted_exc_t) {
+        object_buffer_t<fifo_enforcer_sink_t::exit_read_t> read_token;
+        store_->new_read_token(&read_token);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        store_->acquire_superblock_for_read(&read_token, &txn, &superblock,
+                                            interruptor_, false /* USE_SNAPSHOT */);
+        buf_lock_t sindex_block
+            = store_->acquire_sindex_block_for_read(superblock->expose_buf(),
+                                                    superblock->get_sindex_block_id());
+        superblock.reset();
+
+        bool any_left = false;
+        for (auto it = loaders_->begin(); it != loaders_->end(); ++it) {
+            if ((*it)->is_dropped()) {
+                continue;
+            }
+            secondary_index_t sindex;
+            if (!get_secondary_index(&sindex_block, (*it)->sindex_id(), &sindex)
+                || sindex.being_deleted) {
+                (*it)->mark_dropped();
+            } else {
+                any_left = true;
+            }
+        }
+        return any_left;
+    }
+
+    store_t *store_;
+    const std::vector<scoped_ptr_t<sindex_bulk_loader_t> > *loaders_;
+    cond_t *interrupt_myself_;
+    signal_t *interruptor_;
+};
+
+// Returns the definitions of the given indexes if all of them are empty (so that we
+// can bulk-load them), or an empty map otherwise.
+std::map<uuid_u, sindex_disk_info_t> get_empty_sindexes(
+        store_t *store,
+        const std::set<uuid_u> &sindexes_to_post_construct,
+        signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+    scoped_ptr_t<txn_t> wtxn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_write(
+            repli_timestamp_t::distant_past,
+            1,
+            write_durability_t::SOFT,
+            &token_pair,
+            &wtxn,
+            &superblock,
+            interruptor);
+    buf_lock_t sindex_block
+        = store->acquire_sindex_block_for_write(superblock->expose_buf(),
+                                                superblock->get_sindex_block_id());
+    superblock.reset();
+    store_t::sindex_access_vector_t sindexes;
+    store->acquire_sindex_superblocks_for_write(sindexes_to_post_construct,
+                                                &sindex_block, &sindexes);
+
+    std::map<uuid_u, sindex_disk_info_t> sindex_infos;
+    for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+        if ((*it)->super_block->get_root_block_id() != NULL_BLOCK_ID) {
+            return std::map<uuid_u, sindex_disk_info_t>();
+        }
+        sindex_disk_info_t sindex_info;
+        try {
+            deserialize_sindex_info((*it)->sindex.opaque_definition, &sindex_info);
+        } catch (const archive_exc_t &e) {
+            crash("%s", e.what());
+        }
+        sindex_infos.insert(std::make_pair((*it)->sindex.id, sindex_info));
+    }
+    return sindex_infos;
+}
+
 void post_construct_secondary_indexes(
         store_t *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
@@ -1675,16 +2490,40 @@ void post_construct_secondary_indexes(
 
     wait_any_t wait_any(&local_interruptor, interruptor);
 
+    // Indexes that are still empty are bulk-loaded, otherwise we insert the rows
+    // into them one at a time.
+    const std::map<uuid_u, sindex_disk_info_t> empty_sindexes
+        = get_empty_sindexes(store, sindexes_to_post_construct, interruptor);
+    ql::env_t env(&wait_any, reql_version_t::LATEST);
+    std::vector<scoped_ptr_t<sindex_bulk_loader_t> > loaders;
+    for (auto it = empty_sindexes.begin(); it != empty_sindexes.end(); ++it) {
+        loaders.push_back(make_scoped<sindex_bulk_loader_t>(store, it->first,
+                                                            it->second, &env));
+    }
+
     post_construct_traversal_helper_t helper(store,
             sindexes_to_post_construct, &local_interruptor, interruptor);
+    post_construct_bulk_traversal_helper_t bulk_helper(store, &loaders,
+            &local_interruptor, interruptor);
+    btree_traversal_helper_t *traversal_helper
+        = loaders.empty()
+        ? static_cast<btree_traversal_helper_t *>(&helper)
+        : &bulk_helper;
     /* Notice the ordering of progress_tracker and insertion_sentries matters.
      * insertion_sentries puts pointers in the progress tracker map. Once
      * insertion_sentries is destructed nothing has a reference to
-     * progress_tracker so we know it's safe to destruct it. */
-    parallel_traversal_progress_t progress_tracker;
-    helper.progress = &progress_tracker;
+     * progress_tracker so we know it's safe to destruct it.
+     * Bulk-loaded indexes are done in two parts: the traversal and the load. */
+    sequential_traversal_progress_t progress_tracker(loaders.empty() ? 1 : 2);
+    parallel_traversal_progress_t *traversal_progress
+        = new parallel_traversal_progress_t;
+    {
+        scoped_ptr_t<traversal_progress_t> part(traversal_progress);
+        progress_tracker.start_part(&part);
+    }
+    traversal_helper->progress = traversal_progress;
 
-    std::vector<map_insertion_sentry_t<uuid_u, const parallel_traversal_progress_t *> >
+    std::vector<map_insertion_sentry_t<uuid_u, const traversal_progress_t *> >
         insertion_sentries(sindexes_to_post_construct.size());
     auto sentry = insertion_sentries.begin();
     for (auto it = sindexes_to_post_construct.begin();
@@ -1714,5 +2553,16 @@ void post_construct_secondary_indexes(
         = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
     txn->set_account(&cache_account);
 
-    btree_parallel_traversal(superblock.get(), &helper, &wait_any);
+    btree_parallel_traversal(superblock.get(), traversal_helper, &wait_any);
+
+    superblock.reset();
+    txn.reset();
+    if (!loaders.empty()) {
+        scoped_ptr_t<traversal_progress_t> part(
+            new sindex_bulk_load_progress_t(&loaders));
+        progress_tracker.start_part(&part);
+    }
+    for (auto it = loaders.begin(); it != loaders.end(); ++it) {
+        (*it)->load(&wait_any);
+    }
 }
@@ -64,6 +64,14 @@ void rdb_get(
     point_read_response_t *response,
     profile::trace_t *trace);
 
+// Looks the keys up concurrently.  Releases `superblock`.
+void rdb_batched_get(
+    const std::vector<store_key_t> &keys,
+    btree_slice_t *slice,
+    superblock_t *superblock,
+    batched_point_read_response_t *response,
+    profile::trace_t *trace);
+
 struct btree_info_t {
     btree_info_t(btree_slice_t *_slice,
                  repli_timestamp_t _timestamp,
@@ -123,6 +131,31 @@ void rdb_set(const store_key_t &key, ql::datum_t data,
              profile::trace_t *trace,
              promise_t<superblock_t *> *pass_back_superblock = NULL);
 
+// Makes a new value from a datum that `get_serialized_data()` returned.  Blob blocks
+// that the value needs are created under `parent`.
+scoped_malloc_t<rdb_value_t> rdb_value_from_serialized_data(buf_parent_t parent,
+                                                           const std::string &data);
+
+// Like `rdb_set()` with `overwrite` set, for a datum that `get_serialized_data()`
+// returned.  The datum only gets deserialized for `mod_info`, which may be `NULL` if
+// nothing needs a modification report.
+void rdb_set_serialized(const store_key_t &key,
+                        const std::string &data,
+                        btree_slice_t *slice,
+                        repli_timestamp_t timestamp,
+                        superblock_t *superblock,
+                        const deletion_context_t *deletion_context,
+                        rdb_modification_info_t *mod_info,
+                        promise_t<superblock_t *> *pass_back_superblock = NULL);
+
+// Sets the entries of a secondary index that a backfill sent, where each value is the
+// inline part of an `rdb_value_t`.  The entries must be sorted by key; if they all
+// lie past the end of the index, they get appended bottom-up.
+void rdb_set_sindex_entries(
+        const store_t::sindex_access_t *sindex,
+        const std::vector<std::pair<store_key_t, std::vector<char> > > &entries,
+        const deletion_context_t *deletion_context);
+
 class rdb_backfill_callback_t {
 public:
     virtual void on_delete_range(
@@ -135,6 +168,19 @@ public:
     virtual void on_keyvalues(
         std::vector<backfill_atom_t> &&atoms,
         signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    // `range` is part of a leaf image (see `backfill_chunk_t::leaf_image_t`), and
+    // `atoms` are all of the documents in it.  The entries of `shipped_sindexes`,
+    // which map index names to definitions, follow through `on_sindex_keyvalues()`.
+    virtual void on_leaf_image(
+        const key_range_t &range,
+        const std::map<std::string, std::vector<char> > &shipped_sindexes,
+        std::vector<backfill_raw_atom_t> &&atoms,
+        signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    virtual void on_sindex_keyvalues(
+        const std::string &sindex,
+        const std::vector<char> &opaque_definition,
+        std::vector<backfill_raw_atom_t> &&atoms,
+        signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_sindexes(
         const std::map<std::string, secondary_index_t> &sindexes,
         signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
@@ -143,13 +189,32 @@ protected:
 };
 
 
+// Gets the indexes whose entries a backfill since `since_when` ships instead of
+// letting the backfillee compute them, keyed by name.  Those are the ready indexes
+// if the backfill is from scratch, and none otherwise.
+void rdb_get_shipped_sindexes(buf_lock_t *sindex_block, repli_timestamp_t since_when,
+                              std::map<std::string, secondary_index_t> *sindexes_out);
+
+// Sends the documents in `key_range`.  The entries of `shipped_sindexes` for them
+// have to follow through `rdb_backfill_sindexes()`.
 void rdb_backfill(btree_slice_t *slice, const key_range_t& key_range,
                   repli_timestamp_t since_when, rdb_backfill_callback_t *callback,
                   superblock_t *superblock,
                   buf_lock_t *sindex_block,
+                  const std::map<std::string, secondary_index_t> &shipped_sindexes,
                   parallel_traversal_progress_t *p, signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t);
 
+// Sends the entries of `shipped_sindexes` whose primary keys lie in any of
+// `pkey_ranges`.  Index entries aren't sorted by primary key, so this traverses every
+// index as a whole; call it once for all of the documents that `rdb_backfill()` sent.
+void rdb_backfill_sindexes(const std::vector<key_range_t> &pkey_ranges,
+                           const std::map<std::string, secondary_index_t>
+                               &shipped_sindexes,
+                           rdb_backfill_callback_t *callback,
+                           buf_lock_t *sindex_block, signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t);
+
 
 void rdb_delete(const store_key_t &key, btree_slice_t *slice, repli_timestamp_t
                 timestamp, superblock_t *superblock,
@@ -164,13 +229,16 @@ void rdb_delete(const store_key_t &key, btree_slice_t *slice, repli_timestamp_t
  * It returns a number of modification reports that should be applied
  * to secondary indexes separately. Blobs are detached, and should be deleted later
  * if required (passing the modification reports to store_t::update_sindexes()
- * takes care of that). */
+ * takes care of that). The superblock is released unless `release_superblock` is
+ * `KEEP`. */
 void rdb_erase_small_range(key_tester_t *tester,
                            const key_range_t &keys,
                            superblock_t *superblock,
                            const deletion_context_t *deletion_context,
                            signal_t *interruptor,
-                           std::vector<rdb_modification_report_t> *mod_reports_out);
+                           std::vector<rdb_modification_report_t> *mod_reports_out,
+                           release_superblock_t release_superblock
+                               = release_superblock_t::RELEASE);
 
 void rdb_rget_slice(
     btree_slice_t *slice,
@@ -183,11 +251,16 @@ void rdb_rget_slice(
     sorting_t sorting,
     rget_read_response_t *response);
 
+// `primary_slice` and `primary_superblock` are only used for compact indexes, to
+// read the documents that aren't covered by the index.  The primary superblock
+// isn't released.
 void rdb_rget_secondary_slice(
     btree_slice_t *slice,
     const datum_range_t &datum_range,
     const region_t &sindex_region,
     superblock_t *superblock,
+    btree_slice_t *primary_slice,
+    superblock_t *primary_superblock,
     ql::env_t *ql_env,
     const ql::batchspec_t &batchspec,
     const std::vector<ql::transform_variant_t> &transforms,
@@ -283,13 +356,19 @@ struct sindex_disk_info_t {
     sindex_disk_info_t(const ql::map_wire_func_t &_mapping,
                        const sindex_reql_version_info_t &_mapping_version_info,
                        sindex_multi_bool_t _multi,
-                       sindex_geo_bool_t _geo) :
+                       sindex_geo_bool_t _geo,
+                       const boost::optional<std::vector<std::string> > &_cover
+                           = boost::none) :
         mapping(_mapping), mapping_version_info(_mapping_version_info),
-        multi(_multi), geo(_geo) { }
+        multi(_multi), geo(_geo), cover(_cover) { }
     ql::map_wire_func_t mapping;
     sindex_reql_version_info_t mapping_version_info;
     sindex_multi_bool_t multi;
     sindex_geo_bool_t geo;
+    // Set for compact indexes.  Their entries don't hold the whole document, just
+    // the index value and these fields of it (see `make_compact_sindex_entry()`),
+    // and reads that need more get the document from the primary btree.
+    boost::optional<std::vector<std::string> > cover;
 };
 
 void serialize_sindex_info(write_message_t *wm,
@@ -300,6 +379,14 @@ void deserialize_sindex_info(const std::vector<char> &data,
                              sindex_disk_info_t *info_out)
     THROWS_ONLY(archive_exc_t);
 
+// The value of a compact index's entry for `doc` under `index_value`: an array of
+// `index_value` and an object with the covered fields of `doc`.  Returns an empty
+// datum if that wouldn't be stored inline in the leaf, in which case the entry
+// refers to the document as in other indexes.  (Documents are always objects, so
+// readers can tell the two apart.)
+ql::datum_t make_compact_sindex_entry(ql::datum_t index_value, ql::datum_t doc,
+                                      const std::vector<std::string> &cover);
+
 /* An rdb_modification_cb_t is passed to BTree operations and allows them to
  * modify the secondary while they perform an operation. */
 class rdb_modification_report_cb_t {
@@ -74,7 +74,7 @@ store_t::store_t(serializer_t *serializer,
       ctx(_ctx),
       changefeed_server((ctx == NULL || ctx->manager == NULL)
                         ? NULL
-                        : new ql::changefeed::server_t(ctx->manager)),
+                        : new ql::changefeed::server_t(ctx->manager, ctx)),
       index_report(_index_report)
 {
     cache.init(new cache_t(serializer, balancer, &perfmon_collection));
@@ -479,7 +479,8 @@ void store_t::update_sindexes(
             txn_t *txn,
             buf_lock_t *sindex_block,
             const std::vector<rdb_modification_report_t> &mod_reports,
-            bool release_sindex_block) {
+            bool release_sindex_block,
+            const std::set<uuid_u> &sindexes_to_skip) {
     scoped_ptr_t<new_mutex_in_line_t> acq =
             get_in_line_for_sindex_queue(sindex_block);
     {
@@ -489,6 +490,15 @@ void store_t::update_sindexes(
         if (release_sindex_block) {
             sindex_block->reset_buf_lock();
         }
+        if (!sindexes_to_skip.empty()) {
+            sindex_access_vector_t updated_sindexes;
+            for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+                if (!std_contains(sindexes_to_skip, (*it)->sindex.id)) {
+                    updated_sindexes.push_back(std::move(*it));
+                }
+            }
+            sindexes = std::move(updated_sindexes);
+        }
 
         rdb_live_deletion_context_t deletion_context;
         for (size_t i = 0; i < mod_reports.size(); ++i) {
@@ -539,8 +549,8 @@ void store_t::sindex_queue_push(
 }
 
 void store_t::add_progress_tracker(
-        map_insertion_sentry_t<uuid_u, const parallel_traversal_progress_t *> *sentry,
-        uuid_u id, const parallel_traversal_progress_t *p) {
+        map_insertion_sentry_t<uuid_u, const traversal_progress_t *> *sentry,
+        uuid_u id, const traversal_progress_t *p) {
     assert_thread();
     sentry->reset(&progress_trackers, id, p);
 }
@@ -701,6 +711,7 @@ void store_t::clear_sindex(
                                  repli_timestamp_t::distant_past,
                                  key_modification_proof_t::real_proof());
                 }
+                update_child_count(&kv_location.buf, &kv_location.last_buf);
                 check_and_handle_underfull(sizer, &kv_location.buf,
                         &kv_location.last_buf, kv_location.superblock,
                         keys[i].btree_key(),
@@ -991,7 +1002,8 @@ MUST_USE bool store_t::acquire_sindex_superblock_for_read(
         superblock_t *superblock,
         scoped_ptr_t<real_superblock_t> *sindex_sb_out,
         std::vector<char> *opaque_definition_out,
-        uuid_u *sindex_uuid_out)
+        uuid_u *sindex_uuid_out,
+        release_superblock_t release_superblock)
     THROWS_ONLY(sindex_not_ready_exc_t) {
     assert_thread();
     rassert(opaque_definition_out != NULL);
@@ -1001,7 +1013,9 @@ MUST_USE bool store_t::acquire_sindex_superblock_for_read(
     buf_lock_t sindex_block
         = acquire_sindex_block_for_read(superblock->expose_buf(),
                                         superblock->get_sindex_block_id());
-    superblock->release();
+    if (release_superblock == release_superblock_t::RELEASE) {
+        superblock->release();
+    }
 
     /* Figure out what the superblock for this index is. */
     secondary_index_t sindex;
@@ -0,0 +1,362 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/bytecode.hpp"
+
+#include <algorithm>
+
+#include "concurrency/interruptor.hpp"
+#include "concurrency/signal.hpp"
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/ql2.pb.h"
+
+namespace ql {
+
+class bytecode_t::compiler_t {
+public:
+    compiler_t(bytecode_t *_program,
+               const std::vector<sym_t> &_arg_names,
+               const var_scope_t &_captured_scope)
+        : program(_program),
+          arg_names(_arg_names),
+          captured_scope(_captured_scope),
+          depth(0),
+          max_depth(0) { }
+
+    // Emits code that leaves the value of `t` on top of the stack.  Returns false
+    // if `t` isn't something we compile.
+    bool compile(const Term &t) {
+        if (t.optargs_size() != 0) {
+            return false;
+        }
+        switch (t.type()) {
+        case Term::DATUM: {
+            datum_t d;
+            try {
+                d = to_datum(&t.datum(), configured_limits_t::unlimited);
+            } catch (const base_exc_t &) {
+                return false;
+            }
+            emit(opcode_t::PUSH_CONST, add_const(d), 0, 1);
+            return true;
+        }
+        case Term::VAR: {
+            if (t.args_size() != 1 || t.args(0).type() != Term::DATUM
+                || t.args(0).datum().type() != Datum::R_NUM) {
+                return false;
+            }
+            const sym_t var(static_cast<int64_t>(t.args(0).datum().r_num()));
+            for (size_t i = 0; i < arg_names.size(); ++i) {
+                if (arg_names[i].value == var.value) {
+                    emit(opcode_t::PUSH_ARG, i, 0, 1);
+                    return true;
+                }
+            }
+            // Captured variables can't change between calls.
+            emit(opcode_t::PUSH_CONST, add_const(captured_scope.lookup_var(var)), 0, 1);
+            return true;
+        }
+        case Term::IMPLICIT_VAR: {
+            // The implicit variable is only ours if we're the outermost function
+            // that has one, which is all the term compiler lets `r.row` refer to.
+            if (arg_names.size() != 1 || !function_emits_implicit_variable(arg_names)) {
+                return false;
+            }
+            emit(opcode_t::PUSH_ARG, 0, 0, 1);
+            return true;
+        }
+        case Term::GET_FIELD: // fallthru
+        case Term::BRACKET: {
+            if (t.args_size() != 2 || t.args(1).type() != Term::DATUM
+                || t.args(1).datum().type() != Datum::R_STR) {
+                return false;
+            }
+            if (!compile(t.args(0))) {
+                return false;
+            }
+            program->keys.push_back(datum_string_t(t.args(1).datum().r_str()));
+            emit(opcode_t::GET_FIELD, program->keys.size() - 1, 0, 0);
+            return true;
+        }
+        case Term::EQ: // fallthru
+        case Term::NE: // fallthru
+        case Term::LT: // fallthru
+        case Term::LE: // fallthru
+        case Term::GT: // fallthru
+        case Term::GE:
+            return t.args_size() >= 2 && compile_nary(t, opcode_t::COMPARE);
+        case Term::ADD: // fallthru
+        case Term::SUB: // fallthru
+        case Term::MUL: // fallthru
+        case Term::DIV:
+            return t.args_size() >= 1 && compile_nary(t, opcode_t::ARITH);
+        case Term::MAKE_ARRAY:
+            return compile_nary(t, opcode_t::MAKE_ARRAY);
+        case Term::CONTAINS:
+            return t.args_size() >= 1 && compile_nary(t, opcode_t::CONTAINS);
+        case Term::NOT: {
+            if (t.args_size() != 1 || !compile(t.args(0))) {
+                return false;
+            }
+            emit(opcode_t::NOT, 0, 0, 0);
+            return true;
+        }
+        case Term::ALL: // fallthru
+        case Term::ANY: {
+            if (t.args_size() < 1) {
+                return false;
+            }
+            // `all` returns the first false value or the last value, and `any` the
+            // first true value or `false`.
+            const bool is_all = t.type() == Term::ALL;
+            std::vector<size_t> jumps_to_end;
+            for (int i = 0; i < t.args_size(); ++i) {
+                if (!compile(t.args(i))) {
+                    return false;
+                }
+                if (is_all && i == t.args_size() - 1) {
+                    break;
+                }
+                jumps_to_end.push_back(program->code.size());
+                emit(is_all ? opcode_t::JUMP_IF_FALSE : opcode_t::JUMP_IF_TRUE,
+                     0, 0, 0);
+                emit(opcode_t::POP, 0, 0, -1);
+            }
+            if (!is_all) {
+                emit(opcode_t::PUSH_CONST, add_const(datum_t::boolean(false)), 0, 1);
+            }
+            for (size_t jump : jumps_to_end) {
+                program->code[jump].a = program->code.size();
+            }
+            return true;
+        }
+        case Term::BRANCH: {
+            if (t.args_size() != 3 || !compile(t.args(0))) {
+                return false;
+            }
+            const size_t jump_to_else = program->code.size();
+            emit(opcode_t::POP_JUMP_IF_FALSE, 0, 0, -1);
+            if (!compile(t.args(1))) {
+                return false;
+            }
+            const size_t jump_to_end = program->code.size();
+            emit(opcode_t::JUMP, 0, 0, 0);
+            // Only one of the branches runs.
+            --depth;
+            program->code[jump_to_else].a = program->code.size();
+            if (!compile(t.args(2))) {
+                return false;
+            }
+            program->code[jump_to_end].a = program->code.size();
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    size_t get_max_depth() const { return max_depth; }
+
+private:
+    bool compile_nary(const Term &t, opcode_t op) {
+        for (int i = 0; i < t.args_size(); ++i) {
+            if (!compile(t.args(i))) {
+                return false;
+            }
+        }
+        emit(op, t.type(), t.args_size(), 1 - t.args_size());
+        return true;
+    }
+
+    uint32_t add_const(datum_t d) {
+        program->consts.push_back(std::move(d));
+        return program->consts.size() - 1;
+    }
+
+    void emit(opcode_t op, uint32_t a, uint32_t b, int depth_change) {
+        program->code.push_back(instr_t{op, a, b});
+        depth += depth_change;
+        max_depth = std::max(max_depth, depth);
+    }
+
+    bytecode_t *program;
+    const std::vector<sym_t> &arg_names;
+    const var_scope_t &captured_scope;
+    size_t depth;
+    size_t max_depth;
+};
+
+scoped_ptr_t<bytecode_t> bytecode_t::compile(const Term &body,
+                                             const std::vector<sym_t> &arg_names,
+                                             const var_scope_t &captured_scope) {
+    scoped_ptr_t<bytecode_t> program(new bytecode_t());
+    program->num_args = arg_names.size();
+    compiler_t compiler(program.get(), arg_names, captured_scope);
+    if (!compiler.compile(body) || compiler.get_max_depth() > MAX_STACK_DEPTH) {
+        return scoped_ptr_t<bytecode_t>();
+    }
+    return program;
+}
+
+static bool compare(reql_version_t reql_version, int type,
+                    const datum_t &lhs, const datum_t &rhs) {
+    switch (type) {
+    case Term::EQ: // fallthru
+    case Term::NE: return lhs == rhs;
+    case Term::LT: return lhs.cmp(reql_version, rhs) < 0;
+    case Term::LE: return lhs.cmp(reql_version, rhs) <= 0;
+    case Term::GT: return lhs.cmp(reql_version, rhs) > 0;
+    case Term::GE: return lhs.cmp(reql_version, rhs) >= 0;
+    default: unreachable();
+    }
+}
+
+// Returns false if the interpreter has to do it.
+static bool arith(int type, double lhs, double rhs, double *out) {
+    switch (type) {
+    case Term::ADD: *out = lhs + rhs; return true;
+    case Term::SUB: *out = lhs - rhs; return true;
+    case Term::MUL: *out = lhs * rhs; return true;
+    case Term::DIV:
+        *out = lhs / rhs;
+        return rhs != 0;
+    default: unreachable();
+    }
+}
+
+datum_t bytecode_t::run(env_t *env, const std::vector<datum_t> &args) const {
+    // When profiling, the interpreter's per-term events are what the user asked for.
+    if (args.size() != num_args || env->trace != NULL) {
+        return datum_t();
+    }
+    // The interpreter does these for every term; once per call is plenty.
+    DEBUG_ONLY_CODE(env->do_eval_callback());
+    if (env->interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+    env->maybe_yield();
+    datum_t stack[MAX_STACK_DEPTH];
+    size_t sp = 0;
+    try {
+        for (size_t pc = 0; pc < code.size(); ++pc) {
+            const instr_t &instr = code[pc];
+            switch (instr.op) {
+            case opcode_t::PUSH_CONST:
+                stack[sp++] = consts[instr.a];
+                break;
+            case opcode_t::PUSH_ARG:
+                stack[sp++] = args[instr.a];
+                break;
+            case opcode_t::GET_FIELD: {
+                datum_t *top = &stack[sp - 1];
+                if (top->get_type() != datum_t::R_OBJECT) {
+                    return datum_t();
+                }
+                *top = top->get_field(keys[instr.a], NOTHROW);
+                if (!top->has()) {
+                    return datum_t();
+                }
+            } break;
+            case opcode_t::COMPARE: {
+                const datum_t *operands = &stack[sp - instr.b];
+                bool result = true;
+                for (size_t i = 1; i < instr.b && result; ++i) {
+                    result = compare(env->reql_version(), instr.a,
+                                     operands[i - 1], operands[i]);
+                }
+                sp -= instr.b;
+                stack[sp++] = datum_t::boolean(result != (instr.a == Term::NE));
+            } break;
+            case opcode_t::NOT:
+                stack[sp - 1] = datum_t::boolean(!stack[sp - 1].as_bool());
+                break;
+            case opcode_t::ARITH: {
+                const datum_t *operands = &stack[sp - instr.b];
+                for (size_t i = 0; i < instr.b; ++i) {
+                    // Times, strings, arrays, and geometry go to the interpreter.
+                    if (operands[i].get_type() != datum_t::R_NUM) {
+                        return datum_t();
+                    }
+                }
+                double acc = operands[0].as_num();
+                for (size_t i = 1; i < instr.b; ++i) {
+                    if (!arith(instr.a, acc, operands[i].as_num(), &acc)) {
+                        return datum_t();
+                    }
+                }
+                sp -= instr.b;
+                // Throws on non-finite results.
+                stack[sp++] = datum_t(acc);
+            } break;
+            case opcode_t::MAKE_ARRAY: {
+                datum_array_builder_t builder(env->limits());
+                builder.reserve(instr.b);
+                for (size_t i = sp - instr.b; i < sp; ++i) {
+                    builder.add(std::move(stack[i]));
+                }
+                sp -= instr.b;
+                stack[sp++] = std::move(builder).to_datum();
+            } break;
+            case opcode_t::CONTAINS: {
+                const datum_t &seq = stack[sp - instr.b];
+                if (seq.get_type() != datum_t::R_ARRAY) {
+                    return datum_t();
+                }
+                // Bag semantics: each element of `seq` satisfies at most one of the
+                // required values.
+                const datum_t *required = &stack[sp - instr.b + 1];
+                const size_t num_required = instr.b - 1;
+                bool found[MAX_STACK_DEPTH] = { false };
+                size_t num_found = 0;
+                // Like the interpreter, we're only ever true once we've seen an
+                // element, even if there's nothing to look for.
+                bool result = false;
+                for (size_t i = 0; i < seq.arr_size() && !result; ++i) {
+                    datum_t el = seq.get(i);
+                    for (size_t j = 0; j < num_required; ++j) {
+                        if (!found[j] && required[j] == el) {
+                            found[j] = true;
+                            ++num_found;
+                            break;
+                        }
+                    }
+                    result = num_found == num_required;
+                }
+                sp -= instr.b;
+                stack[sp++] = datum_t::boolean(result);
+            } break;
+            case opcode_t::POP:
+                stack[--sp].reset();
+                break;
+            case opcode_t::JUMP:
+                pc = instr.a - 1;
+                break;
+            case opcode_t::POP_JUMP_IF_FALSE:
+                if (!stack[--sp].as_bool()) {
+                    pc = instr.a - 1;
+                }
+                stack[sp].reset();
+                break;
+            case opcode_t::JUMP_IF_FALSE:
+                if (!stack[sp - 1].as_bool()) {
+                    pc = instr.a - 1;
+                }
+                break;
+            case opcode_t::JUMP_IF_TRUE:
+                if (stack[sp - 1].as_bool()) {
+                    pc = instr.a - 1;
+                }
+                break;
+            default:
+                unreachable();
+            }
+        }
+    } catch (const base_exc_t &) {
+        // The interpreter will produce the error, with the right backtrace.
+        return datum_t();
+    }
+    r_sanity_check(sp == 1);
+    return std::move(stack[0]);
+}
+
+}  // namespace ql
@@ -0,0 +1,98 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_BYTECODE_HPP_
+#define RDB_PROTOCOL_BYTECODE_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_string.hpp"
+#include "rdb_protocol/sym.hpp"
+#include "rdb_protocol/var_types.hpp"
+
+class Term;
+
+namespace ql {
+
+class env_t;
+
+/* `bytecode_t` is a flat stack-machine program for the body of a `reql_func_t`.
+Evaluating a function through the `term_t` tree allocates a `val_t` per term and
+looks every variable up in a `var_scope_t`; for the small predicates and mappings
+that `filter` and `map` run on every row, that overhead is most of the cost.
+
+Only a deterministic subset of terms is compiled (see `compile()`), and the program
+only handles the common case of each: a comparison of two numbers, a field of an
+object, and so on.  Anything else -- including every error -- makes `run()` bail
+out, and the caller falls back to the interpreter, which produces the real result
+or error.  Since the compiled terms are deterministic and have no side effects,
+evaluating them twice is harmless. */
+class bytecode_t {
+public:
+    // Returns an empty pointer if `body` uses a term we don't compile.
+    static scoped_ptr_t<bytecode_t> compile(const Term &body,
+                                            const std::vector<sym_t> &arg_names,
+                                            const var_scope_t &captured_scope);
+
+    // Returns an empty `datum_t` if the interpreter has to evaluate the function
+    // instead.  Throws `interrupted_exc_t`.
+    datum_t run(env_t *env, const std::vector<datum_t> &args) const;
+
+    // The instruction set.
+    enum class opcode_t : uint8_t {
+        // Pushes `consts[a]`.
+        PUSH_CONST,
+        // Pushes `args[a]`.
+        PUSH_ARG,
+        // Replaces the object on top of the stack with its field `keys[a]`.
+        GET_FIELD,
+        // Replaces the top `b` values with the result of comparison `a` on them.
+        COMPARE,
+        // Replaces the top value with its negation.
+        NOT,
+        // Replaces the top `b` numbers with the result of arithmetic operation `a`.
+        ARITH,
+        // Replaces the top `b` values with an array of them.
+        MAKE_ARRAY,
+        // Replaces an array and the `b - 1` values above it with whether the array
+        // contains all of the values.
+        CONTAINS,
+        // Pops a value.
+        POP,
+        // Jumps to `a`.
+        JUMP,
+        // Pops a value and jumps to `a` if it's false.
+        POP_JUMP_IF_FALSE,
+        // Jumps to `a` (keeping the value) if the top value is false, or true.
+        JUMP_IF_FALSE,
+        JUMP_IF_TRUE,
+    };
+
+    struct instr_t {
+        opcode_t op;
+        uint32_t a;
+        uint32_t b;
+    };
+
+    // How deep the stack may get.  `run()` keeps it on the C++ stack, and we don't
+    // compile functions that would need more.
+    static const size_t MAX_STACK_DEPTH = 16;
+
+private:
+    class compiler_t;
+
+    bytecode_t() : num_args(0) { }
+
+    std::vector<instr_t> code;
+    std::vector<datum_t> consts;
+    std::vector<datum_string_t> keys;
+    size_t num_args;
+
+    DISABLE_COPYING(bytecode_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_BYTECODE_HPP_
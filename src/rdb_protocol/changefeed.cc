@@ -2,12 +2,18 @@
 
 #include <queue>
 
+#include "config/args.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/val.hpp"
 #include "rpc/mailbox/typed.hpp"
 
@@ -17,10 +23,63 @@ namespace ql {
 
 namespace changefeed {
 
-server_t::server_t(mailbox_manager_t *_manager)
+// The most a table subscription will buffer (measured by the serialized size of the
+// changes) before it starts dropping changes.
+static const size_t MAX_BUFFERED_SIZE = 16 * MEGABYTE;
+
+// Writes a transformation for `filter_key`.
+class filter_key_visitor_t : public boost::static_visitor<void> {
+public:
+    explicit filter_key_visitor_t(write_message_t *_wm) : wm(_wm) { }
+    void operator()(const map_wire_func_t &f) const {
+        f.serialize_normalized(wm);
+    }
+    void operator()(const filter_wire_func_t &f) const {
+        f.filter_func.serialize_normalized(wm);
+        const bool has_default = static_cast<bool>(f.default_filter_val);
+        serialize<cluster_version_t::CLUSTER>(wm, has_default);
+        if (has_default) {
+            f.default_filter_val->serialize_normalized(wm);
+        }
+    }
+    void operator()(const concatmap_wire_func_t &f) const {
+        f.serialize_normalized(wm);
+    }
+    // Nothing else gets pushed down to the shards (see `pushdown_visitor_t`).
+    template<class T>
+    void operator()(const T &t) const {
+        serialize<cluster_version_t::CLUSTER>(wm, t);
+    }
+private:
+    write_message_t *wm;
+};
+
+std::string filter_key(const std::vector<transform_variant_t> &transforms) {
+    write_message_t wm;
+    const uint64_t num_transforms = transforms.size();
+    serialize<cluster_version_t::CLUSTER>(&wm, num_transforms);
+    for (auto const &tv : transforms) {
+        serialize<cluster_version_t::CLUSTER>(&wm, static_cast<int8_t>(tv.which()));
+        boost::apply_visitor(filter_key_visitor_t(&wm), tv);
+    }
+    vector_stream_t stream;
+    stream.reserve(wm.size());
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    return std::string(stream.vector().begin(), stream.vector().end());
+}
+
+RDB_IMPL_SERIALIZABLE_2(filter_t, id, transforms);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(filter_t);
+
+server_t::server_t(mailbox_manager_t *_manager, rdb_context_t *_ctx)
     : uuid(generate_uuid()),
       manager(_manager),
-      stop_mailbox(manager, std::bind(&server_t::stop_mailbox_cb, this, ph::_1)) { }
+      ctx(_ctx),
+      stop_mailbox(manager, std::bind(&server_t::stop_mailbox_cb, this, ph::_1)),
+      remove_filter_mailbox(
+          manager,
+          std::bind(&server_t::remove_filter_mailbox_cb, this, ph::_1, ph::_2)) { }
 
 server_t::~server_t() { }
 
@@ -37,6 +96,29 @@ void server_t::stop_mailbox_cb(client_t::addr_t addr) {
     }
 }
 
+void server_t::remove_filter_mailbox_cb(client_t::addr_t addr, uint64_t filter_id) {
+    auto_drainer_t::lock_t lock(&drainer);
+    rwlock_in_line_t spot(&clients_lock, access_t::write);
+    spot.write_signal()->wait_lazily_unordered();
+    auto it = clients.find(addr);
+    // As above, the client might have already been removed.
+    if (it != clients.end()) {
+        auto filter_it = it->second.filters.find(filter_id);
+        if (filter_it != it->second.filters.end()) {
+            release_evaluator(filter_it->second);
+            it->second.filters.erase(filter_it);
+        }
+    }
+}
+
+void server_t::release_evaluator(evaluators_t::iterator evaluator) {
+    guarantee(evaluator->second.refcount > 0);
+    evaluator->second.refcount -= 1;
+    if (evaluator->second.refcount == 0) {
+        evaluators.erase(evaluator);
+    }
+}
+
 void server_t::add_client(const client_t::addr_t &addr, region_t region) {
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&clients_lock, access_t::write);
@@ -79,24 +161,20 @@ void server_t::add_client_cb(signal_t *stopped, client_t::addr_t addr) {
         send_one_with_lock(coro_lock, &*it, msg_t(msg_t::stop_t()));
     }
     coro_spot.write_signal()->wait_lazily_unordered();
+    it = clients.find(addr);
+    if (it != clients.end()) {
+        for (auto const &pair : it->second.filters) {
+            release_evaluator(pair.second);
+        }
+    }
     size_t erased = clients.erase(addr);
     // This is true even if we have multiple shards per btree because
     // `add_client` only spawns one of us.
     guarantee(erased == 1);
 }
 
-struct stamped_msg_t {
-    stamped_msg_t() { }
-    stamped_msg_t(uuid_u _server_uuid, uint64_t _stamp, msg_t _submsg)
-        : server_uuid(std::move(_server_uuid)),
-          stamp(_stamp),
-          submsg(std::move(_submsg)) { }
-    uuid_u server_uuid;
-    uint64_t stamp;
-    msg_t submsg;
-};
-
-RDB_MAKE_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
+RDB_IMPL_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(stamped_msg_t);
 
 // This function takes a `lock_t` to make sure you have one.  (We can't just
 // always ackquire a drainer lock before sending because we sometimes send a
@@ -116,16 +194,107 @@ void server_t::send_one_with_lock(
     send(manager, client->first, stamped_msg_t(uuid, stamp, std::move(msg)));
 }
 
-void server_t::send_all(msg_t msg, const store_key_t &key) {
+void server_t::add_filter(const client_t::addr_t &addr, const filter_t &filter) {
+    auto_drainer_t::lock_t lock(&drainer);
+    rwlock_in_line_t spot(&clients_lock, access_t::write);
+    spot.write_signal()->wait_lazily_unordered();
+    auto it = clients.find(addr);
+    // If the client was removed it won't be sent anything anyway.
+    if (it == clients.end() || it->second.filters.count(filter.id) != 0) {
+        return;
+    }
+    const std::string key = filter_key(filter.transforms);
+    auto evaluator = evaluators.find(key);
+    if (evaluator == evaluators.end()) {
+        evaluator = evaluators.insert(std::make_pair(key, evaluator_t())).first;
+        for (auto const &tv : filter.transforms) {
+            evaluator->second.ops.push_back(make_op(tv));
+        }
+    }
+    evaluator->second.refcount += 1;
+    it->second.filters.insert(std::make_pair(filter.id, evaluator));
+}
+
+// What came out of running a change through an `evaluator_t`.
+struct filter_result_t {
+    filter_result_t() : failed(false) { }
+    std::vector<datum_t> vals;
+    bool failed;
+    std::string error;
+};
+
+static filter_result_t apply_filter(env_t *env,
+                                    const std::vector<scoped_ptr_t<op_t> > &ops,
+                                    const datum_t &change) {
+    filter_result_t res;
+    // `env` is NULL if there are no `ops`.
+    groups_t groups(optional_datum_less_t(reql_version_t::LATEST));
+    groups[datum_t()] = std::vector<datum_t>{change};
+    try {
+        for (auto it = ops.begin(); it != ops.end(); ++it) {
+            (**it)(env, &groups, datum_t());
+        }
+    } catch (const base_exc_t &e) {
+        res.failed = true;
+        res.error = e.what();
+        return res;
+    }
+    auto it = groups.find(datum_t());
+    if (it != groups.end()) {
+        res.vals = std::move(it->second);
+    }
+    return res;
+}
+
+void server_t::send_all(const datum_t &old_val, const datum_t &new_val,
+                        const store_key_t &key) {
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&clients_lock, access_t::read);
     spot.read_signal()->wait_lazily_unordered();
-    for (auto it = clients.begin(); it != clients.end(); ++it) {
-        if (std::any_of(it->second.regions.begin(),
-                        it->second.regions.end(),
-                        std::bind(&region_contains_key, ph::_1, std::cref(key)))) {
-            send_one_with_lock(lock, &*it, msg);
+
+    const datum_t change(std::map<datum_string_t, datum_t>{
+        {datum_string_t("new_val"), new_val.has() ? new_val : datum_t::null()},
+        {datum_string_t("old_val"), old_val.has() ? old_val : datum_t::null()}});
+    // Built the first time we have transformations to run.
+    scoped_ptr_t<env_t> env;
+    std::map<const evaluator_t *, filter_result_t> results;
+    try {
+        for (auto it = clients.begin(); it != clients.end(); ++it) {
+            if (!std::any_of(it->second.regions.begin(),
+                             it->second.regions.end(),
+                             std::bind(&region_contains_key,
+                                       ph::_1, std::cref(key)))) {
+                continue;
+            }
+            msg_t::change_t msg;
+            for (auto const &pair : it->second.filters) {
+                const evaluator_t *evaluator = &pair.second->second;
+                auto res = results.find(evaluator);
+                if (res == results.end()) {
+                    if (!env.has() && !evaluator->ops.empty()) {
+                        env.init(new env_t(ctx, lock.get_drain_signal(),
+                                           std::map<std::string, wire_func_t>(),
+                                           NULL));
+                    }
+                    res = results.insert(
+                        std::make_pair(
+                            evaluator,
+                            apply_filter(env.get(), evaluator->ops, change))).first;
+                }
+                if (res->second.failed) {
+                    msg.errors[pair.first] = res->second.error;
+                } else if (!res->second.vals.empty()) {
+                    msg.vals[pair.first] = res->second.vals;
+                }
+            }
+            // Clients whose filters all dropped the change don't hear about it
+            // (and their stamp doesn't advance).
+            if (!msg.vals.empty() || !msg.errors.empty()) {
+                send_one_with_lock(lock, &*it, msg_t(std::move(msg)));
+            }
         }
+    } catch (const interrupted_exc_t &) {
+        // We're shutting down, and every client is about to be sent a `stop_t`.
     }
 }
 
@@ -142,6 +311,10 @@ server_t::addr_t server_t::get_stop_addr() {
     return stop_mailbox.get_address();
 }
 
+remove_filter_addr_t server_t::get_remove_filter_addr() {
+    return remove_filter_mailbox.get_address();
+}
+
 uint64_t server_t::get_stamp(const client_t::addr_t &addr) {
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&clients_lock, access_t::read);
@@ -164,16 +337,146 @@ msg_t::msg_t(stop_t &&_op) : op(std::move(_op)) { }
 msg_t::msg_t(change_t &&_op) : op(std::move(_op)) { }
 
 msg_t::change_t::change_t() { }
-msg_t::change_t::change_t(datum_t _old_val,
-                          datum_t _new_val)
-    : old_val(std::move(_old_val)), new_val(std::move(_new_val)) { }
 msg_t::change_t::~change_t() { }
 
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_13(msg_t, op);
-RDB_IMPL_ME_SERIALIZABLE_2_SINCE_v1_13(
-    msg_t::change_t, empty_ok(old_val), empty_ok(new_val));
+RDB_IMPL_ME_SERIALIZABLE_2_SINCE_v1_13(msg_t::change_t, vals, errors);
 RDB_IMPL_SERIALIZABLE_0_SINCE_v1_13(msg_t::stop_t);
 
+change_buffer_t::change_buffer_t(std::string _pkey, bool _squash, size_t _max_size,
+                                 perfmon_counter_t *_dropped,
+                                 perfmon_counter_t *_squashed)
+    : pkey(std::move(_pkey)),
+      squash(_squash),
+      max_size(_max_size),
+      dropped(_dropped),
+      squashed(_squashed),
+      num_els(0),
+      els_size(0),
+      num_cancelled(0) { }
+
+change_buffer_t::overflow_t change_buffer_t::push(datum_t &&change,
+                                                  size_t array_size_limit,
+                                                  size_t *num_dropped_out) {
+    if (!squash || !squash_el(change)) {
+        els_size += datum_serialized_size(change);
+        els.push_back(std::move(change));
+        num_els += 1;
+        if (squash) {
+            squashable[row_key(els.back())] = &els.back();
+        }
+    }
+    overflow_t overflow = num_els > array_size_limit
+        ? overflow_t::ARRAY_SIZE
+        : els_size > max_size ? overflow_t::MEMORY : overflow_t::NONE;
+    *num_dropped_out = 0;
+    if (overflow != overflow_t::NONE) {
+        *num_dropped_out = num_els;
+        *dropped += num_els;
+        clear();
+    }
+    return overflow;
+}
+
+datum_t change_buffer_t::pop() {
+    guarantee(!empty());
+    // Skip the changes that were squashed into nothing.
+    while (!els.front().has()) {
+        els.pop_front();
+        num_cancelled -= 1;
+    }
+    datum_t ret = std::move(els.front());
+    els.pop_front();
+    num_els -= 1;
+    els_size -= datum_serialized_size(ret);
+    if (squash) {
+        squashable.erase(row_key(ret));
+    }
+    return ret;
+}
+
+datum_t change_buffer_t::row_key(const datum_t &change) const {
+    datum_t val = change.get_field("new_val");
+    if (val.get_type() == datum_t::R_NULL) {
+        val = change.get_field("old_val");
+    }
+    return val.get_field(datum_string_t(pkey));
+}
+
+bool change_buffer_t::squash_el(const datum_t &change) {
+    auto it = squashable.find(row_key(change));
+    if (it == squashable.end()) {
+        return false;
+    }
+    ++*squashed;
+    datum_t *buffered = it->second;
+    els_size -= datum_serialized_size(*buffered);
+    datum_t old_val = buffered->get_field("old_val");
+    datum_t new_val = change.get_field("new_val");
+    if (old_val == new_val) {
+        // The row ended up the way it started (e.g. it was inserted and then
+        // deleted), so there's nothing left to report.
+        buffered->reset();
+        squashable.erase(it);
+        num_els -= 1;
+        num_cancelled += 1;
+        if (num_els == 0) {
+            els.clear();
+            num_cancelled = 0;
+        } else if (num_cancelled > num_els) {
+            // Otherwise inserting and deleting a row over and over next to a
+            // pending change would grow `els` without bound.
+            compact();
+        }
+    } else {
+        *buffered = datum_t(std::map<datum_string_t, datum_t>{
+            {datum_string_t("new_val"), new_val},
+            {datum_string_t("old_val"), old_val}});
+        els_size += datum_serialized_size(*buffered);
+    }
+    return true;
+}
+
+void change_buffer_t::compact() {
+    std::deque<datum_t> live;
+    for (auto &&el : els) {
+        if (el.has()) {
+            live.push_back(std::move(el));
+        }
+    }
+    els = std::move(live);
+    num_cancelled = 0;
+    // `squashable` pointed into the old deque.
+    squashable.clear();
+    for (auto &&el : els) {
+        squashable[row_key(el)] = &el;
+    }
+}
+
+void change_buffer_t::clear() {
+    els.clear();
+    squashable.clear();
+    num_els = 0;
+    els_size = 0;
+    num_cancelled = 0;
+}
+
+std::string skipped_changes_message(change_buffer_t::overflow_t overflow,
+                                    size_t skipped) {
+    switch (overflow) {
+    case change_buffer_t::overflow_t::ARRAY_SIZE:
+        return strprintf("Changefeed cache over array size limit, "
+                         "skipped %zu elements.", skipped);
+    case change_buffer_t::overflow_t::MEMORY:
+        return strprintf("Changefeed cache over memory limit (%zuMB), "
+                         "skipped %zu elements.",
+                         static_cast<size_t>(MAX_BUFFERED_SIZE / MEGABYTE), skipped);
+    case change_buffer_t::overflow_t::NONE: // fallthru
+    default:
+        unreachable();
+    }
+}
+
 enum class detach_t { NO, YES };
 
 // Uses the home thread of the subscriber, not the client.
@@ -188,18 +491,21 @@ public:
                        client_t::addr_t *addr) = 0;
     void stop(const std::string &msg, detach_t should_detach);
 protected:
-    explicit subscription_t(feed_t *_feed);
+    subscription_t(feed_t *_feed, rdb_context_t *_ctx);
     void maybe_signal_cond() THROWS_NOTHING;
     void destructor_cleanup(std::function<void()> del_sub) THROWS_NOTHING;
     // If an error occurs, we're detached and `exc` is set to an exception to rethrow.
     std::exception_ptr exc;
-    // If we exceed the array size limit, elements are evicted from `els` and
-    // `skipped` is incremented appropriately.  If `skipped` is non-0, we send
-    // an error object to the user with the number of skipped elements before
-    // continuing.
+    // If we exceed the array size limit or `MAX_BUFFERED_SIZE`, elements are
+    // evicted and `skipped` is incremented appropriately (and `skipped_limit`
+    // says which limit it was).  If `skipped` is non-0, we send an error object
+    // to the user with the number of skipped elements before continuing.
     size_t skipped;
+    change_buffer_t::overflow_t skipped_limit;
     // The feed we're subscribed to.
     feed_t *feed;
+    // For the dropped and squashed changes stats.
+    rdb_context_t *ctx;
 private:
     virtual bool has_el() = 0;
     virtual datum_t pop_el() = 0;
@@ -219,26 +525,38 @@ public:
            signal_t *interruptor);
     ~feed_t();
 
-    void add_point_sub(subscription_t *sub,
-                       const datum_t &key) THROWS_NOTHING;
+    // These return the id of the filter the subscription should register with
+    // the servers.  Point subscriptions use the filter that lets everything
+    // through.
+    uint64_t add_point_sub(subscription_t *sub,
+                           const datum_t &key) THROWS_NOTHING;
     void del_point_sub(subscription_t *sub,
-                       const datum_t &key) THROWS_NOTHING;
+                       const datum_t &key,
+                       uint64_t filter_id) THROWS_NOTHING;
 
-    void add_table_sub(subscription_t *sub) THROWS_NOTHING;
-    void del_table_sub(subscription_t *sub) THROWS_NOTHING;
+    uint64_t add_table_sub(subscription_t *sub,
+                           const std::string &key) THROWS_NOTHING;
+    void del_table_sub(subscription_t *sub, uint64_t filter_id) THROWS_NOTHING;
 
     void each_table_sub(const std::function<void(subscription_t *)> &f) THROWS_NOTHING;
     void each_point_sub(const std::function<void(subscription_t *)> &f) THROWS_NOTHING;
     void each_sub(const std::function<void(subscription_t *)> &f) THROWS_NOTHING;
+    void on_table_sub(uint64_t filter_id,
+                      const std::function<void(subscription_t *)> &f) THROWS_NOTHING;
     void on_point_sub(datum_t key,
                       const std::function<void(subscription_t *)> &f) THROWS_NOTHING;
 
+    // True if `filter_id` is the filter that lets every change through.
+    bool is_unfiltered(uint64_t filter_id) const;
 
     bool can_be_removed();
     client_t::addr_t get_addr() const;
 
     const std::string pkey;
 private:
+    uint64_t add_filter(const std::string &key);
+    void del_filter(uint64_t filter_id);
+
     void each_sub_in_vec(
         const std::vector<std::set<subscription_t *> > &vec,
         rwlock_in_line_t *spot,
@@ -256,6 +574,7 @@ private:
     mailbox_manager_t *manager;
     mailbox_t<void(stamped_msg_t)> mailbox;
     std::vector<server_t::addr_t> stop_addrs;
+    std::vector<remove_filter_addr_t> remove_filter_addrs;
 
     std::vector<scoped_ptr_t<disconnect_watcher_t> > disconnect_watchers;
 
@@ -274,7 +593,19 @@ private:
     std::map<uuid_u, scoped_ptr_t<queue_t> > queues;
     cond_t queues_ready;
 
-    std::vector<std::set<subscription_t *> > table_subs;
+    // The filters our subscriptions use, keyed by `filter_key`.  A filter is
+    // removed from the servers when its last subscription goes away, and its id
+    // is never reused, so a removal can't race with a later registration.
+    struct filter_info_t {
+        uint64_t id;
+        size_t refcount;
+    };
+    std::map<std::string, filter_info_t> filters;
+    uint64_t next_filter_id;
+    const std::string unfiltered_key;
+
+    // Maps filter ids to the table subscriptions using them.
+    std::map<uint64_t, std::vector<std::set<subscription_t *> > > table_subs;
     std::map<datum_t,
              std::vector<std::set<subscription_t *> >,
              optional_datum_less_t> point_subs;
@@ -290,12 +621,13 @@ private:
 class point_sub_t : public subscription_t {
 public:
     // Throws QL exceptions.
-    point_sub_t(feed_t *feed, datum_t _key)
-        : subscription_t(feed), key(std::move(_key)), stamp(0) {
-        feed->add_point_sub(this, key);
+    point_sub_t(feed_t *feed, rdb_context_t *ctx, datum_t _key)
+        : subscription_t(feed, ctx), key(std::move(_key)), stamp(0) {
+        filter_id = feed->add_point_sub(this, key);
     }
     virtual ~point_sub_t() {
-        destructor_cleanup(std::bind(&feed_t::del_point_sub, feed, this, key));
+        destructor_cleanup(
+            std::bind(&feed_t::del_point_sub, feed, this, key, filter_id));
     }
     virtual void start(env_t *env, namespace_interface_t *nif, client_t::addr_t *addr) {
         assert_thread();
@@ -303,7 +635,8 @@ public:
         nif->read(
             read_t(
                 changefeed_point_stamp_t(
-                    *addr, store_key_t(key->print_primary())),
+                    *addr, store_key_t(key->print_primary()),
+                    filter_t(filter_id, std::vector<transform_variant_t>())),
                 profile_bool_t::DONT_PROFILE),
             &read_resp,
             order_token_t::ignore,
@@ -332,6 +665,10 @@ private:
         // from that we have a strict ordering.
         if (d_stamp >= stamp) {
             stamp = d_stamp;
+            if (el.has()) {
+                // Point changefeeds only ever return the latest value.
+                ++ctx->changefeed_changes_squashed;
+            }
             el = d;
             maybe_signal_cond();
         }
@@ -344,6 +681,7 @@ private:
         return ret;
     }
     datum_t key;
+    uint64_t filter_id;
     uint64_t stamp;
     datum_t el;
 };
@@ -351,17 +689,24 @@ private:
 class table_sub_t : public subscription_t {
 public:
     // Throws QL exceptions.
-    explicit table_sub_t(feed_t *feed) : subscription_t(feed) {
-        feed->add_table_sub(this);
+    table_sub_t(feed_t *feed, rdb_context_t *ctx,
+                std::vector<transform_variant_t> &&transforms, bool _squash)
+        : subscription_t(feed, ctx),
+          els(feed->pkey, _squash, MAX_BUFFERED_SIZE,
+              &ctx->changefeed_changes_dropped, &ctx->changefeed_changes_squashed) {
+        // Squashing needs the untransformed changes.
+        r_sanity_check(!_squash || transforms.empty());
+        const uint64_t filter_id = feed->add_table_sub(this, filter_key(transforms));
+        filter = filter_t(filter_id, std::move(transforms));
     }
     virtual ~table_sub_t() {
-        destructor_cleanup(std::bind(&feed_t::del_table_sub, feed, this));
+        destructor_cleanup(std::bind(&feed_t::del_table_sub, feed, this, filter.id));
     }
     virtual void start(env_t *env, namespace_interface_t *nif, client_t::addr_t *addr) {
         assert_thread();
         read_response_t read_resp;
         nif->read(
-            read_t(changefeed_stamp_t(*addr), profile_bool_t::DONT_PROFILE),
+            read_t(changefeed_stamp_t(*addr, filter), profile_bool_t::DONT_PROFILE),
             &read_resp,
             order_token_t::ignore,
             env->interruptor);
@@ -379,28 +724,27 @@ private:
             auto it = start_stamps.find(uuid);
             guarantee(it != start_stamps.end());
             if (stamp >= it->second) {
-                els.push_back(std::move(d));
-                if (els.size() > limits.array_size_limit()) {
-                    skipped += els.size();
-                    els.clear();
+                size_t num_dropped;
+                change_buffer_t::overflow_t overflow
+                    = els.push(std::move(d), limits.array_size_limit(), &num_dropped);
+                if (overflow != change_buffer_t::overflow_t::NONE) {
+                    skipped += num_dropped;
+                    skipped_limit = overflow;
                 }
                 maybe_signal_cond();
             }
         }
     }
-    virtual bool has_el() { return els.size() != 0; }
-    virtual datum_t pop_el() {
-        guarantee(has_el());
-        datum_t ret = std::move(els.front());
-        els.pop_front();
-        return ret;
-    }
+    virtual bool has_el() { return !els.empty(); }
+    virtual datum_t pop_el() { return els.pop(); }
+    // The transformations the servers apply for us.
+    filter_t filter;
     // The stamp (see `stamped_msg_t`) associated with our `changefeed_stamp_t`
     // read.  We use these to make sure we don't see changes from writes before
     // our subscription.
     std::map<uuid_u, uint64_t> start_stamps;
-    // The queue of changes we've accumulated since the last time we were read from.
-    std::deque<datum_t> els;
+    // The changes we've accumulated since the last time we were read from.
+    change_buffer_t els;
 };
 
 class msg_visitor_t : public boost::static_visitor<void> {
@@ -408,31 +752,42 @@ public:
     msg_visitor_t(feed_t *_feed, uuid_u _server_uuid, uint64_t _stamp)
         : feed(_feed), server_uuid(_server_uuid), stamp(_stamp) { }
     void operator()(const msg_t::change_t &change) const {
-        datum_t null = datum_t::null();
         configured_limits_t default_limits;
-        std::map<datum_string_t, datum_t> obj{
-            {datum_string_t("new_val"), change.new_val.has() ? change.new_val : null},
-            {datum_string_t("old_val"), change.old_val.has() ? change.old_val : null}
-        };
-        auto d = datum_t(std::move(obj));
-        feed->each_table_sub(
-            std::bind(&subscription_t::add_el,
-                      ph::_1,
-                      std::cref(server_uuid),
-                      stamp,
-                      d, default_limits));
-        auto val = change.new_val.has() ? change.new_val : change.old_val;
-        r_sanity_check(val.has());
-        auto pkey_val = val->get_field(datum_string_t(feed->pkey), NOTHROW);
-        r_sanity_check(pkey_val.has());
-        feed->on_point_sub(
-            pkey_val,
-            std::bind(&subscription_t::add_el,
-                      ph::_1,
-                      std::cref(server_uuid),
-                      stamp,
-                      change.new_val.has() ? change.new_val : datum_t::null(),
-                      default_limits));
+        for (auto const &pair : change.vals) {
+            for (const datum_t &d : pair.second) {
+                feed->on_table_sub(
+                    pair.first,
+                    std::bind(&subscription_t::add_el,
+                              ph::_1,
+                              std::cref(server_uuid),
+                              stamp,
+                              d, default_limits));
+            }
+            if (feed->is_unfiltered(pair.first)) {
+                // The unfiltered filter turns a change into exactly one
+                // `{old_val: ..., new_val: ...}` object.
+                r_sanity_check(pair.second.size() == 1);
+                datum_t new_val = pair.second[0].get_field("new_val");
+                datum_t old_val = pair.second[0].get_field("old_val");
+                auto val = new_val.get_type() != datum_t::R_NULL ? new_val : old_val;
+                auto pkey_val = val.get_field(datum_string_t(feed->pkey), NOTHROW);
+                r_sanity_check(pkey_val.has());
+                feed->on_point_sub(
+                    pkey_val,
+                    std::bind(&subscription_t::add_el,
+                              ph::_1,
+                              std::cref(server_uuid),
+                              stamp,
+                              new_val,
+                              default_limits));
+            }
+        }
+        for (auto const &pair : change.errors) {
+            feed->on_table_sub(
+                pair.first,
+                std::bind(&subscription_t::stop,
+                          ph::_1, std::cref(pair.second), detach_t::NO));
+        }
     }
     void operator()(const msg_t::stop_t &) const {
         const char *msg = "Changefeed aborted (table unavailable).";
@@ -444,12 +799,57 @@ private:
     uint64_t stamp;
 };
 
+// Only deterministic `map`s, `filter`s and `concat_map`s are pushed down to the
+// servers: they evaluate each filter once for all the subscriptions sharing it,
+// which is only right if every subscription would have gotten the same result.
+class pushdown_visitor_t : public boost::static_visitor<bool> {
+public:
+    bool operator()(const map_wire_func_t &f) const {
+        return f.compile_wire_func()->is_deterministic();
+    }
+    bool operator()(const filter_wire_func_t &f) const {
+        return f.filter_func.compile_wire_func()->is_deterministic()
+            && (!f.default_filter_val
+                || f.default_filter_val->compile_wire_func()->is_deterministic());
+    }
+    bool operator()(const concatmap_wire_func_t &f) const {
+        return f.compile_wire_func()->is_deterministic();
+    }
+    template<class T>
+    bool operator()(const T &) const {
+        return false;
+    }
+};
+
+// We don't subscribe until the first batch is requested, so that the
+// transformations applied to the stream in the meantime can be pushed down to the
+// servers.
 class stream_t : public eager_datum_stream_t {
 public:
-    template<class... Args>
-    stream_t(scoped_ptr_t<subscription_t> &&_sub, Args... args)
-        : eager_datum_stream_t(std::forward<Args...>(args...)),
-          sub(std::move(_sub)) { }
+    stream_t(client_t *_client, namespace_id_t _table, std::string _table_name,
+             std::string _pkey, keyspec_t &&_keyspec, bool _squash,
+             const protob_t<const Backtrace> &bt)
+        : eager_datum_stream_t(bt),
+          client(_client),
+          table(std::move(_table)),
+          table_name(std::move(_table_name)),
+          pkey(std::move(_pkey)),
+          keyspec(std::move(_keyspec)),
+          squash(_squash) { }
+    virtual void add_transformation(transform_variant_t &&tv,
+                                    const protob_t<const Backtrace> &bt) {
+        // Point changefeeds only ever send one row's changes, so there's nothing
+        // to gain there.  Squashing has to see the changes before they're
+        // transformed, so we can't push anything down then either.
+        if (!sub.has() && !ops_to_do() && !squash
+            && boost::get<keyspec_t::all_t>(&keyspec.spec) != NULL
+            && boost::apply_visitor(pushdown_visitor_t(), tv)) {
+            transforms.push_back(std::move(tv));
+            update_bt(bt);
+        } else {
+            eager_datum_stream_t::add_transformation(std::move(tv), bt);
+        }
+    }
     virtual bool is_array() { return false; }
     virtual bool is_exhausted() const { return false; }
     virtual bool is_cfeed() const { return true; }
@@ -460,15 +860,33 @@ public:
                base_exc_t::GENERIC,
                "Cannot call a terminal (`reduce`, `count`, etc.) on an "
                "infinite stream (such as a changefeed).");
+        if (!sub.has()) {
+            sub = client->subscribe(env, table, table_name, pkey, keyspec, squash,
+                                    std::move(transforms));
+        }
         batcher_t batcher = bs.to_batcher();
         return sub->get_els(&batcher, env->interruptor);
     }
 private:
+    client_t *client;
+    const namespace_id_t table;
+    const std::string table_name;
+    const std::string pkey;
+    const keyspec_t keyspec;
+    const bool squash;
+    // The transformations to push down once we subscribe.
+    std::vector<transform_variant_t> transforms;
     scoped_ptr_t<subscription_t> sub;
 };
 
-subscription_t::subscription_t(feed_t *_feed) : skipped(0), feed(_feed), cond(NULL) {
+subscription_t::subscription_t(feed_t *_feed, rdb_context_t *_ctx)
+    : skipped(0),
+      skipped_limit(change_buffer_t::overflow_t::NONE),
+      feed(_feed),
+      ctx(_ctx),
+      cond(NULL) {
     guarantee(feed != NULL);
+    guarantee(ctx != NULL);
 }
 
 subscription_t::~subscription_t() { }
@@ -509,8 +927,8 @@ subscription_t::get_els(batcher_t *batcher, const signal_t *interruptor) {
             datum_t(
                 std::map<datum_string_t, datum_t>{
                     {datum_string_t("error"), datum_t(
-                        datum_string_t(strprintf("Changefeed cache over array size limit, "
-                                                "skipped %zu elements.", skipped)))}}));
+                        datum_string_t(skipped_changes_message(skipped_limit,
+                                                               skipped)))}}));
         skipped = 0;
     } else {
         while (has_el() && !batcher->should_send_batch()) {
@@ -561,12 +979,49 @@ INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(keyspec_t::point_t);
 RDB_MAKE_SERIALIZABLE_1(keyspec_t, spec);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(keyspec_t);
 
+uint64_t feed_t::add_filter(const std::string &key) {
+    assert_thread();
+    auto it = filters.find(key);
+    if (it == filters.end()) {
+        filter_info_t info;
+        info.id = next_filter_id++;
+        info.refcount = 0;
+        it = filters.insert(std::make_pair(key, info)).first;
+    }
+    it->second.refcount += 1;
+    return it->second.id;
+}
+
+void feed_t::del_filter(uint64_t filter_id) {
+    assert_thread();
+    auto it = std::find_if(
+        filters.begin(), filters.end(),
+        [&](const std::pair<const std::string, filter_info_t> &pair) {
+            return pair.second.id == filter_id;
+        });
+    guarantee(it != filters.end());
+    it->second.refcount -= 1;
+    if (it->second.refcount == 0) {
+        filters.erase(it);
+        for (auto const &addr : remove_filter_addrs) {
+            send(manager, addr, mailbox.get_address(), filter_id);
+        }
+    }
+}
+
+bool feed_t::is_unfiltered(uint64_t filter_id) const {
+    assert_thread();
+    auto it = filters.find(unfiltered_key);
+    return it != filters.end() && it->second.id == filter_id;
+}
+
 // If this throws we might leak the increment to `num_subs`.
-void feed_t::add_point_sub(subscription_t *sub,
-                           const datum_t &key) THROWS_NOTHING {
+uint64_t feed_t::add_point_sub(subscription_t *sub,
+                               const datum_t &key) THROWS_NOTHING {
     on_thread_t th(home_thread());
     guarantee(!detached);
     num_subs += 1;
+    const uint64_t filter_id = add_filter(unfiltered_key);
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&point_subs_lock, access_t::write);
     spot.read_signal()->wait_lazily_unordered();
@@ -577,12 +1032,15 @@ void feed_t::add_point_sub(subscription_t *sub,
             std::make_pair(key, decltype(subvec_it->second)(get_num_threads()))).first;
     }
     (subvec_it->second)[sub->home_thread().threadnum].insert(sub);
+    return filter_id;
 }
 
 // Can't throw because it's called in a destructor.
 void feed_t::del_point_sub(subscription_t *sub,
-                           const datum_t &key) THROWS_NOTHING {
+                           const datum_t &key,
+                           uint64_t filter_id) THROWS_NOTHING {
     on_thread_t th(home_thread());
+    del_filter(filter_id);
     {
         auto_drainer_t::lock_t lock(&drainer);
         rwlock_in_line_t spot(&point_subs_lock, access_t::write);
@@ -612,25 +1070,47 @@ void feed_t::del_point_sub(subscription_t *sub,
 }
 
 // If this throws we might leak the increment to `num_subs`.
-void feed_t::add_table_sub(subscription_t *sub) THROWS_NOTHING {
+uint64_t feed_t::add_table_sub(subscription_t *sub,
+                               const std::string &key) THROWS_NOTHING {
     on_thread_t th(home_thread());
     guarantee(!detached);
     num_subs += 1;
+    const uint64_t filter_id = add_filter(key);
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&table_subs_lock, access_t::write);
     spot.write_signal()->wait_lazily_unordered();
-    table_subs[sub->home_thread().threadnum].insert(sub);
+    auto subvec_it = table_subs.find(filter_id);
+    if (subvec_it == table_subs.end()) {
+        subvec_it = table_subs.insert(
+            std::make_pair(filter_id,
+                           decltype(subvec_it->second)(get_num_threads()))).first;
+    }
+    (subvec_it->second)[sub->home_thread().threadnum].insert(sub);
+    return filter_id;
 }
 
 // Can't throw because it's called in a destructor.
-void feed_t::del_table_sub(subscription_t *sub) THROWS_NOTHING {
+void feed_t::del_table_sub(subscription_t *sub, uint64_t filter_id) THROWS_NOTHING {
     on_thread_t th(home_thread());
+    del_filter(filter_id);
     {
         auto_drainer_t::lock_t lock(&drainer);
         rwlock_in_line_t spot(&table_subs_lock, access_t::write);
         spot.write_signal()->wait_lazily_unordered();
-        size_t erased = table_subs[sub->home_thread().threadnum].erase(sub);
+        auto subvec_it = table_subs.find(filter_id);
+        guarantee(subvec_it != table_subs.end());
+        size_t erased = (subvec_it->second)[sub->home_thread().threadnum].erase(sub);
         guarantee(erased == 1);
+        // If there are no more subscribers, remove the filter from the map.
+        auto it = subvec_it->second.begin();
+        for (; it != subvec_it->second.end(); ++it) {
+            if (it->size() != 0) {
+                break;
+            }
+        }
+        if (it == subvec_it->second.end()) {
+            table_subs.erase(subvec_it);
+        }
     }
     num_subs -= 1;
     if (num_subs == 0) {
@@ -678,7 +1158,24 @@ void feed_t::each_table_sub(
     const std::function<void(subscription_t *)> &f) THROWS_NOTHING {
     assert_thread();
     rwlock_in_line_t spot(&table_subs_lock, access_t::read);
-    each_sub_in_vec(table_subs, &spot, f);
+    spot.read_signal()->wait_lazily_unordered();
+    for (auto const &pair : table_subs) {
+        each_sub_in_vec(pair.second, &spot, f);
+    }
+}
+
+void feed_t::on_table_sub(
+    uint64_t filter_id,
+    const std::function<void(subscription_t *)> &f) THROWS_NOTHING {
+    assert_thread();
+    auto_drainer_t::lock_t lock(&drainer);
+    rwlock_in_line_t spot(&table_subs_lock, access_t::read);
+    spot.read_signal()->wait_lazily_unordered();
+
+    auto table_sub = table_subs.find(filter_id);
+    if (table_sub != table_subs.end()) {
+        each_sub_in_vec(table_sub->second, &spot, f);
+    }
 }
 
 void feed_t::each_point_sub(
@@ -779,7 +1276,8 @@ feed_t::feed_t(client_t *_client,
       uuid(_uuid),
       manager(_manager),
       mailbox(manager, std::bind(&feed_t::mailbox_cb, this, ph::_1)),
-      table_subs(get_num_threads()),
+      next_filter_id(0),
+      unfiltered_key(filter_key(std::vector<transform_variant_t>())),
       /* We only use comparison in the point_subs map for equality purposes, not
          ordering -- and this isn't in a secondary index function.  Thus
          reql_version_t::LATEST is appropriate. */
@@ -797,6 +1295,8 @@ feed_t::feed_t(client_t *_client,
     for (auto it = resp->addrs.begin(); it != resp->addrs.end(); ++it) {
         stop_addrs.push_back(std::move(*it));
     }
+    remove_filter_addrs.assign(resp->remove_filter_addrs.begin(),
+                               resp->remove_filter_addrs.end());
 
     std::set<peer_id_t> peers;
     for (auto it = stop_addrs.begin(); it != stop_addrs.end(); ++it) {
@@ -882,9 +1382,18 @@ client_t::client_t(
 client_t::~client_t() { }
 
 counted_t<datum_stream_t>
-client_t::new_feed(env_t *env, const namespace_id_t &uuid,
+client_t::new_feed(env_t *, const namespace_id_t &uuid,
         const protob_t<const Backtrace> &bt, const std::string &table_name,
-        const std::string &pkey, keyspec_t &&keyspec) {
+        const std::string &pkey, keyspec_t &&keyspec, bool squash) {
+    return make_counted<stream_t>(this, uuid, table_name, pkey, std::move(keyspec),
+                                  squash, bt);
+}
+
+scoped_ptr_t<subscription_t>
+client_t::subscribe(env_t *env, const namespace_id_t &uuid,
+        const std::string &table_name, const std::string &pkey,
+        const keyspec_t &keyspec, bool squash,
+        std::vector<transform_variant_t> &&transforms) {
     try {
         scoped_ptr_t<subscription_t> sub;
         boost::variant<scoped_ptr_t<table_sub_t>, scoped_ptr_t<point_sub_t> > presub;
@@ -917,20 +1426,30 @@ client_t::new_feed(env_t *env, const namespace_id_t &uuid,
             addr = feed->get_addr();
 
             struct keyspec_visitor_t : public boost::static_visitor<subscription_t *> {
-                explicit keyspec_visitor_t(feed_t *_feed) : feed(_feed) { }
+                keyspec_visitor_t(feed_t *_feed, rdb_context_t *_ctx, bool _squash,
+                                  std::vector<transform_variant_t> *_transforms)
+                    : feed(_feed), ctx(_ctx), squash(_squash),
+                      transforms(_transforms) { }
                 subscription_t * operator()(const keyspec_t::all_t &) const {
-                    return new table_sub_t(feed);
+                    return new table_sub_t(feed, ctx, std::move(*transforms), squash);
                 }
                 subscription_t * operator()(const keyspec_t::point_t &point) const {
-                    return new point_sub_t(feed, point.key);
+                    r_sanity_check(transforms->empty());
+                    return new point_sub_t(feed, ctx, point.key);
                 }
                 feed_t *feed;
+                rdb_context_t *ctx;
+                bool squash;
+                std::vector<transform_variant_t> *transforms;
             };
-            sub.init(boost::apply_visitor(keyspec_visitor_t(feed), keyspec.spec));
+            sub.init(boost::apply_visitor(
+                         keyspec_visitor_t(feed, env->get_rdb_ctx(), squash,
+                                           &transforms),
+                         keyspec.spec));
         }
         namespace_interface_access_t access = namespace_source(uuid, env->interruptor);
         sub->start(env, access.get(), &addr);
-        return make_counted<stream_t>(std::move(sub), bt);
+        return sub;
     } catch (const cannot_perform_query_exc_t &e) {
         rfail_datum(base_exc_t::GENERIC,
                     "cannot subscribe to table `%s`: %s",
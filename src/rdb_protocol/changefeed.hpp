@@ -6,6 +6,7 @@
 #include <exception>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
@@ -18,6 +19,8 @@
 #include "protocol_api.hpp"
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/rdb_protocol_json.hpp"
+#include "rdb_protocol/shards.hpp"
 #include "region/region.hpp"
 #include "repli_timestamp.hpp"
 #include "rpc/connectivity/peer_id.hpp"
@@ -27,6 +30,8 @@
 class auto_drainer_t;
 class namespace_interface_access_t;
 class mailbox_manager_t;
+class perfmon_counter_t;
+class rdb_context_t;
 struct rdb_modification_report_t;
 
 namespace ql {
@@ -39,13 +44,36 @@ class table_t;
 
 namespace changefeed {
 
+// The transformations (`filter`, `map`, `pluck`, ...) a table subscription applies
+// to its `{old_val: ..., new_val: ...}` change objects.  The `server_t`s apply
+// them on the subscription's behalf, so that only the changes it wants are sent
+// over the cluster.  An empty chain of transformations passes every change
+// through.  `id` identifies the filter within its `feed_t`; subscriptions to the
+// same feed with identical transformations share a filter.
+struct filter_t {
+    filter_t() : id(0) { }
+    filter_t(uint64_t _id, std::vector<transform_variant_t> &&_transforms)
+        : id(_id), transforms(std::move(_transforms)) { }
+    uint64_t id;
+    std::vector<transform_variant_t> transforms;
+};
+RDB_DECLARE_SERIALIZABLE(filter_t);
+
+// Filters are shared by comparing the serialized transformations.  The functions
+// in them are serialized without the variable numbers and backtraces the driver
+// picked (see `wire_func_t::serialize_normalized`), so that two queries asking for
+// the same thing share a filter.
+std::string filter_key(const std::vector<transform_variant_t> &transforms);
+
 struct msg_t {
+    // A change to a row, as seen through each of the client's filters.
     struct change_t {
         change_t();
-        explicit change_t(datum_t _old_val,
-                          datum_t _new_val);
         ~change_t();
-        datum_t old_val, new_val;
+        // The values the change turned into, for each filter that produced any.
+        std::map<uint64_t, std::vector<datum_t> > vals;
+        // The error message for each filter that failed on the change.
+        std::map<uint64_t, std::string> errors;
         RDB_DECLARE_ME_SERIALIZABLE;
     };
     struct stop_t {
@@ -75,7 +103,19 @@ RDB_DECLARE_SERIALIZABLE(msg_t::stop_t);
 RDB_DECLARE_SERIALIZABLE(msg_t);
 
 class feed_t;
-struct stamped_msg_t;
+class subscription_t;
+
+struct stamped_msg_t {
+    stamped_msg_t() { }
+    stamped_msg_t(uuid_u _server_uuid, uint64_t _stamp, msg_t _submsg)
+        : server_uuid(std::move(_server_uuid)),
+          stamp(_stamp),
+          submsg(std::move(_submsg)) { }
+    uuid_u server_uuid;
+    uint64_t stamp;
+    msg_t submsg;
+};
+RDB_DECLARE_SERIALIZABLE(stamped_msg_t);
 
 typedef mailbox_addr_t<void(stamped_msg_t)> client_addr_t;
 
@@ -106,6 +146,64 @@ RDB_DECLARE_SERIALIZABLE(keyspec_t::all_t);
 RDB_DECLARE_SERIALIZABLE(keyspec_t::point_t);
 RDB_DECLARE_SERIALIZABLE(keyspec_t);
 
+// The `{old_val: ..., new_val: ...}` changes a table subscription has buffered
+// since the client last read from it.  If there are more of them than the array
+// size limit, or they take up more than `max_size` bytes serialized, they're all
+// dropped (and counted in `dropped`).  With `squash` set, a change to a row that
+// already has a buffered change is merged into that change (and counted in
+// `squashed`), keeping the first `old_val` and the last `new_val`; if the two are
+// equal, the row's change is dropped entirely.
+class change_buffer_t {
+public:
+    enum class overflow_t { NONE, ARRAY_SIZE, MEMORY };
+
+    change_buffer_t(std::string _pkey, bool _squash, size_t _max_size,
+                    perfmon_counter_t *_dropped, perfmon_counter_t *_squashed);
+
+    // Returns which limit `change` pushed the buffer over, if any, and sets
+    // `*num_dropped_out` to the number of changes that were dropped.
+    overflow_t push(datum_t &&change, size_t array_size_limit,
+                    size_t *num_dropped_out);
+    bool empty() const { return num_els == 0; }
+    size_t size() const { return num_els; }
+    datum_t pop();
+
+    // The number of slots the buffer holds, including the ones left behind by
+    // changes that cancelled out.  Used in unit tests.
+    size_t num_slots() const { return els.size(); }
+
+private:
+    datum_t row_key(const datum_t &change) const;
+    bool squash_el(const datum_t &change);
+    void compact();
+    void clear();
+
+    const std::string pkey;
+    const bool squash;
+    const size_t max_size;
+    perfmon_counter_t *const dropped;
+    perfmon_counter_t *const squashed;
+    // When squashing, changes that cancelled out are left behind as empty datums,
+    // until there are more of them than changes and `compact` drops them.
+    std::deque<datum_t> els;
+    // The number of (non-empty) changes in `els`, and their serialized size.
+    size_t num_els;
+    size_t els_size;
+    // The number of empty datums in `els`.
+    size_t num_cancelled;
+    // When squashing, maps primary keys to their change in `els`.
+    std::unordered_map<datum_t, datum_t *, optional_datum_hash_t, optional_datum_equal_t>
+        squashable;
+
+    DISABLE_COPYING(change_buffer_t);
+};
+
+// The text of the error document a subscription sends in place of the `skipped`
+// changes it dropped.  Each limit has its own text, so clients can tell a feed
+// that's too busy for the array size limit from one that's using too much memory.
+std::string skipped_changes_message(change_buffer_t::overflow_t overflow,
+                                    size_t skipped);
+
 // The `client_t` exists on the machine handling the changefeed query, in the
 // `rdb_context_t`.  When a query subscribes to the changes on a table, it
 // should call `new_feed`.  The `client_t` will give it back a stream of rows.
@@ -129,7 +227,13 @@ public:
     // Throws QL exceptions.
     counted_t<datum_stream_t> new_feed(env_t *env, const namespace_id_t &table,
         const protob_t<const Backtrace> &bt, const std::string &table_name,
-        const std::string &pkey, keyspec_t &&keyspec);
+        const std::string &pkey, keyspec_t &&keyspec, bool squash);
+    // Called by the stream `new_feed` returns once it knows which of its
+    // transformations can be pushed down to the servers.  Throws QL exceptions.
+    scoped_ptr_t<subscription_t> subscribe(env_t *env, const namespace_id_t &table,
+        const std::string &table_name, const std::string &pkey,
+        const keyspec_t &keyspec, bool squash,
+        std::vector<transform_variant_t> &&transforms);
     void maybe_remove_feed(const namespace_id_t &uuid);
     scoped_ptr_t<feed_t> detach_feed(const namespace_id_t &uuid);
 private:
@@ -157,6 +261,7 @@ private:
 };
 
 typedef mailbox_addr_t<void(client_addr_t)> server_addr_t;
+typedef mailbox_addr_t<void(client_addr_t, uint64_t)> remove_filter_addr_t;
 
 // There is one `server_t` per `store_t`, and it is used to send changes that
 // occur on that `store_t` to any subscribed `feed_t`s contained in a
@@ -164,17 +269,27 @@ typedef mailbox_addr_t<void(client_addr_t)> server_addr_t;
 class server_t {
 public:
     typedef server_addr_t addr_t;
-    explicit server_t(mailbox_manager_t *_manager);
+    server_t(mailbox_manager_t *_manager, rdb_context_t *_ctx);
     ~server_t();
     void add_client(const client_t::addr_t &addr, region_t region);
-    // `key` should be non-NULL if there is a key associated with the message.
-    void send_all(msg_t msg, const store_key_t &key);
+    // Starts sending the client the changes that pass `filter`.  Adding the same
+    // filter twice is a no-op.
+    void add_filter(const client_t::addr_t &addr, const filter_t &filter);
+    // Runs the change through the filters of the clients subscribed to `key`, and
+    // sends each of them what came out.  (`old_val` or `new_val` is empty for
+    // inserts and deletes respectively.)
+    void send_all(const datum_t &old_val, const datum_t &new_val,
+                  const store_key_t &key);
     void stop_all();
     addr_t get_stop_addr();
+    remove_filter_addr_t get_remove_filter_addr();
     uint64_t get_stamp(const client_t::addr_t &addr);
     uuid_u get_uuid();
+    // The number of distinct filters being evaluated.  Used in unit tests.
+    size_t num_evaluators() const { return evaluators.size(); }
 private:
     void stop_mailbox_cb(client_t::addr_t addr);
+    void remove_filter_mailbox_cb(client_t::addr_t addr, uint64_t filter_id);
     void add_client_cb(signal_t *stopped, client_t::addr_t addr);
 
     // The UUID of the server, used so that `feed_t`s can enforce on ordering on
@@ -182,23 +297,43 @@ private:
     // from before their own creation timestamp on a per-server basis).
     const uuid_u uuid;
     mailbox_manager_t *const manager;
+    // Used to build the environment the filters are evaluated in.
+    rdb_context_t *const ctx;
+
+    // The compiled transformations of a filter.  Filters with identical
+    // transformations share an `evaluator_t`, even across clients, so that each
+    // change is only run through them once.
+    struct evaluator_t {
+        evaluator_t() : refcount(0) { }
+        std::vector<scoped_ptr_t<op_t> > ops;
+        size_t refcount;
+    };
+    // Keyed by `filter_key`.
+    typedef std::map<std::string, evaluator_t> evaluators_t;
+    evaluators_t evaluators;
 
     struct client_info_t {
         scoped_ptr_t<cond_t> cond;
         uint64_t stamp;
         std::vector<region_t> regions;
+        // Maps the ids of the client's filters to their evaluators.
+        std::map<uint64_t, evaluators_t::iterator> filters;
     };
     std::map<client_t::addr_t, client_info_t> clients;
 
+    void release_evaluator(evaluators_t::iterator evaluator);
+
     void send_one_with_lock(const auto_drainer_t::lock_t &lock,
                             std::pair<const client_t::addr_t, client_info_t> *client,
                             msg_t msg);
 
-    // Controls access to `clients`.  A `server_t` needs to read `clients` when:
+    // Controls access to `clients` and `evaluators`.  A `server_t` needs to read
+    // `clients` when:
     // * `send_all` is called
     // * `get_stamp` is called
     // And needs to write to clients when:
-    // * `add_client` is called
+    // * `add_client` or `add_filter` is called
+    // * A message is received at `remove_filter_mailbox`
     // * `clear` is called
     // * A message is received at `stop_mailbox` unsubscribing a client
     // A lock is needed because e.g. `send_all` calls `send`, which can block,
@@ -211,6 +346,10 @@ private:
     // to unsubscribe.  The callback of this mailbox acquires the drainer, so it
     // has to be destroyed first.
     mailbox_t<void(client_t::addr_t)> stop_mailbox;
+    // Clients send a message to this mailbox when none of their subscriptions
+    // use one of their filters any more.  Like `stop_mailbox`, it acquires the
+    // drainer.
+    mailbox_t<void(client_t::addr_t, uint64_t)> remove_filter_mailbox;
 };
 
 } // namespace changefeed
@@ -10,7 +10,19 @@ rdb_context_t::rdb_context_t()
       ql_stats_membership(
           &get_global_perfmon_collection(), &ql_stats_collection, "query_language"),
       ql_ops_running_membership(&ql_stats_collection, &ql_ops_running, "ops_running"),
-      reql_http_proxy()
+      changefeed_changes_dropped_membership(
+          &ql_stats_collection, &changefeed_changes_dropped,
+          "changefeed_changes_dropped"),
+      changefeed_changes_squashed_membership(
+          &ql_stats_collection, &changefeed_changes_squashed,
+          "changefeed_changes_squashed"),
+      query_cache_hits_membership(
+          &ql_stats_collection, &query_cache_hits, "query_cache_hits"),
+      query_cache_misses_membership(
+          &ql_stats_collection, &query_cache_misses, "query_cache_misses"),
+      reql_http_proxy(),
+      io_backender(NULL),
+      base_path("")
 { }
 
 rdb_context_t::rdb_context_t(
@@ -22,7 +34,19 @@ rdb_context_t::rdb_context_t(
       ql_stats_membership(
           &get_global_perfmon_collection(), &ql_stats_collection, "query_language"),
       ql_ops_running_membership(&ql_stats_collection, &ql_ops_running, "ops_running"),
-      reql_http_proxy()
+      changefeed_changes_dropped_membership(
+          &ql_stats_collection, &changefeed_changes_dropped,
+          "changefeed_changes_dropped"),
+      changefeed_changes_squashed_membership(
+          &ql_stats_collection, &changefeed_changes_squashed,
+          "changefeed_changes_squashed"),
+      query_cache_hits_membership(
+          &ql_stats_collection, &query_cache_hits, "query_cache_hits"),
+      query_cache_misses_membership(
+          &ql_stats_collection, &query_cache_misses, "query_cache_misses"),
+      reql_http_proxy(),
+      io_backender(NULL),
+      base_path("")
 { }
 
 rdb_context_t::rdb_context_t(
@@ -32,14 +56,28 @@ rdb_context_t::rdb_context_t(
         boost::shared_ptr< semilattice_readwrite_view_t<auth_semilattice_metadata_t> >
             _auth_metadata,
         perfmon_collection_t *_global_stats,
-        const std::string &_reql_http_proxy)
+        const std::string &_reql_http_proxy,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       auth_metadata(_auth_metadata),
       manager(_mailbox_manager),
       ql_stats_membership(_global_stats, &ql_stats_collection, "query_language"),
       ql_ops_running_membership(&ql_stats_collection, &ql_ops_running, "ops_running"),
-      reql_http_proxy(_reql_http_proxy)
+      changefeed_changes_dropped_membership(
+          &ql_stats_collection, &changefeed_changes_dropped,
+          "changefeed_changes_dropped"),
+      changefeed_changes_squashed_membership(
+          &ql_stats_collection, &changefeed_changes_squashed,
+          "changefeed_changes_squashed"),
+      query_cache_hits_membership(
+          &ql_stats_collection, &query_cache_hits, "query_cache_hits"),
+      query_cache_misses_membership(
+          &ql_stats_collection, &query_cache_misses, "query_cache_misses"),
+      reql_http_proxy(_reql_http_proxy),
+      io_backender(_io_backender),
+      base_path(_base_path)
 { }
 
 rdb_context_t::~rdb_context_t() { }
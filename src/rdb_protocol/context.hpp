@@ -28,6 +28,7 @@ class auth_semilattice_metadata_t;
 class datum_range_t;
 class ellipsoid_spec_t;
 class extproc_pool_t;
+class io_backender_t;
 class name_string_t;
 class namespace_interface_t;
 template <class> class semilattice_readwrite_view_t;
@@ -56,6 +57,9 @@ public:
 
     virtual ql::datum_t read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated) = 0;
+    /* Returns the rows in the same order as `pvals`, with null for missing rows. */
+    virtual std::vector<ql::datum_t> read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, bool use_outdated) = 0;
     virtual counted_t<ql::datum_stream_t> read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -71,6 +75,7 @@ public:
         const std::string &table_name) = 0;
     virtual counted_t<ql::datum_stream_t> read_all_changes(
         ql::env_t *env,
+        bool squash,
         const ql::protob_t<const Backtrace> &bt,
         const std::string &table_name) = 0;
     virtual counted_t<ql::datum_stream_t> read_intersecting(
@@ -104,9 +109,11 @@ public:
     virtual bool write_sync_depending_on_durability(ql::env_t *env,
         durability_requirement_t durability) = 0;
 
+    // `cover` is only set for compact indexes; see `sindex_disk_info_t::cover`.
     virtual bool sindex_create(ql::env_t *env, const std::string &id,
         counted_t<const ql::func_t> index_func, sindex_multi_bool_t multi,
-        sindex_geo_bool_t geo) = 0;
+        sindex_geo_bool_t geo,
+        const boost::optional<std::vector<std::string> > &cover) = 0;
     virtual bool sindex_drop(ql::env_t *env, const std::string &id) = 0;
     virtual sindex_rename_result_t sindex_rename(ql::env_t *env,
         const std::string &old_name, const std::string &new_name, bool overwrite) = 0;
@@ -167,7 +174,8 @@ public:
     rdb_context_t(extproc_pool_t *_extproc_pool,
                   reql_cluster_interface_t *_cluster_interface);
 
-    // The "real" constructor used outside of unit tests.
+    // The "real" constructor used outside of unit tests.  `_io_backender` is NULL
+    // on proxies, which have no data directory to spill temporary data to.
     rdb_context_t(extproc_pool_t *_extproc_pool,
                   mailbox_manager_t *_mailbox_manager,
                   reql_cluster_interface_t *_cluster_interface,
@@ -175,7 +183,9 @@ public:
                     semilattice_readwrite_view_t<
                         auth_semilattice_metadata_t> > _auth_metadata,
                   perfmon_collection_t *_global_stats,
-                  const std::string &_reql_http_proxy);
+                  const std::string &_reql_http_proxy,
+                  io_backender_t *_io_backender,
+                  const base_path_t &_base_path);
 
     ~rdb_context_t();
 
@@ -191,9 +201,27 @@ public:
     perfmon_membership_t ql_stats_membership;
     perfmon_counter_t ql_ops_running;
     perfmon_membership_t ql_ops_running_membership;
+    // Changes that changefeed subscriptions dropped because their buffer was full,
+    // and changes that were squashed into a later change to the same row.
+    perfmon_counter_t changefeed_changes_dropped;
+    perfmon_membership_t changefeed_changes_dropped_membership;
+    perfmon_counter_t changefeed_changes_squashed;
+    perfmon_membership_t changefeed_changes_squashed_membership;
+    // START queries whose compiled form was (or wasn't) found in their connection's
+    // `ql::query_cache_t`.
+    perfmon_counter_t query_cache_hits;
+    perfmon_membership_t query_cache_hits_membership;
+    perfmon_counter_t query_cache_misses;
+    perfmon_membership_t query_cache_misses_membership;
 
     const std::string reql_http_proxy;
 
+    // Used by queries that have to spill data to disk (e.g. unindexed `order_by`s
+    // of more than the array limit).  `io_backender` may be NULL, in which case
+    // they fail instead.
+    io_backender_t *const io_backender;
+    const base_path_t base_path;
+
 private:
     DISABLE_COPYING(rdb_context_t);
 };
@@ -5,6 +5,7 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <algorithm>
 #include <iterator>
@@ -14,6 +15,7 @@
 
 #include "containers/archive/stl_types.hpp"
 #include "containers/scoped.hpp"
+#include "rdb_protocol/datum_json.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/pseudo_binary.hpp"
@@ -65,34 +67,34 @@ datum_t::data_wrapper_t &datum_t::data_wrapper_t::operator=(
 }
 
 datum_t::data_wrapper_t::data_wrapper_t() :
-    type(UNINITIALIZED) { }
+    internal_type(internal_type_t::UNINITIALIZED) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(datum_t::construct_null_t) :
-    type(R_NULL) { }
+    internal_type(internal_type_t::R_NULL) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(datum_t::construct_boolean_t, bool _bool) :
-    type(R_BOOL), r_bool(_bool) { }
+    internal_type(internal_type_t::R_BOOL), r_bool(_bool) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(datum_t::construct_binary_t,
                                         datum_string_t _data) :
-    type(R_BINARY), r_str(std::move(_data)) { }
+    internal_type(internal_type_t::R_BINARY), r_str(std::move(_data)) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(double num) :
-    type(R_NUM), r_num(num) { }
+    internal_type(internal_type_t::R_NUM), r_num(num) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(datum_string_t str) :
-    type(R_STR), r_str(std::move(str)) { }
+    internal_type(internal_type_t::R_STR), r_str(std::move(str)) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(const char *cstr) :
-    type(R_STR), r_str(cstr) { }
+    internal_type(internal_type_t::R_STR), r_str(cstr) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(std::vector<datum_t> &&array) :
-    type(R_ARRAY),
+    internal_type(internal_type_t::R_ARRAY),
     r_array(new countable_wrapper_t<std::vector<datum_t> >(std::move(array))) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(
         std::vector<std::pair<datum_string_t, datum_t> > &&object) :
-    type(R_OBJECT),
+    internal_type(internal_type_t::R_OBJECT),
     r_object(new countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > >(
         std::move(object))) {
 
@@ -105,79 +107,112 @@ datum_t::data_wrapper_t::data_wrapper_t(
 #endif
 }
 
+datum_t::data_wrapper_t::data_wrapper_t(type_t type,
+                                        shared_buf_ref_t<char> &&_buf_ref) :
+    buf_ref(std::move(_buf_ref)) {
+    switch (type) {
+    case R_ARRAY: {
+        internal_type = internal_type_t::BUF_R_ARRAY;
+    } break;
+    case R_OBJECT: {
+        internal_type = internal_type_t::BUF_R_OBJECT;
+    } break;
+    case UNINITIALIZED: // fallthru
+    case R_BINARY: // fallthru
+    case R_BOOL: // fallthru
+    case R_NULL: // fallthru
+    case R_NUM: // fallthru
+    case R_STR: // fallthru
+    default:
+        unreachable();
+    }
+}
+
 datum_t::data_wrapper_t::~data_wrapper_t() {
     destruct();
 }
 
 void datum_t::data_wrapper_t::destruct() {
-    switch (type) {
-    case UNINITIALIZED: // fallthru
-    case R_NULL: // fallthru
-    case R_BOOL: // fallthru
-    case R_NUM: break;
-    case R_BINARY: // fallthru
-    case R_STR: {
+    switch (internal_type) {
+    case internal_type_t::UNINITIALIZED: // fallthru
+    case internal_type_t::R_NULL: // fallthru
+    case internal_type_t::R_BOOL: // fallthru
+    case internal_type_t::R_NUM: break;
+    case internal_type_t::R_BINARY: // fallthru
+    case internal_type_t::R_STR: {
         r_str.~datum_string_t();
     } break;
-    case R_ARRAY: {
+    case internal_type_t::R_ARRAY: {
         r_array.~counted_t<countable_wrapper_t<std::vector<datum_t> > >();
     } break;
-    case R_OBJECT: {
+    case internal_type_t::R_OBJECT: {
         r_object.~counted_t<countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > > >();
     } break;
+    case internal_type_t::BUF_R_ARRAY: // fallthru
+    case internal_type_t::BUF_R_OBJECT: {
+        buf_ref.~shared_buf_ref_t<char>();
+    } break;
     default: unreachable();
     }
 }
 
 void datum_t::data_wrapper_t::assign_copy(const datum_t::data_wrapper_t &copyee) {
-    type = copyee.type;
-    switch (type) {
-    case UNINITIALIZED: // fallthru
-    case R_NULL: break;
-    case R_BOOL: {
+    internal_type = copyee.internal_type;
+    switch (internal_type) {
+    case internal_type_t::UNINITIALIZED: // fallthru
+    case internal_type_t::R_NULL: break;
+    case internal_type_t::R_BOOL: {
         r_bool = copyee.r_bool;
     } break;
-    case R_NUM: {
+    case internal_type_t::R_NUM: {
         r_num = copyee.r_num;
     } break;
-    case R_BINARY: // fallthru
-    case R_STR: {
+    case internal_type_t::R_BINARY: // fallthru
+    case internal_type_t::R_STR: {
         new(&r_str) datum_string_t(copyee.r_str);
     } break;
-    case R_ARRAY: {
+    case internal_type_t::R_ARRAY: {
         new(&r_array) counted_t<countable_wrapper_t<std::vector<datum_t> > >(copyee.r_array);
     } break;
-    case R_OBJECT: {
+    case internal_type_t::R_OBJECT: {
         new(&r_object) counted_t<countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > > >(
             copyee.r_object);
     } break;
+    case internal_type_t::BUF_R_ARRAY: // fallthru
+    case internal_type_t::BUF_R_OBJECT: {
+        new(&buf_ref) shared_buf_ref_t<char>(copyee.buf_ref);
+    } break;
     default: unreachable();
     }
 }
 
 void datum_t::data_wrapper_t::assign_move(datum_t::data_wrapper_t &&movee) noexcept {
-    type = movee.type;
-    switch (type) {
-    case UNINITIALIZED: // fallthru
-    case R_NULL: break;
-    case R_BOOL: {
+    internal_type = movee.internal_type;
+    switch (internal_type) {
+    case internal_type_t::UNINITIALIZED: // fallthru
+    case internal_type_t::R_NULL: break;
+    case internal_type_t::R_BOOL: {
         r_bool = movee.r_bool;
     } break;
-    case R_NUM: {
+    case internal_type_t::R_NUM: {
         r_num = movee.r_num;
     } break;
-    case R_BINARY: // fallthru
-    case R_STR: {
+    case internal_type_t::R_BINARY: // fallthru
+    case internal_type_t::R_STR: {
         new(&r_str) datum_string_t(std::move(movee.r_str));
     } break;
-    case R_ARRAY: {
+    case internal_type_t::R_ARRAY: {
         new(&r_array) counted_t<countable_wrapper_t<std::vector<datum_t> > >(
             std::move(movee.r_array));
     } break;
-    case R_OBJECT: {
+    case internal_type_t::R_OBJECT: {
         new(&r_object) counted_t<countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > > >(
             std::move(movee.r_object));
     } break;
+    case internal_type_t::BUF_R_ARRAY: // fallthru
+    case internal_type_t::BUF_R_OBJECT: {
+        new(&buf_ref) shared_buf_ref_t<char>(std::move(movee.buf_ref));
+    } break;
     default: unreachable();
     }
 }
@@ -229,6 +264,9 @@ datum_t::datum_t(std::map<datum_string_t, datum_t> &&_object,
                  no_sanitize_ptype_t)
     : data(to_sorted_vec(std::move(_object))) { }
 
+datum_t::datum_t(type_t type, shared_buf_ref_t<char> &&buf_ref)
+    : data(type, std::move(buf_ref)) { }
+
 std::vector<std::pair<datum_string_t, datum_t> > datum_t::to_sorted_vec(
         std::map<datum_string_t, datum_t> &&map) {
     std::vector<std::pair<datum_string_t, datum_t> > sorted_vec;
@@ -241,14 +279,25 @@ std::vector<std::pair<datum_string_t, datum_t> > datum_t::to_sorted_vec(
 
 const std::vector<std::pair<datum_string_t, datum_t> > &datum_t::get_obj_vec() const {
     check_type(R_OBJECT);
+    r_sanity_check(data.internal_type == internal_type_t::R_OBJECT);
     return *data.r_object;
 }
 
 const std::vector<datum_t> &datum_t::get_arr_vec() const {
     check_type(R_ARRAY);
+    r_sanity_check(data.internal_type == internal_type_t::R_ARRAY);
     return *data.r_array;
 }
 
+const shared_buf_ref_t<char> *datum_t::get_buf_ref() const {
+    if (data.internal_type == internal_type_t::BUF_R_ARRAY
+        || data.internal_type == internal_type_t::BUF_R_OBJECT) {
+        return &data.buf_ref;
+    } else {
+        return NULL;
+    }
+}
+
 datum_t to_datum_for_client_serialization(grouped_data_t &&gd,
                                           reql_version_t reql_version,
                                           const configured_limits_t &limits) {
@@ -282,7 +331,7 @@ datum_t::~datum_t() {
 }
 
 bool datum_t::has() const {
-    return data.type != UNINITIALIZED;
+    return data.internal_type != internal_type_t::UNINITIALIZED;
 }
 
 void datum_t::reset() {
@@ -369,7 +418,21 @@ void datum_t::check_str_validity(const datum_string_t &str) {
     ::ql::check_str_validity(str.data(), str.size());
 }
 
-datum_t::type_t datum_t::get_type() const { return data.type; }
+datum_t::type_t datum_t::get_type() const {
+    switch (data.internal_type) {
+    case internal_type_t::UNINITIALIZED: return UNINITIALIZED;
+    case internal_type_t::R_ARRAY: return R_ARRAY;
+    case internal_type_t::R_BINARY: return R_BINARY;
+    case internal_type_t::R_BOOL: return R_BOOL;
+    case internal_type_t::R_NULL: return R_NULL;
+    case internal_type_t::R_NUM: return R_NUM;
+    case internal_type_t::R_OBJECT: return R_OBJECT;
+    case internal_type_t::R_STR: return R_STR;
+    case internal_type_t::BUF_R_ARRAY: return R_ARRAY;
+    case internal_type_t::BUF_R_OBJECT: return R_OBJECT;
+    default: unreachable();
+    }
+}
 
 bool datum_t::is_ptype() const {
     return get_type() == R_BINARY ||
@@ -1021,7 +1084,11 @@ const datum_string_t &datum_t::as_str() const {
 
 size_t datum_t::arr_size() const {
     check_type(R_ARRAY);
-    return data.r_array->size();
+    if (data.internal_type == internal_type_t::BUF_R_ARRAY) {
+        return datum_get_array_size(data.buf_ref);
+    } else {
+        return data.r_array->size();
+    }
 }
 
 datum_t datum_t::get(size_t index, throw_bool_t throw_bool) const {
@@ -1037,12 +1104,20 @@ datum_t datum_t::get(size_t index, throw_bool_t throw_bool) const {
 }
 
 datum_t datum_t::unchecked_get(size_t index) const {
-    return (*data.r_array)[index];
+    if (data.internal_type == internal_type_t::BUF_R_ARRAY) {
+        return datum_get_array_element(data.buf_ref, index);
+    } else {
+        return (*data.r_array)[index];
+    }
 }
 
 size_t datum_t::obj_size() const {
     check_type(R_OBJECT);
-    return data.r_object->size();
+    if (data.internal_type == internal_type_t::BUF_R_OBJECT) {
+        return datum_get_obj_size(data.buf_ref);
+    } else {
+        return data.r_object->size();
+    }
 }
 
 std::pair<datum_string_t, datum_t> datum_t::get_pair(size_t index) const {
@@ -1052,21 +1127,33 @@ std::pair<datum_string_t, datum_t> datum_t::get_pair(size_t index) const {
 }
 
 std::pair<datum_string_t, datum_t> datum_t::unchecked_get_pair(size_t index) const {
-    return (*data.r_object)[index];
+    if (data.internal_type == internal_type_t::BUF_R_OBJECT) {
+        return datum_get_obj_pair(data.buf_ref, index);
+    } else {
+        return (*data.r_object)[index];
+    }
+}
+
+datum_string_t datum_t::unchecked_get_key(size_t index) const {
+    if (data.internal_type == internal_type_t::BUF_R_OBJECT) {
+        return datum_get_obj_key(data.buf_ref, index);
+    } else {
+        return (*data.r_object)[index].first;
+    }
 }
 
 datum_t datum_t::get_field(const datum_string_t &key, throw_bool_t throw_bool) const {
-    // Use binary search on top of unchecked_get_pair()
+    // Use binary search on top of unchecked_get_key(), so that a buffer-backed
+    // object only has to load the value we're looking for.
     size_t range_beg = 0;
     // The obj_size() also makes sure that this has the right type (R_OBJECT)
     size_t range_end = obj_size();
     while (range_beg < range_end) {
         const size_t center = range_beg + ((range_end - range_beg) / 2);
-        auto center_pair = unchecked_get_pair(center);
-        const int cmp = key.compare(center_pair.first);
+        const int cmp = key.compare(unchecked_get_key(center));
         if (cmp == 0) {
             // Found it
-            return center_pair.second;
+            return unchecked_get_pair(center).second;
         } else if (cmp < 0) {
             range_end = center;
         } else {
@@ -1103,8 +1190,9 @@ cJSON *datum_t::as_json_raw() const {
     } break;
     case R_OBJECT: {
         scoped_cJSON_t obj(cJSON_CreateObject());
-        for (auto it = data.r_object->begin(); it != data.r_object->end(); ++it) {
-            obj.AddItemToObject(it->first.to_std().c_str(), it->second->as_json_raw());
+        for (size_t i = 0; i < obj_size(); ++i) {
+            auto pair = unchecked_get_pair(i);
+            obj.AddItemToObject(pair.first.to_std().c_str(), pair.second->as_json_raw());
         }
         return obj.release();
     } break;
@@ -1140,6 +1228,7 @@ datum_t::as_datum_stream(const protob_t<const Backtrace> &backtrace) const {
 
 void datum_t::replace_field(const datum_string_t &key, datum_t val) {
     check_type(R_OBJECT);
+    r_sanity_check(data.internal_type == internal_type_t::R_OBJECT);
     r_sanity_check(val.has());
 
     auto key_cmp = [](const std::pair<datum_string_t, datum_t> &p1,
@@ -1351,6 +1440,64 @@ bool datum_t::compare_gt(reql_version_t reql_version, const datum_t &rhs) const
     return cmp(reql_version, rhs) > 0;
 }
 
+static uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+}
+
+static uint64_t hash_bytes(const char *data, size_t size) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<uint8_t>(data[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t hash_num(double d) {
+    // 0.0 and -0.0 compare equal.
+    if (d == 0.0) {
+        d = 0.0;
+    }
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+uint64_t datum_t::hash() const {
+    const uint64_t h = static_cast<uint64_t>(get_type());
+    switch (get_type()) {
+    case R_NULL: return h;
+    case R_BOOL: return hash_combine(h, as_bool());
+    case R_NUM: return hash_combine(h, hash_num(as_num()));
+    case R_STR: return hash_combine(h, hash_bytes(as_str().data(), as_str().size()));
+    case R_BINARY:
+        return hash_combine(h, hash_bytes(as_binary().data(), as_binary().size()));
+    case R_ARRAY: {
+        uint64_t res = h;
+        for (size_t i = 0; i < arr_size(); ++i) {
+            res = hash_combine(res, unchecked_get(i).hash());
+        }
+        return res;
+    } unreachable();
+    case R_OBJECT: {
+        if (is_ptype(pseudo::time_string)) {
+            // Times with different time zones compare equal.
+            return hash_combine(h, hash_num(pseudo::time_to_epoch_time(*this)));
+        }
+        uint64_t res = h;
+        for (size_t i = 0; i < obj_size(); ++i) {
+            auto pair = unchecked_get_pair(i);
+            res = hash_combine(res, hash_bytes(pair.first.data(), pair.first.size()));
+            res = hash_combine(res, pair.second.hash());
+        }
+        return res;
+    } unreachable();
+    case UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
 void datum_t::runtime_fail(base_exc_t::type_t exc_type,
                            const char *test, const char *file, int line,
                            std::string msg) const {
@@ -1372,8 +1519,10 @@ datum_t to_datum(const Datum *d, const configured_limits_t &limits) {
         return datum_t(datum_string_t(d->r_str()));
     } break;
     case Datum::R_JSON: {
-        scoped_cJSON_t cjson(cJSON_Parse(d->r_str().c_str()));
-        return to_datum(cjson.get(), limits);
+        datum_t parsed = parse_json(d->r_str(), limits);
+        rcheck_datum(parsed.has(), base_exc_t::GENERIC,
+                     "Failed to parse R_JSON datum as JSON.");
+        return parsed;
     } break;
     case Datum::R_ARRAY: {
         datum_array_builder_t out(limits);
@@ -1449,17 +1598,18 @@ void datum_t::write_to_protobuf(Datum *d, use_json_t use_json) const {
         } break;
         case R_ARRAY: {
             d->set_type(Datum::R_ARRAY);
-            for (size_t i = 0; i < data.r_array->size(); ++i) {
-                (*data.r_array)[i]->write_to_protobuf(d->add_r_array(), use_json);
+            for (size_t i = 0, sz = arr_size(); i < sz; ++i) {
+                unchecked_get(i).write_to_protobuf(d->add_r_array(), use_json);
             }
         } break;
         case R_OBJECT: {
             d->set_type(Datum::R_OBJECT);
-            // We use rbegin and rend so that things print the way we expect.
-            for (auto it = data.r_object->rbegin(); it != data.r_object->rend(); ++it) {
+            // We go backwards so that things print the way we expect.
+            for (size_t i = obj_size(); i > 0; --i) {
+                auto pair = unchecked_get_pair(i - 1);
                 Datum_AssocPair *ap = d->add_r_object();
-                ap->set_key(it->first.to_std());
-                it->second->write_to_protobuf(ap->mutable_val(), use_json);
+                ap->set_key(pair.first.to_std());
+                pair.second.write_to_protobuf(ap->mutable_val(), use_json);
             }
         } break;
         case UNINITIALIZED: // fallthru
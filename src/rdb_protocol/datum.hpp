@@ -138,6 +138,11 @@ public:
     // TODO(2014-08): Remove this constructor, it's a hack.
     datum_t(std::map<datum_string_t, datum_t> &&object, no_sanitize_ptype_t);
 
+    // Constructs an R_ARRAY or R_OBJECT that reads its elements on demand from
+    // `buf_ref`, which must point at the body of a serialized BUF_R_ARRAY or
+    // BUF_R_OBJECT (see serialize_datum.hpp).  Nothing is sanitized or checked.
+    datum_t(type_t type, shared_buf_ref_t<char> &&buf_ref);
+
     ~datum_t();
 
     // Interface to mimic counted_t, to ease transition from counted_t<const datum_t>
@@ -249,6 +254,9 @@ public:
     bool compare_lt(reql_version_t reql_version, const datum_t &rhs) const;
     bool compare_gt(reql_version_t reql_version, const datum_t &rhs) const;
 
+    // Data that compare equal (with any reql_version) have the same hash.
+    uint64_t hash() const;
+
     void runtime_fail(base_exc_t::type_t exc_type,
                       const char *test, const char *file, int line,
                       std::string msg) const NORETURN;
@@ -280,6 +288,9 @@ private:
     friend serialization_result_t datum_serialize(write_message_t *, const datum_t &);
     const std::vector<std::pair<datum_string_t, datum_t> > &get_obj_vec() const;
     const std::vector<datum_t> &get_arr_vec() const;
+    // Returns a pointer to the serialized body if this is a buffer-backed array or
+    // object, NULL otherwise.
+    const shared_buf_ref_t<char> *get_buf_ref() const;
 
     static std::vector<std::pair<datum_string_t, datum_t> > to_sorted_vec(
             std::map<datum_string_t, datum_t> &&map);
@@ -288,6 +299,8 @@ private:
     // For internal use to improve performance.
     std::pair<datum_string_t, datum_t> unchecked_get_pair(size_t index) const;
     datum_t unchecked_get(size_t) const;
+    // Like unchecked_get_pair(index).first, but doesn't load the value.
+    datum_string_t unchecked_get_key(size_t index) const;
 
     friend void pseudo::time_to_str_key(const datum_t &d, std::string *str_out);
     void pt_to_str_key(std::string *str_out) const;
@@ -307,6 +320,22 @@ private:
     // Might return null, if this is a literal without a value.
     datum_t drop_literals(bool *encountered_literal_out) const;
 
+    // Arrays and objects come in two representations: R_ARRAY and R_OBJECT hold
+    // vectors of datums, BUF_R_ARRAY and BUF_R_OBJECT point into a serialized
+    // buffer.  get_type() reports both as R_ARRAY or R_OBJECT.
+    enum class internal_type_t {
+        UNINITIALIZED,
+        R_ARRAY,
+        R_BINARY,
+        R_BOOL,
+        R_NULL,
+        R_NUM,
+        R_OBJECT,
+        R_STR,
+        BUF_R_ARRAY,
+        BUF_R_OBJECT
+    };
+
     // The data_wrapper makes sure we perform proper cleanup when exceptions
     // happen during construction
     class data_wrapper_t {
@@ -326,10 +355,11 @@ private:
         explicit data_wrapper_t(std::vector<datum_t> &&array);
         explicit data_wrapper_t(
                 std::vector<std::pair<datum_string_t, datum_t> > &&object);
+        data_wrapper_t(type_t type, shared_buf_ref_t<char> &&buf_ref);
 
         ~data_wrapper_t();
 
-        type_t type;
+        internal_type_t internal_type;
         union {
             bool r_bool;
             double r_num;
@@ -337,6 +367,7 @@ private:
             counted_t<countable_wrapper_t<std::vector<datum_t> > > r_array;
             counted_t<countable_wrapper_t<std::vector< //NOLINT(whitespace/operators)
                 std::pair<datum_string_t, datum_t> > > > r_object;
+            shared_buf_ref_t<char> buf_ref;
         };
     private:
         void assign_copy(const data_wrapper_t &copyee);
@@ -0,0 +1,398 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/datum_json.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/pseudo_literal.hpp"
+
+namespace ql {
+
+namespace {
+
+/* The scanning loops below look at 16 bytes at a time where SSE2 is available (which
+is everywhere on x86-64), and fall back to a byte at a time elsewhere and for the
+last few bytes of the input. */
+
+// Returns a pointer to the first '"', '\\' or NUL byte in [p, end), or `end`.
+const char *find_string_special(const char *p, const char *end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                       _mm_cmpeq_epi8(chunk, backslash)),
+                                          _mm_cmpeq_epi8(chunk, zero));
+        const int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && *p != '\0') {
+        ++p;
+    }
+    return p;
+}
+
+// Like cJSON, we treat every byte from 1 to 32 as whitespace.  NUL ends the input.
+inline bool is_whitespace(char c) {
+    return c != '\0' && static_cast<unsigned char>(c) <= 32;
+}
+
+// Returns a pointer to the first non-whitespace byte in [p, end), or `end`.
+const char *skip_whitespace(const char *p, const char *end) {
+    // Most values are separated by no whitespace or a single space, so check the
+    // first couple of bytes before setting up the vector loop.
+    for (int i = 0; i < 2; ++i) {
+        if (p == end || !is_whitespace(*p)) {
+            return p;
+        }
+        ++p;
+    }
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        // c <= 32 (unsigned) iff max(c, 32) == 32.
+        const __m128i ws = _mm_andnot_si128(
+            _mm_cmpeq_epi8(chunk, zero),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, space), space));
+        const int mask = _mm_movemask_epi8(ws) ^ 0xFFFF;
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && is_whitespace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// Returns the value of four hex digits, or 0 (which callers reject) if they aren't.
+unsigned parse_hex4(const char *p) {
+    unsigned h = 0;
+    for (int i = 0; i < 4; ++i) {
+        const char c = p[i];
+        h <<= 4;
+        if (c >= '0' && c <= '9') {
+            h += c - '0';
+        } else if (c >= 'A' && c <= 'F') {
+            h += 10 + c - 'A';
+        } else if (c >= 'a' && c <= 'f') {
+            h += 10 + c - 'a';
+        } else {
+            return 0;
+        }
+    }
+    return h;
+}
+
+void append_utf8(unsigned uc, std::string *out) {
+    if (uc < 0x80) {
+        out->push_back(uc);
+    } else if (uc < 0x800) {
+        out->push_back(0xC0 | (uc >> 6));
+        out->push_back(0x80 | (uc & 0x3F));
+    } else if (uc < 0x10000) {
+        out->push_back(0xE0 | (uc >> 12));
+        out->push_back(0x80 | ((uc >> 6) & 0x3F));
+        out->push_back(0x80 | (uc & 0x3F));
+    } else {
+        out->push_back(0xF0 | (uc >> 18));
+        out->push_back(0x80 | ((uc >> 12) & 0x3F));
+        out->push_back(0x80 | ((uc >> 6) & 0x3F));
+        out->push_back(0x80 | (uc & 0x3F));
+    }
+}
+
+class json_parser_t {
+public:
+    json_parser_t(const char *begin, const char *_end,
+                  const configured_limits_t &_limits)
+        : pos(begin), end(_end), limits(_limits) { }
+
+    // Returns false if the input isn't valid JSON.  Leaves `pos` just after the
+    // value.
+    bool parse_value(datum_t *out) {
+        pos = skip_whitespace(pos, end);
+        if (pos == end) {
+            return false;
+        }
+        switch (*pos) {
+        case '"': {
+            datum_string_t str;
+            if (!parse_string(&str)) {
+                return false;
+            }
+            *out = datum_t(std::move(str));
+            return true;
+        }
+        case '[': return parse_array(out);
+        case '{': return parse_object(out);
+        case 'n': return parse_literal("null", 4, datum_t::null(), out);
+        case 't': return parse_literal("true", 4, datum_t::boolean(true), out);
+        case 'f': return parse_literal("false", 5, datum_t::boolean(false), out);
+        default:
+            if (*pos == '-' || (*pos >= '0' && *pos <= '9')) {
+                return parse_number(out);
+            }
+            return false;
+        }
+    }
+
+private:
+    bool parse_literal(const char *literal, size_t size, datum_t value, datum_t *out) {
+        if (static_cast<size_t>(end - pos) < size || memcmp(pos, literal, size) != 0) {
+            return false;
+        }
+        pos += size;
+        *out = std::move(value);
+        return true;
+    }
+
+    bool parse_number(datum_t *out) {
+        const char *const begin = pos;
+        const char *p = pos;
+        if (*p == '-') {
+            ++p;
+        }
+        // Integers that fit in a double's mantissa are by far the most common
+        // numbers, and don't need strtod.
+        int64_t integer = 0;
+        const char *const digits = p;
+        while (p < end && *p >= '0' && *p <= '9' && p - digits < 15) {
+            integer = integer * 10 + (*p - '0');
+            ++p;
+        }
+        if (p > digits
+            && (p == end || !(*p == '.' || *p == 'e' || *p == 'E'
+                              || (*p >= '0' && *p <= '9')))) {
+            pos = p;
+            const double value = static_cast<double>(integer);
+            *out = datum_t(*begin == '-' ? -value : value);
+            return true;
+        }
+
+        // Everything else goes through strtod, like it did with cJSON.  strtod
+        // needs a terminated string, so we copy what could be part of the number.
+        p = begin;
+        while (p < end && ((*p >= '0' && *p <= '9')
+                           || *p == '-' || *p == '+' || *p == '.'
+                           || *p == 'e' || *p == 'E')) {
+            ++p;
+        }
+        scratch.assign(begin, p);
+        char *num_end;
+        const double value = strtod(scratch.c_str(), &num_end);
+        if (num_end == scratch.c_str()) {
+            return false;
+        }
+        pos = begin + (num_end - scratch.c_str());
+        *out = datum_t(value);
+        return true;
+    }
+
+    // Expects `pos` to point at the opening quote.
+    bool parse_string(datum_string_t *out) {
+        rassert(*pos == '"');
+        const char *const begin = pos + 1;
+        const char *p = find_string_special(begin, end);
+        if (p == end || *p == '\0') {
+            return false;
+        }
+        if (*p == '"') {
+            // No escapes, so we can copy the bytes straight out of the input.
+            *out = datum_string_t(p - begin, begin);
+            pos = p + 1;
+            return true;
+        }
+
+        scratch.assign(begin, p);
+        for (;;) {
+            if (p == end || *p == '\0') {
+                return false;
+            } else if (*p == '"') {
+                break;
+            }
+            rassert(*p == '\\');
+            ++p;
+            if (p == end || *p == '\0') {
+                return false;
+            }
+            switch (*p) {
+            case 'b': scratch.push_back('\b'); ++p; break;
+            case 'f': scratch.push_back('\f'); ++p; break;
+            case 'n': scratch.push_back('\n'); ++p; break;
+            case 'r': scratch.push_back('\r'); ++p; break;
+            case 't': scratch.push_back('\t'); ++p; break;
+            case 'u': {
+                if (end - p < 5) {
+                    return false;
+                }
+                unsigned uc = parse_hex4(p + 1);
+                p += 5;
+                // Invalid characters and lone low surrogates fail, like in our
+                // cJSON.
+                if ((uc >= 0xDC00 && uc <= 0xDFFF) || uc == 0) {
+                    return false;
+                }
+                if (uc >= 0xD800 && uc <= 0xDBFF) {
+                    // A high surrogate that isn't followed by a low surrogate is
+                    // dropped, like in our cJSON.
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+                        break;
+                    }
+                    const unsigned uc2 = parse_hex4(p + 2);
+                    p += 6;
+                    if (uc2 < 0xDC00 || uc2 > 0xDFFF) {
+                        break;
+                    }
+                    uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+                }
+                append_utf8(uc, &scratch);
+            } break;
+            default: scratch.push_back(*p); ++p; break;
+            }
+
+            const char *next = find_string_special(p, end);
+            scratch.append(p, next);
+            p = next;
+        }
+
+        *out = datum_string_t(scratch);
+        pos = p + 1;
+        return true;
+    }
+
+    // Expects `pos` to point at the opening bracket.
+    bool parse_array(datum_t *out) {
+        ++pos;
+        std::vector<datum_t> array;
+        pos = skip_whitespace(pos, end);
+        if (pos != end && *pos == ']') {
+            ++pos;
+            *out = datum_t(std::move(array), limits);
+            return true;
+        }
+        for (;;) {
+            datum_t item;
+            if (!parse_value(&item)) {
+                return false;
+            }
+            array.push_back(std::move(item));
+            pos = skip_whitespace(pos, end);
+            if (pos == end) {
+                return false;
+            } else if (*pos == ',') {
+                ++pos;
+            } else if (*pos == ']') {
+                ++pos;
+                break;
+            } else {
+                return false;
+            }
+        }
+        *out = datum_t(std::move(array), limits);
+        return true;
+    }
+
+    // Expects `pos` to point at the opening brace.
+    bool parse_object(datum_t *out) {
+        ++pos;
+        // Collecting the pairs in a vector and sorting it once is a lot cheaper
+        // than going through `datum_object_builder_t`'s map.
+        std::vector<std::pair<datum_string_t, datum_t> > pairs;
+        pos = skip_whitespace(pos, end);
+        if (pos != end && *pos == '}') {
+            ++pos;
+        } else {
+            for (;;) {
+                pos = skip_whitespace(pos, end);
+                if (pos == end || *pos != '"') {
+                    return false;
+                }
+                datum_string_t key;
+                if (!parse_string(&key)) {
+                    return false;
+                }
+                pos = skip_whitespace(pos, end);
+                if (pos == end || *pos != ':') {
+                    return false;
+                }
+                ++pos;
+                datum_t value;
+                if (!parse_value(&value)) {
+                    return false;
+                }
+                pairs.push_back(std::make_pair(std::move(key), std::move(value)));
+                pos = skip_whitespace(pos, end);
+                if (pos == end) {
+                    return false;
+                } else if (*pos == ',') {
+                    ++pos;
+                } else if (*pos == '}') {
+                    ++pos;
+                    break;
+                } else {
+                    return false;
+                }
+            }
+        }
+        std::sort(pairs.begin(), pairs.end(),
+                  [](const std::pair<datum_string_t, datum_t> &a,
+                     const std::pair<datum_string_t, datum_t> &b) {
+                      return a.first < b.first;
+                  });
+        for (size_t i = 1; i < pairs.size(); ++i) {
+            rcheck_datum(pairs[i - 1].first != pairs[i].first, base_exc_t::GENERIC,
+                         strprintf("Duplicate key `%s` in JSON.",
+                                   pairs[i].first.to_std().c_str()));
+        }
+        static const std::set<std::string> pts = { pseudo::literal_string };
+        *out = datum_t(std::move(pairs), pts);
+        return true;
+    }
+
+    const char *pos;
+    const char *const end;
+    const configured_limits_t &limits;
+
+    // Reused for strings with escapes and for numbers that go through strtod.
+    std::string scratch;
+
+    DISABLE_COPYING(json_parser_t);
+};
+
+}  // namespace
+
+datum_t parse_json(const char *json, size_t size, const configured_limits_t &limits) {
+    json_parser_t parser(json, json + size, limits);
+    datum_t ret;
+    if (!parser.parse_value(&ret)) {
+        return datum_t();
+    }
+    return ret;
+}
+
+datum_t parse_json(const std::string &json, const configured_limits_t &limits) {
+    return parse_json(json.data(), json.size(), limits);
+}
+
+}  // namespace ql
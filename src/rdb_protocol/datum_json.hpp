@@ -0,0 +1,27 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_DATUM_JSON_HPP_
+#define RDB_PROTOCOL_DATUM_JSON_HPP_
+
+#include <string>
+
+#include "rdb_protocol/datum.hpp"
+
+namespace ql {
+
+class configured_limits_t;
+
+/* Parses JSON text straight into a `datum_t`, without building a cJSON tree first.
+It accepts the same documents that `cJSON_Parse()` followed by `to_datum(cJSON *)`
+does; in particular, anything after the first complete value is ignored.  (The one
+exception is a NUL byte inside a string, which cJSON silently cut the string short
+at, and which we reject.)
+
+Returns an empty `datum_t` if the text isn't valid JSON.  Valid JSON that doesn't make
+a valid datum (duplicate keys, non-finite numbers, arrays over the size limit, bad
+pseudotypes) throws a `base_exc_t`, just like `to_datum(cJSON *)` does. */
+datum_t parse_json(const char *json, size_t size, const configured_limits_t &limits);
+datum_t parse_json(const std::string &json, const configured_limits_t &limits);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_JSON_HPP_
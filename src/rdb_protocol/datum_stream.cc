@@ -1,6 +1,8 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "rdb_protocol/datum_stream.hpp"
 
+#include <iterator>
+#include <limits>
 #include <map>
 
 #include "rdb_protocol/batching.hpp"
@@ -226,6 +228,10 @@ bool reader_t::is_finished() const {
     return shards_exhausted && items_index >= items.size();
 }
 
+bool reader_t::transforms_are_deterministic() const {
+    return ql::transforms_are_deterministic(transforms);
+}
+
 readgen_t::readgen_t(
     const std::map<std::string, wire_func_t> &_global_optargs,
     std::string _table_name,
@@ -651,6 +657,11 @@ bool lazy_datum_stream_t::is_exhausted() const {
 bool lazy_datum_stream_t::is_cfeed() const {
     return false;
 }
+bool lazy_datum_stream_t::can_read_ahead() const {
+    // The transformations run on the shards as part of the read, so reading ahead
+    // would call `r.js` or `r.http` before the client asks for the results.
+    return reader.transforms_are_deterministic();
+}
 
 array_datum_stream_t::array_datum_stream_t(datum_t _arr,
                                            const protob_t<const Backtrace> &bt_source)
@@ -731,6 +742,41 @@ indexed_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batch
     return ret;
 }
 
+// EXTERNAL_SORT_DATUM_STREAM_T
+external_sort_datum_stream_t::external_sort_datum_stream_t(
+    scoped_ptr_t<external_sorter_t> &&_sorter,
+    const protob_t<const Backtrace> &bt_src)
+    : eager_datum_stream_t(bt_src), sorter(std::move(_sorter)) { }
+
+bool external_sort_datum_stream_t::is_exhausted() const {
+    return sorter->is_exhausted() && batch_cache_exhausted();
+}
+bool external_sort_datum_stream_t::is_cfeed() const {
+    return false;
+}
+bool external_sort_datum_stream_t::is_array() {
+    // Like the other lazy streams: if this were an array, `val_t` and the
+    // top-level query code would call `as_array()` on it, which runs into the array
+    // size limit that we spilled to disk to get around.
+    return false;
+}
+
+std::vector<datum_t>
+external_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
+    std::vector<datum_t> v;
+    batcher_t batcher = batchspec.to_batcher();
+
+    profile::sampler_t sampler("Merging sorted runs.", env->trace);
+    while (datum_t d = sorter->next(env, &sampler)) {
+        batcher.note_el(d);
+        v.push_back(std::move(d));
+        if (batcher.should_send_batch()) {
+            break;
+        }
+    }
+    return v;
+}
+
 // ORDERED_DISTINCT_DATUM_STREAM_T
 ordered_distinct_datum_stream_t::ordered_distinct_datum_stream_t(
     counted_t<datum_stream_t> _source) : wrapper_datum_stream_t(_source) { }
@@ -784,6 +830,27 @@ slice_datum_stream_t::slice_datum_stream_t(
     uint64_t _left, uint64_t _right, counted_t<datum_stream_t> _src)
     : wrapper_datum_stream_t(_src), index(0), left(_left), right(_right) { }
 
+void slice_datum_stream_t::accumulate(
+    env_t *env, eager_acc_t *acc, const terminal_variant_t &tv) {
+    // `skip(n).count()` is the count of the source minus `n`, and the source may be
+    // able to count its rows without reading them (a table range can use the key
+    // counts in the btree).  We don't do this when there's a right bound, since the
+    // source would then count rows we'd otherwise never read.
+    if (boost::get<count_wire_func_t>(&tv) != NULL && !ops_to_do() && index == 0
+        && right == std::numeric_limits<uint64_t>::max() && !source->is_grouped()) {
+        const uint64_t source_count = source->run_terminal(env, tv)->as_int();
+        grouped_t<uint64_t> counts;
+        if (source_count > left) {
+            counts[datum_t()] = source_count - left;
+        }
+        result_t res(std::move(counts));
+        acc->add_res(env, &res);
+        index = right;
+        return;
+    }
+    eager_datum_stream_t::accumulate(env, acc, tv);
+}
+
 std::vector<datum_t>
 slice_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &_batchspec) {
     if (left >= right || index >= right) {
@@ -836,6 +903,141 @@ bool slice_datum_stream_t::is_cfeed() const {
     return source->is_cfeed();
 }
 
+// EQ_JOIN_DATUM_STREAM_T
+eq_join_datum_stream_t::eq_join_datum_stream_t(counted_t<datum_stream_t> _source,
+                                               counted_t<const func_t> _left_key,
+                                               counted_t<table_t> _table,
+                                               const std::string &_index)
+    : wrapper_datum_stream_t(_source), left_key(_left_key), table(_table),
+      index(_index) {
+    guarantee(left_key.has() && table.has());
+}
+
+eq_join_datum_stream_t::~eq_join_datum_stream_t() { }
+
+bool eq_join_datum_stream_t::is_exhausted() const {
+    return source->is_exhausted() && prefetched.empty() && batch_cache_exhausted();
+}
+
+std::vector<std::vector<datum_t> >
+eq_join_datum_stream_t::lookup(env_t *env, const std::vector<datum_t> &keys) {
+    std::vector<std::vector<datum_t> > matches(keys.size());
+    if (index == table->get_pkey()) {
+        std::vector<datum_t> rows = table->get_rows(env, keys);
+        r_sanity_check(rows.size() == keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (rows[i].get_type() != datum_t::R_NULL) {
+                matches[i].push_back(std::move(rows[i]));
+            }
+        }
+    } else {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            counted_t<datum_stream_t> stream
+                = table->get_all(env, keys[i], index, backtrace());
+            for (;;) {
+                std::vector<datum_t> v = stream->next_batch(env, batchspec_t::all());
+                if (v.empty()) {
+                    break;
+                }
+                std::move(v.begin(), v.end(), std::back_inserter(matches[i]));
+            }
+        }
+    }
+    return matches;
+}
+
+std::vector<datum_t>
+eq_join_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
+    std::vector<datum_t> ret;
+    while (ret.empty()) {
+        std::vector<datum_t> rows;
+        rows.swap(prefetched);
+        if (rows.empty()) {
+            rows = source->next_batch(env, batchspec);
+            if (rows.empty()) {
+                break;
+            }
+        }
+
+        // The distinct keys of this batch, and which of them each row wants.
+        // Rows that are null or don't have a key don't join with anything.
+        const size_t NO_KEY = std::numeric_limits<size_t>::max();
+        std::vector<datum_t> keys;
+        std::vector<size_t> row_keys(rows.size(), NO_KEY);
+        {
+            profile::sampler_t sampler("Evaluating eq_join keys.", env->trace);
+            std::map<datum_t, size_t, optional_datum_less_t> key_indexes(
+                optional_datum_less_t(env->reql_version()));
+            for (size_t i = 0; i < rows.size(); ++i) {
+                sampler.new_sample();
+                if (rows[i].get_type() == datum_t::R_NULL) {
+                    continue;
+                }
+                datum_t key;
+                try {
+                    key = left_key->call(env, rows[i])->as_datum();
+                } catch (const base_exc_t &e) {
+                    if (e.get_type() == base_exc_t::NON_EXISTENCE) {
+                        continue;
+                    }
+                    throw;
+                }
+                auto res = key_indexes.insert(std::make_pair(key, keys.size()));
+                if (res.second) {
+                    keys.push_back(key);
+                }
+                row_keys[i] = res.first->second;
+            }
+        }
+        if (keys.empty()) {
+            continue;
+        }
+
+        std::vector<std::vector<datum_t> > matches;
+        if (env->trace != NULL || source->is_cfeed() || source->is_exhausted()) {
+            // (When profiling we can't fetch at the same time, because both would
+            // write to the trace.  A changefeed might not have anything to fetch.)
+            matches = lookup(env, keys);
+        } else {
+            std::exception_ptr lookup_exc;
+            cond_t lookup_done;
+            coro_t::spawn_now_dangerously([&]() {
+                try {
+                    matches = lookup(env, keys);
+                } catch (...) {
+                    lookup_exc = std::current_exception();
+                }
+                lookup_done.pulse();
+            });
+            try {
+                prefetched = source->next_batch(env, batchspec);
+            } catch (...) {
+                // The lookup uses our locals, so we have to wait for it regardless.
+                lookup_done.wait_lazily_unordered();
+                throw;
+            }
+            lookup_done.wait_lazily_unordered();
+            if (lookup_exc) {
+                std::rethrow_exception(lookup_exc);
+            }
+        }
+
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (row_keys[i] == NO_KEY) {
+                continue;
+            }
+            const std::vector<datum_t> &row_matches = matches[row_keys[i]];
+            for (auto it = row_matches.begin(); it != row_matches.end(); ++it) {
+                datum_object_builder_t pair;
+                pair.overwrite("left", rows[i]);
+                pair.overwrite("right", *it);
+                ret.push_back(std::move(pair).to_datum());
+            }
+        }
+    }
+    return ret;
+}
+
 // UNION_DATUM_STREAM_T
 void union_datum_stream_t::add_transformation(transform_variant_t &&tv,
                                               const protob_t<const Backtrace> &bt) {
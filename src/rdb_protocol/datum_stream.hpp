@@ -15,6 +15,7 @@
 #include <boost/optional.hpp>
 
 #include "rdb_protocol/context.hpp"
+#include "rdb_protocol/external_sort.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/real_table.hpp"
 #include "rdb_protocol/shards.hpp"
@@ -23,6 +24,7 @@ namespace ql {
 
 class env_t;
 class scope_env_t;
+class table_t;
 
 class datum_stream_t : public single_threaded_countable_t<datum_stream_t>,
                        public pb_rcheckable_t {
@@ -58,6 +60,12 @@ public:
     virtual bool is_exhausted() const = 0;
     virtual bool is_cfeed() const = 0;
 
+    // Whether `stream_cache_t` may read the next batch while the client is still
+    // busy with the last one.  That runs the stream's functions before anybody asks
+    // for their results, so only streams that read from the shards and whose
+    // functions are deterministic say yes.
+    virtual bool can_read_ahead() const { return false; }
+
     virtual void accumulate(
         env_t *env, eager_acc_t *acc, const terminal_variant_t &tv) = 0;
     virtual void accumulate_all(env_t *env, eager_acc_t *acc) = 0;
@@ -83,14 +91,16 @@ protected:
     virtual datum_t as_array(env_t *env);
     bool ops_to_do() { return ops.size() != 0; }
 
+    virtual void add_transformation(transform_variant_t &&tv,
+                                    const protob_t<const Backtrace> &bt);
+
+    virtual void accumulate(env_t *env, eager_acc_t *acc, const terminal_variant_t &tv);
+
 private:
     enum class done_t { YES, NO };
 
     virtual bool is_array() = 0;
 
-    virtual void add_transformation(transform_variant_t &&tv,
-                                    const protob_t<const Backtrace> &bt);
-    virtual void accumulate(env_t *env, eager_acc_t *acc, const terminal_variant_t &tv);
     virtual void accumulate_all(env_t *env, eager_acc_t *acc);
 
     done_t next_grouped_batch(env_t *env, const batchspec_t &bs, groups_t *out);
@@ -172,6 +182,7 @@ class slice_datum_stream_t : public wrapper_datum_stream_t {
 public:
     slice_datum_stream_t(uint64_t left, uint64_t right, counted_t<datum_stream_t> src);
 private:
+    virtual void accumulate(env_t *env, eager_acc_t *acc, const terminal_variant_t &tv);
     virtual std::vector<datum_t>
     next_raw_batch(env_t *env, const batchspec_t &batchspec);
     virtual bool is_exhausted() const;
@@ -199,6 +210,51 @@ size_t index;
 std::vector<datum_t> data;
 };
 
+// Streams the result of an `external_sorter_t` that has been `finish()`ed.
+class external_sort_datum_stream_t : public eager_datum_stream_t {
+public:
+    external_sort_datum_stream_t(scoped_ptr_t<external_sorter_t> &&_sorter,
+                                 const protob_t<const Backtrace> &bt_src);
+    virtual bool is_exhausted() const;
+    virtual bool is_cfeed() const;
+
+private:
+    virtual bool is_array();
+    virtual std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+
+    scoped_ptr_t<external_sorter_t> sorter;
+};
+
+/* Pairs each row of `source` with the rows of `table` whose `index` value is
+`left_key(row)`, like `source.concat_map(row -> table.get_all(left_key(row)))` but
+with all the lookups for a batch of rows done together: a single read for the
+primary index, and one read per distinct key for a secondary index.  While those
+are in flight we fetch the next batch of rows from `source`. */
+class eq_join_datum_stream_t : public wrapper_datum_stream_t {
+public:
+    eq_join_datum_stream_t(counted_t<datum_stream_t> _source,
+                           counted_t<const func_t> _left_key,
+                           counted_t<table_t> _table,
+                           const std::string &_index);
+    ~eq_join_datum_stream_t();
+
+private:
+    virtual bool is_exhausted() const;
+    virtual std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+
+    // Returns the matches for each of `keys`.
+    std::vector<std::vector<datum_t> > lookup(env_t *env,
+                                              const std::vector<datum_t> &keys);
+
+    counted_t<const func_t> left_key;
+    counted_t<table_t> table;
+    std::string index;
+    // Left rows that we fetched while the previous batch was being looked up.
+    std::vector<datum_t> prefetched;
+};
+
 class union_datum_stream_t : public datum_stream_t {
 public:
     union_datum_stream_t(std::vector<counted_t<datum_stream_t> > &&_streams,
@@ -357,6 +413,7 @@ public:
     std::vector<datum_t>
     next_batch(env_t *env, const batchspec_t &batchspec);
     bool is_finished() const;
+    bool transforms_are_deterministic() const;
 private:
     // Returns `true` if there's data in `items`.
     bool load_items(env_t *env, const batchspec_t &batchspec);
@@ -392,6 +449,7 @@ public:
 
     bool is_exhausted() const;
     virtual bool is_cfeed() const;
+    virtual bool can_read_ahead() const;
 private:
     std::vector<datum_t>
     next_batch_impl(env_t *env, const batchspec_t &batchspec);
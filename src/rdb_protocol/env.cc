@@ -100,6 +100,15 @@ void env_t::do_eval_callback() {
     }
 }
 
+void env_t::set_query_params(std::vector<datum_t> &&params) {
+    query_params_ = std::move(params);
+}
+
+datum_t env_t::get_query_param(size_t index) const {
+    r_sanity_check(index < query_params_.size());
+    return query_params_[index];
+}
+
 profile_bool_t env_t::profile() const {
     return trace != nullptr ? profile_bool_t::PROFILE : profile_bool_t::DONT_PROFILE;
 }
@@ -109,11 +118,25 @@ reql_cluster_interface_t *env_t::reql_cluster_interface() {
     return rdb_ctx_->cluster_interface;
 }
 
+rdb_context_t *env_t::get_rdb_ctx() {
+    r_sanity_check(rdb_ctx_ != NULL);
+    return rdb_ctx_;
+}
+
 std::string env_t::get_reql_http_proxy() {
     r_sanity_check(rdb_ctx_ != NULL);
     return rdb_ctx_->reql_http_proxy;
 }
 
+io_backender_t *env_t::get_io_backender() {
+    return rdb_ctx_ != NULL ? rdb_ctx_->io_backender : NULL;
+}
+
+const base_path_t &env_t::get_base_path() {
+    r_sanity_check(rdb_ctx_ != NULL);
+    return rdb_ctx_->base_path;
+}
+
 extproc_pool_t *env_t::get_extproc_pool() {
     assert_thread();
     r_sanity_check(rdb_ctx_ != NULL);
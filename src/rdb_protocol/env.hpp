@@ -18,6 +18,7 @@
 #include "rdb_protocol/val.hpp"
 
 class extproc_pool_t;
+class io_backender_t;
 
 namespace ql {
 class datum_t;
@@ -67,12 +68,21 @@ public:
 
     extproc_pool_t *get_extproc_pool();
 
+    // Where to put temporary files for data that doesn't fit in memory.
+    // `get_io_backender()` returns NULL if there's nowhere to put them (e.g. on a
+    // proxy, or in unit tests).
+    io_backender_t *get_io_backender();
+    const base_path_t &get_base_path();
+
     // Returns js_runner, but first calls js_runner->begin() if it hasn't
     // already been called.
     js_runner_t *get_js_runner();
 
     reql_cluster_interface_t *reql_cluster_interface();
 
+    // Used by changefeed subscriptions to update the context's stats.
+    rdb_context_t *get_rdb_ctx();
+
     std::string get_reql_http_proxy();
 
     // This is a callback used in unittests to control things during a query
@@ -98,6 +108,11 @@ public:
 
     reql_version_t reql_version() const { return reql_version_; }
 
+    // The values of the parameters of a query that `query_cache_t` compiled.  The
+    // terms for the parameters read them from here.
+    void set_query_params(std::vector<datum_t> &&params);
+    datum_t get_query_param(size_t index) const;
+
 private:
     // The global optargs values passed to .run(...) in the Python, Ruby, and JS
     // drivers.
@@ -111,6 +126,8 @@ private:
     // earlier value.
     const reql_version_t reql_version_;
 
+    std::vector<datum_t> query_params_;
+
 public:
     // The interruptor signal while a query evaluates.
     signal_t *const interruptor;
@@ -137,9 +154,13 @@ private:
 // evaluate anything, it doesn't need an env_t *.
 class compile_env_t {
 public:
-    explicit compile_env_t(var_visibility_t &&_visibility)
-        : visibility(std::move(_visibility)) { }
+    explicit compile_env_t(var_visibility_t &&_visibility,
+                           const std::map<const Term *, size_t> *_query_params = NULL)
+        : visibility(std::move(_visibility)), query_params(_query_params) { }
     var_visibility_t visibility;
+    // When `query_cache_t` compiles a query, the `DATUM` terms that are compiled as
+    // parameters, and their indexes.  NULL otherwise.
+    const std::map<const Term *, size_t> *const query_params;
 };
 
 // This is an environment for evaluating things that use variables in scope.  It
@@ -0,0 +1,207 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/external_sort.hpp"
+
+#include <algorithm>
+
+#include "containers/disk_backed_queue.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/profile.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+
+namespace ql {
+
+// How many elements we write to a spill file per transaction.
+static const size_t SPILL_CHUNK_SIZE = 256;
+
+// The most spilled runs we have open at once, counting the one a merge writes to.
+// Once there are this many minus one we merge them into one.
+static const size_t MAX_SPILLED_RUNS = 16;
+
+class external_sorter_t::run_t {
+public:
+    // A run that was spilled to disk.
+    explicit run_t(scoped_ptr_t<disk_backed_queue_t<datum_t> > &&_queue)
+        : queue(std::move(_queue)), index(0) {
+        advance();
+    }
+
+    // A run that is kept in memory.
+    explicit run_t(std::vector<datum_t> &&_data)
+        : data(std::move(_data)), index(0) {
+        advance();
+    }
+
+    bool is_spilled() const { return queue.has(); }
+
+    // An empty `datum_t` once the run has been drained.
+    const datum_t &head() const { return head_; }
+
+    datum_t pop() {
+        datum_t ret = std::move(head_);
+        advance();
+        return ret;
+    }
+
+private:
+    void advance() {
+        if (queue.has()) {
+            if (queue->empty()) {
+                head_ = datum_t();
+            } else {
+                queue->pop(&head_);
+            }
+        } else {
+            head_ = index < data.size() ? std::move(data[index++]) : datum_t();
+        }
+    }
+
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > queue;
+    std::vector<datum_t> data;
+    size_t index;
+    datum_t head_;
+
+    DISABLE_COPYING(run_t);
+};
+
+external_sorter_t::external_sorter_t(io_backender_t *_io_backender,
+                                     const base_path_t &_base_path,
+                                     lt_cmp_t _lt_cmp)
+    : io_backender(_io_backender),
+      base_path(_base_path),
+      lt_cmp(std::move(_lt_cmp)),
+      finished(false) {
+    guarantee(io_backender != NULL);
+}
+
+external_sorter_t::~external_sorter_t() { }
+
+void external_sorter_t::add_run(env_t *env, std::vector<datum_t> &&run) {
+    guarantee(!finished);
+    sort_run(env, &run);
+
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > queue = make_spill_queue();
+    std::vector<datum_t> chunk;
+    for (size_t i = 0; i < run.size(); i += SPILL_CHUNK_SIZE) {
+        if (env->interruptor->is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        chunk.assign(std::make_move_iterator(run.begin() + i),
+                     std::make_move_iterator(
+                         run.begin() + std::min(i + SPILL_CHUNK_SIZE, run.size())));
+        queue->push(chunk);
+    }
+    run.clear();
+    runs.push_back(make_scoped<run_t>(std::move(queue)));
+
+    if (runs.size() >= MAX_SPILLED_RUNS - 1) {
+        merge_spilled_runs(env);
+    }
+}
+
+void external_sorter_t::finish(env_t *env, std::vector<datum_t> &&last_run) {
+    guarantee(!finished);
+    sort_run(env, &last_run);
+    runs.push_back(make_scoped<run_t>(std::move(last_run)));
+    finished = true;
+}
+
+datum_t external_sorter_t::next(env_t *env, profile::sampler_t *sampler) {
+    guarantee(finished);
+    const size_t i = min_run(env, sampler);
+    return i < runs.size() ? runs[i]->pop() : datum_t();
+}
+
+bool external_sorter_t::is_exhausted() const {
+    guarantee(finished);
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        if ((*it)->head().has()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t external_sorter_t::num_spilled_runs() const {
+    size_t count = 0;
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        if ((*it)->is_spilled()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+scoped_ptr_t<disk_backed_queue_file_t> external_sorter_t::make_spill_file() {
+    // The file is unlinked as soon as it's been created, so there's nothing to
+    // clean up if we crash.
+    return make_scoped<disk_backed_queue_file_t>(
+        io_backender,
+        serializer_filepath_t(base_path, "order_by_" + uuid_to_str(generate_uuid())),
+        &perfmon_collection);
+}
+
+scoped_ptr_t<disk_backed_queue_t<datum_t> > external_sorter_t::make_spill_queue() {
+    if (!spill_file.has()) {
+        spill_file = make_spill_file();
+    }
+    return make_scoped<disk_backed_queue_t<datum_t> >(spill_file.get());
+}
+
+void external_sorter_t::merge_spilled_runs(env_t *env) {
+    profile::sampler_t sampler("Merging sorted runs.", env->trace);
+    // The merged run goes to a new file, and the old one is closed once we've
+    // drained it.  Draining frees the old runs' blocks, but the serializer only
+    // reuses an extent once all of its blocks are free, and only shrinks the file
+    // from the end.  Merging within the file would mostly append to it, leaving
+    // the space of the old runs behind, merge after merge.
+    scoped_ptr_t<disk_backed_queue_file_t> merged_file = make_spill_file();
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > queue
+        = make_scoped<disk_backed_queue_t<datum_t> >(merged_file.get());
+    std::vector<datum_t> chunk;
+    for (;;) {
+        if (env->interruptor->is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        const size_t i = min_run(env, &sampler);
+        if (i == runs.size()) {
+            break;
+        }
+        chunk.push_back(runs[i]->pop());
+        if (chunk.size() == SPILL_CHUNK_SIZE) {
+            queue->push(chunk);
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty()) {
+        queue->push(chunk);
+    }
+    runs.clear();
+    spill_file = std::move(merged_file);
+    runs.push_back(make_scoped<run_t>(std::move(queue)));
+}
+
+size_t external_sorter_t::min_run(env_t *env, profile::sampler_t *sampler) {
+    // There are at most `MAX_SPILLED_RUNS` runs, so a linear scan is fine.  Only
+    // replacing the minimum on a strict `<` is what breaks ties in favor of earlier
+    // runs.
+    size_t best = runs.size();
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (!runs[i]->head().has()) {
+            continue;
+        }
+        if (best == runs.size()
+            || lt_cmp(env, sampler, runs[i]->head(), runs[best]->head())) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void external_sorter_t::sort_run(env_t *env, std::vector<datum_t> *run) {
+    profile::sampler_t sampler("Sorting in-memory.", env->trace);
+    std::stable_sort(run->begin(), run->end(),
+                     std::bind(lt_cmp, env, &sampler, ph::_1, ph::_2));
+}
+
+}  // namespace ql
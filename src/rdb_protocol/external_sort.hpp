@@ -0,0 +1,91 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_EXTERNAL_SORT_HPP_
+#define RDB_PROTOCOL_EXTERNAL_SORT_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "perfmon/core.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "utils.hpp"
+
+class disk_backed_queue_file_t;
+class io_backender_t;
+template <class> class disk_backed_queue_t;
+namespace profile { class sampler_t; }
+
+namespace ql {
+
+class env_t;
+
+/* `external_sorter_t` sorts sequences that are too big to sort in memory.  The
+sequence is fed in as a series of runs; each run is sorted in memory and spilled to
+its own `disk_backed_queue_t`, except for the last one, which stays in memory.
+`next()` then streams a merge of all the runs back out.  Only the head of each run
+(plus the spill file's small cache) is in memory while merging.  The queues share
+a single spill file, which is created when the first run is spilled.  Merging the
+spilled runs moves them to a new file, so that the old one's space is given back.
+
+Runs must be added in the order they appear in the sequence: ties are broken in
+favor of earlier runs, which keeps the sort stable like the in-memory
+`std::stable_sort` it replaces. */
+class external_sorter_t {
+public:
+    typedef std::function<bool(env_t *,  // NOLINT(readability/casting)
+                               profile::sampler_t *,
+                               const datum_t &,
+                               const datum_t &)> lt_cmp_t;
+
+    external_sorter_t(io_backender_t *io_backender,
+                      const base_path_t &base_path,
+                      lt_cmp_t lt_cmp);
+    ~external_sorter_t();
+
+    // Sorts `run` and writes it to disk.  Throws `interrupted_exc_t` if
+    // `env->interruptor` is pulsed.
+    void add_run(env_t *env, std::vector<datum_t> &&run);
+
+    // Sorts the last run (which may be empty), keeping it in memory, and gets ready
+    // to merge.  No more runs may be added after this.
+    void finish(env_t *env, std::vector<datum_t> &&last_run);
+
+    // Returns the next element in sorted order, or an empty `datum_t` once all the
+    // runs have been drained.  Must only be called after `finish()`.
+    datum_t next(env_t *env, profile::sampler_t *sampler);
+    bool is_exhausted() const;
+
+    size_t num_spilled_runs() const;
+
+private:
+    class run_t;
+
+    scoped_ptr_t<disk_backed_queue_file_t> make_spill_file();
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > make_spill_queue();
+    // Merges all the runs we have so far into a single spilled run, in a new spill
+    // file.  Throws `interrupted_exc_t` if `env->interruptor` is pulsed.
+    void merge_spilled_runs(env_t *env);
+    // Returns the index of the run with the smallest head, or `runs.size()` if all
+    // the runs are empty.
+    size_t min_run(env_t *env, profile::sampler_t *sampler);
+    void sort_run(env_t *env, std::vector<datum_t> *run);
+
+    io_backender_t *const io_backender;
+    const base_path_t base_path;
+    const lt_cmp_t lt_cmp;
+
+    // The spill file registers its stats here; it isn't connected to the global
+    // perfmon tree because the file is short-lived.
+    perfmon_collection_t perfmon_collection;
+
+    // Must outlive the runs, whose queues are stored in it.
+    scoped_ptr_t<disk_backed_queue_file_t> spill_file;
+    std::vector<scoped_ptr_t<run_t> > runs;
+    bool finished;
+
+    DISABLE_COPYING(external_sorter_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_EXTERNAL_SORT_HPP_
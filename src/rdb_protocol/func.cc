@@ -1,5 +1,6 @@
 #include "rdb_protocol/func.hpp"
 
+#include "rdb_protocol/bytecode.hpp"
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/minidriver.hpp"
@@ -43,11 +44,25 @@ reql_func_t::reql_func_t(const protob_t<const Backtrace> backtrace,
                          std::vector<sym_t> _arg_names,
                          counted_t<const term_t> _body)
     : func_t(backtrace), captured_scope(_captured_scope),
-      arg_names(std::move(_arg_names)), body(std::move(_body)) { }
+      arg_names(std::move(_arg_names)), body(std::move(_body)),
+      bytecode(bytecode_t::compile(*body->get_src(), arg_names, captured_scope)) { }
 
 reql_func_t::~reql_func_t() { }
 
 counted_t<val_t> reql_func_t::call(
+    env_t *env,
+    const std::vector<datum_t> &args,
+    eval_flags_t eval_flags) const {
+    if (bytecode.has()) {
+        datum_t d = bytecode->run(env, args);
+        if (d.has()) {
+            return make_counted<val_t>(std::move(d), body->backtrace());
+        }
+    }
+    return call_interpreted(env, args, eval_flags);
+}
+
+counted_t<val_t> reql_func_t::call_interpreted(
     env_t *env,
     const std::vector<datum_t> &args,
     eval_flags_t eval_flags) const {
@@ -79,6 +94,60 @@ bool reql_func_t::is_deterministic() const {
     return body->is_deterministic();
 }
 
+static bool is_var(const Term &t, sym_t var) {
+    return t.type() == Term::VAR && t.args_size() == 1
+        && t.args(0).type() == Term::DATUM && t.args(0).datum().type() == Datum::R_NUM
+        && static_cast<int64_t>(t.args(0).datum().r_num()) == var.value;
+}
+
+// Returns false if `t` might use `var` other than to read fields in `fields`.
+static bool term_reads_only_fields(const Term &t, sym_t var,
+                                   const std::set<std::string> &fields) {
+    switch (t.type()) {
+    case Term::VAR:
+        return !is_var(t, var);
+    case Term::IMPLICIT_VAR:
+        return false;
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET: // fallthru
+    case Term::PLUCK: // fallthru
+    case Term::HAS_FIELDS: {
+        if (t.args_size() >= 2 && is_var(t.args(0), var)) {
+            for (int i = 1; i < t.args_size(); ++i) {
+                if (t.args(i).type() != Term::DATUM
+                    || t.args(i).datum().type() != Datum::R_STR
+                    || fields.count(t.args(i).datum().r_str()) == 0) {
+                    return false;
+                }
+            }
+            for (int i = 0; i < t.optargs_size(); ++i) {
+                if (!term_reads_only_fields(t.optargs(i).val(), var, fields)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    } break;
+    default: break;
+    }
+    for (int i = 0; i < t.args_size(); ++i) {
+        if (!term_reads_only_fields(t.args(i), var, fields)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < t.optargs_size(); ++i) {
+        if (!term_reads_only_fields(t.optargs(i).val(), var, fields)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool reql_func_t::reads_only_fields(const std::set<std::string> &fields) const {
+    return arg_names.size() == 1
+        && term_reads_only_fields(*body->get_src(), arg_names[0], fields);
+}
+
 js_func_t::js_func_t(const std::string &_js_source,
                      uint64_t timeout_ms,
                      protob_t<const Backtrace> backtrace)
@@ -124,6 +193,10 @@ bool js_func_t::is_deterministic() const {
     return false;
 }
 
+bool js_func_t::reads_only_fields(const std::set<std::string> &) const {
+    return false;
+}
+
 void reql_func_t::visit(func_visitor_t *visitor) const {
     visitor->on_reql_func(this);
 }
@@ -245,7 +318,13 @@ bool filter_match(datum_t predicate, datum_t value,
 }
 
 bool reql_func_t::filter_helper(env_t *env, datum_t arg) const {
-    datum_t d = call(env, make_vector(arg), NO_FLAGS)->as_datum();
+    // This is the hot path of `filter`, so we skip allocating a `val_t` when the
+    // bytecode can handle the row.
+    std::vector<datum_t> args = make_vector(arg);
+    datum_t d = bytecode.has() ? bytecode->run(env, args) : datum_t();
+    if (!d.has()) {
+        d = call_interpreted(env, args, NO_FLAGS)->as_datum();
+    }
     if (d->get_type() == datum_t::R_OBJECT &&
         (body->get_src()->type() == Term::MAKE_OBJ ||
          body->get_src()->type() == Term::DATUM)) {
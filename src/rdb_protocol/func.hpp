@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_FUNC_HPP_
 
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,6 +12,7 @@
 #include <boost/variant/static_visitor.hpp>
 
 #include "containers/counted.hpp"
+#include "containers/scoped.hpp"
 #include "containers/uuid.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
@@ -22,6 +24,7 @@ class js_runner_t;
 
 namespace ql {
 
+class bytecode_t;
 class func_visitor_t;
 
 class func_t : public slow_atomic_countable_t<func_t>, public pb_rcheckable_t {
@@ -35,6 +38,12 @@ public:
 
     virtual bool is_deterministic() const = 0;
 
+    // Returns true if the function takes one argument and only uses it to read
+    // fields named in `fields`, by constant names.  Calling it on an object with
+    // just those fields then gives the same result, except in error messages that
+    // print the object.
+    virtual bool reads_only_fields(const std::set<std::string> &fields) const = 0;
+
     // Used by info_term_t.
     virtual std::string print_source() const = 0;
 
@@ -77,7 +86,15 @@ public:
         env_t *env,
         const std::vector<datum_t> &args,
         eval_flags_t eval_flags) const;
+    // Like `call`, but always walks the term tree, even if the body was compiled to
+    // bytecode.  `call` falls back to this, and the tests compare the two.
+    counted_t<val_t> call_interpreted(
+        env_t *env,
+        const std::vector<datum_t> &args,
+        eval_flags_t eval_flags) const;
+    bool is_compiled() const { return bytecode.has(); }
     bool is_deterministic() const;
+    bool reads_only_fields(const std::set<std::string> &fields) const;
 
     std::string print_source() const;
 
@@ -85,6 +102,7 @@ public:
 
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
+    friend class wire_func_normalizing_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
 
     // Only contains the parts of the scope that `body` uses.
@@ -96,6 +114,9 @@ private:
     // The body of the function, which gets ->eval(...) called when call(...) is called.
     counted_t<const term_t> body;
 
+    // `body` compiled to bytecode, if it only uses terms that we compile.
+    scoped_ptr_t<const bytecode_t> bytecode;
+
     DISABLE_COPYING(reql_func_t);
 };
 
@@ -113,6 +134,7 @@ public:
                           eval_flags_t eval_flags) const;
 
     bool is_deterministic() const;
+    bool reads_only_fields(const std::set<std::string> &fields) const;
 
     std::string print_source() const;
 
@@ -120,6 +142,7 @@ public:
 
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
+    friend class wire_func_normalizing_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
 
     std::string js_source;
@@ -24,6 +24,23 @@ ql::datum_t get_data(const rdb_value_t *value, buf_parent_t parent) {
     return data;
 }
 
+std::string get_serialized_data(const rdb_value_t *value, buf_parent_t parent) {
+    rdb_blob_wrapper_t blob(parent.cache()->max_block_size(),
+                            const_cast<rdb_value_t *>(value)->value_ref(),
+                            blob::btree_maxreflen);
+
+    blob_acq_t acq_group;
+    buffer_group_t buffer_group;
+    blob.expose_all(parent, access_t::read, &buffer_group, &acq_group);
+    std::string data;
+    data.reserve(buffer_group.get_size());
+    for (size_t i = 0; i < buffer_group.num_buffers(); ++i) {
+        buffer_group_t::buffer_t buffer = buffer_group.get_buffer(i);
+        data.append(static_cast<const char *>(buffer.data), buffer.size);
+    }
+    return data;
+}
+
 const ql::datum_t &lazy_json_t::get() const {
     guarantee(pointee.has());
     if (!pointee->ptr.has()) {
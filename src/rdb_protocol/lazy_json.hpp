@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_LAZY_JSON_HPP_
 #define RDB_PROTOCOL_LAZY_JSON_HPP_
 
+#include <string>
+
 #include "buffer_cache/alt/alt.hpp"
 #include "buffer_cache/alt/blob.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -30,6 +32,10 @@ public:
 ql::datum_t get_data(const rdb_value_t *value,
                                       buf_parent_t parent);
 
+// Returns the serialized datum that `value` refers to, without deserializing it.
+// `store_serialized_data()` in `btree.cc` writes it back into a btree.
+std::string get_serialized_data(const rdb_value_t *value, buf_parent_t parent);
+
 class lazy_json_pointee_t : public single_threaded_countable_t<lazy_json_pointee_t> {
     lazy_json_pointee_t(const rdb_value_t *_rdb_value, buf_parent_t _parent)
         : rdb_value(_rdb_value), parent(_parent) {
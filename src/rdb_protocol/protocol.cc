@@ -104,6 +104,9 @@ key_range_t datum_range_t::to_sindex_keyrange() const {
 
 RDB_IMPL_SERIALIZABLE_3_SINCE_v1_13(backfill_atom_t, key, value, recency);
 
+RDB_IMPL_SERIALIZABLE_3(backfill_raw_atom_t, key, value, recency);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_raw_atom_t);
+
 namespace rdb_protocol {
 
 void post_construct_and_drain_queue(
@@ -385,12 +388,53 @@ store_key_t sindex_list_region_key() {
     return store_key_t();
 }
 
+// The smallest hash region containing all of `keys`.
+region_t region_from_keys(const std::vector<store_key_t> &keys) {
+    // It shouldn't be empty, but we let the places that would break use a
+    // guarantee.
+    rassert(!keys.empty());
+    if (keys.empty()) {
+        return hash_region_t<key_range_t>();
+    }
+
+    store_key_t min_key = store_key_t::max();
+    store_key_t max_key = store_key_t::min();
+    uint64_t min_hash_value = HASH_REGION_HASH_SIZE - 1;
+    uint64_t max_hash_value = 0;
+
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+        const store_key_t &key = *it;
+        if (key < min_key) {
+            min_key = key;
+        }
+        if (key > max_key) {
+            max_key = key;
+        }
+
+        const uint64_t hash_value = hash_region_hasher(key.contents(), key.size());
+        if (hash_value < min_hash_value) {
+            min_hash_value = hash_value;
+        }
+        if (hash_value > max_hash_value) {
+            max_hash_value = hash_value;
+        }
+    }
+
+    return hash_region_t<key_range_t>(
+        min_hash_value, max_hash_value + 1,
+        key_range_t(key_range_t::closed, min_key, key_range_t::closed, max_key));
+}
+
 /* read_t::get_region implementation */
 struct rdb_r_get_region_visitor : public boost::static_visitor<region_t> {
     region_t operator()(const point_read_t &pr) const {
         return rdb_protocol::monokey_region(pr.key);
     }
 
+    region_t operator()(const batched_point_read_t &bpr) const {
+        return region_from_keys(bpr.keys);
+    }
+
     region_t operator()(const rget_read_t &rg) const {
         return rg.region;
     }
@@ -452,6 +496,21 @@ struct rdb_r_shard_visitor_t : public boost::static_visitor<bool> {
         return keyed_read(pr, pr.key);
     }
 
+    bool operator()(const batched_point_read_t &bpr) const {
+        std::vector<store_key_t> shard_keys;
+        for (auto it = bpr.keys.begin(); it != bpr.keys.end(); ++it) {
+            if (region_contains_key(*region, *it)) {
+                shard_keys.push_back(*it);
+            }
+        }
+        if (!shard_keys.empty()) {
+            *payload_out = batched_point_read_t(std::move(shard_keys));
+            return true;
+        } else {
+            return false;
+        }
+    }
+
     template <class T>
     bool rangey_read(const T &arg) const {
         const hash_region_t<key_range_t> intersection
@@ -563,6 +622,7 @@ public:
           ctx(_ctx), interruptor(_interruptor) { }
 
     void operator()(const point_read_t &);
+    void operator()(const batched_point_read_t &);
 
     void operator()(const rget_read_t &rg);
     void operator()(const intersecting_geo_read_t &gr);
@@ -592,6 +652,8 @@ void rdb_r_unshard_visitor_t::operator()(const changefeed_subscribe_t &) {
         for (auto it = res->addrs.begin(); it != res->addrs.end(); ++it) {
             out->addrs.insert(std::move(*it));
         }
+        out->remove_filter_addrs.insert(res->remove_filter_addrs.begin(),
+                                        res->remove_filter_addrs.end());
         for (auto it = res->server_uuids.begin();
              it != res->server_uuids.end(); ++it) {
             out->server_uuids.insert(std::move(*it));
@@ -627,6 +689,19 @@ void rdb_r_unshard_visitor_t::operator()(const point_read_t &) {
     *response_out = responses[0];
 }
 
+void rdb_r_unshard_visitor_t::operator()(const batched_point_read_t &) {
+    response_out->response = batched_point_read_response_t();
+    auto out = boost::get<batched_point_read_response_t>(&response_out->response);
+    for (size_t i = 0; i < count; ++i) {
+        auto res = boost::get<batched_point_read_response_t>(&responses[i].response);
+        guarantee(res != NULL);
+        // The shards own disjoint sets of keys, so there is nothing to merge.
+        for (auto it = res->rows.begin(); it != res->rows.end(); ++it) {
+            out->rows.insert(std::move(*it));
+        }
+    }
+}
+
 void rdb_r_unshard_visitor_t::operator()(const intersecting_geo_read_t &) {
     ql::datum_array_builder_t combined_results(ql::configured_limits_t::unlimited);
     for (size_t i = 0; i < count; ++i) {
@@ -865,44 +940,6 @@ void read_t::unshard(read_response_t *responses, size_t count,
 
 /* write_t::get_region() implementation */
 
-// TODO: This entire type is suspect, given the performance for
-// batched_replaces_t.  Is it used in anything other than assertions?
-region_t region_from_keys(const std::vector<store_key_t> &keys) {
-    // It shouldn't be empty, but we let the places that would break use a
-    // guarantee.
-    rassert(!keys.empty());
-    if (keys.empty()) {
-        return hash_region_t<key_range_t>();
-    }
-
-    store_key_t min_key = store_key_t::max();
-    store_key_t max_key = store_key_t::min();
-    uint64_t min_hash_value = HASH_REGION_HASH_SIZE - 1;
-    uint64_t max_hash_value = 0;
-
-    for (auto it = keys.begin(); it != keys.end(); ++it) {
-        const store_key_t &key = *it;
-        if (key < min_key) {
-            min_key = key;
-        }
-        if (key > max_key) {
-            max_key = key;
-        }
-
-        const uint64_t hash_value = hash_region_hasher(key.contents(), key.size());
-        if (hash_value < min_hash_value) {
-            min_hash_value = hash_value;
-        }
-        if (hash_value > max_hash_value) {
-            max_hash_value = hash_value;
-        }
-    }
-
-    return hash_region_t<key_range_t>(
-        min_hash_value, max_hash_value + 1,
-        key_range_t(key_range_t::closed, min_key, key_range_t::closed, max_key));
-}
-
 struct rdb_w_get_region_visitor : public boost::static_visitor<region_t> {
     region_t operator()(const batched_replace_t &br) const {
         return region_from_keys(br.keys);
@@ -1168,6 +1205,8 @@ INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(rdb_protocol::single_sindex_status_t);
 
 RDB_IMPL_SERIALIZABLE_1(point_read_response_t, data);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(point_read_response_t);
+RDB_IMPL_SERIALIZABLE_1(batched_point_read_response_t, rows);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(batched_point_read_response_t);
 RDB_IMPL_SERIALIZABLE_4(rget_read_response_t, result, key_range, truncated, last_key);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(rget_read_response_t);
 RDB_IMPL_SERIALIZABLE_1(intersecting_geo_read_response_t, results_or_error);
@@ -1180,7 +1219,8 @@ RDB_IMPL_SERIALIZABLE_1(sindex_list_response_t, sindexes);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(sindex_list_response_t);
 RDB_IMPL_SERIALIZABLE_1(sindex_status_response_t, statuses);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(sindex_status_response_t);
-RDB_IMPL_SERIALIZABLE_2(changefeed_subscribe_response_t, server_uuids, addrs);
+RDB_IMPL_SERIALIZABLE_3(changefeed_subscribe_response_t,
+                        server_uuids, addrs, remove_filter_addrs);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(changefeed_subscribe_response_t);
 RDB_IMPL_SERIALIZABLE_1(changefeed_stamp_response_t, stamps);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(changefeed_stamp_response_t);
@@ -1191,6 +1231,8 @@ INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(read_response_t);
 
 RDB_IMPL_SERIALIZABLE_1(point_read_t, key);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(point_read_t);
+RDB_IMPL_SERIALIZABLE_1(batched_point_read_t, keys);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(batched_point_read_t);
 RDB_IMPL_SERIALIZABLE_3(sindex_rangespec_t, id, region, original_range);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(sindex_rangespec_t);
 
@@ -1223,9 +1265,9 @@ INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(sindex_status_t);
 RDB_IMPL_SERIALIZABLE_2(changefeed_subscribe_t, addr, region);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(changefeed_subscribe_t);
 
-RDB_IMPL_SERIALIZABLE_2(changefeed_stamp_t, addr, region);
+RDB_IMPL_SERIALIZABLE_3(changefeed_stamp_t, addr, region, filter);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(changefeed_stamp_t);
-RDB_IMPL_SERIALIZABLE_2(changefeed_point_stamp_t, addr, key);
+RDB_IMPL_SERIALIZABLE_3(changefeed_point_stamp_t, addr, key, filter);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(changefeed_point_stamp_t);
 
 RDB_IMPL_SERIALIZABLE_2(read_t, read, profile);
@@ -1259,7 +1301,7 @@ INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(batched_insert_t);
 
 RDB_IMPL_SERIALIZABLE_3_SINCE_v1_13(point_write_t, key, data, overwrite);
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_13(point_delete_t, key);
-RDB_IMPL_SERIALIZABLE_5(sindex_create_t, id, mapping, region, multi, geo);
+RDB_IMPL_SERIALIZABLE_6(sindex_create_t, id, mapping, region, multi, geo, cover);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(sindex_create_t);
 RDB_IMPL_SERIALIZABLE_2_SINCE_v1_13(sindex_drop_t, id, region);
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_13(sync_t, region);
@@ -1286,5 +1328,16 @@ INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::key_value_pairs_t);
 RDB_IMPL_SERIALIZABLE_1(backfill_chunk_t::sindexes_t, sindexes);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::sindexes_t);
 
+RDB_IMPL_SERIALIZABLE_3(backfill_chunk_t::leaf_image_t,
+                        range, shipped_sindexes, atoms);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::leaf_image_t);
+
+RDB_IMPL_SERIALIZABLE_3(backfill_chunk_t::sindex_key_value_pairs_t,
+                        sindex, opaque_definition, atoms);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::sindex_key_value_pairs_t);
+
+RDB_IMPL_SERIALIZABLE_1(backfill_chunk_t::checkpoint_t, region);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::checkpoint_t);
+
 RDB_IMPL_SERIALIZABLE_1(backfill_chunk_t, val);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t);
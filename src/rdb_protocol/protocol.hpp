@@ -158,6 +158,26 @@ struct backfill_atom_t {
 
 RDB_DECLARE_SERIALIZABLE(backfill_atom_t);
 
+/* A `backfill_raw_atom_t` is like a `backfill_atom_t`, but its value is the datum
+as `datum_serialize()` wrote it to disk, so neither end of the backfill has to
+deserialize or reserialize it. */
+struct backfill_raw_atom_t {
+    store_key_t key;
+    std::string value;
+    repli_timestamp_t recency;
+
+    backfill_raw_atom_t() { }
+    backfill_raw_atom_t(const store_key_t &_key,
+                        std::string &&_value,
+                        const repli_timestamp_t &_recency) :
+        key(_key),
+        value(std::move(_value)),
+        recency(_recency)
+    { }
+};
+
+RDB_DECLARE_SERIALIZABLE(backfill_raw_atom_t);
+
 enum class sindex_multi_bool_t { SINGLE = 0, MULTI = 1};
 enum class sindex_geo_bool_t { REGULAR = 0, GEO = 1};
 
@@ -204,6 +224,14 @@ struct point_read_response_t {
 
 RDB_DECLARE_SERIALIZABLE(point_read_response_t);
 
+struct batched_point_read_response_t {
+    // Only the keys that exist are in here.
+    std::map<store_key_t, ql::datum_t> rows;
+    batched_point_read_response_t() { }
+};
+
+RDB_DECLARE_SERIALIZABLE(batched_point_read_response_t);
+
 struct rget_read_response_t {
     key_range_t key_range;
     ql::result_t result;
@@ -281,6 +309,7 @@ struct changefeed_subscribe_response_t {
     changefeed_subscribe_response_t() { }
     std::set<uuid_u> server_uuids;
     std::set<ql::changefeed::server_t::addr_t> addrs;
+    std::set<ql::changefeed::remove_filter_addr_t> remove_filter_addrs;
 };
 
 RDB_DECLARE_SERIALIZABLE(changefeed_subscribe_response_t);
@@ -315,7 +344,8 @@ struct read_response_t {
                            changefeed_point_stamp_response_t,
                            distribution_read_response_t,
                            sindex_list_response_t,
-                           sindex_status_response_t> variant_t;
+                           sindex_status_response_t,
+                           batched_point_read_response_t> variant_t;
     variant_t response;
     profile::event_log_t event_log;
     size_t n_shards;
@@ -337,6 +367,21 @@ public:
 
 RDB_DECLARE_SERIALIZABLE(point_read_t);
 
+/* Reads several rows by primary key in one go.  It shards like `batched_replace_t`:
+each shard gets only the keys it owns. */
+class batched_point_read_t {
+public:
+    batched_point_read_t() { }
+    explicit batched_point_read_t(std::vector<store_key_t> &&_keys)
+        : keys(std::move(_keys)) {
+        r_sanity_check(keys.size() != 0);
+    }
+
+    std::vector<store_key_t> keys;
+};
+
+RDB_DECLARE_SERIALIZABLE(batched_point_read_t);
+
 struct sindex_rangespec_t {
     sindex_rangespec_t() { }
     sindex_rangespec_t(const std::string &_id,
@@ -495,10 +540,14 @@ RDB_DECLARE_SERIALIZABLE(changefeed_subscribe_t);
 class changefeed_stamp_t {
 public:
     changefeed_stamp_t() : region(region_t::universe()) { }
-    explicit changefeed_stamp_t(ql::changefeed::client_t::addr_t _addr)
-        : addr(std::move(_addr)), region(region_t::universe()) { }
+    changefeed_stamp_t(ql::changefeed::client_t::addr_t _addr,
+                       ql::changefeed::filter_t _filter)
+        : addr(std::move(_addr)), region(region_t::universe()),
+          filter(std::move(_filter)) { }
     ql::changefeed::client_t::addr_t addr;
     region_t region;
+    // Registered with the servers before they read the stamp.
+    ql::changefeed::filter_t filter;
 };
 RDB_DECLARE_SERIALIZABLE(changefeed_stamp_t);
 
@@ -506,11 +555,14 @@ RDB_DECLARE_SERIALIZABLE(changefeed_stamp_t);
 class changefeed_point_stamp_t {
 public:
     changefeed_point_stamp_t() { }
-    explicit changefeed_point_stamp_t(ql::changefeed::client_t::addr_t _addr,
-                                      store_key_t &&_key)
-        : addr(std::move(_addr)), key(std::move(_key)) { }
+    changefeed_point_stamp_t(ql::changefeed::client_t::addr_t _addr,
+                             store_key_t &&_key,
+                             ql::changefeed::filter_t _filter)
+        : addr(std::move(_addr)), key(std::move(_key)),
+          filter(std::move(_filter)) { }
     ql::changefeed::client_t::addr_t addr;
     store_key_t key;
+    ql::changefeed::filter_t filter;
 };
 
 struct read_t {
@@ -523,7 +575,8 @@ struct read_t {
                            changefeed_point_stamp_t,
                            distribution_read_t,
                            sindex_list_t,
-                           sindex_status_t> variant_t;
+                           sindex_status_t,
+                           batched_point_read_t> variant_t;
     variant_t read;
     profile_bool_t profile;
 
@@ -713,9 +766,11 @@ class sindex_create_t {
 public:
     sindex_create_t() { }
     sindex_create_t(const std::string &_id, const ql::map_wire_func_t &_mapping,
-                    sindex_multi_bool_t _multi, sindex_geo_bool_t _geo)
+                    sindex_multi_bool_t _multi, sindex_geo_bool_t _geo,
+                    const boost::optional<std::vector<std::string> > &_cover
+                        = boost::none)
         : id(_id), mapping(_mapping), region(region_t::universe()),
-          multi(_multi), geo(_geo)
+          multi(_multi), geo(_geo), cover(_cover)
     { }
 
     std::string id;
@@ -723,6 +778,8 @@ public:
     region_t region;
     sindex_multi_bool_t multi;
     sindex_geo_bool_t geo;
+    // See `sindex_disk_info_t::cover`.
+    boost::optional<std::vector<std::string> > cover;
 };
 
 RDB_DECLARE_SERIALIZABLE(sindex_create_t);
@@ -843,6 +900,40 @@ struct backfill_chunk_t {
         explicit key_value_pairs_t(std::vector<backfill_atom_t> &&_backfill_atoms)
             : backfill_atoms(std::move(_backfill_atoms)) { }
     };
+    /* The complete contents of `range`, sorted by key.  The backfillee replaces
+    whatever it has in `range` with them, so this stands for a `delete_range_t`
+    followed by a `key_value_pairs_t`.  `shipped_sindexes` maps the names of indexes
+    to their `opaque_definition`s.  The entries of the documents in those indexes
+    follow in `sindex_key_value_pairs_t` chunks, so the backfillee doesn't compute
+    them for its indexes with the same definitions. */
+    struct leaf_image_t {
+        region_t range;
+        std::map<std::string, std::vector<char> > shipped_sindexes;
+        std::vector<backfill_raw_atom_t> atoms;
+
+        leaf_image_t() { }
+        leaf_image_t(const region_t &_range,
+                     const std::map<std::string, std::vector<char> >
+                         &_shipped_sindexes,
+                     std::vector<backfill_raw_atom_t> &&_atoms)
+            : range(_range), shipped_sindexes(_shipped_sindexes),
+              atoms(std::move(_atoms)) { }
+    };
+    /* Entries of the secondary index `sindex`, sorted by key.  An empty value
+    stands for the document with the entry's primary key.  The backfillee only
+    uses them if its index has the same `opaque_definition`. */
+    struct sindex_key_value_pairs_t {
+        std::string sindex;
+        std::vector<char> opaque_definition;
+        std::vector<backfill_raw_atom_t> atoms;
+
+        sindex_key_value_pairs_t() { }
+        sindex_key_value_pairs_t(const std::string &_sindex,
+                                 const std::vector<char> &_opaque_definition,
+                                 std::vector<backfill_raw_atom_t> &&_atoms)
+            : sindex(_sindex), opaque_definition(_opaque_definition),
+              atoms(std::move(_atoms)) { }
+    };
     struct sindexes_t {
         std::map<std::string, secondary_index_t> sindexes;
 
@@ -850,8 +941,20 @@ struct backfill_chunk_t {
         explicit sindexes_t(const std::map<std::string, secondary_index_t> &_sindexes)
             : sindexes(_sindexes) { }
     };
+    /* Everything the backfill has to send for `region` came before this chunk.  The
+    backfillee records in its metainfo that `region` has reached the end point, so if
+    the backfill is interrupted, the next one starts from there.  It never reaches
+    `store_t::receive_backfill()`. */
+    struct checkpoint_t {
+        region_t region;
+
+        checkpoint_t() { }
+        explicit checkpoint_t(const region_t &_region) : region(_region) { }
+    };
 
-    typedef boost::variant<delete_range_t, delete_key_t, key_value_pairs_t, sindexes_t> value_t;
+    typedef boost::variant<delete_range_t, delete_key_t, key_value_pairs_t, sindexes_t,
+                           leaf_image_t, sindex_key_value_pairs_t,
+                           checkpoint_t> value_t;
 
     backfill_chunk_t() { }
     explicit backfill_chunk_t(const value_t &_val) : val(_val) { }
@@ -866,10 +969,27 @@ struct backfill_chunk_t {
     static backfill_chunk_t set_keys(std::vector<backfill_atom_t> &&keys) {
         return backfill_chunk_t(key_value_pairs_t(std::move(keys)));
     }
+    static backfill_chunk_t leaf_image(
+            const region_t &range,
+            const std::map<std::string, std::vector<char> > &shipped_sindexes,
+            std::vector<backfill_raw_atom_t> &&atoms) {
+        return backfill_chunk_t(
+            leaf_image_t(range, shipped_sindexes, std::move(atoms)));
+    }
+    static backfill_chunk_t sindex_key_values(
+            const std::string &sindex,
+            const std::vector<char> &opaque_definition,
+            std::vector<backfill_raw_atom_t> &&atoms) {
+        return backfill_chunk_t(
+            sindex_key_value_pairs_t(sindex, opaque_definition, std::move(atoms)));
+    }
 
     static backfill_chunk_t sindexes(const std::map<std::string, secondary_index_t> &sindexes) {
         return backfill_chunk_t(sindexes_t(sindexes));
     }
+    static backfill_chunk_t checkpoint(const region_t &region) {
+        return backfill_chunk_t(checkpoint_t(region));
+    }
 
     /* This is for `store_t`; it's not part of the ICL protocol API. */
     repli_timestamp_t get_btree_repli_timestamp() const THROWS_NOTHING;
@@ -879,6 +999,9 @@ RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::delete_key_t);
 RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::delete_range_t);
 RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::key_value_pairs_t);
 RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::sindexes_t);
+RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::leaf_image_t);
+RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::sindex_key_value_pairs_t);
+RDB_DECLARE_SERIALIZABLE(backfill_chunk_t::checkpoint_t);
 RDB_DECLARE_SERIALIZABLE(backfill_chunk_t);
 
 
@@ -0,0 +1,137 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_cache.hpp"
+
+#include <map>
+
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/term.hpp"
+
+namespace ql {
+
+// Whether the literals in the subtree of `t`'s argument `arg` (or, if `arg` is -1,
+// in the subtrees of its optargs) can be parameters.
+bool literals_can_be_params(const Term &t, int arg) {
+    switch (t.type()) {
+    // Function bodies get their own `compile_env_t` (and may be compiled to
+    // `bytecode_t`, which keeps the constants), and the compiler checks variable
+    // numbers.
+    case Term::FUNC: // fallthru
+    case Term::VAR: // fallthru
+    // These compile a rewritten copy of their arguments (see `rewrites.cc`).
+    case Term::INNER_JOIN: // fallthru
+    case Term::OUTER_JOIN: // fallthru
+    case Term::DELETE: // fallthru
+    case Term::UPDATE: // fallthru
+    case Term::SKIP: // fallthru
+    case Term::DIFFERENCE: // fallthru
+    case Term::WITH_FIELDS: return false;
+    // These copy all but their first argument into a function (see
+    // `obj_or_seq_op_impl_t` and `eq_join_term_t`).
+    case Term::PLUCK: // fallthru
+    case Term::WITHOUT: // fallthru
+    case Term::MERGE: // fallthru
+    case Term::HAS_FIELDS: // fallthru
+    case Term::GET_FIELD: // fallthru
+    case Term::EQ_JOIN: return arg == 0;
+    // `filter` copies its `default` optarg.
+    case Term::FILTER: return arg != -1;
+    default: return true;
+    }
+}
+
+void append_int(int32_t i, std::string *key_out) {
+    key_out->append(reinterpret_cast<const char *>(&i), sizeof(i));
+}
+
+void append_str(const std::string &s, std::string *key_out) {
+    append_int(s.size(), key_out);
+    key_out->append(s);
+}
+
+// Appends the shape of `t` to `*key_out`, and the literals in it that are
+// parameters to `*params_out`.
+void append_shape(const Term &t, bool can_be_param, std::string *key_out,
+                  std::vector<const Term *> *params_out) {
+    append_int(t.type(), key_out);
+    if (t.type() == Term::DATUM) {
+        if (can_be_param) {
+            key_out->push_back('?');
+            params_out->push_back(&t);
+        } else {
+            key_out->push_back('=');
+            append_str(t.datum().SerializeAsString(), key_out);
+        }
+    }
+    append_int(t.args_size(), key_out);
+    for (int i = 0; i < t.args_size(); ++i) {
+        append_shape(t.args(i), can_be_param && literals_can_be_params(t, i),
+                     key_out, params_out);
+    }
+    append_int(t.optargs_size(), key_out);
+    for (int i = 0; i < t.optargs_size(); ++i) {
+        append_str(t.optargs(i).key(), key_out);
+        append_shape(t.optargs(i).val(), can_be_param && literals_can_be_params(t, -1),
+                     key_out, params_out);
+    }
+}
+
+query_cache_t::query_cache_t(size_t _max_entries)
+    : max_entries(_max_entries) {
+    guarantee(max_entries > 0);
+}
+
+query_cache_t::~query_cache_t() { }
+
+counted_t<const term_t> query_cache_t::compile(const protob_t<const Term> &t,
+                                               std::vector<datum_t> *params_out,
+                                               bool *hit_out) {
+    // These are mostly large inserts, which would pin their documents, and they
+    // hardly ever repeat a shape anyway, because it includes the number of rows.
+    if (static_cast<size_t>(t->ByteSize()) > MAX_QUERY_SIZE) {
+        params_out->clear();
+        *hit_out = false;
+        compile_env_t compile_env((var_visibility_t()));
+        return compile_term(&compile_env, t);
+    }
+
+    std::string key;
+    std::vector<const Term *> params;
+    append_shape(*t, true, &key, &params);
+
+    // HACK: per @srh, use unlimited array size at compile time (as `compile_term`
+    // does for the literals it compiles).
+    params_out->clear();
+    params_out->reserve(params.size());
+    for (auto it = params.begin(); it != params.end(); ++it) {
+        params_out->push_back(to_datum(&(*it)->datum(),
+                                       configured_limits_t::unlimited));
+    }
+
+    auto entry_it = entries.find(key);
+    if (entry_it != entries.end()) {
+        lru.splice(lru.begin(), lru, entry_it->second.lru_it);
+        *hit_out = true;
+        return entry_it->second.root;
+    }
+
+    std::map<const Term *, size_t> param_indexes;
+    for (size_t i = 0; i < params.size(); ++i) {
+        param_indexes[params[i]] = i;
+    }
+    compile_env_t compile_env((var_visibility_t()), &param_indexes);
+    counted_t<const term_t> root = compile_term(&compile_env, t);
+
+    if (entries.size() == max_entries) {
+        entries.erase(*lru.back());
+        lru.pop_back();
+    }
+    entry_it = entries.insert(std::make_pair(std::move(key), entry_t())).first;
+    entry_it->second.root = root;
+    lru.push_front(&entry_it->first);
+    entry_it->second.lru_it = lru.begin();
+
+    *hit_out = false;
+    return root;
+}
+
+}  // namespace ql
@@ -0,0 +1,67 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_CACHE_HPP_
+#define RDB_PROTOCOL_QUERY_CACHE_HPP_
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config/args.hpp"
+#include "containers/counted.hpp"
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/datum.hpp"
+
+namespace ql {
+
+class term_t;
+
+/* `query_cache_t` keeps the compiled `term_t` trees of a connection's recent
+queries, so that a query with the same shape as an earlier one isn't compiled
+again.
+
+Two queries have the same shape if they only differ in the values of their
+literals (`DATUM` terms).  Most literals are compiled as parameters, which read
+their values from the `env_t` (see `env_t::set_query_params`) when the query runs.
+The literals that compilation looks at or copies are part of the shape instead:
+those in function bodies, variable numbers, and the arguments of the terms that
+compile a rewritten copy of their arguments (see `query_cache.cc`). */
+class query_cache_t {
+public:
+    static const size_t DEFAULT_MAX_ENTRIES = 128;
+    // Larger queries aren't cached, because the cached tree keeps the query's
+    // protobuf alive.
+    static const size_t MAX_QUERY_SIZE = 64 * KILOBYTE;
+
+    explicit query_cache_t(size_t _max_entries = DEFAULT_MAX_ENTRIES);
+    ~query_cache_t();
+
+    // Returns the compiled form of `t`, which must have been preprocessed (see
+    // `preprocess_term`), and sets `*params_out` to the values of its parameters.
+    // Sets `*hit_out` to whether it was found in the cache.  Throws whatever
+    // `compile_term` throws.  Queries above `MAX_QUERY_SIZE` bytes are compiled
+    // without the cache.
+    counted_t<const term_t> compile(const protob_t<const Term> &t,
+                                    std::vector<datum_t> *params_out,
+                                    bool *hit_out);
+
+    size_t size() const { return entries.size(); }
+
+private:
+    struct entry_t {
+        counted_t<const term_t> root;
+        // Where the entry's key is in `lru`.
+        std::list<const std::string *>::iterator lru_it;
+    };
+
+    const size_t max_entries;
+    std::unordered_map<std::string, entry_t> entries;
+    // The keys of `entries`, most recently used first.
+    std::list<const std::string *> lru;
+
+    DISABLE_COPYING(query_cache_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_CACHE_HPP_
@@ -6,6 +6,7 @@
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/profile.hpp"
+#include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rpc/semilattice/view/field.hpp"
 
@@ -33,6 +34,7 @@ namespace ql {
              rdb_context_t *ctx,
              signal_t *interruptor,
              stream_cache_t *stream_cache,
+             query_cache_t *query_cache,
              Response *response_out);
 }
 
@@ -68,6 +70,7 @@ bool rdb_query_server_t::run_query(const ql::protob_t<Query> &query,
                 rdb_ctx,
                 client_ctx->interruptor,
                 &client_ctx->stream_cache,
+                &client_ctx->query_cache,
                 response_out);
     } catch (const ql::exc_t &e) {
         fill_error(response_out, Response::COMPILE_ERROR, e.what(), e.backtrace());
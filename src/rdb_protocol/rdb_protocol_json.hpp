@@ -42,4 +42,25 @@ private:
     reql_version_t reql_version_;
 };
 
+// For unordered containers of optional data.  Equality doesn't depend on the
+// reql_version (see `datum_t::operator==`), so neither of these takes one.
+class optional_datum_hash_t {
+public:
+    size_t operator()(const ql::datum_t &d) const {
+        return d.has() ? d.hash() : 0;
+    }
+};
+
+class optional_datum_equal_t {
+public:
+    bool operator()(const ql::datum_t &a,
+                    const ql::datum_t &b) const {
+        if (a.has()) {
+            return b.has() && *a == *b;
+        } else {
+            return !b.has();
+        }
+    }
+};
+
 #endif /* RDB_PROTOCOL_RDB_PROTOCOL_JSON_HPP_ */
@@ -77,6 +77,31 @@ ql::datum_t real_table_t::read_row(ql::env_t *env,
     return p_res->data;
 }
 
+std::vector<ql::datum_t> real_table_t::read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, bool use_outdated) {
+    std::vector<store_key_t> keys;
+    keys.reserve(pvals.size());
+    for (auto it = pvals.begin(); it != pvals.end(); ++it) {
+        keys.push_back(store_key_t((*it)->print_primary()));
+    }
+    std::vector<ql::datum_t> rows;
+    if (keys.empty()) {
+        return rows;
+    }
+    read_t read(batched_point_read_t(std::vector<store_key_t>(keys)), env->profile());
+    read_response_t res;
+    read_with_profile(env, read, &res, use_outdated);
+    batched_point_read_response_t *p_res
+        = boost::get<batched_point_read_response_t>(&res.response);
+    r_sanity_check(p_res);
+    rows.reserve(keys.size());
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+        auto row = p_res->rows.find(*it);
+        rows.push_back(row == p_res->rows.end() ? ql::datum_t::null() : row->second);
+    }
+    return rows;
+}
+
 counted_t<ql::datum_stream_t> real_table_t::read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -107,13 +132,15 @@ counted_t<ql::datum_stream_t> real_table_t::read_row_changes(
         const ql::protob_t<const Backtrace> &bt,
         const std::string &table_name) {
     return changefeed_client->new_feed(env, uuid, bt, table_name, pkey,
-        ql::changefeed::keyspec_t(ql::changefeed::keyspec_t::point_t(std::move(pval))));
+        ql::changefeed::keyspec_t(ql::changefeed::keyspec_t::point_t(std::move(pval))),
+        false);
 }
 
 counted_t<ql::datum_stream_t> real_table_t::read_all_changes(ql::env_t *env,
-        const ql::protob_t<const Backtrace> &bt, const std::string &table_name) {
+        bool squash, const ql::protob_t<const Backtrace> &bt,
+        const std::string &table_name) {
     return changefeed_client->new_feed(env, uuid, bt, table_name, pkey,
-        ql::changefeed::keyspec_t(ql::changefeed::keyspec_t::all_t()));
+        ql::changefeed::keyspec_t(ql::changefeed::keyspec_t::all_t()), squash);
 }
 
 counted_t<ql::datum_stream_t> real_table_t::read_intersecting(
@@ -257,9 +284,10 @@ bool real_table_t::write_sync_depending_on_durability(ql::env_t *env,
 
 bool real_table_t::sindex_create(ql::env_t *env, const std::string &id,
         counted_t<const ql::func_t> index_func, sindex_multi_bool_t multi,
-        sindex_geo_bool_t geo) {
+        sindex_geo_bool_t geo,
+        const boost::optional<std::vector<std::string> > &cover) {
     ql::map_wire_func_t wire_func(index_func);
-    write_t write(sindex_create_t(id, wire_func, multi, geo), env->profile(),
+    write_t write(sindex_create_t(id, wire_func, multi, geo, cover), env->profile(),
                   env->limits());
     write_response_t res;
     write_with_profile(env, &write, &res);
@@ -65,6 +65,8 @@ public:
 
     ql::datum_t read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated);
+    std::vector<ql::datum_t> read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, bool use_outdated);
     counted_t<ql::datum_stream_t> read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -80,6 +82,7 @@ public:
         const std::string &table_name);
     counted_t<ql::datum_stream_t> read_all_changes(
         ql::env_t *env,
+        bool squash,
         const ql::protob_t<const Backtrace> &bt,
         const std::string &table_name);
     counted_t<ql::datum_stream_t> read_intersecting(
@@ -117,7 +120,8 @@ public:
         const std::string &id,
         counted_t<const ql::func_t> index_func,
         sindex_multi_bool_t multi,
-        sindex_geo_bool_t geo);
+        sindex_geo_bool_t geo,
+        const boost::optional<std::vector<std::string> > &cover);
     bool sindex_drop(ql::env_t *env,
         const std::string &id);
     sindex_rename_result_t sindex_rename(ql::env_t *env,
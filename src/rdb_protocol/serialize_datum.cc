@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/archive/versioned.hpp"
 #include "containers/counted.hpp"
@@ -26,11 +27,13 @@ enum class datum_serialized_type_t {
     INT_NEGATIVE = 7,
     INT_POSITIVE = 8,
     R_BINARY = 9,
+    BUF_R_ARRAY = 10,
+    BUF_R_OBJECT = 11,
 };
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(datum_serialized_type_t, int8_t,
                                       datum_serialized_type_t::R_ARRAY,
-                                      datum_serialized_type_t::R_BINARY);
+                                      datum_serialized_type_t::BUF_R_OBJECT);
 
 serialization_result_t datum_serialize(write_message_t *wm,
                                        datum_serialized_type_t type) {
@@ -43,31 +46,16 @@ MUST_USE archive_result_t datum_deserialize(read_stream_t *s,
     return deserialize<cluster_version_t::LATEST_OVERALL>(s, type);
 }
 
+bool datum_serialized_type_is_array(char type_tag) {
+    const datum_serialized_type_t type = static_cast<datum_serialized_type_t>(type_tag);
+    return type == datum_serialized_type_t::R_ARRAY
+        || type == datum_serialized_type_t::BUF_R_ARRAY;
+}
+
 // This looks like it duplicates code of other deserialization functions.  It does.
 // Keeping this separate means that we don't have to worry about whether datum
 // serialization has changed from cluster version to cluster version.
 
-// Keep in sync with datum_serialize.
-size_t datum_serialized_size(const std::vector<datum_t> &v) {
-    size_t ret = varint_uint64_serialized_size(v.size());
-    for (auto it = v.begin(), e = v.end(); it != e; ++it) {
-        ret += datum_serialized_size(*it);
-    }
-    return ret;
-}
-
-
-// Keep in sync with datum_serialized_size.
-serialization_result_t datum_serialize(write_message_t *wm,
-                                       const std::vector<datum_t> &v) {
-    serialization_result_t res = serialization_result_t::SUCCESS;
-    serialize_varint_uint64(wm, v.size());
-    for (auto it = v.begin(), e = v.end(); it != e; ++it) {
-        res = res | datum_serialize(wm, *it);
-    }
-    return res;
-}
-
 MUST_USE archive_result_t
 datum_deserialize(read_stream_t *s, std::vector<datum_t> *v) {
     v->clear();
@@ -90,21 +78,147 @@ datum_deserialize(read_stream_t *s, std::vector<datum_t> *v) {
 }
 
 
-size_t datum_serialized_size(
+MUST_USE archive_result_t datum_deserialize(
+        read_stream_t *s,
+        std::vector<std::pair<datum_string_t, datum_t> > *m) {
+    m->clear();
+
+    uint64_t sz;
+    archive_result_t res = deserialize_varint_uint64(s, &sz);
+    if (bad(res)) { return res; }
+
+    if (sz > std::numeric_limits<size_t>::max()) {
+        return archive_result_t::RANGE_ERROR;
+    }
+
+    m->reserve(static_cast<size_t>(sz));
+
+    for (uint64_t i = 0; i < sz; ++i) {
+        std::pair<datum_string_t, datum_t> p;
+        res = datum_deserialize(s, &p.first);
+        if (bad(res)) { return res; }
+        res = datum_deserialize(s, &p.second);
+        if (bad(res)) { return res; }
+        m->push_back(std::move(p));
+    }
+
+    return archive_result_t::SUCCESS;
+}
+
+
+
+
+// BUF_R_ARRAY and BUF_R_OBJECT are serialized as a varint giving the size of the
+// body, followed by the body:
+//
+//   varint     the number of elements
+//   uint8_t    the width of each offset: 1, 2 or 4 bytes
+//   offsets    one little-endian offset per element, relative to the first element
+//   elements   the serialized elements.  An object element is its key (serialized
+//              like a datum_string_t) followed by its value.  Keys are sorted.
+//
+// The offset table lets `datum_t` read a single element or look up a key by binary
+// search straight from the buffer, without deserializing the rest.  The R_ARRAY and
+// R_OBJECT formats are still read, but no longer written.
+
+size_t offset_width(size_t elements_size) {
+    if (elements_size <= std::numeric_limits<uint8_t>::max()) {
+        return 1;
+    } else if (elements_size <= std::numeric_limits<uint16_t>::max()) {
+        return 2;
+    } else {
+        guarantee(elements_size <= std::numeric_limits<uint32_t>::max(),
+                  "Datum too large to serialize.");
+        return 4;
+    }
+}
+
+size_t buf_body_size(const std::vector<size_t> &element_sizes) {
+    size_t elements_size = 0;
+    for (size_t sz : element_sizes) {
+        elements_size += sz;
+    }
+    return varint_uint64_serialized_size(element_sizes.size())
+        + 1
+        + element_sizes.size() * offset_width(elements_size)
+        + elements_size;
+}
+
+size_t buf_serialized_size(const std::vector<size_t> &element_sizes) {
+    const size_t body_size = buf_body_size(element_sizes);
+    return varint_uint64_serialized_size(body_size) + body_size;
+}
+
+// Writes everything up to the first element.
+void serialize_buf_header(write_message_t *wm,
+                          const std::vector<size_t> &element_sizes) {
+    serialize_varint_uint64(wm, buf_body_size(element_sizes));
+    serialize_varint_uint64(wm, element_sizes.size());
+
+    size_t elements_size = 0;
+    for (size_t sz : element_sizes) {
+        elements_size += sz;
+    }
+    const uint8_t width = offset_width(elements_size);
+    wm->append(&width, 1);
+
+    size_t offset = 0;
+    for (size_t sz : element_sizes) {
+        uint8_t bytes[4];
+        for (size_t i = 0; i < width; ++i) {
+            bytes[i] = (offset >> (8 * i)) & 0xFF;
+        }
+        wm->append(bytes, width);
+        offset += sz;
+    }
+}
+
+std::vector<size_t> element_sizes(const std::vector<datum_t> &v) {
+    std::vector<size_t> ret;
+    ret.reserve(v.size());
+    for (auto it = v.begin(), e = v.end(); it != e; ++it) {
+        ret.push_back(datum_serialized_size(*it));
+    }
+    return ret;
+}
+
+std::vector<size_t> element_sizes(
         const std::vector<std::pair<datum_string_t, datum_t> > &m) {
-    size_t ret = varint_uint64_serialized_size(m.size());
+    std::vector<size_t> ret;
+    ret.reserve(m.size());
     for (auto it = m.begin(), e = m.end(); it != e; ++it) {
-        ret += datum_serialized_size(it->first);
-        ret += datum_serialized_size(it->second);
+        ret.push_back(datum_serialized_size(it->first)
+                      + datum_serialized_size(it->second));
     }
     return ret;
 }
 
+// Keep in sync with datum_serialize.
+size_t datum_serialized_size(const std::vector<datum_t> &v) {
+    return buf_serialized_size(element_sizes(v));
+}
+
+// Keep in sync with datum_serialized_size.
+serialization_result_t datum_serialize(write_message_t *wm,
+                                       const std::vector<datum_t> &v) {
+    serialization_result_t res = serialization_result_t::SUCCESS;
+    serialize_buf_header(wm, element_sizes(v));
+    for (auto it = v.begin(), e = v.end(); it != e; ++it) {
+        res = res | datum_serialize(wm, *it);
+    }
+    return res;
+}
+
+size_t datum_serialized_size(
+        const std::vector<std::pair<datum_string_t, datum_t> > &m) {
+    return buf_serialized_size(element_sizes(m));
+}
+
 serialization_result_t
 datum_serialize(write_message_t *wm,
                 const std::vector<std::pair<datum_string_t, datum_t> > &m) {
     serialization_result_t res = serialization_result_t::SUCCESS;
-    serialize_varint_uint64(wm, m.size());
+    serialize_buf_header(wm, element_sizes(m));
     for (auto it = m.begin(), e = m.end(); it != e; ++it) {
         res = res | datum_serialize(wm, it->first);
         res = res | datum_serialize(wm, it->second);
@@ -112,42 +226,158 @@ datum_serialize(write_message_t *wm,
     return res;
 }
 
-MUST_USE archive_result_t datum_deserialize(
-        read_stream_t *s,
-        std::vector<std::pair<datum_string_t, datum_t> > *m) {
-    m->clear();
+// A buffer-backed datum already holds its serialization (minus the type tag).
+size_t buf_ref_serialized_size(const shared_buf_ref_t<char> &buf) {
+    buffer_read_stream_t s(buf.get(), buf.get_safety_boundary());
+    uint64_t body_size;
+    guarantee_deserialization(deserialize_varint_uint64(&s, &body_size),
+                              "datum buffer size");
+    const size_t sz = varint_uint64_serialized_size(body_size) + body_size;
+    buf.guarantee_in_boundary(sz);
+    return sz;
+}
 
-    uint64_t sz;
-    archive_result_t res = deserialize_varint_uint64(s, &sz);
+void serialize_buf_ref(write_message_t *wm, const shared_buf_ref_t<char> &buf) {
+    wm->append(buf.get(), buf_ref_serialized_size(buf));
+}
+
+MUST_USE archive_result_t datum_deserialize_buf(read_stream_t *s,
+                                                shared_buf_ref_t<char> *out) {
+    uint64_t body_size;
+    archive_result_t res = deserialize_varint_uint64(s, &body_size);
     if (bad(res)) { return res; }
 
-    if (sz > std::numeric_limits<size_t>::max()) {
+    if (body_size > std::numeric_limits<size_t>::max()) {
         return archive_result_t::RANGE_ERROR;
     }
 
-    m->reserve(static_cast<size_t>(sz));
-
-    for (uint64_t i = 0; i < sz; ++i) {
-        std::pair<datum_string_t, datum_t> p;
-        res = datum_deserialize(s, &p.first);
-        if (bad(res)) { return res; }
-        res = datum_deserialize(s, &p.second);
-        if (bad(res)) { return res; }
-        m->push_back(std::move(p));
+    const size_t body_offset = varint_uint64_serialized_size(body_size);
+    counted_t<shared_buf_t> buf =
+        shared_buf_t::create(body_offset + static_cast<size_t>(body_size));
+    serialize_varint_uint64_into_buf(body_size,
+                                     reinterpret_cast<uint8_t *>(buf->data()));
+    int64_t num_read = force_read(s, buf->data() + body_offset, body_size);
+    if (num_read == -1) {
+        return archive_result_t::SOCK_ERROR;
+    }
+    if (static_cast<uint64_t>(num_read) < body_size) {
+        return archive_result_t::SOCK_EOF;
     }
 
+    *out = shared_buf_ref_t<char>(std::move(buf), 0);
     return archive_result_t::SUCCESS;
 }
 
+// The parsed header of a BUF_R_ARRAY or BUF_R_OBJECT.
+struct buf_header_t {
+    size_t num_elements;
+    size_t width;
+    // Where the offset table and the elements start, relative to the buf ref.
+    size_t offsets_begin;
+    size_t elements_begin;
+};
 
+buf_header_t parse_buf_header(const shared_buf_ref_t<char> &buf) {
+    buffer_read_stream_t s(buf.get(), buf.get_safety_boundary());
+    uint64_t body_size;
+    guarantee_deserialization(deserialize_varint_uint64(&s, &body_size),
+                              "datum buffer size");
+    uint64_t num_elements;
+    guarantee_deserialization(deserialize_varint_uint64(&s, &num_elements),
+                              "datum buffer element count");
+    uint8_t width;
+    guarantee(force_read(&s, &width, 1) == 1, "Corrupted datum buffer.");
+    guarantee(width == 1 || width == 2 || width == 4, "Corrupted datum buffer.");
+
+    buf_header_t ret;
+    ret.num_elements = num_elements;
+    ret.width = width;
+    ret.offsets_begin = s.tell();
+    ret.elements_begin = ret.offsets_begin + ret.num_elements * ret.width;
+    buf.guarantee_in_boundary(ret.elements_begin);
+    return ret;
+}
 
+// Returns the position of the `index`th element, relative to the buf ref.
+size_t buf_element_position(const shared_buf_ref_t<char> &buf, size_t index) {
+    const buf_header_t header = parse_buf_header(buf);
+    guarantee(index < header.num_elements);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(
+        buf.get() + header.offsets_begin + index * header.width);
+    size_t offset = 0;
+    for (size_t i = 0; i < header.width; ++i) {
+        offset |= static_cast<size_t>(bytes[i]) << (8 * i);
+    }
+    return header.elements_begin + offset;
+}
+
+datum_t datum_deserialize_from_buf(const shared_buf_ref_t<char> &buf) {
+    buf.guarantee_in_boundary(1);
+    switch (static_cast<datum_serialized_type_t>(*buf.get())) {
+    case datum_serialized_type_t::R_STR: {
+        return datum_t(datum_string_t(buf.make_child(1)));
+    }
+    case datum_serialized_type_t::R_BINARY: {
+        return datum_t::binary(datum_string_t(buf.make_child(1)));
+    }
+    case datum_serialized_type_t::BUF_R_ARRAY: {
+        return datum_t(datum_t::R_ARRAY, buf.make_child(1));
+    }
+    case datum_serialized_type_t::BUF_R_OBJECT: {
+        return datum_t(datum_t::R_OBJECT, buf.make_child(1));
+    }
+    case datum_serialized_type_t::R_ARRAY: // fallthru
+    case datum_serialized_type_t::R_BOOL: // fallthru
+    case datum_serialized_type_t::R_NULL: // fallthru
+    case datum_serialized_type_t::DOUBLE: // fallthru
+    case datum_serialized_type_t::R_OBJECT: // fallthru
+    case datum_serialized_type_t::INT_NEGATIVE: // fallthru
+    case datum_serialized_type_t::INT_POSITIVE: // fallthru
+    default: {
+        buffer_read_stream_t s(buf.get(), buf.get_safety_boundary());
+        datum_t ret;
+        guarantee_deserialization(datum_deserialize(&s, &ret), "datum in buffer");
+        return ret;
+    }
+    }
+}
+
+size_t datum_get_array_size(const shared_buf_ref_t<char> &array) {
+    return parse_buf_header(array).num_elements;
+}
+
+datum_t datum_get_array_element(const shared_buf_ref_t<char> &array, size_t index) {
+    return datum_deserialize_from_buf(
+        array.make_child(buf_element_position(array, index)));
+}
+
+size_t datum_get_obj_size(const shared_buf_ref_t<char> &object) {
+    return parse_buf_header(object).num_elements;
+}
+
+datum_string_t datum_get_obj_key(const shared_buf_ref_t<char> &object, size_t index) {
+    return datum_string_t(object.make_child(buf_element_position(object, index)));
+}
+
+std::pair<datum_string_t, datum_t>
+datum_get_obj_pair(const shared_buf_ref_t<char> &object, size_t index) {
+    const size_t key_position = buf_element_position(object, index);
+    datum_string_t key(object.make_child(key_position));
+    const size_t value_position = key_position + datum_serialized_size(key);
+    return std::make_pair(std::move(key),
+                          datum_deserialize_from_buf(object.make_child(value_position)));
+}
 
 size_t datum_serialized_size(const datum_t &datum) {
     r_sanity_check(datum.has());
     size_t sz = 1; // 1 byte for the type
     switch (datum.get_type()) {
     case datum_t::R_ARRAY: {
-        sz += datum_serialized_size(datum.get_arr_vec());
+        if (const shared_buf_ref_t<char> *buf = datum.get_buf_ref()) {
+            sz += buf_ref_serialized_size(*buf);
+        } else {
+            sz += datum_serialized_size(datum.get_arr_vec());
+        }
     } break;
     case datum_t::R_BINARY: {
         sz += datum_serialized_size(datum.as_binary());
@@ -166,7 +396,11 @@ size_t datum_serialized_size(const datum_t &datum) {
         }
     } break;
     case datum_t::R_OBJECT: {
-        sz += datum_serialized_size(datum.get_obj_vec());
+        if (const shared_buf_ref_t<char> *buf = datum.get_buf_ref()) {
+            sz += buf_ref_serialized_size(*buf);
+        } else {
+            sz += datum_serialized_size(datum.get_obj_vec());
+        }
     } break;
     case datum_t::R_STR: {
         sz += datum_serialized_size(datum.as_str());
@@ -183,11 +417,14 @@ serialization_result_t datum_serialize(write_message_t *wm,
     r_sanity_check(datum.has());
     switch (datum->get_type()) {
     case datum_t::R_ARRAY: {
-        res = res | datum_serialize(wm, datum_serialized_type_t::R_ARRAY);
-        const std::vector<datum_t> &value = datum->get_arr_vec();
-        if (value.size() > 100000)
+        res = res | datum_serialize(wm, datum_serialized_type_t::BUF_R_ARRAY);
+        if (datum->arr_size() > 100000)
             res = res | serialization_result_t::ARRAY_TOO_BIG;
-        res = res | datum_serialize(wm, value);
+        if (const shared_buf_ref_t<char> *buf = datum->get_buf_ref()) {
+            serialize_buf_ref(wm, *buf);
+        } else {
+            res = res | datum_serialize(wm, datum->get_arr_vec());
+        }
     } break;
     case datum_t::R_BINARY: {
         datum_serialize(wm, datum_serialized_type_t::R_BINARY);
@@ -223,8 +460,12 @@ serialization_result_t datum_serialize(write_message_t *wm,
         }
     } break;
     case datum_t::R_OBJECT: {
-        res = res | datum_serialize(wm, datum_serialized_type_t::R_OBJECT);
-        res = res | datum_serialize(wm, datum->get_obj_vec());
+        res = res | datum_serialize(wm, datum_serialized_type_t::BUF_R_OBJECT);
+        if (const shared_buf_ref_t<char> *buf = datum->get_buf_ref()) {
+            serialize_buf_ref(wm, *buf);
+        } else {
+            res = res | datum_serialize(wm, datum->get_obj_vec());
+        }
     } break;
     case datum_t::R_STR: {
         res = res | datum_serialize(wm, datum_serialized_type_t::R_STR);
@@ -350,6 +591,22 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
             return archive_result_t::RANGE_ERROR;
         }
     } break;
+    case datum_serialized_type_t::BUF_R_ARRAY: {
+        shared_buf_ref_t<char> buf;
+        res = datum_deserialize_buf(s, &buf);
+        if (bad(res)) {
+            return res;
+        }
+        *datum = datum_t(datum_t::R_ARRAY, std::move(buf));
+    } break;
+    case datum_serialized_type_t::BUF_R_OBJECT: {
+        shared_buf_ref_t<char> buf;
+        res = datum_deserialize_buf(s, &buf);
+        if (bad(res)) {
+            return res;
+        }
+        *datum = datum_t(datum_t::R_OBJECT, std::move(buf));
+    } break;
     default:
         return archive_result_t::RANGE_ERROR;
     }
@@ -440,7 +697,10 @@ template archive_result_t deserialize<cluster_version_t::v1_13_2>(
 template archive_result_t deserialize<cluster_version_t::v1_14>(
         read_stream_t *s,
         empty_ok_ref_t<datum_t> datum);
-template archive_result_t deserialize<cluster_version_t::v1_15_is_latest>(
+template archive_result_t deserialize<cluster_version_t::v1_15>(
+        read_stream_t *s,
+        empty_ok_ref_t<datum_t> datum);
+template archive_result_t deserialize<cluster_version_t::v1_16_is_latest>(
         read_stream_t *s,
         empty_ok_ref_t<datum_t> datum);
 
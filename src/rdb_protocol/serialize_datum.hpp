@@ -4,6 +4,7 @@
 #include "containers/archive/archive.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/counted.hpp"
+#include "containers/shared_buffer.hpp"
 #include "rdb_protocol/datum_string.hpp"
 
 namespace ql {
@@ -49,6 +50,22 @@ serialization_result_t datum_serialize(write_message_t *wm, const datum_string_t
 
 MUST_USE archive_result_t datum_deserialize(read_stream_t *s, datum_string_t *out);
 
+// Random access into the serialization of a buffer-backed array or object.  `buf`
+// points just past the type tag, at the size prefix.  Only the requested element is
+// deserialized; strings and nested arrays and objects keep referencing `buf`.
+size_t datum_get_array_size(const shared_buf_ref_t<char> &array);
+datum_t datum_get_array_element(const shared_buf_ref_t<char> &array, size_t index);
+size_t datum_get_obj_size(const shared_buf_ref_t<char> &object);
+datum_string_t datum_get_obj_key(const shared_buf_ref_t<char> &object, size_t index);
+std::pair<datum_string_t, datum_t>
+datum_get_obj_pair(const shared_buf_ref_t<char> &object, size_t index);
+
+// Deserializes the datum (including its type tag) that `buf` points to.
+datum_t datum_deserialize_from_buf(const shared_buf_ref_t<char> &buf);
+
+// Whether `type_tag`, the first byte of a serialized datum, is that of an array.
+bool datum_serialized_type_is_array(char type_tag);
+
 // The versioned serialization functions.
 template <cluster_version_t W>
 size_t serialized_size(const datum_t &datum) {
@@ -92,9 +109,14 @@ archive_result_t deserialize(read_stream_t *s,
 // change to the serialization format should be indicated.
 //
 // I think the unused bits in the pair offsets array should be reserved for
-// indicating a different kind of change to the blob value format. For example, if we
-// want to support loading only parts of the object, without loading the whole thing,
-// that would be appropriate for the bits in the pair offsets array, which is a
-// relatively scarce resource.
+// indicating a different kind of change to the blob value format.
+//
+// Q. How do we load only parts of an object, then?
+//
+// A. Through the type tag, as above.  Arrays and objects are written with the
+// BUF_R_ARRAY and BUF_R_OBJECT tags, whose serialization carries an offset table
+// (see serialize_datum.cc).  Deserializing one reads it into a single buffer, and
+// the resulting `datum_t` looks up elements and fields directly in that buffer.
+// The older R_ARRAY and R_OBJECT formats are still read.
 
 #endif /* RDB_PROTOCOL_SERIALIZE_DATUM_HPP_ */
@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/shards.hpp"
 
+#include <unordered_map>
 #include <utility>
 
 #include "errors.hpp"
@@ -675,6 +676,9 @@ private:
         if (groups->size() == 0) return;
         r_sanity_check(groups->size() == 1 && !groups->begin()->first.has());
         datums_t *ds = &groups->begin()->second;
+        // We group the batch in a hash table, so that we only have to do ordered
+        // comparisons once per group rather than once per element.
+        hashed_groups_t hashed;
         for (auto el = ds->begin(); el != ds->end(); ++el) {
             std::vector<datum_t> arr;
             arr.reserve(funcs.size() + append_index);
@@ -700,7 +704,7 @@ private:
             r_sanity_check(arr.size() == (funcs.size() + append_index));
 
             if (!multi) {
-                add(groups, std::move(arr), *el, env->limits());
+                add(&hashed, std::move(arr), *el, env->limits());
             } else {
                 std::vector<std::vector<datum_t> > perms(arr.size());
                 for (size_t i = 0; i < arr.size(); ++i) {
@@ -715,20 +719,26 @@ private:
                 }
                 std::vector<datum_t> instance;
                 instance.reserve(perms.size());
-                add_perms(groups, &instance, &perms, 0, *el, env->limits());
+                add_perms(&hashed, &instance, &perms, 0, *el, env->limits());
                 r_sanity_check(instance.size() == 0);
             }
 
             rcheck_src(
                 bt.get(), base_exc_t::GENERIC,
-                groups->size() <= env->limits().array_size_limit(),
+                hashed.size() <= env->limits().array_size_limit(),
                 strprintf("Too many groups (> %zu).", env->limits().array_size_limit()));
         }
-        size_t erased = groups->erase(datum_t());
-        r_sanity_check(erased == 1);
+        groups->clear();
+        for (auto it = hashed.begin(); it != hashed.end(); ++it) {
+            groups->insert(std::make_pair(it->first, std::move(it->second)));
+        }
     }
 
-    void add(groups_t *groups,
+    typedef std::unordered_map<datum_t, datums_t,
+                               optional_datum_hash_t, optional_datum_equal_t>
+        hashed_groups_t;
+
+    void add(hashed_groups_t *groups,
              std::vector<datum_t> &&arr,
              const datum_t &el,
              const configured_limits_t &limits) {
@@ -739,7 +749,7 @@ private:
         (*groups)[group].push_back(el);
     }
 
-    void add_perms(groups_t *groups,
+    void add_perms(hashed_groups_t *groups,
                    std::vector<datum_t> *instance,
                    std::vector<std::vector<datum_t> > *arr,
                    size_t index,
@@ -918,6 +928,143 @@ scoped_ptr_t<op_t> make_op(const transform_variant_t &tv) {
     return scoped_ptr_t<op_t>(boost::apply_visitor(transform_visitor_t(), tv));
 }
 
+// How a transformation uses the rows it's applied to.
+enum class row_use_t {
+    // It only reads the fields and passes the rows on.
+    FIELDS_AND_PASS_ON,
+    // It only reads the fields and replaces the rows with something else.
+    FIELDS_AND_REPLACE,
+    // It reads other fields, or we don't know.
+    WHOLE_ROW
+};
+
+class row_use_visitor_t : public boost::static_visitor<row_use_t> {
+public:
+    explicit row_use_visitor_t(const std::set<std::string> *_fields)
+        : fields(_fields) { }
+    row_use_t operator()(const map_wire_func_t &f) const {
+        return f.compile_wire_func()->reads_only_fields(*fields)
+            ? row_use_t::FIELDS_AND_REPLACE
+            : row_use_t::WHOLE_ROW;
+    }
+    row_use_t operator()(const group_wire_func_t &f) const {
+        std::vector<counted_t<const func_t> > funcs = f.compile_funcs();
+        for (auto it = funcs.begin(); it != funcs.end(); ++it) {
+            if (!(*it)->reads_only_fields(*fields)) {
+                return row_use_t::WHOLE_ROW;
+            }
+        }
+        return row_use_t::FIELDS_AND_PASS_ON;
+    }
+    row_use_t operator()(const filter_wire_func_t &f) const {
+        return f.filter_func.compile_wire_func()->reads_only_fields(*fields)
+            ? row_use_t::FIELDS_AND_PASS_ON
+            : row_use_t::WHOLE_ROW;
+    }
+    row_use_t operator()(const concatmap_wire_func_t &f) const {
+        return f.compile_wire_func()->reads_only_fields(*fields)
+            ? row_use_t::FIELDS_AND_REPLACE
+            : row_use_t::WHOLE_ROW;
+    }
+    row_use_t operator()(const distinct_wire_func_t &) const {
+        return row_use_t::WHOLE_ROW;
+    }
+    row_use_t operator()(const zip_wire_func_t &) const {
+        return row_use_t::WHOLE_ROW;
+    }
+private:
+    const std::set<std::string> *const fields;
+};
+
+class terminal_field_use_visitor_t : public boost::static_visitor<bool> {
+public:
+    explicit terminal_field_use_visitor_t(const std::set<std::string> *_fields)
+        : fields(_fields) { }
+    bool operator()(const count_wire_func_t &) const {
+        return true;
+    }
+    bool operator()(const sum_wire_func_t &f) const {
+        return func_reads_only_fields(f.compile_wire_func_or_null());
+    }
+    bool operator()(const avg_wire_func_t &f) const {
+        return func_reads_only_fields(f.compile_wire_func_or_null());
+    }
+    // `min` and `max` return the row itself.
+    bool operator()(const min_wire_func_t &) const {
+        return false;
+    }
+    bool operator()(const max_wire_func_t &) const {
+        return false;
+    }
+    bool operator()(const reduce_wire_func_t &) const {
+        return false;
+    }
+private:
+    // Without a function, the terminal uses the whole row.
+    bool func_reads_only_fields(const counted_t<const func_t> &f) const {
+        return f.has() && f->reads_only_fields(*fields);
+    }
+    const std::set<std::string> *const fields;
+};
+
+bool reads_only_fields(const std::vector<transform_variant_t> &transforms,
+                       const boost::optional<terminal_variant_t> &terminal,
+                       const std::set<std::string> &fields) {
+    for (auto it = transforms.begin(); it != transforms.end(); ++it) {
+        switch (boost::apply_visitor(row_use_visitor_t(&fields), *it)) {
+        case row_use_t::FIELDS_AND_PASS_ON:
+            break;
+        case row_use_t::FIELDS_AND_REPLACE:
+            return true;
+        case row_use_t::WHOLE_ROW:
+            return false;
+        default: unreachable();
+        }
+    }
+    // Without a terminal, the rows themselves are the result.
+    return terminal
+        && boost::apply_visitor(terminal_field_use_visitor_t(&fields), *terminal);
+}
+
+class transform_is_deterministic_visitor_t : public boost::static_visitor<bool> {
+public:
+    bool operator()(const map_wire_func_t &f) const {
+        return f.compile_wire_func()->is_deterministic();
+    }
+    bool operator()(const group_wire_func_t &f) const {
+        std::vector<counted_t<const func_t> > funcs = f.compile_funcs();
+        for (auto it = funcs.begin(); it != funcs.end(); ++it) {
+            if (!(*it)->is_deterministic()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator()(const filter_wire_func_t &f) const {
+        return f.filter_func.compile_wire_func()->is_deterministic()
+            && (!f.default_filter_val
+                || f.default_filter_val->compile_wire_func()->is_deterministic());
+    }
+    bool operator()(const concatmap_wire_func_t &f) const {
+        return f.compile_wire_func()->is_deterministic();
+    }
+    bool operator()(const distinct_wire_func_t &) const {
+        return true;
+    }
+    bool operator()(const zip_wire_func_t &) const {
+        return true;
+    }
+};
+
+bool transforms_are_deterministic(const std::vector<transform_variant_t> &transforms) {
+    for (auto it = transforms.begin(); it != transforms.end(); ++it) {
+        if (!boost::apply_visitor(transform_is_deterministic_visitor_t(), *it)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 RDB_IMPL_ME_SERIALIZABLE_3_SINCE_v1_13(rget_item_t, key, empty_ok(sindex_key), data);
 
 } // namespace ql
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <limits>
 #include <map>
+#include <set>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -378,6 +380,16 @@ scoped_ptr_t<eager_acc_t> make_eager_terminal(const terminal_variant_t &t);
 
 scoped_ptr_t<op_t> make_op(const transform_variant_t &tv);
 
+// Returns true if the transformations and terminal only read the fields in `fields`
+// of the rows they're applied to (see `func_t::reads_only_fields()`).
+bool reads_only_fields(const std::vector<transform_variant_t> &transforms,
+                       const boost::optional<terminal_variant_t> &terminal,
+                       const std::set<std::string> &fields);
+
+// Returns false if any of the transformations could have side effects or depend on
+// when they run, e.g. because they call `r.js` or `r.http`.
+bool transforms_are_deterministic(const std::vector<transform_variant_t> &transforms);
+
 } // namespace ql
 
 #endif  // RDB_PROTOCOL_SHARDS_HPP_
@@ -1,6 +1,9 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/store.hpp"
 
+#include "btree/bulk_load.hpp"
+#include "btree/get_distribution.hpp"
+#include "btree/secondary_operations.hpp"
 #include "btree/slice.hpp"
 #include "btree/superblock.hpp"
 #include "concurrency/cross_thread_signal.hpp"
@@ -11,6 +14,8 @@
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/lazy_json.hpp"
+#include "stl_utils.hpp"
 
 void store_t::note_reshard() {
     if (changefeed_server.has()) {
@@ -172,10 +177,13 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         guarantee(res != NULL);
         res->server_uuids.insert(store->changefeed_server->get_uuid());
         res->addrs.insert(store->changefeed_server->get_stop_addr());
+        res->remove_filter_addrs.insert(
+            store->changefeed_server->get_remove_filter_addr());
     }
 
     void operator()(const changefeed_stamp_t &s) {
         guarantee(store->changefeed_server.has());
+        store->changefeed_server->add_filter(s.addr, s.filter);
         response->response = changefeed_stamp_response_t();
         auto res = boost::get<changefeed_stamp_response_t>(&response->response);
         res->stamps[store->changefeed_server->get_uuid()]
@@ -184,6 +192,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
 
     void operator()(const changefeed_point_stamp_t &s) {
         guarantee(store->changefeed_server.has());
+        store->changefeed_server->add_filter(s.addr, s.filter);
         response->response = changefeed_point_stamp_response_t();
         auto res = boost::get<changefeed_point_stamp_response_t>(&response->response);
         res->stamp = std::make_pair(
@@ -201,6 +210,13 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         rdb_get(get.key, btree, superblock, res, trace);
     }
 
+    void operator()(const batched_point_read_t &get) {
+        response->response = batched_point_read_response_t();
+        batched_point_read_response_t *res =
+            boost::get<batched_point_read_response_t>(&response->response);
+        rdb_batched_get(get.keys, btree, superblock, res, trace);
+    }
+
     void operator()(const intersecting_geo_read_t &geo_read) {
         ql::env_t ql_env(ctx, interruptor, geo_read.optargs, trace);
 
@@ -299,13 +315,18 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             uuid_u sindex_uuid;
             scoped_ptr_t<real_superblock_t> sindex_sb;
             try {
+                // Compact indexes read documents from the primary btree, so we
+                // keep its superblock until we know whether the index is compact.
                 sindex_sb =
                     acquire_sindex_for_read(rget.table_name, rget.sindex->id,
-                    &sindex_info, &sindex_uuid);
+                    &sindex_info, &sindex_uuid, release_superblock_t::KEEP);
             } catch (const ql::exc_t &e) {
                 res->result = e;
                 return;
             }
+            if (!sindex_info.cover) {
+                superblock->release();
+            }
 
             if (sindex_info.geo == sindex_geo_bool_t::GEO) {
                 res->result = ql::exc_t(
@@ -321,7 +342,8 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             rdb_rget_secondary_slice(
                 store->get_sindex_slice(sindex_uuid),
                 rget.sindex->original_range, rget.sindex->region,
-                sindex_sb.get(), &ql_env, rget.batchspec, rget.transforms,
+                sindex_sb.get(), btree, sindex_info.cover ? superblock : NULL,
+                &ql_env, rget.batchspec, rget.transforms,
                 rget.terminal, rget.region.inner, rget.sorting,
                 sindex_info, res);
         }
@@ -445,7 +467,8 @@ private:
             const std::string &table_name,
             const std::string &sindex_id,
             sindex_disk_info_t *sindex_info_out,
-            uuid_u *sindex_uuid_out) {
+            uuid_u *sindex_uuid_out,
+            release_superblock_t release_superblock = release_superblock_t::RELEASE) {
         rassert(sindex_info_out != NULL);
         rassert(sindex_uuid_out != NULL);
 
@@ -460,7 +483,8 @@ private:
                 superblock,
                 &sindex_sb,
                 &sindex_mapping_data,
-                &sindex_uuid);
+                &sindex_uuid,
+                release_superblock);
             if (!found) {
                 throw ql::exc_t(
                     ql::base_exc_t::GENERIC,
@@ -630,7 +654,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
 
         write_message_t wm;
         sindex_disk_info_t info(c.mapping, sindex_reql_version_info_t::LATEST(),
-                                c.multi, c.geo);
+                                c.multi, c.geo, c.cover);
         serialize_sindex_info(&wm, info);
 
         vector_stream_t stream;
@@ -809,6 +833,30 @@ struct rdb_backfill_chunk_get_btree_repli_timestamp_visitor_t : public boost::st
     repli_timestamp_t operator()(const backfill_chunk_t::sindexes_t &) {
         return repli_timestamp_t::invalid;
     }
+
+    repli_timestamp_t operator()(const backfill_chunk_t::leaf_image_t &image) {
+        return max_recency(image.atoms);
+    }
+
+    repli_timestamp_t operator()(const backfill_chunk_t::sindex_key_value_pairs_t &) {
+        return repli_timestamp_t::invalid;
+    }
+
+    repli_timestamp_t operator()(const backfill_chunk_t::checkpoint_t &) {
+        return repli_timestamp_t::invalid;
+    }
+
+    static repli_timestamp_t max_recency(
+            const std::vector<backfill_raw_atom_t> &atoms) {
+        repli_timestamp_t most_recent = repli_timestamp_t::invalid;
+        for (auto it = atoms.begin(); it != atoms.end(); ++it) {
+            if (most_recent == repli_timestamp_t::invalid
+                || most_recent < it->recency) {
+                most_recent = it->recency;
+            }
+        }
+        return most_recent;
+    }
 };
 
 repli_timestamp_t backfill_chunk_t::get_btree_repli_timestamp() const THROWS_NOTHING {
@@ -840,6 +888,25 @@ public:
         chunk_fun_cb->send_chunk(chunk_t::set_keys(std::move(atoms)), interruptor);
     }
 
+    void on_leaf_image(const key_range_t &range,
+                       const std::map<std::string, std::vector<char> >
+                           &shipped_sindexes,
+                       std::vector<backfill_raw_atom_t> &&atoms,
+                       signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        chunk_fun_cb->send_chunk(chunk_t::leaf_image(region_t(range), shipped_sindexes,
+                                                     std::move(atoms)),
+                                 interruptor);
+    }
+
+    void on_sindex_keyvalues(const std::string &sindex,
+                             const std::vector<char> &opaque_definition,
+                             std::vector<backfill_raw_atom_t> &&atoms,
+                             signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        chunk_fun_cb->send_chunk(chunk_t::sindex_key_values(sindex, opaque_definition,
+                                                            std::move(atoms)),
+                                 interruptor);
+    }
+
     void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes,
                      signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         chunk_fun_cb->send_chunk(chunk_t::sindexes(sindexes), interruptor);
@@ -856,20 +923,79 @@ private:
     DISABLE_COPYING(rdb_backfill_callback_impl_t);
 };
 
+// A backfill sends each region in up to this many slices of keys, and checkpoints
+// after each one (see `backfill_chunk_t::checkpoint_t`), so an interrupted backfill
+// can continue from the last checkpoint.
+#define MAX_BACKFILL_SLICES 8
+
+// Picks at most `MAX_BACKFILL_SLICES - 1` of the keys that split the root node, so
+// that the slices between them hold roughly the same number of subtrees.
+std::vector<store_key_t> choose_backfill_split_keys(superblock_t *superblock) {
+    std::vector<store_key_t> root_keys;
+    get_btree_root_split_keys(superblock, &root_keys);
+    const size_t num_children = root_keys.size() + 1;
+    if (num_children <= MAX_BACKFILL_SLICES) {
+        return root_keys;
+    }
+    std::vector<store_key_t> split_keys;
+    for (size_t i = 1; i < MAX_BACKFILL_SLICES; ++i) {
+        split_keys.push_back(root_keys[i * num_children / MAX_BACKFILL_SLICES - 1]);
+    }
+    return split_keys;
+}
+
+std::vector<region_t> split_backfill_region(const region_t &region,
+                                            const std::vector<store_key_t> &split_keys) {
+    std::vector<region_t> slices;
+    region_t rest = region;
+    for (auto it = split_keys.begin(); it != split_keys.end(); ++it) {
+        if (*it <= rest.inner.left) {
+            continue;
+        }
+        if (!rest.inner.right.unbounded && rest.inner.right.key <= *it) {
+            break;
+        }
+        region_t slice = rest;
+        slice.inner.right = key_range_t::right_bound_t(*it);
+        slices.push_back(slice);
+        rest.inner.left = *it;
+    }
+    slices.push_back(rest);
+    return slices;
+}
+
 void call_rdb_backfill(int i, btree_slice_t *btree,
                        const std::vector<std::pair<region_t, state_timestamp_t> > &regions,
+                       const std::vector<store_key_t> &split_keys,
+                       chunk_fun_callback_t *chunk_fun_cb,
                        rdb_backfill_callback_t *callback,
                        superblock_t *superblock,
                        buf_lock_t *sindex_block,
                        traversal_progress_combiner_t *progress,
                        signal_t *interruptor) THROWS_NOTHING {
-    parallel_traversal_progress_t *p = new parallel_traversal_progress_t;
+    std::vector<region_t> slices = split_backfill_region(regions[i].first, split_keys);
+    sequential_traversal_progress_t *p =
+        new sequential_traversal_progress_t(slices.size());
     scoped_ptr_t<traversal_progress_t> p_owned(p);
     progress->add_constituent(&p_owned);
     repli_timestamp_t timestamp = regions[i].second.to_repli_timestamp();
+    std::map<std::string, secondary_index_t> shipped_sindexes;
+    rdb_get_shipped_sindexes(sindex_block, timestamp, &shipped_sindexes);
     try {
-        rdb_backfill(btree, regions[i].first.inner, timestamp, callback,
-                     superblock, sindex_block, p, interruptor);
+        for (auto it = slices.begin(); it != slices.end(); ++it) {
+            parallel_traversal_progress_t *slice_progress =
+                new parallel_traversal_progress_t;
+            scoped_ptr_t<traversal_progress_t> slice_progress_owned(slice_progress);
+            p->start_part(&slice_progress_owned);
+            rdb_backfill(btree, it->inner, timestamp, callback, superblock,
+                         sindex_block, shipped_sindexes, slice_progress, interruptor);
+            // Otherwise the region is checkpointed once its index entries have
+            // been sent (see `protocol_send_backfill()`).
+            if (shipped_sindexes.empty()) {
+                chunk_fun_cb->send_chunk(backfill_chunk_t::checkpoint(*it),
+                                         interruptor);
+            }
+        }
     } catch (const interrupted_exc_t &) {
         /* do nothing; `protocol_send_backfill()` will notice that interruptor
         has been pulsed */
@@ -886,17 +1012,48 @@ void store_t::protocol_send_backfill(const region_map_t<state_timestamp_t> &star
     with_priority_t p(CORO_PRIORITY_BACKFILL_SENDER);
     rdb_backfill_callback_impl_t callback(chunk_fun_cb);
     std::vector<std::pair<region_t, state_timestamp_t> > regions(start_point.begin(), start_point.end());
-    refcount_superblock_t refcount_wrapper(superblock, regions.size());
+    std::vector<store_key_t> split_keys = choose_backfill_split_keys(superblock);
+    size_t num_slices = 0;
+    for (auto it = regions.begin(); it != regions.end(); ++it) {
+        num_slices += split_backfill_region(it->first, split_keys).size();
+    }
+    // Every slice's traversal releases the superblock once.
+    refcount_superblock_t refcount_wrapper(superblock, num_slices);
     pmap(regions.size(), std::bind(&call_rdb_backfill, ph::_1,
-                                   btree.get(), regions, &callback,
-                                   &refcount_wrapper, sindex_block, progress,
-                                   interruptor));
+                                   btree.get(), regions, split_keys, chunk_fun_cb,
+                                   &callback, &refcount_wrapper, sindex_block,
+                                   progress, interruptor));
 
     /* If interruptor was pulsed, `call_rdb_backfill()` exited silently, so we
     have to check directly. */
     if (interruptor->is_pulsed()) {
         throw interrupted_exc_t();
     }
+
+    // Traversing the shipped indexes once per slice, or even once per region, would
+    // cost too much, so the entries for all the regions that ship them come last.
+    // The backfillee doesn't compute them itself, so those regions are only
+    // checkpointed afterwards.
+    std::map<std::string, secondary_index_t> shipped_sindexes;
+    std::vector<key_range_t> shipped_ranges;
+    std::vector<region_t> shipped_regions;
+    for (auto it = regions.begin(); it != regions.end(); ++it) {
+        std::map<std::string, secondary_index_t> region_sindexes;
+        rdb_get_shipped_sindexes(sindex_block, it->second.to_repli_timestamp(),
+                                 &region_sindexes);
+        if (!region_sindexes.empty()) {
+            shipped_sindexes.insert(region_sindexes.begin(), region_sindexes.end());
+            shipped_ranges.push_back(it->first.inner);
+            shipped_regions.push_back(it->first);
+        }
+    }
+    if (!shipped_sindexes.empty()) {
+        rdb_backfill_sindexes(shipped_ranges, shipped_sindexes, &callback,
+                              sindex_block, interruptor);
+        for (auto it = shipped_regions.begin(); it != shipped_regions.end(); ++it) {
+            chunk_fun_cb->send_chunk(backfill_chunk_t::checkpoint(*it), interruptor);
+        }
+    }
 }
 
 void backfill_chunk_single_rdb_set(const backfill_atom_t &bf_atom,
@@ -913,6 +1070,30 @@ void backfill_chunk_single_rdb_set(const backfill_atom_t &bf_atom,
             superblock_promise_out);
 }
 
+// `mod_report_out` may be `NULL`.
+void backfill_chunk_single_rdb_set_serialized(
+        const backfill_raw_atom_t &bf_atom,
+        btree_slice_t *btree, superblock_t *superblock,
+        UNUSED auto_drainer_t::lock_t drainer_acq,
+        rdb_modification_report_t *mod_report_out,
+        promise_t<superblock_t *> *superblock_promise_out) {
+    if (mod_report_out != NULL) {
+        mod_report_out->primary_key = bf_atom.key;
+    }
+    rdb_live_deletion_context_t deletion_context;
+    rdb_set_serialized(bf_atom.key, bf_atom.value, btree, bf_atom.recency,
+                       superblock, &deletion_context,
+                       mod_report_out != NULL ? &mod_report_out->info : NULL,
+                       superblock_promise_out);
+}
+
+// Whether our index `sindex` takes the entries that the backfiller ships for its
+// index with `opaque_definition`, instead of computing them.
+bool takes_shipped_sindex_entries(const secondary_index_t &sindex,
+                                  const std::vector<char> &opaque_definition) {
+    return sindex.is_ready() && sindex.opaque_definition == opaque_definition;
+}
+
 struct rdb_receive_backfill_visitor_t : public boost::static_visitor<void> {
     rdb_receive_backfill_visitor_t(store_t *_store,
                                    btree_slice_t *_btree,
@@ -972,7 +1153,161 @@ struct rdb_receive_backfill_visitor_t : public boost::static_visitor<void> {
         update_sindexes(mod_reports);
     }
 
+    void operator()(const backfill_chunk_t::leaf_image_t &image) {
+        rdb_protocol::range_key_tester_t tester(&image.range);
+        rdb_live_deletion_context_t deletion_context;
+        std::vector<rdb_modification_report_t> mod_reports;
+        rdb_erase_small_range(&tester, image.range.inner, superblock.get(),
+                              &deletion_context, interruptor, &mod_reports,
+                              release_superblock_t::KEEP);
+
+        // The indexes whose entries for the new documents the backfiller sends don't
+        // need the documents as datums, and without any others we don't make
+        // modification reports for them.  If the image also lies past the end of the
+        // tree, which is the case when a new replica is filled in key order, we load
+        // it bottom-up.
+        std::map<sindex_name_t, secondary_index_t> sindexes;
+        get_secondary_indexes(&sindex_block, &sindexes);
+        std::set<uuid_u> shipped_sindexes;
+        bool needs_mod_reports = false;
+        for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+            auto shipped = image.shipped_sindexes.find(it->first.name);
+            if (shipped != image.shipped_sindexes.end()
+                && takes_shipped_sindex_entries(it->second, shipped->second)) {
+                shipped_sindexes.insert(it->second.id);
+            } else {
+                needs_mod_reports = true;
+            }
+        }
+
+        bool appended = false;
+        if (!needs_mod_reports && !image.atoms.empty()
+            && can_append_to_btree(superblock.get(),
+                                   image.atoms.front().key.btree_key())) {
+            rdb_value_sizer_t sizer(txn->cache()->max_block_size());
+            btree_appender_t appender(&sizer, superblock.get());
+            for (auto it = image.atoms.begin(); it != image.atoms.end(); ++it) {
+                const btree_key_t *key = it->key.btree_key();
+                // Like any other value's, the blob's blocks are children of the
+                // leaf the value is in.
+                scoped_malloc_t<rdb_value_t> value
+                    = rdb_value_from_serialized_data(appender.rightmost_leaf(),
+                                                     it->value);
+                if (!appender.fits(key, value.get())) {
+                    deletion_context.post_deleter()->delete_value(
+                        appender.rightmost_leaf(), value.get());
+                    appender.start_new_leaf();
+                    value = rdb_value_from_serialized_data(appender.rightmost_leaf(),
+                                                           it->value);
+                }
+                appender.append(key, value.get(), it->recency);
+            }
+            btree->stats.pm_keys_set.record(image.atoms.size());
+            btree->stats.pm_total_keys_set += image.atoms.size();
+            appended = true;
+        }
+
+        std::vector<rdb_modification_report_t> set_reports;
+        if (!appended) {
+            if (needs_mod_reports) {
+                set_reports.resize(image.atoms.size());
+            }
+            auto_drainer_t drainer;
+            for (size_t i = 0; i < image.atoms.size(); ++i) {
+                promise_t<superblock_t *> superblock_promise;
+                // See the `key_value_pairs_t` case.
+                coro_t::spawn_now_dangerously(std::bind(
+                        &backfill_chunk_single_rdb_set_serialized,
+                        image.atoms[i], btree, superblock.release(),
+                        auto_drainer_t::lock_t(&drainer),
+                        needs_mod_reports ? &set_reports[i] : NULL,
+                        &superblock_promise));
+                superblock.init(superblock_promise.wait());
+            }
+        }
+        superblock.reset();
+        if (set_reports.empty()) {
+            update_sindexes(mod_reports);
+        } else {
+            // The erased documents' entries are removed from every index.
+            store->update_sindexes(txn, &sindex_block, mod_reports, false);
+            store->update_sindexes(txn, &sindex_block, set_reports, true,
+                                   shipped_sindexes);
+        }
+    }
+
+    void operator()(const backfill_chunk_t::sindex_key_value_pairs_t &pairs) {
+        secondary_index_t sindex;
+        if (!get_secondary_index(&sindex_block, sindex_name_t(pairs.sindex), &sindex)
+            || !takes_shipped_sindex_entries(sindex, pairs.opaque_definition)) {
+            // The index computed the entries itself (see the `leaf_image_t` case).
+            return;
+        }
+
+        // Entries that refer to a document get our copy's value.  The documents
+        // came in leaf images before their entries.
+        const max_block_size_t block_size = txn->cache()->max_block_size();
+        rdb_value_sizer_t sizer(block_size);
+        std::vector<std::pair<store_key_t, std::vector<char> > > entries;
+        entries.reserve(pairs.atoms.size());
+        rdb_live_deletion_context_t deletion_context;
+        // We only read the documents, and each lookup releases the superblock, so
+        // they share it until the last one is done.
+        int num_lookups = 0;
+        for (auto it = pairs.atoms.begin(); it != pairs.atoms.end(); ++it) {
+            num_lookups += it->value.empty() ? 1 : 0;
+        }
+        refcount_superblock_t refcount_wrapper(superblock.get(), num_lookups);
+        for (auto it = pairs.atoms.begin(); it != pairs.atoms.end(); ++it) {
+            std::vector<char> value_ref;
+            if (it->value.empty()) {
+                {
+                    keyvalue_location_t kv_location;
+                    find_keyvalue_location_for_read(
+                        &sizer, &refcount_wrapper,
+                        ql::datum_t::extract_primary(it->key).btree_key(),
+                        &kv_location, &btree->stats,
+                        static_cast<profile::trace_t *>(NULL));
+                    if (kv_location.value.has()) {
+                        const rdb_value_t *value
+                            = kv_location.value_as<rdb_value_t>();
+                        value_ref.assign(value->value_ref(),
+                                         value->value_ref()
+                                         + value->inline_size(block_size));
+                    }
+                }
+                if (value_ref.empty()) {
+                    // The document was deleted after the backfill sent it.
+                    continue;
+                }
+            } else {
+                // Compact entries are stored inline, so the blob doesn't need a
+                // parent.
+                scoped_malloc_t<rdb_value_t> value
+                    = rdb_value_from_serialized_data(buf_parent_t(txn), it->value);
+                value_ref.assign(value->value_ref(),
+                                 value->value_ref() + value->inline_size(block_size));
+            }
+            entries.push_back(std::make_pair(it->key, std::move(value_ref)));
+        }
+        superblock.reset();
+
+        std::set<uuid_u> sindex_ids;
+        sindex_ids.insert(sindex.id);
+        store_t::sindex_access_vector_t sindexes;
+        store->acquire_sindex_superblocks_for_write(sindex_ids, &sindex_block,
+                                                    &sindexes);
+        sindex_block.reset_buf_lock();
+        if (!sindexes.empty()) {
+            rdb_set_sindex_entries(sindexes[0].get(), entries, &deletion_context);
+        }
+    }
+
     void operator()(const backfill_chunk_t::sindexes_t &s) {
+        // With no documents, there's nothing to post-construct new indexes from.
+        // The backfill then either sends their entries or makes the modification
+        // reports that update them.
+        const bool store_is_empty = superblock->get_root_block_id() == NULL_BLOCK_ID;
         // Release the superblock. We don't need it for this.
         superblock.reset();
 
@@ -1000,12 +1335,22 @@ struct rdb_receive_backfill_visitor_t : public boost::static_visitor<void> {
         std::set<sindex_name_t> created_sindexes;
         store->set_sindexes(sindexes, &sindex_block, &created_sindexes);
 
-        if (!created_sindexes.empty()) {
+        if (store_is_empty) {
+            for (auto it = created_sindexes.begin(); it != created_sindexes.end();
+                 ++it) {
+                bool found = store->mark_index_up_to_date(*it, &sindex_block);
+                guarantee(found);
+            }
+        } else if (!created_sindexes.empty()) {
             rdb_protocol::bring_sindexes_up_to_date(created_sindexes, store,
                                                             &sindex_block);
         }
     }
 
+    void operator()(const backfill_chunk_t::checkpoint_t &) {
+        unreachable("backfillee() records checkpoints in the metainfo itself.");
+    }
+
 private:
     void update_sindexes(const std::vector<rdb_modification_report_t> &mod_reports) {
         store->update_sindexes(txn,
@@ -180,12 +180,14 @@ public:
             internal_disk_backed_queue_t *disk_backed_queue);
 
     // Updates the live sindexes, and pushes modification reports onto the sindex
-    // queues of non-live indexes.
+    // queues of non-live indexes.  The live sindexes in `sindexes_to_skip` aren't
+    // updated; a backfill sends their entries instead.
     void update_sindexes(
             txn_t *txn,
             buf_lock_t *sindex_block,
             const std::vector<rdb_modification_report_t> &mod_reports,
-            bool release_sindex_block);
+            bool release_sindex_block,
+            const std::set<uuid_u> &sindexes_to_skip = std::set<uuid_u>());
 
     void sindex_queue_push(
             const rdb_modification_report_t &mod_report,
@@ -195,8 +197,8 @@ public:
             const new_mutex_in_line_t *acq);
 
     void add_progress_tracker(
-        map_insertion_sentry_t<uuid_u, const parallel_traversal_progress_t *> *sentry,
-        uuid_u id, const parallel_traversal_progress_t *p);
+        map_insertion_sentry_t<uuid_u, const traversal_progress_t *> *sentry,
+        uuid_u id, const traversal_progress_t *p);
 
     progress_completion_fraction_t get_progress(uuid_u id);
 
@@ -245,10 +247,11 @@ public:
     MUST_USE bool acquire_sindex_superblock_for_read(
             const sindex_name_t &name,
             const std::string &table_name,
-            superblock_t *superblock,  // releases this.
+            superblock_t *superblock,  // releases this, unless told to keep it.
             scoped_ptr_t<real_superblock_t> *sindex_sb_out,
             std::vector<char> *opaque_definition_out,
-            uuid_u *sindex_uuid_out)
+            uuid_u *sindex_uuid_out,
+            release_superblock_t release_superblock = release_superblock_t::RELEASE)
         THROWS_ONLY(sindex_not_ready_exc_t);
 
     MUST_USE bool acquire_sindex_superblock_for_write(
@@ -426,7 +429,7 @@ public:
 
     std::vector<internal_disk_backed_queue_t *> sindex_queues;
     new_mutex_t sindex_queue_mutex;
-    std::map<uuid_u, const parallel_traversal_progress_t *> progress_trackers;
+    std::map<uuid_u, const traversal_progress_t *> progress_trackers;
 
     rdb_context_t *ctx;
     scoped_ptr_t<ql::changefeed::server_t> changefeed_server;
@@ -451,4 +454,9 @@ private:
     DISABLE_COPYING(store_t);
 };
 
+// Splits `region` at those of `split_keys` that fall inside it.  A backfill sends
+// each region slice by slice, and checkpoints after each one.
+std::vector<region_t> split_backfill_region(const region_t &region,
+                                            const std::vector<store_key_t> &split_keys);
+
 #endif  // RDB_PROTOCOL_STORE_HPP_
@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/stream_cache.hpp"
 
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/interruptor.hpp"
 #include "rdb_protocol/env.hpp"
 
 #include "debug.hpp"
@@ -46,13 +48,24 @@ bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
 
         env_t env(rdb_ctx, interruptor, entry->global_optargs, trace.get_or_null());
 
-        batch_type_t batch_type = entry->has_sent_batch
-                                      ? batch_type_t::NORMAL
-                                      : batch_type_t::NORMAL_FIRST;
-        std::vector<datum_t> ds
-            = entry->stream->next_batch(
+        std::vector<datum_t> ds;
+        if (entry->read_ahead_done.has()) {
+            wait_interruptible(entry->read_ahead_done.get(), interruptor);
+            entry->read_ahead_done.reset();
+            if (entry->read_ahead_exc) {
+                std::exception_ptr read_ahead_exc;
+                std::swap(read_ahead_exc, entry->read_ahead_exc);
+                std::rethrow_exception(read_ahead_exc);
+            }
+            ds.swap(entry->read_ahead_batch);
+        } else {
+            batch_type_t batch_type = entry->has_sent_batch
+                                          ? batch_type_t::NORMAL
+                                          : batch_type_t::NORMAL_FIRST;
+            ds = entry->stream->next_batch(
                 &env,
                 batchspec_t::user(batch_type, &env));
+        }
         entry->has_sent_batch = true;
         for (auto d = ds.begin(); d != ds.end(); ++d) {
             (*d)->write_to_protobuf(res->add_response(), entry->use_json);
@@ -82,10 +95,33 @@ bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
         res->set_type(Response::SUCCESS_SEQUENCE);
     } else {
         res->set_type(cfeed ? Response::SUCCESS_FEED : Response::SUCCESS_PARTIAL);
+        // Profiles are per batch, so we don't read ahead when the client wants one.
+        if (entry->stream->can_read_ahead()
+            && entry->profile == profile_bool_t::DONT_PROFILE) {
+            entry->read_ahead_done.init(new cond_t);
+            coro_t::spawn_sometime(std::bind(&stream_cache_t::read_ahead,
+                                             this,
+                                             entry,
+                                             auto_drainer_t::lock_t(&entry->drainer)));
+        }
     }
     return true;
 }
 
+void stream_cache_t::read_ahead(entry_t *entry, auto_drainer_t::lock_t keepalive) {
+    try {
+        env_t env(rdb_ctx, keepalive.get_drain_signal(), entry->global_optargs, NULL);
+        entry->read_ahead_batch = entry->stream->next_batch(
+            &env,
+            batchspec_t::user(batch_type_t::NORMAL, &env));
+    } catch (const std::exception &) {
+        // If we were interrupted, the entry is going away, and nobody will look at
+        // this.
+        entry->read_ahead_exc = std::current_exception();
+    }
+    entry->read_ahead_done->pulse();
+}
+
 void stream_cache_t::maybe_evict() {
     // We never evict right now.
 }
@@ -4,9 +4,13 @@
 
 #include <time.h>
 
+#include <exception>
 #include <map>
 #include <string>
+#include <vector>
 
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/signal.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/datum_stream.hpp"
@@ -53,10 +57,25 @@ private:
         counted_t<datum_stream_t> stream;
         time_t max_age;
         bool has_sent_batch;
+
+        // After sending a batch, we read the next one in the background, so that
+        // the next CONTINUE doesn't wait for the shards.  `read_ahead_done` is
+        // pulsed when the batch (or the exception it threw) is ready; it's empty if
+        // we aren't reading ahead.  Only one batch is read ahead at a time.
+        scoped_ptr_t<cond_t> read_ahead_done;
+        std::vector<datum_t> read_ahead_batch;
+        std::exception_ptr read_ahead_exc;
+
+        // Interrupts the read-ahead when the entry goes away.  This must be
+        // destroyed first.
+        auto_drainer_t drainer;
     private:
         DISABLE_COPYING(entry_t);
     };
 
+    // Reads `entry`'s next batch into `entry->read_ahead_batch`.
+    void read_ahead(entry_t *entry, auto_drainer_t::lock_t keepalive);
+
     rdb_context_t *const rdb_ctx;
     const reject_cfeeds_t reject_cfeeds;
     std::map<int64_t, scoped_ptr_t<entry_t> > streams;
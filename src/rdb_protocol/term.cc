@@ -7,6 +7,7 @@
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/term_walker.hpp"
 #include "rdb_protocol/validate.hpp"
@@ -19,7 +20,15 @@ counted_t<const term_t> compile_term(compile_env_t *env, protob_t<const Term> t)
     // HACK: per @srh, use unlimited array size at compile time
     ql::configured_limits_t limits = ql::configured_limits_t::unlimited;
     switch (t->type()) {
-    case Term::DATUM:              return make_datum_term(t, limits);
+    case Term::DATUM: {
+        if (env->query_params != NULL) {
+            auto it = env->query_params->find(t.get());
+            if (it != env->query_params->end()) {
+                return make_query_param_term(t, it->second);
+            }
+        }
+        return make_datum_term(t, limits);
+    }
     case Term::MAKE_ARRAY:         return make_make_array_term(env, t);
     case Term::MAKE_OBJ:           return make_make_obj_term(env, t);
     case Term::BINARY:             return make_binary_term(env, t);
@@ -193,6 +202,7 @@ void run(protob_t<Query> q,
          rdb_context_t *ctx,
          signal_t *interruptor,
          stream_cache_t *stream_cache,
+         query_cache_t *query_cache,
          Response *res) {
     try {
         validate_pb(*q);
@@ -214,10 +224,17 @@ void run(protob_t<Query> q,
         env_t env(ctx, interruptor, global_optargs(q), trace.get_or_null());
 
         counted_t<const term_t> root_term;
+        std::vector<datum_t> query_params;
         try {
             Term *t = q->mutable_query();
-            compile_env_t compile_env((var_visibility_t()));
-            root_term = compile_term(&compile_env, q.make_child(t));
+            if (query_cache != NULL) {
+                bool hit;
+                root_term = query_cache->compile(q.make_child(t), &query_params, &hit);
+                ++(hit ? ctx->query_cache_hits : ctx->query_cache_misses);
+            } else {
+                compile_env_t compile_env((var_visibility_t()));
+                root_term = compile_term(&compile_env, q.make_child(t));
+            }
         } catch (const exc_t &e) {
             fill_error(res, Response::COMPILE_ERROR, e.what(), e.backtrace());
             return;
@@ -238,6 +255,7 @@ void run(protob_t<Query> q,
             return;
         }
 
+        env.set_query_params(std::move(query_params));
         try {
             scope_env_t scope_env(&env, var_scope_t());
             counted_t<val_t> val = root_term->eval(&scope_env);
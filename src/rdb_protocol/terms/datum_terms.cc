@@ -21,6 +21,22 @@ private:
     counted_t<val_t> raw_val;
 };
 
+// A literal of a query that `query_cache_t` compiled, whose value may be different
+// each time the query runs.
+class query_param_term_t : public term_t {
+public:
+    query_param_term_t(protob_t<const Term> t, size_t _index)
+        : term_t(t), index(_index) { }
+private:
+    virtual void accumulate_captures(var_captures_t *) const { /* do nothing */ }
+    virtual bool is_deterministic() const { return true; }
+    virtual counted_t<val_t> term_eval(scope_env_t *env, eval_flags_t) const {
+        return new_val(env->env->get_query_param(index));
+    }
+    virtual const char *name() const { return "datum"; }
+    const size_t index;
+};
+
 class constant_term_t : public op_term_t {
 public:
     constant_term_t(compile_env_t *env, protob_t<const Term> t,
@@ -130,6 +146,10 @@ counted_t<term_t> make_datum_term(const protob_t<const Term> &term,
                                   const configured_limits_t &limits) {
     return make_counted<datum_term_t>(term, limits);
 }
+counted_t<term_t> make_query_param_term(const protob_t<const Term> &term,
+                                        size_t index) {
+    return make_counted<query_param_term_t>(term, index);
+}
 counted_t<term_t> make_constant_term(compile_env_t *env, const protob_t<const Term> &term,
                                      double constant, const char *name) {
     return make_counted<constant_term_t>(env, term, constant, name);
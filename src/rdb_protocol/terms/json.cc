@@ -1,4 +1,5 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "rdb_protocol/datum_json.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/term.hpp"
 #include "rdb_protocol/terms/terms.hpp"
@@ -11,18 +12,13 @@ public:
 
     counted_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
         const datum_string_t &data = args->arg(env, 0)->as_str();
-        // TODO (daniel): This causes copying, which might reduce performance and
-        // wastes memory. Change the cJSON interface to take a length.
-        // Or maybe store datum_string_ts with a null byte appended, though that
-        // would suck.
-        const std::string std_data = data.to_std();
-        scoped_cJSON_t cjson(cJSON_Parse(std_data.c_str()));
-        rcheck(cjson.get() != NULL, base_exc_t::GENERIC,
+        datum_t parsed = parse_json(data.data(), data.size(), env->env->limits());
+        rcheck(parsed.has(), base_exc_t::GENERIC,
                strprintf("Failed to parse \"%s\" as JSON.",
                  (data.size() > 40
-                  ? (std_data.substr(0, 37) + "...").c_str()
-                  : std_data.c_str())));
-        return new_val(to_datum(cjson.get(), env->env->limits()));
+                  ? (data.to_std().substr(0, 37) + "...").c_str()
+                  : data.to_std().c_str())));
+        return new_val(std::move(parsed));
     }
 
     virtual const char *name() const { return "json"; }
@@ -9,6 +9,8 @@
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/math_utils.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/pb_utils.hpp"
 
 namespace ql {
 
@@ -124,6 +126,64 @@ private:
     virtual const char *name() const { return "concatmap"; }
 };
 
+/* `eq_join` is done by `eq_join_datum_stream_t`, which looks up the keys of a whole
+batch of left rows at a time.  Grouped streams can't be wrapped like that, so they
+get the per-row function `eq_join` used to be rewritten into, applied as a
+`concat_map`. */
+class eq_join_term_t : public grouped_seq_op_term_t {
+public:
+    eq_join_term_t(compile_env_t *env, const protob_t<const Term> &term)
+        : grouped_seq_op_term_t(env, term, argspec_t(3), optargspec_t({ "index" })),
+          per_row_src(make_counted_term()) {
+        per_row_src->Swap(&make_per_row_func(term).get());
+        propagate(per_row_src.get());
+        per_row = compile_term(env, per_row_src);
+    }
+private:
+    // row -> r.branch(row == null, [],
+    //                 right.get_all(left_attr(row)).default([])
+    //                      .map(v -> {left: row, right: v}))
+    static r::reql_t make_per_row_func(const protob_t<const Term> &in) {
+        const Term &left_attr = in->args(1);
+        const Term &right = in->args(2);
+
+        auto row = pb::dummy_var_t::EQJOIN_ROW;
+        auto v = pb::dummy_var_t::EQJOIN_V;
+
+        r::reql_t get_all =
+            r::expr(right).get_all(
+                r::expr(left_attr)(row, r::optarg("_SHORTCUT_", GET_FIELD_SHORTCUT)));
+        get_all.copy_optargs_from_term(*in);
+        return r::fun(row,
+                      r::branch(
+                          r::null() == row,
+                          r::array(),
+                          std::move(get_all).default_(r::array()).map(
+                              r::fun(v, r::object(r::optarg("left", row),
+                                                  r::optarg("right", v))))));
+    }
+
+    virtual counted_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
+        counted_t<datum_stream_t> stream = args->arg(env, 0)->as_seq(env->env);
+        if (stream->is_grouped()) {
+            stream->add_transformation(
+                concatmap_wire_func_t(per_row->eval(env)->as_func()), backtrace());
+            return new_val(env->env, stream);
+        }
+        counted_t<const func_t> left_key =
+            args->arg(env, 1)->as_func(GET_FIELD_SHORTCUT);
+        counted_t<table_t> table = args->arg(env, 2)->as_table();
+        counted_t<val_t> index = args->optarg(env, "index");
+        std::string index_str = index ? index->as_str().to_std() : table->get_pkey();
+        return new_val(env->env, make_counted<eq_join_datum_stream_t>(
+                           stream, left_key, table, index_str));
+    }
+    virtual const char *name() const { return "eq_join"; }
+
+    protob_t<Term> per_row_src;
+    counted_t<const term_t> per_row;
+};
+
 class group_term_t : public grouped_seq_op_term_t {
 public:
     group_term_t(compile_env_t *env, const protob_t<const Term> &term)
@@ -221,16 +281,22 @@ private:
 class changes_term_t : public op_term_t {
 public:
     changes_term_t(compile_env_t *env, const protob_t<const Term> &term)
-        : op_term_t(env, term, argspec_t(1)) { }
+        : op_term_t(env, term, argspec_t(1), optargspec_t({"squash"})) { }
 private:
     virtual counted_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
         counted_t<val_t> v = args->arg(env, 0);
         if (v->get_type().is_convertible(val_t::type_t::TABLE)) {
+            // With `squash`, changes to a row that the client hasn't read yet are
+            // merged into one.
+            bool squash = false;
+            if (counted_t<val_t> s = args->optarg(env, "squash")) {
+                squash = s->as_bool();
+            }
             counted_t<table_t> tbl = v->as_table();
             return new_val(env->env,
                 tbl->table->read_all_changes(
-                    env->env, backtrace(), tbl->display_name()));
+                    env->env, squash, backtrace(), tbl->display_name()));
         } else if (v->get_type().is_convertible(val_t::type_t::SINGLE_SELECTION)) {
             auto single_selection = v->as_single_selection();
             counted_t<table_t> tbl = std::move(single_selection.first);
@@ -349,6 +415,10 @@ counted_t<term_t> make_concatmap_term(
     compile_env_t *env, const protob_t<const Term> &term) {
     return make_counted<concatmap_term_t>(env, term);
 }
+counted_t<term_t> make_eq_join_term(
+    compile_env_t *env, const protob_t<const Term> &term) {
+    return make_counted<eq_join_term_t>(env, term);
+}
 counted_t<term_t> make_group_term(
     compile_env_t *env, const protob_t<const Term> &term) {
     return make_counted<group_term_t>(env, term);
@@ -18,7 +18,8 @@ namespace ql {
 class sindex_create_term_t : public op_term_t {
 public:
     sindex_create_term_t(compile_env_t *env, const protob_t<const Term> &term)
-        : op_term_t(env, term, argspec_t(2, 3), optargspec_t({"multi", "geo"})) { }
+        : op_term_t(env, term, argspec_t(2, 3),
+                    optargspec_t({"multi", "geo", "cover"})) { }
 
     virtual counted_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
         counted_t<table_t> table = args->arg(env, 0)->as_table();
@@ -32,6 +33,7 @@ public:
         /* Check if we're doing a multi index or a normal index. */
         sindex_multi_bool_t multi = sindex_multi_bool_t::SINGLE;
         sindex_geo_bool_t geo = sindex_geo_bool_t::REGULAR;
+        boost::optional<std::vector<std::string> > cover;
         counted_t<const func_t> index_func;
         if (args->num_args() == 3) {
             counted_t<val_t> v = args->arg(env, 2);
@@ -55,6 +57,7 @@ public:
                         deserialize_sindex_info(vec, &sindex_info);
                         multi = sindex_info.multi;
                         geo = sindex_info.geo;
+                        cover = sindex_info.cover;
                     } catch (const archive_exc_t &e) {
                         rfail(base_exc_t::GENERIC,
                               "Binary blob passed to index create could not "
@@ -99,7 +102,25 @@ public:
                 : sindex_geo_bool_t::REGULAR;
         }
 
-        bool success = table->sindex_create(env->env, name, index_func, multi, geo);
+        /* A compact index stores the index value and the `cover` fields of each
+           document, rather than the whole document. */
+        if (counted_t<val_t> cover_val = args->optarg(env, "cover")) {
+            datum_t cover_datum = cover_val->as_datum();
+            rcheck_target(cover_val.get(), base_exc_t::GENERIC,
+                          cover_datum->get_type() == datum_t::R_ARRAY,
+                          "`cover` must be an array of field names.");
+            std::vector<std::string> fields;
+            for (size_t i = 0; i < cover_datum->arr_size(); ++i) {
+                fields.push_back(cover_datum->get(i)->as_str().to_std());
+            }
+            cover = fields;
+        }
+        rcheck(!cover || geo == sindex_geo_bool_t::REGULAR,
+               base_exc_t::GENERIC,
+               "A geospatial index can't have covered fields.");
+
+        bool success = table->sindex_create(env->env, name, index_func, multi, geo,
+                                            cover);
 
         if (success) {
             datum_object_builder_t res;
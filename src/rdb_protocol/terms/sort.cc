@@ -1,8 +1,12 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "rdb_protocol/terms/terms.hpp"
 
+#include <algorithm>
+#include <functional>
 #include <string>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "errors.hpp"
 #include <boost/bind.hpp>
@@ -177,6 +181,10 @@ private:
             rcheck(!comparisons.empty(), base_exc_t::GENERIC,
                    "Must specify something to order by.");
             std::vector<datum_t> to_sort;
+            // Once we have more than the array limit's worth of data we sort it in
+            // runs that get spilled to disk, if this server has somewhere to put
+            // them.
+            scoped_ptr_t<external_sorter_t> sorter;
             batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
             for (;;) {
                 std::vector<datum_t> data
@@ -185,14 +193,32 @@ private:
                     break;
                 }
                 std::move(data.begin(), data.end(), std::back_inserter(to_sort));
-                rcheck_array_size(to_sort, env->env->limits(), base_exc_t::GENERIC);
+                if (to_sort.size() > env->env->limits().array_size_limit()) {
+                    io_backender_t *io_backender = env->env->get_io_backender();
+                    if (io_backender == NULL) {
+                        rcheck_array_size(to_sort, env->env->limits(),
+                                          base_exc_t::GENERIC);
+                    }
+                    if (!sorter.has()) {
+                        sorter.init(new external_sorter_t(
+                            io_backender, env->env->get_base_path(), lt_cmp));
+                    }
+                    sorter->add_run(env->env, std::move(to_sort));
+                    to_sort.clear();
+                }
+            }
+            if (sorter.has()) {
+                sorter->finish(env->env, std::move(to_sort));
+                seq = make_counted<external_sort_datum_stream_t>(
+                    std::move(sorter), backtrace());
+            } else {
+                profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
+                auto fn = boost::bind(lt_cmp, env->env, &sampler, _1, _2);
+                std::stable_sort(to_sort.begin(), to_sort.end(), fn);
+                seq = make_counted<array_datum_stream_t>(
+                    datum_t(std::move(to_sort), env->env->limits()),
+                    backtrace());
             }
-            profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
-            auto fn = boost::bind(lt_cmp, env->env, &sampler, _1, _2);
-            std::stable_sort(to_sort.begin(), to_sort.end(), fn);
-            seq = make_counted<array_datum_stream_t>(
-                datum_t(std::move(to_sort), env->env->limits()),
-                backtrace());
         }
         return tbl.has() ? new_val(seq, tbl) : new_val(env->env, seq);
     }
@@ -208,6 +234,12 @@ public:
     distinct_term_t(compile_env_t *env, const protob_t<const Term> &term)
         : op_term_t(env, term, argspec_t(1), optargspec_t({"index"})) { }
 private:
+    static bool distinct_lt(env_t *env, profile::sampler_t *sampler,
+                            const datum_t &l, const datum_t &r) {
+        sampler->new_sample();
+        return l.compare_lt(env->reql_version(), r);
+    }
+
     virtual counted_t<val_t> eval_impl(scope_env_t *env, args_t *args,
                                        eval_flags_t) const {
         counted_t<val_t> v = args->arg(env, 0);
@@ -240,22 +272,54 @@ private:
             rcheck(!idx, base_exc_t::GENERIC,
                    "Can only perform an indexed distinct on a TABLE.");
             counted_t<datum_stream_t> s = v->as_seq(env->env);
-            // The reql_version matters here, because we copy `results` into `toret`
-            // in ascending order.
-            std::set<datum_t, optional_datum_less_t>
-                results(optional_datum_less_t(env->env->reql_version()));
+            // We only sort the distinct elements, at the end.  If there are more
+            // than the array limit's worth of them we spill them to disk as sorted
+            // runs (each of which is distinct, but they can overlap), if this
+            // server has somewhere to put them.
+            std::unordered_set<datum_t, optional_datum_hash_t, optional_datum_equal_t>
+                results;
+            scoped_ptr_t<external_sorter_t> sorter;
             batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
             {
                 profile::sampler_t sampler("Evaluating elements in distinct.",
                                            env->env->trace);
                 while (datum_t d = s->next(env->env, batchspec)) {
                     results.insert(std::move(d));
-                    rcheck_array_size(results, env->env->limits(), base_exc_t::GENERIC);
+                    if (results.size() > env->env->limits().array_size_limit()) {
+                        io_backender_t *io_backender = env->env->get_io_backender();
+                        if (io_backender == NULL) {
+                            rcheck_array_size(results, env->env->limits(),
+                                              base_exc_t::GENERIC);
+                        }
+                        if (!sorter.has()) {
+                            sorter.init(new external_sorter_t(
+                                io_backender, env->env->get_base_path(), &distinct_lt));
+                        }
+                        sorter->add_run(env->env, std::vector<datum_t>(
+                                            results.begin(), results.end()));
+                        results.clear();
+                    }
                     sampler.new_sample();
                 }
             }
-            std::vector<datum_t> toret;
-            std::move(results.begin(), results.end(), std::back_inserter(toret));
+            std::vector<datum_t> toret(results.begin(), results.end());
+            results.clear();
+            if (sorter.has()) {
+                sorter->finish(env->env, std::move(toret));
+                counted_t<datum_stream_t> merged =
+                    make_counted<external_sort_datum_stream_t>(
+                        std::move(sorter), backtrace());
+                return new_val(env->env, merged->ordered_distinct());
+            }
+            {
+                profile::sampler_t sampler("Sorting distinct elements.",
+                                           env->env->trace);
+                // The elements are distinct, so `std::sort` is as good as a stable
+                // sort.
+                std::sort(toret.begin(), toret.end(),
+                          std::bind(&distinct_lt, env->env, &sampler,
+                                    ph::_1, ph::_2));
+            }
             return new_val(datum_t(std::move(toret), env->env->limits()));
         }
     }
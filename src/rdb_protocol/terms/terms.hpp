@@ -74,6 +74,8 @@ counted_t<term_t> make_funcall_term(
 // datum_terms.cc
 counted_t<term_t> make_datum_term(const protob_t<const Term> &term,
                                   const configured_limits_t &limits);
+counted_t<term_t> make_query_param_term(const protob_t<const Term> &term,
+                                        size_t index);
 counted_t<term_t> make_constant_term(
     compile_env_t *env, const protob_t<const Term> &term,
                                      double constant, const char *name);
@@ -118,13 +118,15 @@ datum_t table_t::batched_insert(
     return std::move(result).to_datum();
 }
 
-MUST_USE bool table_t::sindex_create(env_t *env,
-                                     const std::string &id,
-                                     counted_t<const func_t> index_func,
-                                     sindex_multi_bool_t multi,
-                                     sindex_geo_bool_t geo) {
+MUST_USE bool table_t::sindex_create(
+        env_t *env,
+        const std::string &id,
+        counted_t<const func_t> index_func,
+        sindex_multi_bool_t multi,
+        sindex_geo_bool_t geo,
+        const boost::optional<std::vector<std::string> > &cover) {
     index_func->assert_deterministic("Index functions must be deterministic.");
-    return table->sindex_create(env, id, index_func, multi, geo);
+    return table->sindex_create(env, id, index_func, multi, geo, cover);
 }
 
 MUST_USE bool table_t::sindex_drop(env_t *env, const std::string &id) {
@@ -191,6 +193,10 @@ datum_t table_t::get_row(env_t *env, datum_t pval) {
     return table->read_row(env, pval, use_outdated);
 }
 
+std::vector<datum_t> table_t::get_rows(env_t *env, const std::vector<datum_t> &pvals) {
+    return table->read_rows(env, pvals, use_outdated);
+}
+
 counted_t<datum_stream_t> table_t::get_all(
         env_t *env,
         datum_t value,
@@ -35,6 +35,8 @@ public:
                                               const protob_t<const Backtrace> &bt);
     const std::string &get_pkey();
     datum_t get_row(env_t *env, datum_t pval);
+    // Like `get_row`, but reads all the rows with one query.
+    std::vector<datum_t> get_rows(env_t *env, const std::vector<datum_t> &pvals);
     counted_t<datum_stream_t> get_all(
             env_t *env,
             datum_t value,
@@ -84,7 +86,8 @@ public:
     MUST_USE bool sindex_create(
         env_t *env, const std::string &name,
         counted_t<const func_t> index_func, sindex_multi_bool_t multi,
-        sindex_geo_bool_t geo);
+        sindex_geo_bool_t geo,
+        const boost::optional<std::vector<std::string> > &cover);
     MUST_USE bool sindex_drop(env_t *env, const std::string &name);
     MUST_USE sindex_rename_result_t sindex_rename(
         env_t *env, const std::string &old_name,
@@ -1,12 +1,15 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/wire_func.hpp"
 
+#include <map>
+
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/archive/archive.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/ql2_extensions.pb.h"
 #include "rdb_protocol/term_walker.hpp"
 #include "stl_utils.hpp"
 
@@ -141,6 +144,87 @@ archive_result_t wire_func_t::rdb_deserialize(read_stream_t *s) {
 
 INSTANTIATE_SERIALIZABLE_SELF_SINCE_v1_13(wire_func_t);
 
+class wire_func_normalizing_visitor_t : public func_visitor_t {
+public:
+    explicit wire_func_normalizing_visitor_t(write_message_t *_wm) : wm(_wm) { }
+
+    void on_reql_func(const reql_func_t *reql_func) {
+        serialize<cluster_version_t::CLUSTER>(wm, wire_func_type_t::REQL);
+        // The captured variables keep their numbers, and so do their uses in the
+        // body, because we only renumber the variables that get bound.
+        serialize<cluster_version_t::CLUSTER>(wm, reql_func->captured_scope);
+        std::vector<sym_t> arg_names;
+        for (const sym_t &arg : reql_func->arg_names) {
+            arg_names.push_back(bind(arg));
+        }
+        serialize<cluster_version_t::CLUSTER>(wm, arg_names);
+        Term body = *reql_func->body->get_src();
+        normalize(&body);
+        serialize_protobuf(wm, body);
+    }
+
+    void on_js_func(const js_func_t *js_func) {
+        serialize<cluster_version_t::CLUSTER>(wm, wire_func_type_t::JS);
+        serialize<cluster_version_t::CLUSTER>(wm, js_func->js_source);
+        serialize<cluster_version_t::CLUSTER>(wm, js_func->js_timeout_ms);
+    }
+
+private:
+    // Drivers number their variables from 1 up, so the negative numbers we give
+    // the bound variables can't be confused with the captured ones.
+    sym_t bind(sym_t var) {
+        const int64_t normalized = -1 - static_cast<int64_t>(bound.size());
+        bound[var.value] = normalized;
+        return sym_t(normalized);
+    }
+
+    void bind_datum(Datum *d) {
+        if (d->type() == Datum::R_NUM) {
+            d->set_r_num(bind(sym_t(d->r_num())).value);
+        }
+    }
+
+    void normalize(Term *t) {
+        t->ClearExtension(ql2::extension::backtrace);
+        if (t->type() == Term::FUNC && t->args_size() == 2) {
+            // The variables are a literal array, either as a datum or as a
+            // `MAKE_ARRAY` of datums (see `func_term_t`).
+            Term *vars = t->mutable_args(0);
+            if (vars->type() == Term::DATUM) {
+                for (int i = 0; i < vars->datum().r_array_size(); ++i) {
+                    bind_datum(vars->mutable_datum()->mutable_r_array(i));
+                }
+            } else if (vars->type() == Term::MAKE_ARRAY) {
+                for (int i = 0; i < vars->args_size(); ++i) {
+                    bind_datum(vars->mutable_args(i)->mutable_datum());
+                }
+            }
+        } else if (t->type() == Term::VAR && t->args_size() == 1
+                   && t->args(0).datum().type() == Datum::R_NUM) {
+            auto it = bound.find(static_cast<int64_t>(t->args(0).datum().r_num()));
+            if (it != bound.end()) {
+                t->mutable_args(0)->mutable_datum()->set_r_num(it->second);
+            }
+        }
+        for (int i = 0; i < t->args_size(); ++i) {
+            normalize(t->mutable_args(i));
+        }
+        for (int i = 0; i < t->optargs_size(); ++i) {
+            normalize(t->mutable_optargs(i)->mutable_val());
+        }
+    }
+
+    write_message_t *wm;
+    // Maps the numbers of the variables bound so far to their new numbers.
+    std::map<int64_t, int64_t> bound;
+};
+
+void wire_func_t::serialize_normalized(write_message_t *wm) const {
+    r_sanity_check(func.has());
+    wire_func_normalizing_visitor_t v(wm);
+    func->visit(&v);
+}
+
 
 template <cluster_version_t W>
 void maybe_wire_func_t::rdb_serialize(write_message_t *wm) const {
@@ -38,6 +38,11 @@ public:
     counted_t<const func_t> compile_wire_func() const;
     protob_t<const Backtrace> get_bt() const;
 
+    // Serializes the function without its backtraces, and with the variables it
+    // binds renumbered in the order they're bound, so that the same function sent
+    // in two different queries comes out the same.  Can't be deserialized.
+    void serialize_normalized(write_message_t *wm) const;
+
     template <cluster_version_t W>
     void rdb_serialize(write_message_t *wm) const;
     template <cluster_version_t W>
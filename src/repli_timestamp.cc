@@ -12,8 +12,10 @@ void serialize(write_message_t *wm, repli_timestamp_t tstamp) {
     serialize<W>(wm, tstamp.longtime);
 }
 
-template void serialize<cluster_version_t::v1_15_is_latest>(write_message_t *wm,
-                                                            repli_timestamp_t tstamp);
+template void serialize<cluster_version_t::CLUSTER>(write_message_t *wm,
+                                                    repli_timestamp_t tstamp);
+template void serialize<cluster_version_t::LATEST_DISK>(write_message_t *wm,
+                                                        repli_timestamp_t tstamp);
 
 template <cluster_version_t W>
 MUST_USE archive_result_t deserialize(read_stream_t *s, repli_timestamp_t *tstamp) {
@@ -27,10 +27,10 @@
 #define MESSAGE_HANDLER_MAX_BATCH_SIZE           8
 
 // The cluster communication protocol version.
-static_assert(cluster_version_t::CLUSTER == cluster_version_t::v1_15_is_latest,
+static_assert(cluster_version_t::CLUSTER == cluster_version_t::v1_16_is_latest,
               "We need to update CLUSTER_VERSION_STRING when we add a new cluster "
               "version.");
-#define CLUSTER_VERSION_STRING "1.15"
+#define CLUSTER_VERSION_STRING "1.16"
 
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
 const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION_STRING);
@@ -128,13 +128,21 @@ void connectivity_cluster_t::connection_t::kill_connection() {
 connectivity_cluster_t::connection_t::connection_t(run_t *p,
                                               peer_id_t id,
                                               keepalive_tcp_conn_stream_t *c,
-                                              const peer_address_t &a) THROWS_NOTHING :
+                                              const peer_address_t &a,
+                                              bool compressed) THROWS_NOTHING :
     conn(c), peer_address(a),
+    compressor(compressed ? new cluster_compressor_t() : NULL),
     pm_collection(),
     pm_bytes_sent(secs_to_ticks(1), true),
+    pm_bytes_compressed(secs_to_ticks(1), true),
+    pm_compressed_bytes_sent(secs_to_ticks(1), true),
     pm_collection_membership(&p->parent->connectivity_collection, &pm_collection,
         uuid_to_str(id.get_uuid())),
     pm_bytes_sent_membership(&pm_collection, &pm_bytes_sent, "bytes_sent"),
+    pm_bytes_compressed_membership(&pm_collection, &pm_bytes_compressed,
+        "bytes_compressed"),
+    pm_compressed_bytes_sent_membership(&pm_collection, &pm_compressed_bytes_sent,
+        "compressed_bytes_sent"),
     parent(p), peer_id(id),
     drainers()
 {
@@ -166,8 +174,10 @@ connectivity_cluster_t::connection_t::~connection_t() THROWS_NOTHING {
         drainers.get()->drain();
     });
 
-    /* The drainers have been destroyed, so nothing can be holding the `send_mutex`. */
+    /* The drainers have been destroyed, so nothing can be holding the `send_mutex`
+    or waiting on a batch. */
     guarantee(!send_mutex.is_locked());
+    guarantee(!next_batch.has());
 }
 
 // Helper function for the `run_t` constructor's initialization list
@@ -204,7 +214,8 @@ static peer_address_t our_peer_address(std::set<ip_address_t> local_addresses,
 connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
                                      const std::set<ip_address_t> &local_addresses,
                                      const peer_address_t &canonical_addresses,
-                                     int port, int client_port)
+                                     int port, int client_port,
+                                     cluster_compression_t compression)
         THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t) :
     parent(p),
 
@@ -215,6 +226,8 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
     /* The local port to use when connecting to the cluster port of peers */
     cluster_client_port(client_port),
 
+    cluster_compression(compression),
+
     /* This sets `parent->current_run` to `this`. It's necessary to do it in the
     constructor of a subfield rather than in the body of the `run_t` constructor
     because `parent->current_run` needs to be set before `connection_to_ourself`
@@ -238,7 +251,7 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
     `connection_map` on each thread and notifying any listeners that we're now
     connected to ourself. The destructor will remove us from the
     `connection_map` and again notify any listeners. */
-    connection_to_ourself(this, parent->me, NULL, routing_table[parent->me]),
+    connection_to_ourself(this, parent->me, NULL, routing_table[parent->me], false),
 
     listener(new tcp_listener_t(
         cluster_listener_socket.get(),
@@ -885,10 +898,13 @@ void connectivity_cluster_t::run_t::handle(
         return;
     }
 
+    bool compressed = false;
     {
-        // Tell the other node that we are happy to connect with it
+        // Tell the other node that we are happy to connect with it, and whether we
+        // want the connection to be compressed.
         write_message_t wm;
         serialize_universal(&wm, handshake_result_t::success());
+        serialize_universal(&wm, static_cast<uint8_t>(cluster_compression));
         if (send_write_message(conn, &wm)) {
             return; // network error.
         }
@@ -904,6 +920,15 @@ void connectivity_cluster_t::run_t::handle(
                    sanitize_for_logger(handshake_result.get_error_reason()).c_str());
             return;
         }
+
+        // Find out whether the other side wants the connection to be compressed
+        // too.  Values we don't know are treated like `none`.
+        uint8_t remote_compression;
+        if (deserialize_universal_and_check(conn, &remote_compression, peername)) {
+            return;
+        }
+        compressed = cluster_compression == cluster_compression_t::zlib
+            && remote_compression == static_cast<uint8_t>(cluster_compression_t::zlib);
     }
 
     // Look up the ip addresses for the other host
@@ -1088,7 +1113,17 @@ void connectivity_cluster_t::run_t::handle(
         /* `connection_t` is the public interface of this coroutine. Its
         constructor registers it in the `connectivity_cluster_t`'s connection
         map. */
-        connection_t conn_structure(this, other_id, conn, *other_peer_addr.get());
+        connection_t conn_structure(this, other_id, conn, *other_peer_addr.get(),
+                                    compressed);
+
+        /* On a compressed connection, messages arrive in frames (see
+        `compression.hpp`). */
+        scoped_ptr_t<cluster_decompressing_stream_t> decompressor;
+        read_stream_t *messages = conn;
+        if (compressed) {
+            decompressor.init(new cluster_decompressing_stream_t(conn));
+            messages = decompressor.get();
+        }
 
         /* `heartbeat_manager` will periodically send a heartbeat message to
         other machines, and it will also close the connection if we don't
@@ -1105,7 +1140,7 @@ void connectivity_cluster_t::run_t::handle(
             int messages_handled_since_yield = 0;
             while (true) {
                 message_tag_t tag;
-                archive_result_t res = deserialize_universal(conn, &tag);
+                archive_result_t res = deserialize_universal(messages, &tag);
                 if (bad(res)) { throw fake_archive_exc_t(); }
 
                 /* Ignore messages tagged with the heartbeat tag. The
@@ -1123,7 +1158,7 @@ void connectivity_cluster_t::run_t::handle(
                     handler->on_message(
                         &conn_structure,
                         auto_drainer_t::lock_t(conn_structure.drainers.get()),
-                        conn); // might raise fake_archive_exc_t
+                        messages); // might raise fake_archive_exc_t
                 }
 
                 ++messages_handled_since_yield;
@@ -1190,6 +1225,30 @@ connectivity_cluster_t::connection_t *connectivity_cluster_t::get_connection(
     return conn;
 }
 
+/* `message_gathering_stream_t` collects what a message's write callback writes.
+Messages that are passed to it whole (see `send_write_message(write_stream_t *,
+write_message_t &&)`) are spliced in without copying their buffers, so that they can
+go to the socket with `writev()`. */
+class message_gathering_stream_t : public write_stream_t {
+public:
+    message_gathering_stream_t() { }
+
+    int64_t write(const void *p, int64_t n) {
+        message.append(p, n);
+        return n;
+    }
+
+    int take_message(write_message_t *wm) {
+        message.splice(wm);
+        return 0;
+    }
+
+    write_message_t message;
+
+private:
+    DISABLE_COPYING(message_gathering_stream_t);
+};
+
 void connectivity_cluster_t::send_message(connection_t *connection,
                                      auto_drainer_t::lock_t connection_keepalive,
                                      message_tag_t tag,
@@ -1201,27 +1260,25 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     // reconnect.)
     const cluster_version_t cluster_version = cluster_version_t::CLUSTER;
 
-    /* We currently write the message to a vector_stream_t, then
-       serialize that as a string. It's horribly inefficient, of course. */
-    // TODO: If we don't do it this way, we (or the caller) will need
-    // to worry about having the writer run on the connection thread.
-    vector_stream_t buffer;
-    // Reserve some space to reduce overhead (especially for small messages)
-    buffer.reserve(1024);
+    /* The callback writes the message into buffers on this thread, and we hand those
+    buffers to the connection's thread as they are. */
+    message_gathering_stream_t stream;
     {
         ASSERT_FINITE_CORO_WAITING;
-        callback->write(cluster_version, &buffer);
+        callback->write(cluster_version, &stream);
     }
 
 #ifdef CLUSTER_MESSAGE_DEBUGGING
     {
+        vector_stream_t flattened;
+        send_write_message(&flattened, &stream.message);
         printf_buffer_t buf;
         buf.appendf("from ");
         debug_print(&buf, me);
         buf.appendf(" to ");
         debug_print(&buf, dest);
         buf.appendf("\n");
-        print_hd(buffer.vector().data(), 0, buffer.vector().size());
+        print_hd(flattened.vector().data(), 0, flattened.vector().size());
     }
 #endif
 
@@ -1235,10 +1292,14 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     }
 #endif
 
-    size_t bytes_sent = buffer.vector().size();
+    size_t bytes_sent = stream.message.size();
 
     if (connection->is_loopback()) {
         // We could be on any thread here! Oh no!
+        vector_stream_t buffer;
+        buffer.reserve(bytes_sent);
+        int res = send_write_message(&buffer, &stream.message);
+        guarantee(res == 0);
         std::vector<char> buffer_data;
         buffer.swap(&buffer_data);
         rassert(message_handlers[tag], "No message handler for tag %" PRIu8, tag);
@@ -1247,44 +1308,61 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     } else {
         on_thread_t threader(connection->conn->home_thread());
 
-        /* Acquire the send-mutex so we don't collide with other things trying
-        to send on the same connection. */
-        mutex_t::acq_t acq(&connection->send_mutex);
+        /* Messages that are sent to the same connection in the same tick go out
+        together in one batch. The first of them leads the batch: it yields so that
+        the others can join, then writes the whole batch with one `writev()`. */
+        counted_t<outgoing_batch_t> batch = connection->next_batch;
+        const bool leader = !batch.has();
+        if (leader) {
+            batch = make_counted<outgoing_batch_t>();
+            connection->next_batch = batch;
+        }
 
-        /* Write the tag to the network */
-        {
-            // All cluster versions use a uint8_t tag here.
-            write_message_t wm;
-            static_assert(std::is_same<message_tag_t, uint8_t>::value,
-                          "We expect to be serializing a uint8_t -- if this has "
-                          "changed, the cluster communication format has changed and "
-                          "you need to ask yourself whether live cluster upgrades work."
-                          );
-            serialize_universal(&wm, tag);
-            int res = send_write_message(connection->conn, &wm);
-            if (res == -1) {
-                if (connection->conn->is_read_open()) {
-                    connection->conn->shutdown_read();
+        // All cluster versions use a uint8_t tag here.
+        static_assert(std::is_same<message_tag_t, uint8_t>::value,
+                      "We expect to be serializing a uint8_t -- if this has "
+                      "changed, the cluster communication format has changed and "
+                      "you need to ask yourself whether live cluster upgrades work."
+                      );
+        serialize_universal(&batch->message, tag);
+        batch->message.splice(&stream.message);
+
+        if (leader) {
+            coro_t::yield();
+
+            /* Acquire the send-mutex so we don't collide with an earlier batch that
+            is still being written. */
+            mutex_t::acq_t acq(&connection->send_mutex);
+
+            /* Messages that arrive from now on go in the next batch. */
+            rassert(connection->next_batch.get() == batch.get());
+            connection->next_batch.reset();
+            int res;
+            if (connection->compressor.has()) {
+                const size_t batch_size = batch->message.size();
+                write_message_t frame;
+                if (connection->compressor->make_frame(&batch->message, &frame)) {
+                    connection->pm_bytes_compressed.record(batch_size);
+                    connection->pm_compressed_bytes_sent.record(frame.size());
                 }
-                return;
+                res = send_write_message(connection->conn, std::move(frame));
+            } else {
+                res = send_write_message(connection->conn, std::move(batch->message));
             }
+            batch->failed = (res == -1);
+            batch->done.pulse();
+        } else {
+            batch->done.wait();
         }
 
-        /* Write the message itself to the network */
-        {
-            int64_t res = connection->conn->write(buffer.vector().data(),
-                                                  buffer.vector().size());
-            if (res == -1) {
-                /* Close the other half of the connection to make sure that
-                   `connectivity_cluster_t::run_t::handle()` notices that something is
-                   up */
-                if (connection->conn->is_read_open()) {
-                    connection->conn->shutdown_read();
-                }
-                return;
-            } else {
-                guarantee(res == static_cast<int64_t>(buffer.vector().size()));
+        if (batch->failed) {
+            /* Close the other half of the connection to make sure that
+               `connectivity_cluster_t::run_t::handle()` notices that something is
+               up */
+            if (connection->conn->is_read_open()) {
+                connection->conn->shutdown_read();
             }
+            return;
         }
     }
 
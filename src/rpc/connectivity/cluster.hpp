@@ -10,12 +10,15 @@
 
 #include "arch/types.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/mutex.hpp"
 #include "concurrency/one_per_thread.hpp"
 #include "concurrency/watchable.hpp"
 #include "containers/archive/tcp_conn_stream.hpp"
+#include "containers/counted.hpp"
 #include "containers/map_sentries.hpp"
 #include "perfmon/perfmon.hpp"
+#include "rpc/connectivity/compression.hpp"
 #include "rpc/connectivity/peer_id.hpp"
 #include "utils.hpp"
 
@@ -74,6 +77,19 @@ public:
 
     class run_t;
 
+    /* Messages that `send_message()` writes to a connection together, with one
+    `writev()`. */
+    class outgoing_batch_t : public single_threaded_countable_t<outgoing_batch_t> {
+    public:
+        outgoing_batch_t() : failed(false) { }
+        write_message_t message;
+        /* Pulsed once `message` has been written, or `failed` has been set. */
+        cond_t done;
+        bool failed;
+    private:
+        DISABLE_COPYING(outgoing_batch_t);
+    };
+
     /* `connection_t` represents an open connection to another machine. If we lose
     contact with another machine and then regain it, then a new `connection_t` will be
     created. Generally, any code that handles a `connection_t *` will also carry around a
@@ -112,7 +128,7 @@ public:
         /* The constructor registers us in every thread's `connections` map, thereby
         notifying event subscribers. */
         connection_t(run_t *, peer_id_t, keepalive_tcp_conn_stream_t *,
-                const peer_address_t &peer) THROWS_NOTHING;
+                const peer_address_t &peer, bool compressed) THROWS_NOTHING;
         ~connection_t() THROWS_NOTHING;
 
         /* NULL for the loopback connection (i.e. our "connection" to ourself) */
@@ -126,9 +142,23 @@ public:
         /* Unused for our connection to ourself */
         mutex_t send_mutex;
 
+        /* The batch that messages sent to this connection join until its first
+        sender gets the `send_mutex` and writes it.  Empty if there's none.  Unused
+        for our connection to ourself. */
+        counted_t<outgoing_batch_t> next_batch;
+
+        /* Makes the frames we send if the connection is compressed; empty if it
+        isn't. Only used while holding the `send_mutex`. */
+        scoped_ptr_t<cluster_compressor_t> compressor;
+
         perfmon_collection_t pm_collection;
         perfmon_sampler_t pm_bytes_sent;
+        /* How many bytes of messages went into compressed frames, and how many bytes
+        those frames took. */
+        perfmon_sampler_t pm_bytes_compressed, pm_compressed_bytes_sent;
         perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
+        perfmon_membership_t pm_bytes_compressed_membership,
+            pm_compressed_bytes_sent_membership;
 
         /* We only hold this information so we can deregister ourself */
         run_t *parent;
@@ -148,7 +178,8 @@ public:
         run_t(connectivity_cluster_t *parent,
               const std::set<ip_address_t> &local_addresses,
               const peer_address_t &canonical_addresses,
-              int port, int client_port)
+              int port, int client_port,
+              cluster_compression_t compression = cluster_compression_t::none)
             THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t);
 
         ~run_t();
@@ -247,6 +278,9 @@ public:
         int cluster_listener_port;
         int cluster_client_port;
 
+        /* Whether we ask for our connections to be compressed. */
+        const cluster_compression_t cluster_compression;
+
         variable_setter_t register_us_with_parent;
 
         map_insertion_sentry_t<peer_id_t, peer_address_t> routing_table_entry_for_ourself;
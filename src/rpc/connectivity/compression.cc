@@ -0,0 +1,152 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rpc/connectivity/compression.hpp"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+cluster_compressor_t::cluster_compressor_t() {
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    int res = deflateInit(&zstream, Z_BEST_SPEED);
+    guarantee(res == Z_OK, "deflateInit failed with error %d", res);
+}
+
+cluster_compressor_t::~cluster_compressor_t() {
+    deflateEnd(&zstream);
+}
+
+void write_frame_header(cluster_frame_type_t type, size_t size,
+                        write_message_t *frame_out) {
+    guarantee(size <= std::numeric_limits<uint32_t>::max(),
+              "A cluster frame would be too large (%zu bytes).", size);
+    serialize_universal(frame_out, static_cast<uint8_t>(type));
+    serialize_universal(frame_out, static_cast<uint32_t>(size));
+}
+
+bool cluster_compressor_t::make_frame(write_message_t *message,
+                                      write_message_t *frame_out) {
+    const size_t size = message->size();
+    if (size < MIN_COMPRESSED_SIZE) {
+        write_frame_header(cluster_frame_type_t::raw, size, frame_out);
+        frame_out->splice(message);
+        return false;
+    }
+
+    /* Every frame ends with a sync flush, so that the other end can inflate all of
+    it without waiting for the next one. */
+    write_message_t payload;
+    char out[write_buffer_t::DATA_SIZE];
+    intrusive_list_t<write_buffer_t> *buffers = message->unsafe_expose_buffers();
+    for (write_buffer_t *b = buffers->head(); b != NULL; b = buffers->next(b)) {
+        const int flush = buffers->next(b) == NULL ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        zstream.next_in = reinterpret_cast<Bytef *>(b->data);
+        zstream.avail_in = b->size;
+        do {
+            zstream.next_out = reinterpret_cast<Bytef *>(out);
+            zstream.avail_out = sizeof(out);
+            int res = deflate(&zstream, flush);
+            guarantee(res == Z_OK || res == Z_BUF_ERROR,
+                      "deflate failed with error %d", res);
+            payload.append(out, sizeof(out) - zstream.avail_out);
+        } while (zstream.avail_out == 0);
+        rassert(zstream.avail_in == 0);
+    }
+
+    // Leave `*message` empty, as for an uncompressed frame.
+    write_message_t consumed;
+    consumed.splice(message);
+
+    write_frame_header(cluster_frame_type_t::zlib, payload.size(), frame_out);
+    frame_out->splice(&payload);
+    return true;
+}
+
+cluster_decompressing_stream_t::cluster_decompressing_stream_t(read_stream_t *_inner)
+    : inner(_inner), raw_remaining(0), inflated_pos(0) {
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    zstream.next_in = Z_NULL;
+    zstream.avail_in = 0;
+    int res = inflateInit(&zstream);
+    guarantee(res == Z_OK, "inflateInit failed with error %d", res);
+}
+
+cluster_decompressing_stream_t::~cluster_decompressing_stream_t() {
+    inflateEnd(&zstream);
+}
+
+int64_t cluster_decompressing_stream_t::read(void *p, int64_t n) {
+    while (true) {
+        if (inflated_pos < inflated.size()) {
+            const int64_t count = std::min<int64_t>(n, inflated.size() - inflated_pos);
+            memcpy(p, inflated.data() + inflated_pos, count);
+            inflated_pos += count;
+            return count;
+        }
+        if (raw_remaining > 0) {
+            int64_t res = inner->read(p, std::min<int64_t>(n, raw_remaining));
+            if (res > 0) {
+                raw_remaining -= res;
+            }
+            return res;
+        }
+        int64_t res = read_frame();
+        if (res != 1) {
+            return res;
+        }
+    }
+}
+
+int64_t cluster_decompressing_stream_t::read_frame() {
+    uint8_t type;
+    uint32_t size;
+    archive_result_t res = deserialize_universal(inner, &type);
+    if (res == archive_result_t::SUCCESS) {
+        res = deserialize_universal(inner, &size);
+    }
+    if (res == archive_result_t::SOCK_EOF) {
+        return 0;
+    } else if (res != archive_result_t::SUCCESS) {
+        return -1;
+    }
+
+    if (type == static_cast<uint8_t>(cluster_frame_type_t::raw)) {
+        raw_remaining = size;
+        return 1;
+    } else if (type != static_cast<uint8_t>(cluster_frame_type_t::zlib)) {
+        return -1;
+    }
+
+    std::vector<char> payload(size);
+    int64_t read_res = force_read(inner, payload.data(), size);
+    if (read_res != static_cast<int64_t>(size)) {
+        return read_res == -1 ? -1 : 0;
+    }
+
+    inflated.clear();
+    inflated_pos = 0;
+    zstream.next_in = reinterpret_cast<Bytef *>(payload.data());
+    zstream.avail_in = size;
+    do {
+        const size_t old_size = inflated.size();
+        const size_t chunk_size = std::max<size_t>(4 * size, write_buffer_t::DATA_SIZE);
+        inflated.resize(old_size + chunk_size);
+        zstream.next_out = reinterpret_cast<Bytef *>(inflated.data() + old_size);
+        zstream.avail_out = chunk_size;
+        int inflate_res = inflate(&zstream, Z_SYNC_FLUSH);
+        inflated.resize(old_size + chunk_size - zstream.avail_out);
+        if (inflate_res != Z_OK && inflate_res != Z_BUF_ERROR) {
+            return -1;
+        }
+        if (inflate_res == Z_BUF_ERROR && zstream.avail_out > 0
+            && zstream.avail_in > 0) {
+            // No progress was possible.
+            return -1;
+        }
+    } while (zstream.avail_in > 0 || zstream.avail_out == 0);
+    return 1;
+}
@@ -0,0 +1,78 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_COMPRESSION_HPP_
+#define RPC_CONNECTIVITY_COMPRESSION_HPP_
+
+#include <zlib.h>
+
+#include <vector>
+
+#include "containers/archive/archive.hpp"
+
+/* Whether a node compresses its connections to other nodes.  A connection is
+compressed if both of its ends ask for it; this is negotiated during the handshake in
+`connectivity_cluster_t::run_t::handle()`.  The numeric values are part of the
+handshake. */
+enum class cluster_compression_t : uint8_t {
+    none = 0,
+    zlib = 1
+};
+
+/* On a compressed connection, what `connectivity_cluster_t::send_message()` writes is
+cut into frames.  Each frame is a `uint8_t` frame type, the size of the payload as a
+`uint32_t`, and the payload.  The payloads of `zlib` frames are consecutive pieces of
+one deflate stream per direction, so later frames can refer back to data in earlier
+ones. */
+enum class cluster_frame_type_t : uint8_t {
+    raw = 'r',
+    zlib = 'z'
+};
+
+/* `cluster_compressor_t` makes the frames that one end of a connection sends. */
+class cluster_compressor_t {
+public:
+    /* Batches of messages smaller than this go out in `raw` frames, so that
+    heartbeats and small mailbox messages don't pay for compression. */
+    static const size_t MIN_COMPRESSED_SIZE = 512;
+
+    cluster_compressor_t();
+    ~cluster_compressor_t();
+
+    /* Moves the contents of `*message` into a new frame at the end of `*frame_out`.
+    Returns `true` if the frame is compressed. */
+    bool make_frame(write_message_t *message, write_message_t *frame_out);
+
+private:
+    z_stream zstream;
+
+    DISABLE_COPYING(cluster_compressor_t);
+};
+
+/* `cluster_decompressing_stream_t` reads the frames that a `cluster_compressor_t`
+made from `inner`, and returns their contents.  Corrupt frames are read errors. */
+class cluster_decompressing_stream_t : public read_stream_t {
+public:
+    explicit cluster_decompressing_stream_t(read_stream_t *inner);
+    ~cluster_decompressing_stream_t();
+
+    MUST_USE int64_t read(void *p, int64_t n);
+
+private:
+    /* Reads the next frame header, and the payload if it's compressed.  Returns the
+    same as `read()`, except that it returns 1 on success. */
+    int64_t read_frame();
+
+    read_stream_t *inner;
+    z_stream zstream;
+
+    /* The part of the current `raw` frame that hasn't been read from `inner`. */
+    uint32_t raw_remaining;
+
+    /* The inflated payload of the current `zlib` frame, and how much of it has been
+    returned. */
+    std::vector<char> inflated;
+    size_t inflated_pos;
+
+    DISABLE_COPYING(cluster_decompressing_stream_t);
+};
+
+#endif  // RPC_CONNECTIVITY_COMPRESSION_HPP_
@@ -103,7 +103,7 @@ public:
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, initial_value);
         serialize_for_version(cluster_version, &wm, metadata_fifo_state);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) {
             throw fake_archive_exc_t();
         }
@@ -130,7 +130,7 @@ public:
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, new_value);
         serialize_for_version(cluster_version, &wm, metadata_fifo_token);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) {
             throw fake_archive_exc_t();
         }
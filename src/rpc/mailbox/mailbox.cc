@@ -79,15 +79,12 @@ public:
         subwriter->write(cluster_version, &wm);
 
         // Prepend the message length.
-        // TODO: It would be more efficient if we could make this part of `msg`.
-        //  e.g. with a `prepend()` method on write_message_t.
         write_message_t length_msg;
         serialize_universal(&length_msg,
                             static_cast<uint64_t>(wm.size()) - prefix_length);
+        length_msg.splice(&wm);
 
-        int res = send_write_message(stream, &length_msg);
-        if (res) { throw fake_archive_exc_t(); }
-        res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(length_msg));
         if (res) { throw fake_archive_exc_t(); }
     }
 private:
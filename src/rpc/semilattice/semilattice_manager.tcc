@@ -117,7 +117,7 @@ public:
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, md);
         serialize_for_version(cluster_version, &wm, mdv);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) { throw fake_archive_exc_t(); }
     }
 private:
@@ -139,7 +139,7 @@ public:
         uint8_t code = message_code_sync_from_query;
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, query_id);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) { throw fake_archive_exc_t(); }
     }
 private:
@@ -161,7 +161,7 @@ public:
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, query_id);
         serialize_for_version(cluster_version, &wm, version);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) { throw fake_archive_exc_t(); }
     }
 private:
@@ -184,7 +184,7 @@ public:
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, query_id);
         serialize_for_version(cluster_version, &wm, version);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) { throw fake_archive_exc_t(); }
     }
 private:
@@ -206,7 +206,7 @@ public:
         uint8_t code = message_code_sync_to_reply;
         serialize_universal(&wm, code);
         serialize_for_version(cluster_version, &wm, query_id);
-        int res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, std::move(wm));
         if (res) { throw fake_archive_exc_t(); }
     }
 private:
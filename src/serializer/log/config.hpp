@@ -26,11 +26,27 @@ struct log_serializer_dynamic_config_t {
     bool read_ahead;
 };
 
+/* How the serializer stores full-size data blocks.  The numeric values are part of
+the on-disk format.  With `zlib`, a block is deflated before it is packed into an
+extent whenever that makes it take up fewer device blocks, and inflated again by
+`block_read`.  Files created before this existed read back as `none`, because the
+unused part of the static header is zeroed. */
+enum class block_compression_t : uint32_t {
+    none = 0,
+    zlib = 1
+};
+
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(block_compression_t, int8_t,
+                                      block_compression_t::none,
+                                      block_compression_t::zlib);
+
 /* This is equivalent to log_serializer_static_config_t below, but is an on-disk
 structure. Changes to this change the on-disk database format! */
 struct log_serializer_on_disk_static_config_t {
     uint64_t block_size_;
     uint64_t extent_size_;
+    block_compression_t block_compression_;
+    uint32_t padding_;
 
     // Some helpers
     uint64_t blocks_per_extent() const { return extent_size_ / block_size_; }
@@ -39,6 +55,7 @@ struct log_serializer_on_disk_static_config_t {
     // Minimize calls to these.
     max_block_size_t max_block_size() const { return max_block_size_t::unsafe_make(block_size_); }
     uint64_t extent_size() const { return extent_size_; }
+    block_compression_t block_compression() const { return block_compression_; }
 };
 
 /* Configuration for the serializer that is set when the database is created */
@@ -46,11 +63,13 @@ struct log_serializer_static_config_t : public log_serializer_on_disk_static_con
     log_serializer_static_config_t() {
         extent_size_ = DEFAULT_EXTENT_SIZE;
         block_size_ = DEFAULT_BTREE_BLOCK_SIZE;
+        block_compression_ = block_compression_t::none;
+        padding_ = 0;
     }
 };
 
-RDB_MAKE_SERIALIZABLE_2(log_serializer_static_config_t,
-                        block_size_, extent_size_);
+RDB_MAKE_SERIALIZABLE_3(log_serializer_static_config_t,
+                        block_size_, extent_size_, block_compression_);
 
 #endif /* SERIALIZER_LOG_CONFIG_HPP_ */
 
@@ -5,6 +5,7 @@
 #include <sys/uio.h>
 
 #include <functional>
+#include <limits>
 
 #include "arch/arch.hpp"
 #include "arch/runtime/coroutines.hpp"
@@ -51,6 +52,13 @@ const size_t GC_YOUNG_EXTENT_MAX_SIZE = 50;
 // What's the definition of a "young" extent in microseconds?
 const microtime_t GC_YOUNG_EXTENT_TIMELIMIT_MICROS = 50000;
 
+// A block whose previous version is on an extent we started writing to longer ago
+// than this is considered cold, and written to the cold active extent.
+const microtime_t GC_COLD_BLOCK_AGE_MICROS = 30 * MILLION;
+
+// How many of the least recently scored extents we rescore before GCing an extent.
+const size_t GC_RESCORES_PER_EXTENT = 64;
+
 
 // Identifies an extent, the time we started writing to the
 // extent, whether it's the extent we're currently writing to, and
@@ -70,6 +78,8 @@ public:
         : parent(_parent),
           extent_ref(parent->extent_manager->gen_extent()),
           timestamp(current_microtime()),
+          our_pq_entry(NULL),
+          gc_score(0),
           was_written(false),
           state(state_active),
           garbage_bytes_stat(_parent->static_config->extent_size()),
@@ -84,6 +94,8 @@ public:
         : parent(_parent),
           extent_ref(parent->extent_manager->reserve_extent(_offset)),
           timestamp(current_microtime()),
+          our_pq_entry(NULL),
+          gc_score(0),
           was_written(false),
           state(state_reconstructing),
           garbage_bytes_stat(_parent->static_config->extent_size()),
@@ -192,6 +204,26 @@ public:
 
     bool all_garbage() const { return num_live_blocks() == 0; }
 
+    // The cost-benefit of GCing this extent: its age times the space we get back,
+    // over the live data we'd have to copy to get it.  Older extents are favored
+    // because their remaining live blocks are unlikely to become garbage on their
+    // own any time soon.
+    double compute_gc_score(microtime_t now) const {
+        const uint32_t garbage = garbage_bytes();
+        const uint32_t live = parent->static_config->extent_size() - garbage;
+        if (live == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        // Add a second so that extents of the same age are still ordered by their
+        // garbage.
+        const double age_secs = 1.0 + (now > timestamp ? now - timestamp : 0) / 1e6;
+        return age_secs * garbage / live;
+    }
+
+    void update_gc_score(microtime_t now) {
+        gc_score = compute_gc_score(now);
+    }
+
     uint32_t garbage_bytes() const {
         rassert(compute_garbage_bytes() == garbage_bytes_stat);
         return garbage_bytes_stat;
@@ -362,24 +394,30 @@ private:
 public:
     extent_reference_t extent_ref;
 
-    // When we started writing to the extent (this time).
+    // When we started writing to the extent (this time).  This isn't persisted:
+    // extents reconstructed at startup get the startup time, so after a restart
+    // their blocks all count as hot for GC_COLD_BLOCK_AGE_MICROS and their GC
+    // scores differ only by their garbage until the ages spread out again.
     const microtime_t timestamp;
 
     // The PQ entry pointing to us.
     priority_queue_t<gc_entry_t *, gc_entry_less_t>::entry_t *our_pq_entry;
 
+    // Our priority in the PQ, as of the last time update_gc_score() was called.
+    double gc_score;
+
     // True iff the extent has been written to after starting up the serializer.
     bool was_written;
 
     enum state_t {
         // It has been, or is being, reconstructed from data on disk.
         state_reconstructing,
-        // We are currently putting things on this extent. It is equal to
-        // last_data_extent.
+        // We are currently putting things on this extent. It is one of
+        // active_extents.
         state_active,
         // Not active, but not a GC candidate yet. It is in young_extent_queue.
         state_young,
-        // Candidate to be GCed. It is in gc_pq.
+        // Candidate to be GCed. It is in gc_pq and gc_rescore_queue.
         state_old,
         // Currently being GCed. It is equal to `current_entry` in one of `active_gcs`.
         state_in_gc
@@ -408,6 +446,9 @@ data_block_manager_t::data_block_manager_t(
       static_config(_static_config), extent_manager(em), serializer(_serializer),
       gc_stats(stats)
 {
+    for (size_t i = 0; i < NUM_EXTENT_CLASSES; ++i) {
+        active_extents[i] = NULL;
+    }
     rassert(static_config != NULL);
     rassert(extent_manager != NULL);
     rassert(serializer != NULL);
@@ -466,7 +507,7 @@ void data_block_manager_t::start_existing(file_t *file,
             reconstructed_extents.push_back(e);
         }
 
-        active_extent = entries.get(offset / extent_manager->extent_size);
+        gc_entry_t *active_extent = entries.get(offset / extent_manager->extent_size);
         guarantee(active_extent != NULL);
 
         /* Turn the extent from a reconstructing extent into an active extent */
@@ -474,19 +515,21 @@ void data_block_manager_t::start_existing(file_t *file,
         reconstructed_extents.remove(active_extent);
 
         active_extent->make_active();
-    } else {
-        active_extent = NULL;
+        active_extents[HOT_EXTENT] = active_extent;
     }
 
     /* Convert any extents that we found live blocks in, but that are not active
     extents, into old extents */
+    const microtime_t now = current_microtime();
     while (gc_entry_t *entry = reconstructed_extents.head()) {
         reconstructed_extents.remove(entry);
 
         guarantee(entry->state == gc_entry_t::state_reconstructing);
         entry->state = gc_entry_t::state_old;
 
+        entry->update_gc_score(now);
         entry->our_pq_entry = gc_pq.push(entry);
+        gc_rescore_queue.push_back(entry);
 
         gc_stats.old_total_block_bytes += static_config->extent_size();
         gc_stats.old_garbage_block_bytes += entry->garbage_bytes();
@@ -658,15 +701,25 @@ public:
                     continue;
                 }
 
-                const block_size_t block_size = block_size_t::unsafe_make(info.ser_block_size);
-                buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(block_size);
-                memcpy(buf.ser_buffer(), current_buf, info.ser_block_size);
-                buf.fill_padding_zero();
-                guarantee(info.ser_block_size <= *(lower_it + 1) - *lower_it);
+                const uint32_t on_disk_size
+                    = lba_ser_block_size_on_disk(info.ser_block_size);
+                guarantee(on_disk_size <= *(lower_it + 1) - *lower_it);
+
+                buf_ptr_t buf;
+                if (lba_ser_block_size_is_compressed(info.ser_block_size)) {
+                    buf = parent->serializer->decompress_block(
+                        reinterpret_cast<const ser_buffer_t *>(current_buf),
+                        block_size_t::unsafe_make(on_disk_size));
+                } else {
+                    buf = buf_ptr_t::alloc_uninitialized(
+                        block_size_t::unsafe_make(on_disk_size));
+                    memcpy(buf.ser_buffer(), current_buf, on_disk_size);
+                    buf.fill_padding_zero();
+                }
 
                 counted_t<ls_block_token_pointee_t> ls_token
-                    = parent->serializer->generate_block_token(current_offset,
-                                                               block_size);
+                    = parent->serializer->generate_block_token_from_index(
+                        current_offset, info.ser_block_size);
 
                 counted_t<standard_block_token_t> token
                     = to_standard_block_token(block_id, std::move(ls_token));
@@ -732,14 +785,74 @@ buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
     }
 }
 
+data_block_manager_t::extent_class_t
+data_block_manager_t::classify_write(block_id_t block_id, microtime_t now) {
+    // We judge how often a block gets written by how long its current version has
+    // been around, going by when we started writing to the extent it's on.
+    const flagged_off64_t old_offset = serializer->lba_index->get_block_offset(block_id);
+    if (!old_offset.has_value()) {
+        return HOT_EXTENT;
+    }
+    gc_entry_t *entry = entries.get(static_config->extent_index(old_offset.get_value()));
+    if (entry == NULL || entry->state == gc_entry_t::state_active
+        || now < entry->timestamp + GC_COLD_BLOCK_AGE_MICROS) {
+        return HOT_EXTENT;
+    }
+    return COLD_EXTENT;
+}
+
 std::vector<counted_t<ls_block_token_pointee_t> >
 data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
                                   file_account_t *io_account,
                                   iocallback_t *cb) {
+    const microtime_t now = current_microtime();
+    std::vector<extent_class_t> classes;
+    classes.reserve(writes.size());
+    for (auto it = writes.begin(); it != writes.end(); ++it) {
+        classes.push_back(classify_write(it->block_id, now));
+    }
+    account_block_writes(writes, false);
+    return write_blocks(writes, classes, io_account, cb);
+}
+
+std::vector<counted_t<ls_block_token_pointee_t> >
+data_block_manager_t::write_blocks(const std::vector<buf_write_info_t> &writes,
+                                   const std::vector<extent_class_t> &classes,
+                                   file_account_t *io_account,
+                                   iocallback_t *cb) {
+    guarantee(classes.size() == writes.size());
+
+    // Split the writes up by extent class, remembering where each one came from.
+    std::vector<buf_write_info_t> class_writes[NUM_EXTENT_CLASSES];
+    std::vector<size_t> class_write_indices[NUM_EXTENT_CLASSES];
+    for (size_t i = 0; i < writes.size(); ++i) {
+        class_writes[classes[i]].push_back(writes[i]);
+        class_write_indices[classes[i]].push_back(i);
+    }
+
     // These tokens are grouped by extent.  You can do a contiguous write in each
-    // extent.
-    std::vector<std::vector<counted_t<ls_block_token_pointee_t> > > token_groups
-        = gimme_some_new_offsets(writes);
+    // extent.  token_group_indices[i][j] is the index in `writes` of
+    // token_groups[i][j].
+    std::vector<std::vector<counted_t<ls_block_token_pointee_t> > > token_groups;
+    std::vector<std::vector<size_t> > token_group_indices;
+    for (size_t c = 0; c < NUM_EXTENT_CLASSES; ++c) {
+        if (class_writes[c].empty()) {
+            continue;
+        }
+        std::vector<std::vector<counted_t<ls_block_token_pointee_t> > > groups
+            = gimme_some_new_offsets(class_writes[c], static_cast<extent_class_t>(c));
+        size_t write_number = 0;
+        for (auto it = groups.begin(); it != groups.end(); ++it) {
+            std::vector<size_t> indices;
+            for (size_t j = 0; j < it->size(); ++j) {
+                indices.push_back(class_write_indices[c][write_number]);
+                ++write_number;
+            }
+            token_groups.push_back(std::move(*it));
+            token_group_indices.push_back(std::move(indices));
+        }
+        guarantee(write_number == class_writes[c].size());
+    }
 
     for (auto it = writes.begin(); it != writes.end(); ++it) {
         it->buf->ser_header.block_id = it->block_id;
@@ -765,12 +878,11 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
     intermediate_cb->ops_remaining = token_groups.size() + 1;
     intermediate_cb->cb = cb;
 
-    size_t write_number = 0;
     for (size_t i = 0; i < token_groups.size(); ++i) {
 
         const int64_t front_offset = token_groups[i].front()->offset();
         const int64_t back_offset = token_groups[i].back()->offset()
-            + gc_entry_t::aligned_value(token_groups[i].back()->block_size());
+            + gc_entry_t::aligned_value(token_groups[i].back()->on_disk_block_size());
 
         guarantee(divides(DEVICE_BLOCK_SIZE, front_offset));
 
@@ -782,19 +894,18 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
 
         for (size_t j = 0; j < token_groups[i].size(); ++j) {
             const int64_t j_offset = token_groups[i][j]->offset();
-            const block_size_t j_block_size = token_groups[i][j]->block_size();
+            const block_size_t j_block_size = token_groups[i][j]->on_disk_block_size();
             guarantee(j_offset == last_written_offset);
             const size_t j_aligned_size = gc_entry_t::aligned_value(j_block_size);
 
             // The behavior of gimme_some_new_offsets is supposed to retain order, so
             // we expect writes[write_number] to have the currently-relevant write.
+            const size_t write_number = token_group_indices[i][j];
             guarantee(writes[write_number].block_size == j_block_size);
 
             iovecs[j].iov_base = writes[write_number].buf;
             iovecs[j].iov_len = j_aligned_size;
             last_written_offset = j_offset + j_aligned_size;
-
-            ++write_number;
         }
 
         guarantee(last_written_offset == back_offset);
@@ -807,11 +918,10 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
     // earlier).
     intermediate_cb->on_io_complete();
 
-    std::vector<counted_t<ls_block_token_pointee_t> > ret;
-    ret.reserve(writes.size());
-    for (auto it = token_groups.begin(); it != token_groups.end(); ++it) {
-        for (auto jt = it->begin(); jt != it->end(); ++jt) {
-            ret.push_back(std::move(*jt));
+    std::vector<counted_t<ls_block_token_pointee_t> > ret(writes.size());
+    for (size_t i = 0; i < token_groups.size(); ++i) {
+        for (size_t j = 0; j < token_groups[i].size(); ++j) {
+            ret[token_group_indices[i][j]] = std::move(token_groups[i][j]);
         }
     }
 
@@ -846,6 +956,7 @@ void data_block_manager_t::check_and_handle_empty_extent(uint64_t extent_id) {
             /* Remove from the priority queue */
             case gc_entry_t::state_old:
                 gc_pq.remove(entry->our_pq_entry);
+                gc_rescore_queue.remove(entry);
                 gc_stats.old_total_block_bytes -= static_config->extent_size();
                 gc_stats.old_garbage_block_bytes -= static_config->extent_size();
                 break;
@@ -877,7 +988,7 @@ void data_block_manager_t::check_and_handle_empty_extent(uint64_t extent_id) {
         destroy_entry(entry);
 
     } else if (entry->state == gc_entry_t::state_old) {
-        entry->our_pq_entry->update();
+        rescore_gc_entry(entry, current_microtime());
     }
 }
 
@@ -1050,11 +1161,14 @@ void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
 
         ++stats->pm_serializer_data_extents_gced;
 
+        rescore_stalest_gc_entries();
+
         /* grab the entry */
         guarantee (!gc_pq.empty());
         guarantee(gc_state->current_entry == NULL);
         gc_state->current_entry = gc_pq.pop();
         gc_state->current_entry->our_pq_entry = NULL;
+        gc_rescore_queue.remove(gc_state->current_entry);
 
         guarantee(gc_state->current_entry->state == gc_entry_t::state_old);
         gc_state->current_entry->state = gc_entry_t::state_in_gc;
@@ -1218,8 +1332,14 @@ void data_block_manager_t::write_gcs(const std::vector<gc_write_t> &writes,
                                                   writes[i].buf->ser_header.block_id));
         }
 
-        new_block_tokens = many_writes(the_writes, choose_gc_io_account(),
-                                       &block_write_cond);
+        // Blocks that survived until GC got to them are unlikely to be rewritten
+        // soon, so they all go to the cold extent.
+        new_block_tokens = write_blocks(the_writes,
+                                        std::vector<extent_class_t>(the_writes.size(),
+                                                                    COLD_EXTENT),
+                                        choose_gc_io_account(),
+                                        &block_write_cond);
+        account_block_writes(the_writes, true);
 
         guarantee(new_block_tokens.size() == writes.size());
     }
@@ -1246,11 +1366,20 @@ void data_block_manager_t::write_gcs(const std::vector<gc_write_t> &writes,
             if (gc_state->current_entry->block_referenced_by_index(block_index)) {
                 block_id_t block_id = writes[i].buf->ser_header.block_id;
 
+                // We copied the block's bytes without looking at them, so the new
+                // copy is compressed exactly if the index says the old one is.
+                counted_t<ls_block_token_pointee_t> token
+                    = serializer->generate_block_token_from_index(
+                        new_block_tokens[i]->offset(),
+                        serializer->lba_index->get_ser_block_size(block_id));
+                guarantee(token->on_disk_block_size()
+                          == new_block_tokens[i]->on_disk_block_size());
+
                 index_write_ops.push_back(
                         index_write_op_t(block_id,
                                          to_standard_block_token(
                                                  block_id,
-                                                 new_block_tokens[i])));
+                                                 std::move(token))));
             }
 
             // (If we don't have an i_array entry, the block is referenced
@@ -1289,8 +1418,8 @@ void data_block_manager_t::write_gcs(const std::vector<gc_write_t> &writes,
 void data_block_manager_t::prepare_metablock(data_block_manager::metablock_mixin_t *metablock) {
     guarantee(state == state_ready || state == state_shutting_down);
 
-    if (active_extent != NULL) {
-        metablock->active_extent = active_extent->extent_ref.offset();
+    if (active_extents[HOT_EXTENT] != NULL) {
+        metablock->active_extent = active_extents[HOT_EXTENT]->extent_ref.offset();
     } else {
         metablock->active_extent = NULL_OFFSET;
     }
@@ -1317,10 +1446,12 @@ void data_block_manager_t::actually_shutdown() {
 
     guarantee(reconstructed_extents.head() == NULL);
 
-    if (active_extent != NULL) {
-        UNUSED int64_t extent = active_extent->extent_ref.release();
-        delete active_extent;
-        active_extent = NULL;
+    for (size_t i = 0; i < NUM_EXTENT_CLASSES; ++i) {
+        if (active_extents[i] != NULL) {
+            UNUSED int64_t extent = active_extents[i]->extent_ref.release();
+            delete active_extents[i];
+            active_extents[i] = NULL;
+        }
     }
 
     while (gc_entry_t *entry = young_extent_queue.head()) {
@@ -1331,6 +1462,7 @@ void data_block_manager_t::actually_shutdown() {
 
     while (!gc_pq.empty()) {
         gc_entry_t *entry = gc_pq.pop();
+        gc_rescore_queue.remove(entry);
         UNUSED int64_t extent = entry->extent_ref.release();
         delete entry;
     }
@@ -1341,9 +1473,12 @@ void data_block_manager_t::actually_shutdown() {
 }
 
 std::vector<std::vector<counted_t<ls_block_token_pointee_t> > >
-data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes) {
+data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes,
+                                             extent_class_t extent_class) {
     ASSERT_NO_CORO_WAITING;
 
+    gc_entry_t *&active_extent = active_extents[extent_class];
+
     // Start a new extent if necessary.
     if (active_extent == NULL) {
         active_extent = new gc_entry_t(this);
@@ -1427,12 +1562,45 @@ void data_block_manager_t::remove_last_unyoung_entry() {
     guarantee(entry->state == gc_entry_t::state_young);
     entry->state = gc_entry_t::state_old;
 
+    entry->update_gc_score(current_microtime());
     entry->our_pq_entry = gc_pq.push(entry);
+    gc_rescore_queue.push_back(entry);
 
     gc_stats.old_total_block_bytes += static_config->extent_size();
     gc_stats.old_garbage_block_bytes += entry->garbage_bytes();
 }
 
+void data_block_manager_t::rescore_gc_entry(gc_entry_t *entry, microtime_t now) {
+    guarantee(entry->state == gc_entry_t::state_old);
+    entry->update_gc_score(now);
+    entry->our_pq_entry->update();
+    gc_rescore_queue.remove(entry);
+    gc_rescore_queue.push_back(entry);
+}
+
+void data_block_manager_t::rescore_stalest_gc_entries() {
+    ASSERT_NO_CORO_WAITING;
+    const microtime_t now = current_microtime();
+    const size_t count = std::min(GC_RESCORES_PER_EXTENT, gc_rescore_queue.size());
+    for (size_t i = 0; i < count; ++i) {
+        rescore_gc_entry(gc_rescore_queue.head(), now);
+    }
+}
+
+void data_block_manager_t::account_block_writes(
+        const std::vector<buf_write_info_t> &writes, bool for_gc) {
+    int64_t bytes = 0;
+    for (auto it = writes.begin(); it != writes.end(); ++it) {
+        bytes += gc_entry_t::aligned_value(it->block_size);
+    }
+    if (for_gc) {
+        gc_stats.gc_block_bytes_written += bytes;
+    } else {
+        gc_stats.block_bytes_written += bytes;
+    }
+    stats->pm_serializer_write_amplification_percent.record(bytes, for_gc);
+}
+
 /* functions for gc structures */
 
 // Answers the following question: We're in the middle of gc'ing, and
@@ -1455,7 +1623,7 @@ bool data_block_manager_t::do_we_want_to_start_gcing() const {
 }
 
 bool gc_entry_less_t::operator()(const gc_entry_t *x, const gc_entry_t *y) {
-    return x->garbage_bytes() < y->garbage_bytes();
+    return x->gc_score < y->gc_score;
 }
 
 /****************
@@ -1484,4 +1652,6 @@ void data_block_manager_t::gc_stat_t::operator-=(int64_t num) {
 
 data_block_manager_t::gc_stats_t::gc_stats_t(log_serializer_stats_t *_stats)
     : old_total_block_bytes(&_stats->pm_serializer_old_total_block_bytes),
-      old_garbage_block_bytes(&_stats->pm_serializer_old_garbage_block_bytes) { }
+      old_garbage_block_bytes(&_stats->pm_serializer_old_garbage_block_bytes),
+      block_bytes_written(&_stats->pm_serializer_block_bytes_written),
+      gc_block_bytes_written(&_stats->pm_serializer_gc_block_bytes_written) { }
@@ -14,6 +14,7 @@
 #include "serializer/log/config.hpp"
 #include "serializer/log/extent_manager.hpp"
 #include "serializer/types.hpp"
+#include "time.hpp"
 
 class buf_ptr_t;
 class log_serializer_t;
@@ -81,11 +82,37 @@ public:
                 file_account_t *io_account,
                 iocallback_t *cb);
 
-    std::vector<std::vector<counted_t<ls_block_token_pointee_t> > >
-    gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes);
+private:
+    // Data blocks are written to one of several active extents, depending on how
+    // soon we expect them to be rewritten.  Blocks that get rewritten all the time
+    // then become garbage together, instead of leaving GC to copy the cold blocks
+    // they share extents with over and over again.
+    enum extent_class_t {
+        // Blocks written by the cache whose previous version is recent, or that
+        // didn't exist before.
+        HOT_EXTENT = 0,
+        // Blocks that GC relocates, and blocks written by the cache whose previous
+        // version has been around for a while.
+        COLD_EXTENT = 1,
+        NUM_EXTENT_CLASSES = 2
+    };
 
+    extent_class_t classify_write(block_id_t block_id, microtime_t now);
+
+    // Like `many_writes()`, but puts `writes[i]` on the active extent of class
+    // `classes[i]`.  Returns the tokens in the order of `writes`.
+    std::vector<counted_t<ls_block_token_pointee_t> >
+    write_blocks(const std::vector<buf_write_info_t> &writes,
+                 const std::vector<extent_class_t> &classes,
+                 file_account_t *io_account,
+                 iocallback_t *cb);
+
+    // Allocates space for the writes on the active extent of the given class.  The
+    // tokens are grouped by extent.  You can do a contiguous write in each extent.
+    std::vector<std::vector<counted_t<ls_block_token_pointee_t> > >
+    gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes,
+                           extent_class_t extent_class);
 
-private:
     void actually_shutdown();
 
     struct gc_state_t : public intrusive_list_node_t<gc_state_t>{
@@ -143,6 +170,20 @@ private:
     // to be not young.
     void remove_last_unyoung_entry();
 
+    // The GC priorities depend on the age of the extents, so they go stale as
+    // time passes.  An extent gets rescored whenever it gains garbage; on top of
+    // that, before each extent we GC this rescores the GC_RESCORES_PER_EXTENT
+    // extents that went the longest without.
+    void rescore_stalest_gc_entries();
+
+    // Recomputes the priority of an extent in gc_pq and moves it to the back of
+    // gc_rescore_queue.
+    void rescore_gc_entry(gc_entry_t *entry, microtime_t now);
+
+    // Updates the block byte counters and the write amplification stat.
+    void account_block_writes(const std::vector<buf_write_info_t> &writes,
+                              bool for_gc);
+
     void destroy_entry(gc_entry_t *entry);
 
     bool should_perform_read_ahead(int64_t offset);
@@ -177,8 +218,10 @@ private:
     /* Contains every extent in the gc_entry_t::state_reconstructing state */
     intrusive_list_t<gc_entry_t> reconstructed_extents;
 
-    /* Contains the extent in the gc_entry_t::state_active state. */
-    gc_entry_t *active_extent;
+    /* Contains the extents in the gc_entry_t::state_active state, one (or NULL) per
+    extent_class_t.  Only the HOT_EXTENT one is recorded in the metablock; after a
+    restart, the others get reconstructed like any other extent. */
+    gc_entry_t *active_extents[NUM_EXTENT_CLASSES];
 
     /* Contains every extent in the gc_entry_t::state_young state */
     intrusive_list_t<gc_entry_t> young_extent_queue;
@@ -186,6 +229,9 @@ private:
     /* Contains every extent in the gc_entry_t::state_old state */
     priority_queue_t<gc_entry_t *, gc_entry_less_t> gc_pq;
 
+    /* Contains every extent in gc_pq, least recently scored first */
+    intrusive_list_t<gc_entry_t> gc_rescore_queue;
+
     /* \brief structure to keep track of global stats about the data blocks
      */
     class gc_stat_t {
@@ -207,6 +253,8 @@ private:
     struct gc_stats_t {
         gc_stat_t old_total_block_bytes;
         gc_stat_t old_garbage_block_bytes;
+        gc_stat_t block_bytes_written;
+        gc_stat_t gc_block_bytes_written;
         explicit gc_stats_t(log_serializer_stats_t *);
     };
 
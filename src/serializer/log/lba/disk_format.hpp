@@ -59,6 +59,20 @@ inline bool operator==(flagged_off64_t x, flagged_off64_t y) {
 
 static const block_id_t PADDING_BLOCK_ID = NULL_BLOCK_ID;
 
+// Marks an lba_entry_t::ser_block_size (and the in-memory index's copy of it) as
+// belonging to a compressed block.  A compressed block's uncompressed size is always
+// the serializer's max block size.
+static const uint32_t LBA_COMPRESSED_BLOCK_FLAG = 0x80000000u;
+
+inline bool lba_ser_block_size_is_compressed(uint32_t ser_block_size) {
+    return (ser_block_size & LBA_COMPRESSED_BLOCK_FLAG) != 0;
+}
+
+// The number of bytes the block takes up in its extent.
+inline uint32_t lba_ser_block_size_on_disk(uint32_t ser_block_size) {
+    return ser_block_size & ~LBA_COMPRESSED_BLOCK_FLAG;
+}
+
 struct lba_entry_t {
     // Right now there's code that assumes sizeof(lba_entry_t) is a power of two.
     // (It probably assumes that sizeof(lba_entry_t) evenly divides
@@ -69,7 +83,9 @@ struct lba_entry_t {
     uint32_t zero_reserved;
 
     // This could be a uint16_t if you wanted it to be, as long as block sizes are
-    // all less than or equal to 4K (which is less than 64K).
+    // all less than or equal to 4K (which is less than 64K).  The
+    // LBA_COMPRESSED_BLOCK_FLAG bit is set if the block is stored compressed, in
+    // which case the rest of the value is its compressed size.
     uint32_t ser_block_size;
 
     block_id_t block_id;
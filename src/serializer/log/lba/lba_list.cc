@@ -151,7 +151,8 @@ uint32_t lba_list_t::get_ser_block_size(block_id_t block) {
 }
 
 block_size_t lba_list_t::get_block_size(block_id_t block) {
-    return block_size_t::unsafe_make(get_block_info(block).ser_block_size);
+    return block_size_t::unsafe_make(
+        lba_ser_block_size_on_disk(get_block_info(block).ser_block_size));
 }
 
 repli_timestamp_t lba_list_t::get_block_recency(block_id_t block) {
@@ -42,7 +42,9 @@ public:
 
     index_block_info_t get_block_info(block_id_t block);
 
-    // These return individual fields of get_block_info.
+    // These return individual fields of get_block_info.  get_ser_block_size
+    // includes the LBA_COMPRESSED_BLOCK_FLAG bit, get_block_size is the size of the
+    // block on disk.
     flagged_off64_t get_block_offset(block_id_t block);
     uint32_t get_ser_block_size(block_id_t block);
     block_size_t get_block_size(block_id_t block);
@@ -5,6 +5,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <zlib.h>
 
 #include <functional>
 
@@ -116,6 +117,40 @@ void filepath_file_opener_t::open_semantic_checking_file(scoped_ptr_t<semantic_c
 
 
 
+perfmon_write_amplification_t::perfmon_write_amplification_t()
+    : thread_data(MAX_THREADS) {
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        thread_data[i].value = std::make_pair(0, 0);
+    }
+}
+
+void perfmon_write_amplification_t::record(int64_t bytes, bool for_gc) {
+    std::pair<int64_t, int64_t> *data = &thread_data[get_thread_id().threadnum].value;
+    (for_gc ? data->second : data->first) += bytes;
+}
+
+void perfmon_write_amplification_t::get_thread_stat(padded_bytes_t *stat) {
+    stat->value = thread_data[get_thread_id().threadnum].value;
+}
+
+std::pair<int64_t, int64_t> perfmon_write_amplification_t::combine_stats(
+        const padded_bytes_t *data) {
+    std::pair<int64_t, int64_t> bytes(0, 0);
+    for (int i = 0; i < get_num_threads(); ++i) {
+        bytes.first += data[i].value.first;
+        bytes.second += data[i].value.second;
+    }
+    return bytes;
+}
+
+scoped_ptr_t<perfmon_result_t> perfmon_write_amplification_t::output_stat(
+        const std::pair<int64_t, int64_t> &bytes) {
+    const int64_t percent = bytes.first == 0
+        ? 100
+        : 100 * (bytes.first + bytes.second) / bytes.first;
+    return make_scoped<perfmon_result_t>(strprintf("%" PRIi64, percent));
+}
+
 log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
     : serializer_collection(),
       pm_serializer_block_reads(secs_to_ticks(1)),
@@ -123,6 +158,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_block_writes(),
       pm_serializer_index_writes(secs_to_ticks(1)),
       pm_serializer_index_writes_size(secs_to_ticks(1), false),
+      pm_serializer_compressed_block_writes(),
+      pm_serializer_compression_bytes_saved(),
       pm_extents_in_use(),
       pm_bytes_in_use(),
       pm_serializer_lba_extents(),
@@ -131,6 +168,9 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_data_extents_gced(),
       pm_serializer_old_garbage_block_bytes(),
       pm_serializer_old_total_block_bytes(),
+      pm_serializer_block_bytes_written(),
+      pm_serializer_gc_block_bytes_written(),
+      pm_serializer_write_amplification_percent(),
       pm_serializer_lba_gcs(),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
@@ -139,6 +179,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_block_writes, "serializer_block_writes",
           &pm_serializer_index_writes, "serializer_index_writes",
           &pm_serializer_index_writes_size, "serializer_index_writes_size",
+          &pm_serializer_compressed_block_writes, "serializer_compressed_block_writes",
+          &pm_serializer_compression_bytes_saved, "serializer_compression_bytes_saved",
           &pm_extents_in_use, "serializer_extents_in_use",
           &pm_bytes_in_use, "serializer_bytes_in_use",
           &pm_serializer_lba_extents, "serializer_lba_extents",
@@ -147,6 +189,10 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
+          &pm_serializer_block_bytes_written, "serializer_block_bytes_written",
+          &pm_serializer_gc_block_bytes_written, "serializer_gc_block_bytes_written",
+          &pm_serializer_write_amplification_percent,
+          "serializer_write_amplification_percent",
           &pm_serializer_lba_gcs, "serializer_lba_gcs")
 { }
 
@@ -421,8 +467,13 @@ buf_ptr_t log_serializer_t::block_read(const counted_t<ls_block_token_pointee_t>
     ticks_t pm_time;
     stats->pm_serializer_block_reads.begin(&pm_time);
 
-    buf_ptr_t ret = data_block_manager->read(token->offset_, token->block_size(),
-                                           io_account);
+    buf_ptr_t ret = data_block_manager->read(token->offset_,
+                                             token->on_disk_block_size(),
+                                             io_account);
+    if (token->is_compressed()) {
+        ret = decompress_block(ret.ser_buffer(), token->on_disk_block_size());
+        rassert(ret.block_size() == token->block_size());
+    }
 
     stats->pm_serializer_block_reads.end(&pm_time);
     return ret;
@@ -483,10 +534,14 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 // Write new token to index, or remove from index as appropriate.
                 if (token.has()) {
                     offset = flagged_off64_t::make(token->offset_);
-                    ser_block_size = token->block_size().ser_value();
+                    ser_block_size = token->on_disk_block_size().ser_value();
+                    if (token->is_compressed()) {
+                        ser_block_size |= LBA_COMPRESSED_BLOCK_FLAG;
+                    }
 
                     /* mark the life */
-                    data_block_manager->mark_live(offset.get_value(), token->block_size());
+                    data_block_manager->mark_live(offset.get_value(),
+                                                  token->on_disk_block_size());
                 } else {
                     offset = flagged_off64_t::unused();
                     ser_block_size = 0;
@@ -607,7 +662,67 @@ void log_serializer_t::write_metablock_sans_pipelining(const signal_t *safe_to_w
 counted_t<ls_block_token_pointee_t>
 log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size) {
     assert_thread();
-    counted_t<ls_block_token_pointee_t> ret(new ls_block_token_pointee_t(this, offset, block_size));
+    counted_t<ls_block_token_pointee_t> ret(new ls_block_token_pointee_t(this, offset, block_size, block_size));
+    return ret;
+}
+
+counted_t<ls_block_token_pointee_t>
+log_serializer_t::generate_block_token_from_index(int64_t offset,
+                                                  uint32_t ser_block_size) {
+    assert_thread();
+    const block_size_t on_disk_block_size
+        = block_size_t::unsafe_make(lba_ser_block_size_on_disk(ser_block_size));
+    const block_size_t block_size = lba_ser_block_size_is_compressed(ser_block_size)
+        ? max_block_size()
+        : on_disk_block_size;
+    counted_t<ls_block_token_pointee_t> ret(
+        new ls_block_token_pointee_t(this, offset, block_size, on_disk_block_size));
+    return ret;
+}
+
+bool log_serializer_t::compress_block(const ser_buffer_t *buf, block_size_t block_size,
+                                      buf_ptr_t *compressed_out) {
+    const uint32_t aligned_size = buf_ptr_t::compute_aligned_block_size(block_size);
+    if (aligned_size <= DEVICE_BLOCK_SIZE) {
+        return false;
+    }
+
+    // We only give zlib enough room for a result that is at least one device block
+    // smaller than the original, so that it gives up on anything that compresses
+    // worse than that.
+    buf_ptr_t compressed = buf_ptr_t::alloc_uninitialized(block_size);
+    uLongf compressed_size = aligned_size - DEVICE_BLOCK_SIZE - sizeof(ls_buf_data_t);
+    int res = compress2(reinterpret_cast<Bytef *>(compressed.cache_data()),
+                        &compressed_size,
+                        reinterpret_cast<const Bytef *>(buf->cache_data),
+                        block_size.value(),
+                        Z_BEST_SPEED);
+    if (res == Z_BUF_ERROR) {
+        return false;
+    }
+    guarantee(res == Z_OK, "compress2 failed with error %d", res);
+
+    compressed.ser_buffer()->ser_header = buf->ser_header;
+    compressed.resize_fill_zero(
+        block_size_t::unsafe_make(compressed_size + sizeof(ls_buf_data_t)));
+    rassert(compressed.aligned_block_size() < aligned_size);
+    *compressed_out = std::move(compressed);
+    return true;
+}
+
+buf_ptr_t log_serializer_t::decompress_block(const ser_buffer_t *compressed,
+                                             block_size_t on_disk_block_size) {
+    buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(max_block_size());
+    ret.ser_buffer()->ser_header = compressed->ser_header;
+    uLongf size = ret.block_size().value();
+    int res = uncompress(reinterpret_cast<Bytef *>(ret.cache_data()),
+                         &size,
+                         reinterpret_cast<const Bytef *>(compressed->cache_data),
+                         on_disk_block_size.value());
+    guarantee(res == Z_OK && size == ret.block_size().value(),
+              "Compressed block %" PR_BLOCK_ID " is corrupted (zlib error %d).",
+              compressed->ser_header.block_id, res);
+    ret.fill_padding_zero();
     return ret;
 }
 
@@ -617,9 +732,66 @@ log_serializer_t::block_writes(const std::vector<buf_write_info_t> &write_infos,
     assert_thread();
     stats->pm_serializer_block_writes += write_infos.size();
 
+    if (static_config.block_compression() == block_compression_t::none) {
+        std::vector<counted_t<ls_block_token_pointee_t> > result
+            = data_block_manager->many_writes(write_infos, io_account, cb);
+        guarantee(result.size() == write_infos.size());
+        return result;
+    }
+
+    rassert(static_config.block_compression() == block_compression_t::zlib);
+
+    // Keeps the compressed copies of the blocks alive until they are on disk.
+    struct compressed_writes_cb_t : public iocallback_t {
+        void on_io_complete() {
+            iocallback_t *local_cb = cb;
+            delete this;
+            local_cb->on_io_complete();
+        }
+
+        std::vector<buf_ptr_t> compressed_bufs;
+        iocallback_t *cb;
+    };
+
+    compressed_writes_cb_t *const compressed_cb = new compressed_writes_cb_t;
+    compressed_cb->cb = cb;
+
+    // Only full-size blocks get compressed, so that the index doesn't have to
+    // record the uncompressed size.
+    std::vector<buf_write_info_t> disk_write_infos;
+    disk_write_infos.reserve(write_infos.size());
+    std::vector<bool> is_compressed(write_infos.size(), false);
+    for (size_t i = 0; i < write_infos.size(); ++i) {
+        const buf_write_info_t &info = write_infos[i];
+        buf_ptr_t compressed;
+        if (info.block_size == max_block_size()
+            && compress_block(info.buf, info.block_size, &compressed)) {
+            compressed.ser_buffer()->ser_header.block_id = info.block_id;
+            info.buf->ser_header.block_id = info.block_id;
+            ++stats->pm_serializer_compressed_block_writes;
+            stats->pm_serializer_compression_bytes_saved
+                += buf_ptr_t::compute_aligned_block_size(info.block_size)
+                - compressed.aligned_block_size();
+            disk_write_infos.push_back(buf_write_info_t(compressed.ser_buffer(),
+                                                        compressed.block_size(),
+                                                        info.block_id));
+            compressed_cb->compressed_bufs.push_back(std::move(compressed));
+            is_compressed[i] = true;
+        } else {
+            disk_write_infos.push_back(info);
+        }
+    }
+
     std::vector<counted_t<ls_block_token_pointee_t> > result
-        = data_block_manager->many_writes(write_infos, io_account, cb);
+        = data_block_manager->many_writes(disk_write_infos, io_account, compressed_cb);
     guarantee(result.size() == write_infos.size());
+
+    // The data block manager only knows about the compressed size.
+    for (size_t i = 0; i < result.size(); ++i) {
+        if (is_compressed[i]) {
+            result[i]->block_size_ = write_infos[i].block_size;
+        }
+    }
     return result;
 }
 
@@ -740,7 +912,7 @@ counted_t<ls_block_token_pointee_t> log_serializer_t::index_read(block_id_t bloc
 
     index_block_info_t info = lba_index->get_block_info(block_id);
     if (info.offset.has_value()) {
-        return generate_block_token(info.offset.get_value(), block_size_t::unsafe_make(info.ser_block_size));
+        return generate_block_token_from_index(info.offset.get_value(), info.ser_block_size);
     } else {
         return counted_t<ls_block_token_pointee_t>();
     }
@@ -936,9 +1108,12 @@ bool log_serializer_t::should_perform_read_ahead() {
 
 ls_block_token_pointee_t::ls_block_token_pointee_t(log_serializer_t *serializer,
                                                    int64_t initial_offset,
-                                                   block_size_t initial_block_size)
+                                                   block_size_t initial_block_size,
+                                                   block_size_t initial_on_disk_block_size)
     : serializer_(serializer), ref_count_(0),
-      block_size_(initial_block_size), offset_(initial_offset) {
+      block_size_(initial_block_size),
+      on_disk_block_size_(initial_on_disk_block_size),
+      offset_(initial_offset) {
     serializer_->assert_thread();
     serializer_->register_block_token(this, initial_offset);
 }
@@ -168,6 +168,19 @@ private:
     void remap_block_to_new_offset(int64_t current_offset, int64_t new_offset);
     counted_t<ls_block_token_pointee_t> generate_block_token(int64_t offset,
                                                              block_size_t block_size);
+    // Makes a token for a block that the LBA records with `ser_block_size`, which
+    // may carry the LBA_COMPRESSED_BLOCK_FLAG.
+    counted_t<ls_block_token_pointee_t>
+    generate_block_token_from_index(int64_t offset, uint32_t ser_block_size);
+
+    // Deflates the block in `buf` into `*compressed_out`.  Returns false (and leaves
+    // `*compressed_out` empty) if that would not save at least one device block.
+    bool compress_block(const ser_buffer_t *buf, block_size_t block_size,
+                        buf_ptr_t *compressed_out);
+    // Inflates a block that compress_block produced.  `compressed` is the block as
+    // it is on disk, `on_disk_block_size` bytes long.
+    buf_ptr_t decompress_block(const ser_buffer_t *compressed,
+                               block_size_t on_disk_block_size);
 
     void offer_buf_to_read_ahead_callbacks(
             block_id_t block_id,
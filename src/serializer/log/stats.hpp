@@ -2,8 +2,30 @@
 #ifndef SERIALIZER_LOG_STATS_HPP_
 #define SERIALIZER_LOG_STATS_HPP_
 
+#include <utility>
+
 #include "perfmon/perfmon.hpp"
 
+/* Reports 100 * (block bytes written + GC block bytes written) / block bytes
+written, computed from the bytes recorded on each thread when the stats are read.
+(A counter can only be incremented, so it can't hold a ratio.) */
+class perfmon_write_amplification_t
+    : public perfmon_perthread_t<cache_line_padded_t<std::pair<int64_t, int64_t> >,
+                                 std::pair<int64_t, int64_t> > {
+public:
+    perfmon_write_amplification_t();
+    void record(int64_t bytes, bool for_gc);
+protected:
+    typedef cache_line_padded_t<std::pair<int64_t, int64_t> > padded_bytes_t;
+
+    void get_thread_stat(padded_bytes_t *);
+    std::pair<int64_t, int64_t> combine_stats(const padded_bytes_t *);
+    scoped_ptr_t<perfmon_result_t> output_stat(const std::pair<int64_t, int64_t> &);
+private:
+    // (block bytes written, GC block bytes written) on each thread.
+    scoped_array_t<padded_bytes_t> thread_data;
+};
+
 struct log_serializer_stats_t {
     perfmon_collection_t serializer_collection;
     explicit log_serializer_stats_t(perfmon_collection_t *perfmon_collection);
@@ -13,6 +35,8 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_block_writes;
     perfmon_duration_sampler_t pm_serializer_index_writes;
     perfmon_sampler_t pm_serializer_index_writes_size;
+    perfmon_counter_t pm_serializer_compressed_block_writes;
+    perfmon_counter_t pm_serializer_compression_bytes_saved;
 
     /* used in serializer/log/extent_manager.cc */
     perfmon_counter_t pm_extents_in_use;
@@ -27,6 +51,9 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_data_extents_gced;
     perfmon_counter_t pm_serializer_old_garbage_block_bytes;
     perfmon_counter_t pm_serializer_old_total_block_bytes;
+    perfmon_counter_t pm_serializer_block_bytes_written;
+    perfmon_counter_t pm_serializer_gc_block_bytes_written;
+    perfmon_write_amplification_t pm_serializer_write_amplification_percent;
 
     /* used in serializer/log/lba/lba_list.cc */
     perfmon_counter_t pm_serializer_lba_gcs;
@@ -122,6 +122,11 @@ public:
     int64_t offset() const { return offset_; }
     block_size_t block_size() const { return block_size_; }
 
+    // The number of bytes the block takes up in its extent.  This is less than
+    // block_size() for blocks the serializer has stored compressed.
+    block_size_t on_disk_block_size() const { return on_disk_block_size_; }
+    bool is_compressed() const { return on_disk_block_size_ != block_size_; }
+
 private:
     friend class log_serializer_t;
     friend class dbm_read_ahead_fsm_t;  // For read-ahead tokens.
@@ -131,14 +136,18 @@ private:
 
     ls_block_token_pointee_t(log_serializer_t *serializer,
                              int64_t initial_offset,
-                             block_size_t initial_ser_block_size);
+                             block_size_t initial_ser_block_size,
+                             block_size_t initial_on_disk_block_size);
 
     log_serializer_t *serializer_;
     intptr_t ref_count_;
 
-    // The block's size.
+    // The block's size, as seen by the cache.
     block_size_t block_size_;
 
+    // The block's size on disk.
+    block_size_t on_disk_block_size_;
+
     // The block's offset on disk.
     int64_t offset_;
 
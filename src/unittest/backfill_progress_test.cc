@@ -0,0 +1,56 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "backfill_progress.hpp"
+#include "containers/scoped.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+class fixed_progress_t : public traversal_progress_t {
+public:
+    explicit fixed_progress_t(progress_completion_fraction_t *_fraction)
+        : fraction(_fraction) { }
+    progress_completion_fraction_t guess_completion() const {
+        return *fraction;
+    }
+private:
+    progress_completion_fraction_t *fraction;
+};
+
+void expect_fraction(int64_t released, int64_t total,
+                     const progress_completion_fraction_t &fraction) {
+    EXPECT_EQ(released, fraction.estimate_of_released_nodes);
+    EXPECT_EQ(total, fraction.estimate_of_total_nodes);
+}
+
+TPTEST(BackfillProgressTest, SequentialParts) {
+    sequential_traversal_progress_t progress(3);
+    EXPECT_TRUE(progress.guess_completion().invalid());
+
+    progress_completion_fraction_t first;
+    scoped_ptr_t<traversal_progress_t> part(new fixed_progress_t(&first));
+    progress.start_part(&part);
+    EXPECT_TRUE(progress.guess_completion().invalid());
+
+    // The parts that haven't started are guessed to be as large as the first.
+    first = progress_completion_fraction_t(5, 10);
+    expect_fraction(5, 30, progress.guess_completion());
+    first = progress_completion_fraction_t(10, 10);
+
+    // While the second part doesn't know its size, only the first one counts.
+    progress_completion_fraction_t second;
+    part.init(new fixed_progress_t(&second));
+    progress.start_part(&part);
+    expect_fraction(10, 30, progress.guess_completion());
+
+    second = progress_completion_fraction_t(10, 20);
+    expect_fraction(20, 45, progress.guess_completion());
+    second = progress_completion_fraction_t(20, 20);
+
+    progress_completion_fraction_t third(0, 0);
+    part.init(new fixed_progress_t(&third));
+    progress.start_part(&part);
+    expect_fraction(30, 30, progress.guess_completion());
+}
+
+}  // namespace unittest
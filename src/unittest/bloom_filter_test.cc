@@ -0,0 +1,46 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+
+#include "containers/bloom_filter.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(BloomFilterTest, NoFalseNegatives) {
+    bloom_filter_t filter(1000);
+    for (int i = 0; i < 1000; ++i) {
+        const std::string key = strprintf("key %d", i);
+        filter.add(key.data(), key.size());
+    }
+    for (int i = 0; i < 1000; ++i) {
+        const std::string key = strprintf("key %d", i);
+        EXPECT_TRUE(filter.may_contain(key.data(), key.size()));
+    }
+}
+
+TEST(BloomFilterTest, FalsePositiveRate) {
+    bloom_filter_t filter(1000);
+    for (int i = 0; i < 1000; ++i) {
+        const std::string key = strprintf("key %d", i);
+        filter.add(key.data(), key.size());
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 100000; ++i) {
+        const std::string key = strprintf("other key %d", i);
+        if (filter.may_contain(key.data(), key.size())) {
+            ++false_positives;
+        }
+    }
+    // We expect about 1%.
+    EXPECT_LT(false_positives, 3000);
+}
+
+TEST(BloomFilterTest, Empty) {
+    bloom_filter_t filter(0);
+    EXPECT_FALSE(filter.may_contain("", 0));
+    filter.add("", 0);
+    EXPECT_TRUE(filter.may_contain("", 0));
+}
+
+}  // namespace unittest
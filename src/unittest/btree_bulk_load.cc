@@ -0,0 +1,262 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "btree/bulk_load.hpp"
+#include "btree/count.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/operations.hpp"
+#include "btree/slice.hpp"
+#include "buffer_cache/alt/cache_balancer.hpp"
+#include "containers/binary_blob.hpp"
+#include "rdb_protocol/btree.hpp"
+#include "serializer/config.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// A btree in a temporary file, with the rdb value format.
+class bulk_load_tree_t {
+public:
+    bulk_load_tree_t()
+        : io_backender(file_direct_io_mode_t::buffered_desired),
+          file_opener(temp_file.name(), &io_backender),
+          serializer(create_and_construct_serializer(&file_opener)),
+          balancer(GIGABYTE),
+          cache(serializer.get(), &balancer, &get_global_perfmon_collection()),
+          cache_conn(&cache),
+          stats(&perfmon_collection, "bulk_load", index_type_t::PRIMARY) {
+        txn_t txn(&cache_conn, write_durability_t::HARD, repli_timestamp_t::invalid, 1);
+        buf_lock_t superblock(&txn, SUPERBLOCK_ID, alt_create_t::create);
+        buf_write_t sb_write(&superblock);
+        btree_slice_t::init_superblock(&superblock,
+                                       std::vector<char>(), binary_blob_t());
+    }
+
+    void get_superblock(scoped_ptr_t<txn_t> *txn_out,
+                        scoped_ptr_t<real_superblock_t> *superblock_out) {
+        get_btree_superblock_and_txn(&cache_conn, write_access_t::write, 1,
+                                     repli_timestamp_t::invalid,
+                                     write_durability_t::SOFT,
+                                     superblock_out, txn_out);
+    }
+
+    temp_file_t temp_file;
+    io_backender_t io_backender;
+    filepath_file_opener_t file_opener;
+    scoped_ptr_t<standard_serializer_t> serializer;
+    dummy_cache_balancer_t balancer;
+    cache_t cache;
+    cache_conn_t cache_conn;
+    perfmon_collection_t perfmon_collection;
+    btree_stats_t stats;
+
+private:
+    static standard_serializer_t *create_and_construct_serializer(
+            filepath_file_opener_t *opener) {
+        standard_serializer_t::create(opener, standard_serializer_t::static_config_t());
+        return new standard_serializer_t(standard_serializer_t::dynamic_config_t(),
+                                         opener,
+                                         &get_global_perfmon_collection());
+    }
+};
+
+store_key_t bulk_load_key(int i) {
+    return store_key_t(strprintf("key %08d", i));
+}
+
+// An inline blob, as it's stored in an `rdb_value_t`.
+std::vector<char> bulk_load_value(int i) {
+    const std::string data = strprintf("value %d", i);
+    std::vector<char> value(1, static_cast<char>(data.size()));
+    value.insert(value.end(), data.begin(), data.end());
+    return value;
+}
+
+void count_nodes(buf_parent_t parent, block_id_t block_id,
+                 int *leaves_out, int *internal_nodes_out) {
+    buf_lock_t lock(parent, block_id, access_t::read);
+    std::vector<block_id_t> children;
+    {
+        buf_read_t read(&lock);
+        const node_t *node = static_cast<const node_t *>(read.get_data_read());
+        if (node::is_leaf(node)) {
+            ++*leaves_out;
+            return;
+        }
+        ++*internal_nodes_out;
+        const internal_node_t *internal
+            = reinterpret_cast<const internal_node_t *>(node);
+        for (int i = 0; i < internal->npairs; ++i) {
+            children.push_back(internal_node::get_pair_by_index(internal, i)->lnode);
+        }
+    }
+    for (auto it = children.begin(); it != children.end(); ++it) {
+        count_nodes(buf_parent_t(&lock), *it, leaves_out, internal_nodes_out);
+    }
+}
+
+// Inserts keys `0` to `num_keys - 1` in order, one transaction per `keys_per_txn`
+// keys.
+void insert_sorted(bulk_load_tree_t *tree, int num_keys, int keys_per_txn,
+                   bool use_appender) {
+    rdb_value_sizer_t sizer(tree->cache.max_block_size());
+    noop_value_deleter_t detacher;
+    for (int i = 0; i < num_keys; i += keys_per_txn) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        tree->get_superblock(&txn, &superblock);
+        const int end = std::min(num_keys, i + keys_per_txn);
+        if (use_appender) {
+            btree_appender_t appender(&sizer, superblock.get());
+            for (int j = i; j < end; ++j) {
+                appender.append(bulk_load_key(j).btree_key(),
+                                bulk_load_value(j).data(),
+                                repli_timestamp_t::distant_past);
+            }
+        } else {
+            for (int j = i; j < end; ++j) {
+                const store_key_t key = bulk_load_key(j);
+                const std::vector<char> value = bulk_load_value(j);
+                promise_t<superblock_t *> pass_back_superblock;
+                {
+                    keyvalue_location_t kv_location;
+                    find_keyvalue_location_for_write(&sizer, superblock.get(),
+                                                     key.btree_key(), &detacher,
+                                                     &kv_location, &tree->stats,
+                                                     NULL, &pass_back_superblock);
+                    kv_location.value = scoped_malloc_t<void>(
+                        value.data(), value.data() + value.size());
+                    null_key_modification_callback_t null_cb;
+                    apply_keyvalue_change(&sizer, &kv_location, key.btree_key(),
+                                          repli_timestamp_t::distant_past,
+                                          &detacher, &null_cb);
+                }
+                pass_back_superblock.wait();
+            }
+        }
+    }
+}
+
+TPTEST(BtreeBulkLoad, AppendedKeysAreFound) {
+    bulk_load_tree_t tree;
+    const int num_keys = 20000;
+    // Different transaction sizes, so that some transactions start in the middle of
+    // a leaf.
+    insert_sorted(&tree, num_keys / 2, 1000, true);
+    {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        tree.get_superblock(&txn, &superblock);
+        rdb_value_sizer_t sizer(tree.cache.max_block_size());
+        EXPECT_FALSE(can_append_to_btree(superblock.get(),
+                                         bulk_load_key(num_keys / 2 - 1).btree_key()));
+        EXPECT_TRUE(can_append_to_btree(superblock.get(),
+                                        bulk_load_key(num_keys / 2).btree_key()));
+        btree_appender_t appender(&sizer, superblock.get());
+        EXPECT_FALSE(appender.can_append(bulk_load_key(num_keys / 2 - 1).btree_key()));
+        EXPECT_TRUE(appender.can_append(bulk_load_key(num_keys / 2).btree_key()));
+        for (int i = num_keys / 2; i < num_keys; ++i) {
+            appender.append(bulk_load_key(i).btree_key(), bulk_load_value(i).data(),
+                            repli_timestamp_t::distant_past);
+        }
+    }
+
+    rdb_value_sizer_t sizer(tree.cache.max_block_size());
+    for (int i = 0; i < num_keys; i += 7) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        tree.get_superblock(&txn, &superblock);
+        keyvalue_location_t kv_location;
+        find_keyvalue_location_for_read(&sizer, superblock.get(),
+                                        bulk_load_key(i).btree_key(),
+                                        &kv_location, &tree.stats, NULL);
+        ASSERT_TRUE(kv_location.value.has()) << i;
+        const std::vector<char> expected = bulk_load_value(i);
+        EXPECT_EQ(0, memcmp(kv_location.value.get(), expected.data(), expected.size()));
+    }
+
+    // The appender keeps the child counts up to date.
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    tree.get_superblock(&txn, &superblock);
+    EXPECT_EQ(static_cast<uint64_t>(num_keys),
+              btree_count_keys(superblock.get(), key_range_t::universe(),
+                               release_superblock_t::KEEP));
+    EXPECT_EQ(static_cast<uint64_t>(1000),
+              btree_count_keys(superblock.get(),
+                               key_range_t(key_range_t::closed, bulk_load_key(5000),
+                                           key_range_t::open, bulk_load_key(6000)),
+                               release_superblock_t::KEEP));
+}
+
+TPTEST(BtreeBulkLoad, AppenderPacksLeaves) {
+    const int num_keys = 20000;
+    int leaves[2] = { 0, 0 };
+    for (int use_appender = 0; use_appender <= 1; ++use_appender) {
+        bulk_load_tree_t tree;
+        insert_sorted(&tree, num_keys, 256, use_appender);
+
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        tree.get_superblock(&txn, &superblock);
+        int internal_nodes = 0;
+        count_nodes(superblock->expose_buf(), superblock->get_root_block_id(),
+                    &leaves[use_appender], &internal_nodes);
+    }
+    // Inserting one key at a time leaves the leaves about half full.
+    EXPECT_LT(leaves[1], leaves[0] * 3 / 4);
+}
+
+class recorded_timestamps_t : public leaf::entry_reception_callback_t {
+public:
+    void lost_deletions() { }
+    void deletion(const btree_key_t *, repli_timestamp_t) { }
+    void keys_values(const std::vector<const btree_key_t *> &,
+                     const std::vector<const void *> &,
+                     const std::vector<repli_timestamp_t> &tstamps) {
+        timestamps.insert(timestamps.end(), tstamps.begin(), tstamps.end());
+    }
+    std::vector<repli_timestamp_t> timestamps;
+};
+
+TPTEST(BtreeBulkLoad, AppenderKeepsTimestamps) {
+    bulk_load_tree_t tree;
+    const int num_keys = 10;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    tree.get_superblock(&txn, &superblock);
+    rdb_value_sizer_t sizer(tree.cache.max_block_size());
+    {
+        btree_appender_t appender(&sizer, superblock.get());
+        for (int i = 0; i < num_keys; ++i) {
+            repli_timestamp_t timestamp;
+            timestamp.longtime = 100 + i;
+            appender.append(bulk_load_key(i).btree_key(), bulk_load_value(i).data(),
+                            timestamp);
+        }
+    }
+
+    // Only the keys appended since a timestamp are newer than it.
+    buf_lock_t leaf(superblock->expose_buf(), superblock->get_root_block_id(),
+                    access_t::read);
+    buf_read_t read(&leaf);
+    recorded_timestamps_t cb;
+    repli_timestamp_t since, max;
+    since.longtime = 105;
+    max.longtime = 100 + num_keys;
+    leaf::dump_entries_since_time(&sizer,
+                                  static_cast<const leaf_node_t *>(read.get_data_read()),
+                                  since, max, &cb);
+    ASSERT_EQ(5u, cb.timestamps.size());
+    std::sort(cb.timestamps.begin(), cb.timestamps.end());
+    for (size_t i = 0; i < cb.timestamps.size(); ++i) {
+        EXPECT_EQ(105 + i, cb.timestamps[i].longtime);
+    }
+}
+
+}  // namespace unittest
@@ -0,0 +1,108 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "concurrency/cond_var.hpp"
+#include "http/json.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/val.hpp"
+#include "rdb_protocol/wire_func.hpp"
+#include "stl_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// The functions below all take a single row argument, `row`.
+static const ql::sym_t row_var(1);
+
+static ql::r::reql_t row(const std::string &field) {
+    return ql::r::var(row_var)[field];
+}
+
+static counted_t<const ql::func_t> make_func(ql::r::reql_t &&body) {
+    ql::protob_t<const Term> term = body.release_counted();
+    return ql::map_wire_func_t(term, make_vector(row_var),
+                               ql::get_backtrace(term)).compile_wire_func();
+}
+
+static const ql::reql_func_t *as_reql_func(const counted_t<const ql::func_t> &f) {
+    const ql::reql_func_t *reql_func = dynamic_cast<const ql::reql_func_t *>(f.get());
+    guarantee(reql_func != NULL);
+    return reql_func;
+}
+
+// Returns the result of calling `f` on `arg`, or the error message it threw.
+static std::string call_to_string(ql::env_t *env, const ql::reql_func_t *f,
+                                  ql::datum_t arg, bool interpreted) {
+    try {
+        counted_t<ql::val_t> v = interpreted
+            ? f->call_interpreted(env, make_vector(arg), ql::NO_FLAGS)
+            : f->call(env, make_vector(arg), ql::NO_FLAGS);
+        return v->as_datum().print();
+    } catch (const ql::base_exc_t &e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+static std::vector<ql::datum_t> test_rows() {
+    std::vector<ql::datum_t> rows;
+    rows.push_back(ql::to_datum(scoped_cJSON_t(cJSON_Parse(
+        "{\"a\": 1, \"b\": 2, \"age\": 40, \"tags\": [\"x\", \"y\"]}")).get(),
+        ql::configured_limits_t::unlimited));
+    rows.push_back(ql::to_datum(scoped_cJSON_t(cJSON_Parse(
+        "{\"a\": 0, \"b\": 1, \"age\": 20, \"tags\": []}")).get(),
+        ql::configured_limits_t::unlimited));
+    rows.push_back(ql::to_datum(scoped_cJSON_t(cJSON_Parse(
+        "{\"a\": 1, \"b\": 1, \"age\": 31, \"tags\": \"x\"}")).get(),
+        ql::configured_limits_t::unlimited));
+    rows.push_back(ql::to_datum(scoped_cJSON_t(cJSON_Parse(
+        "{\"a\": \"str\", \"b\": null}")).get(),
+        ql::configured_limits_t::unlimited));
+    rows.push_back(ql::to_datum(scoped_cJSON_t(cJSON_Parse("{}")).get(),
+                                ql::configured_limits_t::unlimited));
+    return rows;
+}
+
+static std::vector<ql::r::reql_t> compiled_bodies() {
+    std::vector<ql::r::reql_t> bodies;
+    bodies.push_back((row("age") > 30.0) && row("tags").contains(std::string("x")));
+    bodies.push_back(row("a") + ql::r::reql_t(Term::MUL, row("b"), 2.0));
+    bodies.push_back(!(row("a") == 1.0));
+    bodies.push_back(ql::r::expr(10.0) / row("a"));
+    bodies.push_back(ql::r::reql_t(Term::NE, row("a"), row("b"), 1.0));
+    bodies.push_back(ql::r::reql_t(Term::BRANCH, row("a") < 1.0,
+                                   std::string("small"), std::string("big")));
+    bodies.push_back(ql::r::reql_t(Term::ANY, row("a") == 0.0, row("b")));
+    bodies.push_back(ql::r::array(row("a"), row("b")).contains(1.0, 1.0));
+    return bodies;
+}
+
+TPTEST(BytecodeTest, MatchesInterpreter) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+    std::vector<ql::datum_t> rows = test_rows();
+    std::vector<ql::r::reql_t> bodies = compiled_bodies();
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        counted_t<const ql::func_t> f = make_func(std::move(bodies[i]));
+        const ql::reql_func_t *reql_func = as_reql_func(f);
+        EXPECT_TRUE(reql_func->is_compiled()) << "body " << i;
+        for (size_t j = 0; j < rows.size(); ++j) {
+            EXPECT_EQ(call_to_string(&env, reql_func, rows[j], true),
+                      call_to_string(&env, reql_func, rows[j], false))
+                << "body " << i << ", row " << j;
+        }
+    }
+}
+
+TPTEST(BytecodeTest, NotCompiled) {
+    // `default` isn't compiled, and neither is a field name we don't know until the
+    // function runs.
+    EXPECT_FALSE(as_reql_func(make_func(row("a").default_(0.0)))->is_compiled());
+    EXPECT_FALSE(as_reql_func(make_func(
+        ql::r::var(row_var).bracket(row("key"))))->is_compiled());
+}
+
+}  // namespace unittest
@@ -0,0 +1,229 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "concurrency/pmap.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rdb_protocol/changefeed.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term_walker.hpp"
+#include "rpc/mailbox/typed.hpp"
+#include "threading.hpp"
+#include "unittest/clustering_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+using ql::changefeed::change_buffer_t;
+using ql::changefeed::filter_key;
+using ql::changefeed::filter_t;
+
+static ql::datum_t make_row(int id, int value) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        {datum_string_t("id"), ql::datum_t(static_cast<double>(id))},
+        {datum_string_t("value"), ql::datum_t(static_cast<double>(value))}});
+}
+
+static ql::datum_t make_change(ql::datum_t old_val, ql::datum_t new_val) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        {datum_string_t("old_val"), std::move(old_val)},
+        {datum_string_t("new_val"), std::move(new_val)}});
+}
+
+static int64_t get_count(perfmon_counter_t *counter) {
+    void *data = counter->begin_stats();
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        counter->visit_stats(data);
+    });
+    scoped_ptr_t<perfmon_result_t> result = counter->end_stats(data);
+    return std::stoll(*result->get_string());
+}
+
+static change_buffer_t::overflow_t push(change_buffer_t *buffer,
+                                        ql::datum_t change,
+                                        size_t *num_dropped_out) {
+    return buffer->push(std::move(change), 1000, num_dropped_out);
+}
+
+TPTEST(ChangefeedTest, SquashSameKey) {
+    perfmon_counter_t dropped, squashed;
+    change_buffer_t buffer("id", true, MEGABYTE, &dropped, &squashed);
+    const ql::datum_t null = ql::datum_t::null();
+    size_t num_dropped;
+
+    EXPECT_EQ(change_buffer_t::overflow_t::NONE,
+              push(&buffer, make_change(make_row(1, 0), make_row(1, 1)), &num_dropped));
+    EXPECT_EQ(0u, num_dropped);
+    push(&buffer, make_change(null, make_row(2, 0)), &num_dropped);
+    push(&buffer, make_change(make_row(1, 1), make_row(1, 2)), &num_dropped);
+    push(&buffer, make_change(make_row(1, 2), make_row(1, 3)), &num_dropped);
+    // Inserting a row and then deleting it leaves nothing to report.
+    push(&buffer, make_change(make_row(2, 0), null), &num_dropped);
+    EXPECT_EQ(1u, buffer.size());
+    EXPECT_EQ(3, get_count(&squashed));
+    EXPECT_EQ(0, get_count(&dropped));
+
+    // The first `old_val` and the last `new_val` survive.
+    ql::datum_t change = buffer.pop();
+    EXPECT_EQ(make_row(1, 0), change.get_field("old_val"));
+    EXPECT_EQ(make_row(1, 3), change.get_field("new_val"));
+    EXPECT_TRUE(buffer.empty());
+
+    // Once a change has been read, later changes to the row are queued again.
+    push(&buffer, make_change(make_row(1, 3), make_row(1, 4)), &num_dropped);
+    EXPECT_EQ(1u, buffer.size());
+    EXPECT_EQ(make_row(1, 3), buffer.pop().get_field("old_val"));
+    EXPECT_EQ(3, get_count(&squashed));
+}
+
+TPTEST(ChangefeedTest, SquashChurnNextToPendingChange) {
+    perfmon_counter_t dropped, squashed;
+    change_buffer_t buffer("id", true, MEGABYTE, &dropped, &squashed);
+    const ql::datum_t null = ql::datum_t::null();
+    size_t num_dropped;
+    push(&buffer, make_change(make_row(1, 0), make_row(1, 1)), &num_dropped);
+
+    // A row that keeps getting inserted and deleted cancels out every time, and
+    // mustn't leave anything behind that piles up.
+    for (int i = 0; i < 1000; ++i) {
+        push(&buffer, make_change(null, make_row(2, i)), &num_dropped);
+        push(&buffer, make_change(make_row(2, i), null), &num_dropped);
+        ASSERT_EQ(1u, buffer.size());
+        ASSERT_LE(buffer.num_slots(), 3u);
+    }
+    EXPECT_EQ(1000, get_count(&squashed));
+    EXPECT_EQ(0, get_count(&dropped));
+
+    // The pending change survives, and can still be squashed into.
+    push(&buffer, make_change(make_row(1, 1), make_row(1, 2)), &num_dropped);
+    ASSERT_EQ(1u, buffer.size());
+    ql::datum_t change = buffer.pop();
+    EXPECT_EQ(make_row(1, 0), change.get_field("old_val"));
+    EXPECT_EQ(make_row(1, 2), change.get_field("new_val"));
+    EXPECT_TRUE(buffer.empty());
+}
+
+TPTEST(ChangefeedTest, NoSquash) {
+    perfmon_counter_t dropped, squashed;
+    change_buffer_t buffer("id", false, MEGABYTE, &dropped, &squashed);
+    size_t num_dropped;
+    for (int i = 0; i < 3; ++i) {
+        push(&buffer, make_change(make_row(1, i), make_row(1, i + 1)), &num_dropped);
+    }
+    ASSERT_EQ(3u, buffer.size());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(make_row(1, i + 1), buffer.pop().get_field("new_val"));
+    }
+    EXPECT_EQ(0, get_count(&squashed));
+}
+
+TPTEST(ChangefeedTest, OverflowArraySize) {
+    perfmon_counter_t dropped, squashed;
+    change_buffer_t buffer("id", false, MEGABYTE, &dropped, &squashed);
+    const size_t limit = 10;
+    size_t num_dropped;
+    for (size_t i = 0; i < limit; ++i) {
+        EXPECT_EQ(change_buffer_t::overflow_t::NONE,
+                  buffer.push(make_change(ql::datum_t::null(), make_row(i, 0)),
+                              limit, &num_dropped));
+    }
+    EXPECT_EQ(limit, buffer.size());
+
+    EXPECT_EQ(change_buffer_t::overflow_t::ARRAY_SIZE,
+              buffer.push(make_change(ql::datum_t::null(), make_row(limit, 0)),
+                          limit, &num_dropped));
+    EXPECT_EQ(limit + 1, num_dropped);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(static_cast<int64_t>(limit + 1), get_count(&dropped));
+
+    // The buffer starts filling up again afterwards.
+    EXPECT_EQ(change_buffer_t::overflow_t::NONE,
+              buffer.push(make_change(ql::datum_t::null(), make_row(0, 1)),
+                          limit, &num_dropped));
+    EXPECT_EQ(1u, buffer.size());
+}
+
+TPTEST(ChangefeedTest, OverflowMemory) {
+    perfmon_counter_t dropped, squashed;
+    change_buffer_t buffer("id", true, 1000, &dropped, &squashed);
+    size_t num_dropped;
+    change_buffer_t::overflow_t overflow = change_buffer_t::overflow_t::NONE;
+    int pushed = 0;
+    while (overflow == change_buffer_t::overflow_t::NONE) {
+        ASSERT_LT(pushed, 1000);
+        overflow = push(&buffer, make_change(ql::datum_t::null(), make_row(pushed, 0)),
+                        &num_dropped);
+        ++pushed;
+    }
+    EXPECT_EQ(change_buffer_t::overflow_t::MEMORY, overflow);
+    EXPECT_EQ(static_cast<size_t>(pushed), num_dropped);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(pushed, get_count(&dropped));
+
+    // Dropped changes aren't squashed into later ones.
+    push(&buffer, make_change(make_row(0, 0), make_row(0, 1)), &num_dropped);
+    EXPECT_EQ(1u, buffer.size());
+    EXPECT_EQ(0, get_count(&squashed));
+}
+
+// `filter(row => r([value]).contains(y => y == row("a")))`, as sent by a driver
+// that numbered the variables from `var` and put the filter at position `frame`.
+static std::vector<ql::transform_variant_t> make_filter(int64_t var, double value,
+                                                        int64_t frame) {
+    const ql::sym_t x(var), y(var + 1);
+    ql::r::reql_t body = ql::r::array(value).contains(
+        ql::r::reql_t(Term::FUNC, ql::r::array(static_cast<double>(y.value)),
+                      ql::r::var(y) == ql::r::var(x)[std::string("a")]));
+    ql::protob_t<Term> term = ql::make_counted_term_copy(body.get());
+    ql::protob_t<Backtrace> bt = ql::make_counted_backtrace();
+    Frame *f = bt->add_frames();
+    f->set_type(Frame::POS);
+    f->set_pos(frame);
+    ql::propagate_backtrace(term.get(), bt.get());
+    return std::vector<ql::transform_variant_t>{
+        ql::filter_wire_func_t(ql::wire_func_t(term, std::vector<ql::sym_t>{x}, bt),
+                               boost::none)};
+}
+
+TPTEST(ChangefeedTest, FilterKeyIgnoresVariablesAndBacktraces) {
+    EXPECT_EQ(filter_key(make_filter(1, 1.0, 0)), filter_key(make_filter(7, 1.0, 3)));
+    EXPECT_NE(filter_key(make_filter(1, 1.0, 0)), filter_key(make_filter(1, 2.0, 0)));
+}
+
+TPTEST(ChangefeedTest, SameFilterSharesEvaluator) {
+    connectivity_cluster_t c;
+    mailbox_manager_t m(&c, 'M');
+    connectivity_cluster_t::run_t r(&c, get_unittest_addresses(), peer_address_t(),
+                                    ANY_PORT, 0);
+    rdb_context_t ctx;
+    ql::changefeed::server_t server(&m, &ctx);
+    mailbox_t<void(ql::changefeed::stamped_msg_t)> client_a(
+        &m, [](ql::changefeed::stamped_msg_t) { });
+    mailbox_t<void(ql::changefeed::stamped_msg_t)> client_b(
+        &m, [](ql::changefeed::stamped_msg_t) { });
+    server.add_client(client_a.get_address(), region_t::universe());
+    server.add_client(client_b.get_address(), region_t::universe());
+
+    // Two feeds with the same predicate, from different queries.
+    server.add_filter(client_a.get_address(), filter_t(1, make_filter(1, 1.0, 0)));
+    server.add_filter(client_b.get_address(), filter_t(1, make_filter(4, 1.0, 2)));
+    EXPECT_EQ(1u, server.num_evaluators());
+
+    server.add_filter(client_b.get_address(), filter_t(2, make_filter(4, 2.0, 2)));
+    EXPECT_EQ(2u, server.num_evaluators());
+}
+
+TEST(ChangefeedTest, SkippedMessages) {
+    EXPECT_EQ("Changefeed cache over array size limit, skipped 5 elements.",
+              ql::changefeed::skipped_changes_message(
+                  change_buffer_t::overflow_t::ARRAY_SIZE, 5));
+    EXPECT_EQ("Changefeed cache over memory limit (16MB), skipped 7 elements.",
+              ql::changefeed::skipped_changes_message(
+                  change_buffer_t::overflow_t::MEMORY, 7));
+}
+
+}  // namespace unittest
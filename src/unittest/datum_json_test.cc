@@ -0,0 +1,75 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "http/json.hpp"
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_json.hpp"
+#include "rdb_protocol/error.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+ql::datum_t parse_with_cjson(const std::string &json) {
+    scoped_cJSON_t cjson(cJSON_Parse(json.c_str()));
+    if (cjson.get() == NULL) {
+        return ql::datum_t();
+    }
+    return ql::to_datum(cjson.get(), ql::configured_limits_t());
+}
+
+void check_same_as_cjson(const std::string &json) {
+    SCOPED_TRACE(json);
+    ql::datum_t expected = parse_with_cjson(json);
+    ql::datum_t actual = ql::parse_json(json, ql::configured_limits_t());
+    ASSERT_TRUE(expected.has());
+    ASSERT_TRUE(actual.has());
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(DatumJsonTest, SameAsCJSON) {
+    const char *docs[] = {
+        "null", "true", "false", "0", "-0", "17", "-17", "123456789012345",
+        "1234567890123456789", "3.25", "-1e10", "6.02214179e23", "1E-5",
+        "\"\"", "\"plain\"", "\"a \\\"quoted\\\" \\\\ string\\n\\t\\/\"",
+        "\"\\u00e9\\u4e2d\\ud83d\\ude00\"", "\"caf\xc3\xa9\"",
+        "[]", "[1, 2, 3]", "  [ 1 ,\n\t\"two\" , [3] , {\"four\": 4} ]  ",
+        "{}", "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\"}}",
+        // Strings long enough to go through the vectorized scanning loops.
+        "\"0123456789abcdef0123456789abcdef0123456789\"",
+        "\"0123456789abcdef0123456789\\\"abcdef0123456789\\\\0123456789\"",
+        "[1,                                              2]",
+        // cJSON ignores whatever follows the first value.
+        "[1, 2] trailing garbage", "1 2",
+    };
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); ++i) {
+        check_same_as_cjson(docs[i]);
+    }
+}
+
+TEST(DatumJsonTest, Invalid) {
+    const char *docs[] = {
+        "", "   ", "nul", "tru", "[1, 2", "[1 2]", "{\"a\" 1}", "{\"a\": 1,}",
+        "{1: 2}", "\"unterminated", "\"bad escape \\u0000\"", "\"lone \\udc00\"",
+        "-", "+1", "[,]", "{\"a\": }",
+    };
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); ++i) {
+        SCOPED_TRACE(docs[i]);
+        EXPECT_FALSE(ql::parse_json(docs[i], ql::configured_limits_t()).has());
+    }
+
+    // cJSON silently cut strings short at a NUL byte, we reject them.
+    const std::string with_nul("\"abc\0def\"", 9);
+    EXPECT_FALSE(ql::parse_json(with_nul, ql::configured_limits_t()).has());
+}
+
+TEST(DatumJsonTest, InvalidDatum) {
+    EXPECT_THROW(ql::parse_json("{\"a\": 1, \"a\": 2}", ql::configured_limits_t()),
+                 ql::base_exc_t);
+    EXPECT_THROW(ql::parse_json("1e999", ql::configured_limits_t()), ql::base_exc_t);
+    EXPECT_THROW(ql::parse_json("[1, 2, 3]", ql::configured_limits_t(2)),
+                 ql::base_exc_t);
+}
+
+}  // namespace unittest
@@ -3,6 +3,8 @@
 #include "containers/archive/string_stream.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "unittest/gtest.hpp"
 
 
@@ -66,6 +68,100 @@ TEST(DatumTest, NumericSerialization) {
     test_datum_serialization(ql::datum_t(std::move(vec), limits));
 }
 
+TEST(DatumTest, BufferBackedAccess) {
+    ql::configured_limits_t limits;
+
+    // Enough fields that the offset table needs more than one byte per entry.
+    std::map<datum_string_t, ql::datum_t> inner;
+    for (int i = 0; i < 100; ++i) {
+        inner[datum_string_t(strprintf("field%03d", i))] =
+            ql::datum_t(datum_string_t(strprintf("value %d", i)));
+    }
+    std::vector<ql::datum_t> arr;
+    for (int i = 0; i < 10; ++i) {
+        arr.push_back(ql::datum_t(static_cast<double>(i)));
+    }
+    arr.push_back(ql::datum_t(std::map<datum_string_t, ql::datum_t>(inner)));
+
+    std::map<datum_string_t, ql::datum_t> outer;
+    outer[datum_string_t("id")] = ql::datum_t(1.0);
+    outer[datum_string_t("inner")] = ql::datum_t(std::move(inner));
+    outer[datum_string_t("arr")] = ql::datum_t(std::move(arr), limits);
+    outer[datum_string_t("empty")] =
+        ql::datum_t(std::map<datum_string_t, ql::datum_t>());
+    const ql::datum_t datum(std::move(outer));
+
+    write_message_t wm;
+    ASSERT_FALSE(bad(ql::datum_serialize(&wm, datum)));
+    string_stream_t write_stream;
+    ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+    const std::string serialized = write_stream.str();
+    ASSERT_EQ(ql::datum_serialized_size(datum), serialized.size());
+
+    string_read_stream_t read_stream(std::string(serialized), 0);
+    ql::datum_t buf_datum;
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&read_stream, &buf_datum));
+
+    ASSERT_EQ(datum, buf_datum);
+    ASSERT_EQ(4u, buf_datum.obj_size());
+    ASSERT_EQ(1.0, buf_datum.get_field("id").as_num());
+    ASSERT_FALSE(buf_datum.get_field("missing", ql::NOTHROW).has());
+
+    const ql::datum_t buf_inner = buf_datum.get_field("inner");
+    ASSERT_EQ(100u, buf_inner.obj_size());
+    ASSERT_EQ("value 42", buf_inner.get_field("field042").as_str().to_std());
+    ASSERT_EQ("field099", buf_inner.get_pair(99).first.to_std());
+
+    const ql::datum_t buf_arr = buf_datum.get_field("arr");
+    ASSERT_EQ(ql::datum_t::R_ARRAY, buf_arr.get_type());
+    ASSERT_EQ(11u, buf_arr.arr_size());
+    ASSERT_EQ(7.0, buf_arr.get(7).as_num());
+    ASSERT_EQ(buf_inner, buf_arr.get(10));
+    ASSERT_EQ(0u, buf_datum.get_field("empty").obj_size());
+
+    // Serializing a buffer-backed datum copies its buffer unchanged.
+    write_message_t wm2;
+    ASSERT_FALSE(bad(ql::datum_serialize(&wm2, buf_datum)));
+    string_stream_t write_stream2;
+    ASSERT_EQ(0, send_write_message(&write_stream2, &wm2));
+    ASSERT_EQ(serialized, write_stream2.str());
+
+    test_datum_serialization(buf_datum);
+}
+
+TEST(DatumTest, HashMatchesEquality) {
+    ql::configured_limits_t limits;
+
+    // Data that compare equal without being identical.
+    ASSERT_EQ(ql::datum_t(0.0), ql::datum_t(-0.0));
+    EXPECT_EQ(ql::datum_t(0.0).hash(), ql::datum_t(-0.0).hash());
+    const ql::datum_t utc = ql::pseudo::make_time(1400000000, "+00:00");
+    const ql::datum_t pst = ql::pseudo::make_time(1400000000, "-08:00");
+    ASSERT_EQ(utc, pst);
+    EXPECT_EQ(utc.hash(), pst.hash());
+
+    std::map<datum_string_t, ql::datum_t> obj;
+    obj[datum_string_t("a")] = ql::datum_t(1.0);
+    obj[datum_string_t("b")] = ql::datum_t(std::vector<ql::datum_t>{
+            ql::datum_t::null(), ql::datum_t::boolean(true),
+            ql::datum_t("str")}, limits);
+    const ql::datum_t datum(std::move(obj));
+    write_message_t wm;
+    ASSERT_FALSE(bad(ql::datum_serialize(&wm, datum)));
+    string_stream_t write_stream;
+    ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+    string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+    ql::datum_t buf_datum;
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&read_stream, &buf_datum));
+    EXPECT_EQ(datum.hash(), buf_datum.hash());
+
+    // Different data should (almost always) hash differently.
+    EXPECT_NE(ql::datum_t(1.0).hash(), ql::datum_t(2.0).hash());
+    EXPECT_NE(ql::datum_t("a").hash(), ql::datum_t("b").hash());
+    EXPECT_NE(ql::datum_t("1").hash(), ql::datum_t(1.0).hash());
+    EXPECT_NE(datum.hash(), datum.get_field("b").hash());
+}
+
 
 
 }  // namespace unittest
@@ -0,0 +1,86 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+#include <sys/uio.h>
+
+#include "arch/io/disk.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/scoped.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+struct disk_backend_test_callback_t : public linux_iocallback_t, public cond_t {
+    void on_io_complete() {
+        pulse();
+    }
+};
+
+void run_write_read_test(file_io_backend_t io_backend) {
+    temp_file_t temp_file;
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired,
+                                DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                                io_backend);
+
+    scoped_ptr_t<file_t> file;
+    file_open_result_t res = open_file(temp_file.name().permanent_path().c_str(),
+                                       linux_file_t::mode_read
+                                       | linux_file_t::mode_write
+                                       | linux_file_t::mode_create,
+                                       &io_backender,
+                                       &file);
+    ASSERT_NE(file_open_result_t::ERROR, res.outcome);
+
+    const size_t chunk_size = DEVICE_BLOCK_SIZE * 4;
+    file->set_file_size_at_least(chunk_size * 3);
+
+    scoped_malloc_t<char> chunks[3];
+    for (int i = 0; i < 3; ++i) {
+        chunks[i] = scoped_malloc_t<char>(malloc_aligned(chunk_size, DEVICE_BLOCK_SIZE));
+        memset(chunks[i].get(), 'a' + i, chunk_size);
+    }
+
+    // A single write wrapped in datasyncs...
+    {
+        disk_backend_test_callback_t cb;
+        file->write_async(0, chunk_size, chunks[0].get(), DEFAULT_DISK_ACCOUNT, &cb,
+                          file_t::WRAP_IN_DATASYNCS);
+        cb.wait();
+    }
+
+    // ... and a writev behind it.
+    {
+        scoped_array_t<iovec> iovecs(2);
+        iovecs[0].iov_base = chunks[1].get();
+        iovecs[0].iov_len = chunk_size;
+        iovecs[1].iov_base = chunks[2].get();
+        iovecs[1].iov_len = chunk_size;
+        disk_backend_test_callback_t cb;
+        file->writev_async(chunk_size, chunk_size * 2, std::move(iovecs),
+                           DEFAULT_DISK_ACCOUNT, &cb);
+        cb.wait();
+    }
+
+    scoped_malloc_t<char> read_buf(malloc_aligned(chunk_size * 3, DEVICE_BLOCK_SIZE));
+    {
+        disk_backend_test_callback_t cb;
+        file->read_async(0, chunk_size * 3, read_buf.get(), DEFAULT_DISK_ACCOUNT, &cb);
+        cb.wait();
+    }
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(0, memcmp(read_buf.get() + i * chunk_size, chunks[i].get(), chunk_size));
+    }
+}
+
+TPTEST(DiskBackendTest, PoolWriteRead) {
+    run_write_read_test(file_io_backend_t::blocker_pool);
+}
+
+// If the kernel doesn't support io_uring this exercises the fallback to the pool,
+// which should be just as correct.
+TPTEST(DiskBackendTest, UringWriteRead) {
+    run_write_read_test(file_io_backend_t::io_uring);
+}
+
+}  // namespace unittest
@@ -0,0 +1,237 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rdb_protocol/context.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term_walker.hpp"
+#include "rdb_protocol/val.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// A table that answers `get_rows` and `get_all` from a vector of rows, and counts
+// how many reads it was asked to do.
+class eq_join_table_t : public base_table_t {
+public:
+    explicit eq_join_table_t(std::vector<ql::datum_t> &&_rows)
+        : rows(std::move(_rows)), pkey("id"), num_reads(0), num_keys_read(0) { }
+
+    const std::string &get_pkey() { return pkey; }
+
+    ql::datum_t read_row(ql::env_t *, ql::datum_t, bool) {
+        unreachable();
+    }
+    std::vector<ql::datum_t> read_rows(ql::env_t *,
+                                       const std::vector<ql::datum_t> &pvals, bool) {
+        ++num_reads;
+        num_keys_read += pvals.size();
+        std::vector<ql::datum_t> ret;
+        for (auto it = pvals.begin(); it != pvals.end(); ++it) {
+            std::vector<ql::datum_t> matches = find(pkey, *it);
+            ret.push_back(matches.empty() ? ql::datum_t::null() : matches[0]);
+        }
+        return ret;
+    }
+    counted_t<ql::datum_stream_t> read_all(
+            ql::env_t *env, const std::string &sindex,
+            const ql::protob_t<const Backtrace> &bt, const std::string &,
+            const datum_range_t &range, sorting_t, bool) {
+        ++num_reads;
+        std::vector<ql::datum_t> matches;
+        for (auto it = rows.begin(); it != rows.end(); ++it) {
+            if (range.contains(env->reql_version(), it->get_field(sindex.c_str()))) {
+                matches.push_back(*it);
+            }
+        }
+        return make_counted<ql::array_datum_stream_t>(
+            ql::datum_t(std::move(matches), ql::configured_limits_t::unlimited), bt);
+    }
+    counted_t<ql::datum_stream_t> read_row_changes(
+            ql::env_t *, ql::datum_t, const ql::protob_t<const Backtrace> &,
+            const std::string &) {
+        unreachable();
+    }
+    counted_t<ql::datum_stream_t> read_all_changes(
+            ql::env_t *, bool, const ql::protob_t<const Backtrace> &,
+            const std::string &) {
+        unreachable();
+    }
+    counted_t<ql::datum_stream_t> read_intersecting(
+            ql::env_t *, const std::string &, const ql::protob_t<const Backtrace> &,
+            const std::string &, bool, const ql::datum_t &) {
+        unreachable();
+    }
+    counted_t<ql::datum_stream_t> read_nearest(
+            ql::env_t *, const std::string &, const ql::protob_t<const Backtrace> &,
+            const std::string &, bool, lat_lon_point_t, double, uint64_t,
+            const ellipsoid_spec_t &, dist_unit_t, const ql::configured_limits_t &) {
+        unreachable();
+    }
+    ql::datum_t write_batched_replace(
+            ql::env_t *, const std::vector<ql::datum_t> &,
+            const counted_t<const ql::func_t> &, return_changes_t,
+            durability_requirement_t) {
+        unreachable();
+    }
+    ql::datum_t write_batched_insert(
+            ql::env_t *, std::vector<ql::datum_t> &&, conflict_behavior_t,
+            return_changes_t, durability_requirement_t) {
+        unreachable();
+    }
+    bool write_sync_depending_on_durability(ql::env_t *, durability_requirement_t) {
+        unreachable();
+    }
+    bool sindex_create(ql::env_t *, const std::string &, counted_t<const ql::func_t>,
+                       sindex_multi_bool_t, sindex_geo_bool_t,
+                       const boost::optional<std::vector<std::string> > &) {
+        unreachable();
+    }
+    bool sindex_drop(ql::env_t *, const std::string &) {
+        unreachable();
+    }
+    sindex_rename_result_t sindex_rename(ql::env_t *, const std::string &,
+                                         const std::string &, bool) {
+        unreachable();
+    }
+    std::vector<std::string> sindex_list(ql::env_t *) {
+        unreachable();
+    }
+    std::map<std::string, ql::datum_t> sindex_status(ql::env_t *,
+                                                     const std::set<std::string> &) {
+        unreachable();
+    }
+
+    const std::vector<ql::datum_t> rows;
+    const std::string pkey;
+    int num_reads;
+    size_t num_keys_read;
+
+private:
+    std::vector<ql::datum_t> find(const std::string &field, const ql::datum_t &key) {
+        std::vector<ql::datum_t> ret;
+        for (auto it = rows.begin(); it != rows.end(); ++it) {
+            ql::datum_t val = it->get_field(field.c_str(), ql::NOTHROW);
+            if (val.has() && val == key) {
+                ret.push_back(*it);
+            }
+        }
+        return ret;
+    }
+};
+
+static ql::datum_t make_row(const std::string &field, ql::datum_t id, ql::datum_t val) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        {datum_string_t("id"), std::move(id)},
+        {datum_string_t(field), std::move(val)}});
+}
+
+static ql::datum_t make_join_pair(ql::datum_t left, ql::datum_t right) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        {datum_string_t("left"), std::move(left)},
+        {datum_string_t("right"), std::move(right)}});
+}
+
+// Joins `left` on its `fk` field with `table`'s `index`, reading `batch_size` rows
+// at a time.
+static std::vector<ql::datum_t> eq_join(ql::env_t *env,
+                                        const std::vector<ql::datum_t> &left,
+                                        eq_join_table_t *table,
+                                        const std::string &index,
+                                        uint64_t batch_size) {
+    const ql::sym_t x(1);
+    ql::protob_t<Term> body
+        = ql::make_counted_term_copy((ql::r::var(x)[std::string("fk")]).get());
+    ql::protob_t<Backtrace> bt = ql::make_counted_backtrace();
+    ql::propagate_backtrace(body.get(), bt.get());
+    counted_t<const ql::func_t> left_key
+        = ql::wire_func_t(body, std::vector<ql::sym_t>{x}, bt).compile_wire_func();
+
+    counted_t<ql::datum_stream_t> source = make_counted<ql::array_datum_stream_t>(
+        ql::datum_t(std::vector<ql::datum_t>(left), ql::configured_limits_t::unlimited),
+        bt);
+    counted_t<ql::table_t> t = make_counted<ql::table_t>(
+        scoped_ptr_t<base_table_t>(table),
+        make_counted<const ql::db_t>(generate_uuid(), "test"), "test", false, bt);
+    counted_t<ql::datum_stream_t> join
+        = make_counted<ql::eq_join_datum_stream_t>(source, left_key, t, index);
+
+    std::vector<ql::datum_t> ret;
+    const ql::batchspec_t batchspec = ql::batchspec_t::all().with_at_most(batch_size);
+    for (;;) {
+        std::vector<ql::datum_t> batch = join->next_batch(env, batchspec);
+        if (batch.empty()) {
+            break;
+        }
+        std::move(batch.begin(), batch.end(), std::back_inserter(ret));
+    }
+    return ret;
+}
+
+TPTEST(EqJoinTest, PrimaryKey) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+    std::vector<ql::datum_t> right;
+    for (int i = 1; i <= 3; ++i) {
+        right.push_back(make_row("value", ql::datum_t(static_cast<double>(i)),
+                                 ql::datum_t(static_cast<double>(i * 10))));
+    }
+    // Duplicate keys, a key with no match, a null row and a row without the field.
+    std::vector<ql::datum_t> left{
+        make_row("fk", ql::datum_t(10.0), ql::datum_t(1.0)),
+        make_row("fk", ql::datum_t(11.0), ql::datum_t(2.0)),
+        make_row("fk", ql::datum_t(12.0), ql::datum_t(1.0)),
+        make_row("fk", ql::datum_t(13.0), ql::datum_t(5.0)),
+        ql::datum_t::null(),
+        make_row("other", ql::datum_t(14.0), ql::datum_t(1.0))};
+    const std::vector<ql::datum_t> expected{
+        make_join_pair(left[0], right[0]),
+        make_join_pair(left[1], right[1]),
+        make_join_pair(left[2], right[0])};
+
+    // The three distinct keys are looked up with a single read.
+    eq_join_table_t *table = new eq_join_table_t(std::vector<ql::datum_t>(right));
+    EXPECT_EQ(expected, eq_join(&env, left, table, "id", 100));
+    EXPECT_EQ(1, table->num_reads);
+    EXPECT_EQ(3u, table->num_keys_read);
+
+    // One row at a time, each looked up while the next one is fetched.  The null
+    // row and the row without the field aren't looked up.
+    table = new eq_join_table_t(std::vector<ql::datum_t>(right));
+    EXPECT_EQ(expected, eq_join(&env, left, table, "id", 1));
+    EXPECT_EQ(4, table->num_reads);
+    EXPECT_EQ(4u, table->num_keys_read);
+}
+
+TPTEST(EqJoinTest, SecondaryIndex) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+    std::vector<ql::datum_t> right{
+        make_row("k", ql::datum_t(1.0), ql::datum_t("a")),
+        make_row("k", ql::datum_t(2.0), ql::datum_t("a")),
+        make_row("k", ql::datum_t(3.0), ql::datum_t("b"))};
+    std::vector<ql::datum_t> left{
+        make_row("fk", ql::datum_t(10.0), ql::datum_t("a")),
+        make_row("fk", ql::datum_t(11.0), ql::datum_t("b")),
+        make_row("fk", ql::datum_t(12.0), ql::datum_t("a")),
+        make_row("fk", ql::datum_t(13.0), ql::datum_t("c")),
+        make_row("other", ql::datum_t(14.0), ql::datum_t("a"))};
+    const std::vector<ql::datum_t> expected{
+        make_join_pair(left[0], right[0]),
+        make_join_pair(left[0], right[1]),
+        make_join_pair(left[1], right[2]),
+        make_join_pair(left[2], right[0]),
+        make_join_pair(left[2], right[1])};
+
+    // One read per distinct key.
+    eq_join_table_t *table = new eq_join_table_t(std::vector<ql::datum_t>(right));
+    EXPECT_EQ(expected, eq_join(&env, left, table, "k", 100));
+    EXPECT_EQ(3, table->num_reads);
+}
+
+}  // namespace unittest
@@ -0,0 +1,183 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "concurrency/cond_var.hpp"
+#include "rdb_protocol/context.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/external_sort.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/profile.hpp"
+#include "rdb_protocol/term.hpp"
+#include "rdb_protocol/term_walker.hpp"
+#include "rdb_protocol/val.hpp"
+#include "rdb_protocol/wire_func.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Orders `{key: k, seq: n}` objects by `key` alone, so that we can check that
+// the sort is stable by looking at `seq`.
+bool key_lt(ql::env_t *, profile::sampler_t *sampler,
+            const ql::datum_t &l, const ql::datum_t &r) {
+    sampler->new_sample();
+    return l.get_field("key").as_num() < r.get_field("key").as_num();
+}
+
+void run_external_sort_test(int num_elements, size_t run_size) {
+    char tmpl[] = "/tmp/rdb_unittest.XXXXXX";
+    guarantee_err(mkdtemp(tmpl) != NULL, "Couldn't create a temporary directory");
+    const base_path_t base_path(tmpl);
+    recreate_temporary_directory(base_path);
+
+    {
+        io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+        cond_t interruptor;
+        ql::env_t env(&interruptor, reql_version_t::LATEST);
+
+        ql::external_sorter_t sorter(&io_backender, base_path, &key_lt);
+        std::vector<ql::datum_t> run;
+        for (int i = 0; i < num_elements; ++i) {
+            ql::datum_object_builder_t builder;
+            builder.overwrite("key", ql::datum_t(static_cast<double>((i * 7919) % 97)));
+            builder.overwrite("seq", ql::datum_t(static_cast<double>(i)));
+            run.push_back(std::move(builder).to_datum());
+            if (run.size() == run_size) {
+                sorter.add_run(&env, std::move(run));
+                run.clear();
+            }
+        }
+        sorter.finish(&env, std::move(run));
+        EXPECT_LE(1u, sorter.num_spilled_runs());
+
+        profile::sampler_t sampler("test", env.trace);
+        ql::datum_t prev;
+        int count = 0;
+        while (ql::datum_t d = sorter.next(&env, &sampler)) {
+            if (prev.has()) {
+                const double prev_key = prev.get_field("key").as_num();
+                const double key = d.get_field("key").as_num();
+                ASSERT_LE(prev_key, key);
+                if (prev_key == key) {
+                    ASSERT_LT(prev.get_field("seq").as_num(),
+                              d.get_field("seq").as_num());
+                }
+            }
+            prev = d;
+            ++count;
+        }
+        EXPECT_EQ(num_elements, count);
+        EXPECT_TRUE(sorter.is_exhausted());
+    }
+
+    remove_directory_recursive(tmpl);
+}
+
+TPTEST(ExternalSort, FewRuns) {
+    run_external_sort_test(1000, 300);
+}
+
+// Enough runs to force intermediate merges.
+TPTEST(ExternalSort, ManyRuns) {
+    run_external_sort_test(5000, 100);
+}
+
+// Evaluates `query` with an array size limit of `array_limit`, in an environment
+// that can spill to disk, and returns the elements of the sequence it returns.
+std::vector<ql::datum_t> eval_spilling_query(const ql::r::reql_t &query,
+                                             double array_limit) {
+    char tmpl[] = "/tmp/rdb_unittest.XXXXXX";
+    guarantee_err(mkdtemp(tmpl) != NULL, "Couldn't create a temporary directory");
+    const base_path_t base_path(tmpl);
+    recreate_temporary_directory(base_path);
+
+    std::vector<ql::datum_t> result;
+    {
+        io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+        rdb_context_t ctx(NULL, NULL, NULL,
+                          boost::shared_ptr<semilattice_readwrite_view_t<
+                              auth_semilattice_metadata_t> >(),
+                          &get_global_perfmon_collection(), "",
+                          &io_backender, base_path);
+
+        ql::protob_t<const Term> limit_term
+            = ql::r::expr(array_limit).release_counted();
+        std::map<std::string, ql::wire_func_t> optargs;
+        optargs["array_limit"] = ql::wire_func_t(
+            ql::map_wire_func_t(limit_term, std::vector<ql::sym_t>(),
+                                ql::get_backtrace(limit_term)).compile_wire_func());
+
+        cond_t interruptor;
+        ql::env_t env(&ctx, &interruptor, optargs, nullptr);
+
+        ql::protob_t<Term> term = ql::make_counted_term_copy(query.get());
+        ql::preprocess_term(term.get());
+        ql::compile_env_t compile_env((ql::var_visibility_t()));
+        counted_t<const ql::term_t> root = ql::compile_term(&compile_env, term);
+        ql::scope_env_t scope_env(&env, ql::var_scope_t());
+        counted_t<ql::datum_stream_t> seq = root->eval(&scope_env)->as_seq(&env);
+
+        // The query gets sent back as a stream, not as an array, which would be
+        // over the limit.
+        EXPECT_FALSE(seq->as_array(&env).has());
+        ql::batchspec_t batchspec
+            = ql::batchspec_t::user(ql::batch_type_t::NORMAL, &env);
+        while (ql::datum_t d = seq->next(&env, batchspec)) {
+            result.push_back(d);
+        }
+    }
+
+    remove_directory_recursive(tmpl);
+    return result;
+}
+
+TPTEST(ExternalSort, OrderByOverArrayLimit) {
+    ql::datum_array_builder_t input(ql::configured_limits_t::unlimited);
+    for (int i = 0; i < 1000; ++i) {
+        ql::datum_object_builder_t builder;
+        builder.overwrite("key", ql::datum_t(static_cast<double>((i * 7919) % 97)));
+        builder.overwrite("seq", ql::datum_t(static_cast<double>(i)));
+        input.add(std::move(builder).to_datum());
+    }
+
+    std::vector<ql::datum_t> sorted = eval_spilling_query(
+        ql::r::reql_t(Term::ORDERBY, ql::r::expr(std::move(input).to_datum()),
+                      std::string("key")),
+        100);
+
+    ASSERT_EQ(1000u, sorted.size());
+    for (size_t i = 1; i < sorted.size(); ++i) {
+        const double prev_key = sorted[i - 1].get_field("key").as_num();
+        const double key = sorted[i].get_field("key").as_num();
+        ASSERT_LE(prev_key, key);
+        if (prev_key == key) {
+            ASSERT_LT(sorted[i - 1].get_field("seq").as_num(),
+                      sorted[i].get_field("seq").as_num());
+        }
+    }
+}
+
+TPTEST(ExternalSort, DistinctOverArrayLimit) {
+    ql::datum_array_builder_t input(ql::configured_limits_t::unlimited);
+    for (int i = 0; i < 1000; ++i) {
+        input.add(ql::datum_t(static_cast<double>((i * 7919) % 500)));
+    }
+
+    std::vector<ql::datum_t> distinct = eval_spilling_query(
+        ql::r::reql_t(Term::DISTINCT, ql::r::expr(std::move(input).to_datum())),
+        100);
+
+    ASSERT_EQ(500u, distinct.size());
+    for (size_t i = 0; i < distinct.size(); ++i) {
+        ASSERT_EQ(static_cast<double>(i), distinct[i].as_num());
+    }
+}
+
+}  // namespace unittest
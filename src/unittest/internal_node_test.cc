@@ -6,6 +6,8 @@
 
 #include "btree/internal_node.hpp"
 #include "btree/node.hpp"
+#include "containers/scoped.hpp"
+#include "utils.hpp"
 
 namespace unittest {
 
@@ -29,7 +31,7 @@ void verify(block_size_t block_size, const internal_node_t *buf) {
     for (std::vector<uint16_t>::const_iterator p = offsets.begin(), e = offsets.end(); p < e; ++p) {
         ASSERT_LE(expected, block_size.value());
         ASSERT_EQ(expected, *p);
-        expected += internal_node::pair_size(internal_node::get_pair(buf, *p));
+        expected += internal_node::pair_size(buf, internal_node::get_pair(buf, *p));
     }
     ASSERT_EQ(block_size.value(), expected);
 
@@ -61,6 +63,111 @@ TEST(InternalNodeTest, Offsets) {
     EXPECT_EQ(9u, sizeof(btree_internal_pair));
 }
 
+store_key_t child_key(block_id_t child) {
+    return store_key_t(strprintf("key %05" PR_BLOCK_ID, child));
+}
+
+// Makes `node` point at the children `first` to `last`, child `i` getting keys up
+// to `child_key(i)`, and gives each child a count of `10 * i`.
+void make_node(block_size_t bs, internal_node_t *node, block_id_t first,
+               block_id_t last) {
+    internal_node::init(bs, node);
+    for (block_id_t i = first; i < last; ++i) {
+        ASSERT_TRUE(internal_node::insert(bs, node, child_key(i).btree_key(), i, i + 1));
+    }
+    for (block_id_t i = first; i <= last; ++i) {
+        internal_node::set_child_count(node, internal_node::find_child(node, i),
+                                       10 * i);
+    }
+}
+
+void verify_counts(const internal_node_t *node) {
+    for (int i = 0; i < node->npairs; ++i) {
+        const block_id_t child = internal_node::get_pair_by_index(node, i)->lnode;
+        EXPECT_EQ(10 * child, internal_node::get_child_count(node, i));
+    }
+}
+
+TEST(InternalNodeTest, ChildCountsFollowChildren) {
+    block_size_t bs = block_size_t::unsafe_make(4096);
+    scoped_malloc_t<internal_node_t> node(bs.value());
+    scoped_malloc_t<internal_node_t> rnode(bs.value());
+    scoped_malloc_t<internal_node_t> parent(bs.value());
+
+    block_id_t last = 1;
+    internal_node::init(bs, node.get());
+    do {
+        ++last;
+        make_node(bs, node.get(), 1, last);
+    } while (!internal_node::is_full(node.get()));
+    verify(bs, node.get());
+    verify_counts(node.get());
+
+    store_key_t median;
+    internal_node::split(bs, node.get(), rnode.get(), median.btree_key());
+    verify(bs, node.get());
+    verify(bs, rnode.get());
+    verify_counts(node.get());
+    verify_counts(rnode.get());
+
+    internal_node::init(bs, parent.get());
+    ASSERT_TRUE(internal_node::insert(bs, parent.get(), median.btree_key(),
+                                      1000, 1001));
+
+    // Move some children from `rnode` into `node` and back again.
+    store_key_t replacement;
+    internal_node::remove(bs, node.get(), child_key(1).btree_key());
+    internal_node::remove(bs, node.get(), child_key(2).btree_key());
+    ASSERT_TRUE(internal_node::level(bs, node.get(), rnode.get(),
+                                     replacement.btree_key(), parent.get(), NULL));
+    verify_counts(node.get());
+    verify_counts(rnode.get());
+    internal_node::update_key(parent.get(), median.btree_key(), replacement.btree_key());
+    internal_node::remove(bs, rnode.get(), child_key(last - 1).btree_key());
+    internal_node::remove(bs, rnode.get(), child_key(last - 2).btree_key());
+    ASSERT_TRUE(internal_node::level(bs, rnode.get(), node.get(),
+                                     median.btree_key(), parent.get(), NULL));
+    verify_counts(node.get());
+    verify_counts(rnode.get());
+    internal_node::update_key(parent.get(), replacement.btree_key(), median.btree_key());
+
+    internal_node::merge(bs, node.get(), rnode.get(), parent.get());
+    verify(bs, rnode.get());
+    verify_counts(rnode.get());
+}
+
+TEST(InternalNodeTest, LegacyNodes) {
+    block_size_t bs = block_size_t::unsafe_make(4096);
+    scoped_malloc_t<internal_node_t> node(bs.value());
+    internal_node::init(bs, node.get());
+    node->magic = internal_node_t::legacy_magic;
+    for (block_id_t i = 1; i < 10; ++i) {
+        ASSERT_TRUE(internal_node::insert(bs, node.get(), child_key(i).btree_key(),
+                                          i, i + 1));
+    }
+    EXPECT_FALSE(internal_node::has_child_counts(node.get()));
+    EXPECT_EQ(internal_node::UNKNOWN_CHILD_COUNT,
+              internal_node::get_child_count(node.get(), 0));
+
+    ASSERT_TRUE(internal_node::can_add_child_counts(node.get()));
+    internal_node::add_child_counts(bs, node.get());
+    verify(bs, node.get());
+    for (int i = 0; i < node->npairs; ++i) {
+        EXPECT_EQ(internal_node::UNKNOWN_CHILD_COUNT,
+                  internal_node::get_child_count(node.get(), i));
+        EXPECT_EQ(static_cast<block_id_t>(i + 1),
+                  internal_node::get_pair_by_index(node.get(), i)->lnode);
+    }
+
+    internal_node::set_child_count(node.get(), internal_node::find_child(node.get(), 4),
+                                   7);
+    EXPECT_EQ(7u, internal_node::get_child_count(node.get(), 3));
+    internal_node::invalidate_child_counts(node.get(), child_key(2).btree_key(),
+                                           child_key(5).btree_key());
+    EXPECT_EQ(internal_node::UNKNOWN_CHILD_COUNT,
+              internal_node::get_child_count(node.get(), 3));
+}
+
 
 }  // namespace unittest
 
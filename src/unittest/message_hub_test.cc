@@ -0,0 +1,109 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/runtime_utils.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/pmap.hpp"
+#include "containers/scoped.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Delivered to thread 0, which checks that the messages from each sender arrive in
+// the order they were sent.
+class ordering_message_t : public thread_message_t {
+public:
+    ordering_message_t() : sender(-1), seq(-1), last_seen(NULL), remaining(NULL),
+                           done(NULL) { }
+
+    void on_thread_switch() {
+        EXPECT_EQ((*last_seen)[sender] + 1, seq);
+        (*last_seen)[sender] = seq;
+        if (--*remaining == 0) {
+            done->pulse();
+        }
+    }
+
+    int sender;
+    int seq;
+    std::vector<int> *last_seen;
+    int *remaining;
+    cond_t *done;
+};
+
+void run_ordering_test() {
+    const int num_threads = get_num_threads();
+    const int per_thread = 10000;
+    std::vector<int> last_seen(num_threads, -1);
+    int remaining = num_threads * per_thread;
+    cond_t done;
+
+    std::vector<scoped_array_t<ordering_message_t> > messages(num_threads);
+    pmap(0, num_threads, [&](int sender) {
+        on_thread_t thread_switcher((threadnum_t(sender)));
+        messages[sender].init(per_thread);
+        for (int i = 0; i < per_thread; ++i) {
+            ordering_message_t *msg = &messages[sender][i];
+            msg->sender = sender;
+            msg->seq = i;
+            msg->last_seen = &last_seen;
+            msg->remaining = &remaining;
+            msg->done = &done;
+            if (continue_on_thread(threadnum_t(0), msg)) {
+                call_later_on_this_thread(msg);
+            }
+            // Let the batches go out at different sizes.
+            if (i % (sender + 7) == 0) {
+                coro_t::yield();
+            }
+        }
+    });
+    done.wait();
+}
+
+TEST(MessageHubTest, OrderedPerSender) {
+    run_in_thread_pool(&run_ordering_test, 8);
+}
+
+// Not really a test: measures how long it takes to hop between threads, and how many
+// hops a second all the threads can do together.
+void run_hop_benchmark() {
+    const int num_threads = get_num_threads();
+    const int round_trips = 20000;
+
+    ticks_t start = get_ticks();
+    for (int i = 0; i < round_trips; ++i) {
+        on_thread_t thread_switcher((threadnum_t(1)));
+    }
+    const double latency_secs = ticks_to_secs(get_ticks() - start) / round_trips;
+
+    start = get_ticks();
+    pmap(0, num_threads, [&](int i) {
+        on_thread_t home_switcher((threadnum_t(i)));
+        for (int j = 1; j <= round_trips / 10; ++j) {
+            on_thread_t thread_switcher(threadnum_t((i + j) % num_threads));
+        }
+    });
+    const double hops_per_sec =
+        2.0 * num_threads * (round_trips / 10) / ticks_to_secs(get_ticks() - start);
+
+    printf("%d threads: %.2f us per round trip, %.0f hops/s overall.\n",
+           num_threads, latency_secs * 1e6, hops_per_sec);
+}
+
+// Disabled so that it doesn't slow down the unit tests; run it on its own with
+// `--gtest_filter=MessageHubTest.DISABLED_HopBenchmark --gtest_also_run_disabled_tests`.
+TEST(MessageHubTest, DISABLED_HopBenchmark) {
+    const int thread_counts[] = { 2, 4, 8, 16, 24 };
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        run_in_thread_pool(&run_hop_benchmark, thread_counts[i]);
+    }
+}
+
+}  // namespace unittest
@@ -106,7 +106,8 @@ class test_acq_t : public page_acq_t {
 public:
     test_acq_t() : page_acq_t() { }
     void init(page_t *page, page_cache_t *page_cache) {
-        page_acq_t::init(page, page_cache, page_cache->default_reads_account());
+        page_acq_t::init(page, page_cache, page_cache->default_reads_account(),
+                         alt_access_hint_t::normal);
     }
 
     void *get_buf_write() {
@@ -1182,4 +1183,25 @@ TPTEST(PageTest, BiggerTestNoMemory, 4) {
     test.run();
 }
 
+TEST(PageTest, GhostList) {
+    alt::ghost_list_t ghosts;
+    for (block_id_t i = 0; i < 10; ++i) {
+        ghosts.add(i, 4);
+    }
+
+    // Only the four most recently added block ids are remembered.
+    ASSERT_FALSE(ghosts.take(5));
+    ASSERT_TRUE(ghosts.take(6));
+    ASSERT_FALSE(ghosts.take(6));
+    ASSERT_TRUE(ghosts.take(9));
+
+    // Adding a block id again keeps it around for longer.
+    ghosts.add(7, 4);
+    ghosts.add(10, 4);
+    ghosts.add(11, 4);
+    ASSERT_FALSE(ghosts.take(8));
+    ASSERT_TRUE(ghosts.take(7));
+    ASSERT_TRUE(ghosts.take(10));
+}
+
 }  // namespace unittest
@@ -0,0 +1,99 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "concurrency/cond_var.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/query_cache.hpp"
+#include "rdb_protocol/term.hpp"
+#include "rdb_protocol/term_walker.hpp"
+#include "rdb_protocol/val.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+std::string eval_to_string(const counted_t<const ql::term_t> &root,
+                           std::vector<ql::datum_t> &&params) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+    env.set_query_params(std::move(params));
+    ql::scope_env_t scope_env(&env, ql::var_scope_t());
+    return root->eval(&scope_env)->as_datum().print();
+}
+
+// Runs `query` through `cache`, and checks that the result is the same as without
+// it.  Returns whether the compiled query came from the cache.
+bool run_cached(ql::query_cache_t *cache, const ql::r::reql_t &query) {
+    ql::protob_t<Term> cached = ql::make_counted_term_copy(query.get());
+    ql::preprocess_term(cached.get());
+    std::vector<ql::datum_t> params;
+    bool hit;
+    counted_t<const ql::term_t> root = cache->compile(cached, &params, &hit);
+
+    ql::protob_t<Term> uncached = ql::make_counted_term_copy(query.get());
+    ql::preprocess_term(uncached.get());
+    ql::compile_env_t compile_env((ql::var_visibility_t()));
+    EXPECT_EQ(eval_to_string(ql::compile_term(&compile_env, uncached),
+                             std::vector<ql::datum_t>()),
+              eval_to_string(root, std::move(params)));
+    return hit;
+}
+
+ql::r::reql_t plus_func(double addend) {
+    const ql::sym_t x(1);
+    return ql::r::reql_t(Term::FUNC, ql::r::array(1.0), ql::r::var(x) + addend);
+}
+
+TPTEST(QueryCacheTest, LiteralsAreParams) {
+    ql::query_cache_t cache;
+    EXPECT_FALSE(run_cached(&cache, ql::r::expr(1.0) + 2.0));
+    EXPECT_TRUE(run_cached(&cache, ql::r::expr(10.0) + 20.0));
+    EXPECT_TRUE(run_cached(&cache, ql::r::expr(std::string("a")) + std::string("b")));
+    EXPECT_FALSE(run_cached(&cache, ql::r::reql_t(Term::SUB, 1.0, 2.0)));
+    EXPECT_FALSE(run_cached(&cache, ql::r::array(1.0, 2.0).map(plus_func(1.0))));
+    EXPECT_EQ(3u, cache.size());
+}
+
+TPTEST(QueryCacheTest, CopiedLiteralsAreShape) {
+    ql::query_cache_t cache;
+    // Literals in function bodies are part of the shape.
+    EXPECT_FALSE(run_cached(&cache, ql::r::array(1.0, 2.0).map(plus_func(1.0))));
+    EXPECT_FALSE(run_cached(&cache, ql::r::array(1.0, 2.0).map(plus_func(2.0))));
+    EXPECT_TRUE(run_cached(&cache, ql::r::array(5.0, 6.0).map(plus_func(2.0))));
+    // So are the fields `pluck` copies into a function, but not the object.
+    EXPECT_FALSE(run_cached(&cache, ql::r::object(ql::r::optarg("a", 1.0),
+                                                  ql::r::optarg("b", 2.0))
+                                        .pluck(std::string("a"))));
+    EXPECT_FALSE(run_cached(&cache, ql::r::object(ql::r::optarg("a", 1.0),
+                                                  ql::r::optarg("b", 2.0))
+                                        .pluck(std::string("b"))));
+    EXPECT_TRUE(run_cached(&cache, ql::r::object(ql::r::optarg("a", 3.0),
+                                                 ql::r::optarg("b", 4.0))
+                                       .pluck(std::string("b"))));
+}
+
+TPTEST(QueryCacheTest, EvictsLeastRecentlyUsed) {
+    ql::query_cache_t cache(2);
+    EXPECT_FALSE(run_cached(&cache, ql::r::expr(1.0) + 2.0));
+    EXPECT_FALSE(run_cached(&cache, ql::r::reql_t(Term::SUB, 1.0, 2.0)));
+    EXPECT_TRUE(run_cached(&cache, ql::r::expr(1.0) + 2.0));
+    EXPECT_FALSE(run_cached(&cache, ql::r::reql_t(Term::MUL, 1.0, 2.0)));
+    EXPECT_EQ(2u, cache.size());
+    EXPECT_TRUE(run_cached(&cache, ql::r::expr(1.0) + 2.0));
+    EXPECT_FALSE(run_cached(&cache, ql::r::reql_t(Term::SUB, 1.0, 2.0)));
+}
+
+TPTEST(QueryCacheTest, LargeQueriesAreNotCached) {
+    ql::query_cache_t cache;
+    const std::string large(ql::query_cache_t::MAX_QUERY_SIZE, 'a');
+    EXPECT_FALSE(run_cached(&cache, ql::r::expr(large) + std::string("b")));
+    EXPECT_FALSE(run_cached(&cache, ql::r::expr(large) + std::string("b")));
+    EXPECT_EQ(0u, cache.size());
+    // Smaller queries of the same shape are still cached.
+    EXPECT_FALSE(run_cached(&cache, ql::r::expr(std::string("a")) + std::string("b")));
+    EXPECT_TRUE(run_cached(&cache, ql::r::expr(std::string("c")) + std::string("d")));
+}
+
+}  // namespace unittest
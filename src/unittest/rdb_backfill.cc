@@ -1,13 +1,20 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
+
 #include "unittest/gtest.hpp"
 
+#include "backfill_progress.hpp"
+#include "btree/depth_first_traversal.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/immediate_consistency/branch/backfill_throttler.hpp"
 #include "clustering/immediate_consistency/branch/broadcaster.hpp"
 #include "clustering/immediate_consistency/branch/listener.hpp"
 #include "clustering/immediate_consistency/branch/replier.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "extproc/extproc_pool.hpp"
 #include "extproc/extproc_spawner.hpp"
+#include "rdb_protocol/btree.hpp"
+#include "rdb_protocol/lazy_json.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/pb_utils.hpp"
 #include "rdb_protocol/env.hpp"
@@ -353,4 +360,595 @@ TEST(RDBProtocolBackfill, SindexBackfill) {
      run_in_thread_pool_with_broadcaster(&run_sindex_backfill_test);
 }
 
+/* The tests below run backfills between stores directly. */
+
+static ql::datum_t make_backfill_test_row(int id, const std::string &a) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        {datum_string_t("id"), ql::datum_t(static_cast<double>(id))},
+        {datum_string_t("sid"), ql::datum_t(static_cast<double>(id % 10))},
+        {datum_string_t("a"), ql::datum_t(datum_string_t(a))}});
+}
+
+// Applies `mod_report` to the secondary indexes.
+static void update_backfill_test_sindexes(store_t *store, txn_t *txn,
+                                          buf_lock_t *sindex_block,
+                                          rdb_modification_report_t *mod_report) {
+    store_t::sindex_access_vector_t sindexes;
+    store->acquire_post_constructed_sindex_superblocks_for_write(sindex_block,
+                                                                 &sindexes);
+    rdb_live_deletion_context_t deletion_context;
+    rdb_update_sindexes(sindexes, mod_report, txn, &deletion_context);
+    scoped_ptr_t<new_mutex_in_line_t> acq
+        = store->get_in_line_for_sindex_queue(sindex_block);
+    store->sindex_queue_push(*mod_report, acq.get());
+}
+
+// Writes `doc` at `timestamp` to the primary btree and to the secondary indexes.
+static void write_backfill_test_row(
+        store_t *store, const ql::datum_t &doc,
+        repli_timestamp_t timestamp = repli_timestamp_t::invalid) {
+    cond_t non_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+    store->acquire_superblock_for_write(
+        timestamp, 1, write_durability_t::SOFT,
+        &token_pair, &txn, &superblock, &non_interruptor);
+    buf_lock_t sindex_block
+        = store->acquire_sindex_block_for_write(superblock->expose_buf(),
+                                                superblock->get_sindex_block_id());
+
+    point_write_response_t response;
+    store_key_t pk(doc.get_field("id").print_primary());
+    rdb_modification_report_t mod_report(pk);
+    rdb_live_deletion_context_t deletion_context;
+    rdb_set(pk, doc, true, store->btree.get(), timestamp,
+            superblock.get(), &deletion_context, &response, &mod_report.info,
+            static_cast<profile::trace_t *>(NULL));
+    update_backfill_test_sindexes(store, txn.get(), &sindex_block, &mod_report);
+}
+
+// Deletes the row with the `id` at `timestamp`.
+static void delete_backfill_test_row(store_t *store, int id,
+                                     repli_timestamp_t timestamp) {
+    cond_t non_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+    store->acquire_superblock_for_write(
+        timestamp, 1, write_durability_t::SOFT,
+        &token_pair, &txn, &superblock, &non_interruptor);
+    buf_lock_t sindex_block
+        = store->acquire_sindex_block_for_write(superblock->expose_buf(),
+                                                superblock->get_sindex_block_id());
+
+    point_delete_response_t response;
+    store_key_t pk(ql::datum_t(static_cast<double>(id)).print_primary());
+    rdb_modification_report_t mod_report(pk);
+    rdb_live_deletion_context_t deletion_context;
+    rdb_delete(pk, store->btree.get(), timestamp, superblock.get(),
+               &deletion_context, &response, &mod_report.info,
+               static_cast<profile::trace_t *>(NULL));
+    update_backfill_test_sindexes(store, txn.get(), &sindex_block, &mod_report);
+}
+
+// Creates an index `name` on the field `sid`, which is compact if `cover` is set,
+// and waits until it's ready.
+static void create_backfill_test_sindex(
+        store_t *store, const std::string &name,
+        const boost::optional<std::vector<std::string> > &cover) {
+    cond_t non_interruptor;
+    {
+        write_token_pair_t token_pair;
+        store->new_write_token_pair(&token_pair);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        store->acquire_superblock_for_write(
+            repli_timestamp_t::invalid, 1, write_durability_t::SOFT,
+            &token_pair, &txn, &superblock, &non_interruptor);
+
+        const ql::sym_t one(1);
+        ql::protob_t<const Term> mapping = ql::r::var(one)["sid"].release_counted();
+        ql::map_wire_func_t m(mapping, make_vector(one), get_backtrace(mapping));
+        write_message_t wm;
+        serialize_sindex_info(&wm, sindex_disk_info_t(
+            m, sindex_reql_version_info_t::LATEST(), sindex_multi_bool_t::SINGLE,
+            sindex_geo_bool_t::REGULAR, cover));
+        vector_stream_t stream;
+        stream.reserve(wm.size());
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+
+        buf_lock_t sindex_block
+            = store->acquire_sindex_block_for_write(superblock->expose_buf(),
+                                                    superblock->get_sindex_block_id());
+        bool added = store->add_sindex(sindex_name_t(name), stream.vector(),
+                                       &sindex_block);
+        guarantee(added);
+        std::set<sindex_name_t> created_sindexes;
+        created_sindexes.insert(sindex_name_t(name));
+        rdb_protocol::bring_sindexes_up_to_date(created_sindexes, store,
+                                                &sindex_block);
+    }
+
+    for (;;) {
+        read_token_pair_t token_pair;
+        store->new_read_token_pair(&token_pair);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        store->acquire_superblock_for_read(&token_pair.main_read_token, &txn,
+                                           &superblock, &non_interruptor, true);
+        buf_lock_t sindex_block
+            = store->acquire_sindex_block_for_read(superblock->expose_buf(),
+                                                   superblock->get_sindex_block_id());
+        secondary_index_t sindex;
+        bool found = get_secondary_index(&sindex_block, sindex_name_t(name), &sindex);
+        guarantee(found);
+        if (sindex.is_ready()) {
+            return;
+        }
+        nap(100);
+    }
+}
+
+class btree_value_collector_t : public depth_first_traversal_callback_t {
+public:
+    done_traversing_t handle_pair(scoped_key_value_t &&keyvalue) {
+        entries[store_key_t(keyvalue.key())] = get_serialized_data(
+            static_cast<const rdb_value_t *>(keyvalue.value()),
+            keyvalue.expose_buf());
+        return done_traversing_t::NO;
+    }
+    std::map<store_key_t, std::string> entries;
+};
+
+// Maps the keys of the index `name` to the serialized datums that the entries hold
+// or refer to, so that they can be compared across stores.
+static std::map<store_key_t, std::string> get_sindex_entries(store_t *store,
+                                                             const std::string &name) {
+    cond_t non_interruptor;
+    read_token_pair_t token_pair;
+    store->new_read_token_pair(&token_pair);
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_read(&token_pair.main_read_token, &txn,
+                                       &superblock, &non_interruptor, true);
+    scoped_ptr_t<real_superblock_t> sindex_superblock;
+    std::vector<char> opaque_definition;
+    uuid_u sindex_uuid;
+    bool found = store->acquire_sindex_superblock_for_read(
+        sindex_name_t(name), "", superblock.get(), &sindex_superblock,
+        &opaque_definition, &sindex_uuid);
+    guarantee(found);
+    btree_value_collector_t collector;
+    btree_depth_first_traversal(sindex_superblock.get(), key_range_t::universe(),
+                                &collector, FORWARD);
+    return collector.entries;
+}
+
+// Maps the primary keys to the serialized documents.
+static std::map<store_key_t, std::string> get_primary_values(store_t *store) {
+    cond_t non_interruptor;
+    read_token_pair_t token_pair;
+    store->new_read_token_pair(&token_pair);
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_read(&token_pair.main_read_token, &txn,
+                                       &superblock, &non_interruptor, true);
+    btree_value_collector_t collector;
+    btree_depth_first_traversal(superblock.get(), key_range_t::universe(),
+                                &collector, FORWARD);
+    return collector.entries;
+}
+
+class backfill_chunk_collector_t : public send_backfill_callback_t {
+public:
+    void send_chunk(const backfill_chunk_t &chunk, signal_t *)
+        THROWS_ONLY(interrupted_exc_t) {
+        chunks.push_back(chunk);
+    }
+    std::vector<backfill_chunk_t> chunks;
+private:
+    bool should_backfill_impl(const region_map_t<binary_blob_t> &) {
+        return true;
+    }
+};
+
+// Returns the chunks of a backfill of `store` from `start_point`.
+static std::vector<backfill_chunk_t> send_test_backfill(
+        store_t *store, const region_map_t<state_timestamp_t> &start_point) {
+    cond_t non_interruptor;
+    backfill_chunk_collector_t collector;
+    traversal_progress_combiner_t progress;
+    read_token_pair_t token_pair;
+    store->new_read_token_pair(&token_pair);
+    bool sent = store->send_backfill(start_point, &collector, &progress, &token_pair,
+                                     &non_interruptor);
+    guarantee(sent);
+    return collector.chunks;
+}
+
+static std::vector<backfill_chunk_t> send_backfill_from_scratch(store_t *store) {
+    return send_test_backfill(store, region_map_t<state_timestamp_t>(
+        store->get_region(), state_timestamp_t::zero()));
+}
+
+// Applies the chunks to `store` in order.  Checkpoints don't reach the store.
+static void receive_test_backfill(store_t *store,
+                                  const std::vector<backfill_chunk_t> &chunks) {
+    cond_t non_interruptor;
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        if (boost::get<backfill_chunk_t::checkpoint_t>(&it->val) != NULL) {
+            continue;
+        }
+        write_token_pair_t token_pair;
+        store->new_write_token_pair(&token_pair);
+        store->receive_backfill(*it, &token_pair, &non_interruptor);
+    }
+}
+
+// Applies the chunks to `store` in order, and records for each checkpoint that its
+// region has reached `end_point`, like the backfillee does.  Stops after
+// `max_checkpoints` checkpoints, as if the backfill was interrupted there.
+static void receive_test_backfill_with_checkpoints(
+        store_t *store, const std::vector<backfill_chunk_t> &chunks,
+        const version_t &end_point, size_t max_checkpoints) {
+    cond_t non_interruptor;
+    size_t num_checkpoints = 0;
+    for (auto it = chunks.begin();
+         it != chunks.end() && num_checkpoints < max_checkpoints;
+         ++it) {
+        const backfill_chunk_t::checkpoint_t *checkpoint
+            = boost::get<backfill_chunk_t::checkpoint_t>(&it->val);
+        if (checkpoint != NULL) {
+            object_buffer_t<fifo_enforcer_sink_t::exit_write_t> token;
+            store->new_write_token(&token);
+            store->set_metainfo(
+                region_map_t<binary_blob_t>(
+                    checkpoint->region, binary_blob_t(version_range_t(end_point))),
+                order_token_t::ignore, &token, &non_interruptor);
+            ++num_checkpoints;
+        } else {
+            write_token_pair_t token_pair;
+            store->new_write_token_pair(&token_pair);
+            store->receive_backfill(*it, &token_pair, &non_interruptor);
+        }
+    }
+}
+
+// The start point of a backfill into `store`, which continues from the versions in
+// its metainfo.
+static region_map_t<state_timestamp_t> get_backfill_start_point(store_t *store) {
+    cond_t non_interruptor;
+    object_buffer_t<fifo_enforcer_sink_t::exit_read_t> token;
+    store->new_read_token(&token);
+    region_map_t<binary_blob_t> metainfo;
+    store->do_get_metainfo(order_token_t::ignore, &token, &non_interruptor,
+                           &metainfo);
+    return region_map_transform<binary_blob_t, state_timestamp_t>(
+        metainfo,
+        [](const binary_blob_t &blob) {
+            return binary_blob_t::get<version_range_t>(blob).latest.timestamp;
+        });
+}
+
+// The number of documents that the chunks send.
+static size_t count_sent_documents(const std::vector<backfill_chunk_t> &chunks) {
+    size_t count = 0;
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        const backfill_chunk_t::leaf_image_t *image
+            = boost::get<backfill_chunk_t::leaf_image_t>(&it->val);
+        const backfill_chunk_t::key_value_pairs_t *pairs
+            = boost::get<backfill_chunk_t::key_value_pairs_t>(&it->val);
+        if (image != NULL) {
+            count += image->atoms.size();
+        } else if (pairs != NULL) {
+            count += pairs->backfill_atoms.size();
+        }
+    }
+    return count;
+}
+
+// The index entries in the chunks, in the order they were sent.
+static std::vector<backfill_raw_atom_t> get_shipped_sindex_atoms(
+        const std::vector<backfill_chunk_t> &chunks, const std::string &name) {
+    std::vector<backfill_raw_atom_t> atoms;
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        auto pairs = boost::get<backfill_chunk_t::sindex_key_value_pairs_t>(&it->val);
+        if (pairs != NULL && pairs->sindex == name) {
+            atoms.insert(atoms.end(), pairs->atoms.begin(), pairs->atoms.end());
+        }
+    }
+    return atoms;
+}
+
+TPTEST(RDBProtocolBackfill, SindexEntriesShippedFromScratch) {
+    recreate_temporary_directory(base_path_t("."));
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    order_source_t order_source;
+    test_store_t source(&io_backender, &order_source, NULL);
+    create_backfill_test_sindex(&source.store, "sid", boost::none);
+    for (int i = 0; i < 100; ++i) {
+        write_backfill_test_row(&source.store, make_backfill_test_row(i, "a"));
+    }
+
+    std::vector<backfill_chunk_t> chunks = send_backfill_from_scratch(&source.store);
+    std::vector<char> opaque_definition;
+    size_t last_leaf_image = 0, first_sindex_pairs = chunks.size();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const backfill_chunk_t::sindexes_t *sindexes
+            = boost::get<backfill_chunk_t::sindexes_t>(&chunks[i].val);
+        const backfill_chunk_t::leaf_image_t *image
+            = boost::get<backfill_chunk_t::leaf_image_t>(&chunks[i].val);
+        if (sindexes != NULL) {
+            ASSERT_EQ(1u, sindexes->sindexes.size());
+            opaque_definition = sindexes->sindexes.at("sid").opaque_definition;
+        } else if (image != NULL) {
+            // Leaf images name the shipped index along with its definition.
+            ASSERT_EQ(1u, image->shipped_sindexes.size());
+            EXPECT_EQ(opaque_definition, image->shipped_sindexes.at("sid"));
+            last_leaf_image = i;
+        } else if (boost::get<backfill_chunk_t::sindex_key_value_pairs_t>(
+                       &chunks[i].val) != NULL) {
+            first_sindex_pairs = std::min(first_sindex_pairs, i);
+        }
+    }
+    EXPECT_LT(last_leaf_image, first_sindex_pairs);
+
+    // The entries come once, after all of the documents, and refer to them.
+    std::vector<backfill_raw_atom_t> atoms = get_shipped_sindex_atoms(chunks, "sid");
+    ASSERT_EQ(100u, atoms.size());
+    for (auto it = atoms.begin(); it != atoms.end(); ++it) {
+        EXPECT_TRUE(it->value.empty());
+    }
+
+    // The region is only checkpointed once its entries are there.
+    auto checkpoint = boost::get<backfill_chunk_t::checkpoint_t>(&chunks.back().val);
+    ASSERT_TRUE(checkpoint != NULL);
+    EXPECT_EQ(source.store.get_region(), checkpoint->region);
+
+    test_store_t dest(&io_backender, &order_source, NULL);
+    receive_test_backfill(&dest.store, chunks);
+    std::map<store_key_t, std::string> entries
+        = get_sindex_entries(&source.store, "sid");
+    EXPECT_EQ(100u, entries.size());
+    EXPECT_EQ(entries, get_sindex_entries(&dest.store, "sid"));
+}
+
+TPTEST(RDBProtocolBackfill, CompactSindexEntriesShipped) {
+    recreate_temporary_directory(base_path_t("."));
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    order_source_t order_source;
+    test_store_t source(&io_backender, &order_source, NULL);
+    create_backfill_test_sindex(&source.store, "sid", make_vector(std::string("a")));
+    for (int i = 0; i < 100; ++i) {
+        write_backfill_test_row(&source.store, make_backfill_test_row(i, "a"));
+    }
+    // This row's compact entry would be too large, so its entry refers to it.
+    const int large_id = 100;
+    write_backfill_test_row(&source.store,
+                            make_backfill_test_row(large_id, std::string(300, 'a')));
+
+    std::vector<backfill_chunk_t> chunks = send_backfill_from_scratch(&source.store);
+    std::vector<backfill_raw_atom_t> atoms = get_shipped_sindex_atoms(chunks, "sid");
+    ASSERT_EQ(101u, atoms.size());
+    const store_key_t large_key(
+        ql::datum_t(static_cast<double>(large_id)).print_primary());
+    for (auto it = atoms.begin(); it != atoms.end(); ++it) {
+        // Compact entries are sent as they are.
+        EXPECT_EQ(ql::datum_t::extract_primary(it->key) == large_key,
+                  it->value.empty());
+    }
+
+    test_store_t dest(&io_backender, &order_source, NULL);
+    receive_test_backfill(&dest.store, chunks);
+    EXPECT_EQ(get_sindex_entries(&source.store, "sid"),
+              get_sindex_entries(&dest.store, "sid"));
+}
+
+TPTEST(RDBProtocolBackfill, SindexDefinitionMismatch) {
+    recreate_temporary_directory(base_path_t("."));
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    order_source_t order_source;
+    test_store_t source(&io_backender, &order_source, NULL);
+    create_backfill_test_sindex(&source.store, "sid", boost::none);
+    // A compact index on the same field counts as the same index, so the
+    // backfill doesn't replace it, but the entries differ.
+    test_store_t dest(&io_backender, &order_source, NULL);
+    create_backfill_test_sindex(&dest.store, "sid", make_vector(std::string("a")));
+    test_store_t expected(&io_backender, &order_source, NULL);
+    create_backfill_test_sindex(&expected.store, "sid", make_vector(std::string("a")));
+    for (int i = 0; i < 100; ++i) {
+        write_backfill_test_row(&source.store, make_backfill_test_row(i, "a"));
+        write_backfill_test_row(&expected.store, make_backfill_test_row(i, "a"));
+    }
+
+    // The backfillee computes its own entries and drops the shipped ones.
+    std::vector<backfill_chunk_t> chunks = send_backfill_from_scratch(&source.store);
+    ASSERT_EQ(100u, get_shipped_sindex_atoms(chunks, "sid").size());
+    receive_test_backfill(&dest.store, chunks);
+    std::map<store_key_t, std::string> entries
+        = get_sindex_entries(&dest.store, "sid");
+    EXPECT_EQ(get_sindex_entries(&expected.store, "sid"), entries);
+    EXPECT_NE(get_sindex_entries(&source.store, "sid"), entries);
+}
+
+static key_range_t backfill_test_range(const char *left, const char *right) {
+    return key_range_t(key_range_t::closed, store_key_t(left),
+                       key_range_t::open, store_key_t(right));
+}
+
+TEST(RDBProtocolBackfill, SplitBackfillRegion) {
+    const region_t region(backfill_test_range("b", "f"));
+    const store_key_t a("a"), b("b"), d("d"), f("f"), g("g");
+
+    // Split keys outside of the region or on its edges don't split it.
+    std::vector<region_t> slices = split_backfill_region(region, {a, b, d, f, g});
+    ASSERT_EQ(2u, slices.size());
+    EXPECT_EQ(region_t(backfill_test_range("b", "d")), slices[0]);
+    EXPECT_EQ(region_t(backfill_test_range("d", "f")), slices[1]);
+    EXPECT_EQ(std::vector<region_t>(1, region),
+              split_backfill_region(region, {a, b, f, g}));
+    EXPECT_EQ(std::vector<region_t>(1, region),
+              split_backfill_region(region, std::vector<store_key_t>()));
+
+    // The last slice of a region without a right bound has none either.
+    const region_t unbounded(
+        key_range_t(key_range_t::closed, b, key_range_t::none, store_key_t()));
+    slices = split_backfill_region(unbounded, {a, d, g});
+    ASSERT_EQ(3u, slices.size());
+    EXPECT_EQ(region_t(backfill_test_range("b", "d")), slices[0]);
+    EXPECT_EQ(region_t(backfill_test_range("d", "g")), slices[1]);
+    EXPECT_TRUE(slices[2].inner.right.unbounded);
+    EXPECT_EQ(g, slices[2].inner.left);
+
+    // Slices keep the hash range of the region.
+    const region_t hashed(HASH_REGION_HASH_SIZE / 4, HASH_REGION_HASH_SIZE / 2,
+                          backfill_test_range("b", "f"));
+    slices = split_backfill_region(hashed, {d});
+    ASSERT_EQ(2u, slices.size());
+    EXPECT_EQ(region_t(hashed.beg, hashed.end, backfill_test_range("b", "d")),
+              slices[0]);
+    EXPECT_EQ(region_t(hashed.beg, hashed.end, backfill_test_range("d", "f")),
+              slices[1]);
+}
+
+// Whether everything that `chunk` changes lies in `range`.
+static bool backfill_chunk_lies_in(const backfill_chunk_t &chunk,
+                                   const key_range_t &range) {
+    const backfill_chunk_t::delete_range_t *delete_range
+        = boost::get<backfill_chunk_t::delete_range_t>(&chunk.val);
+    const backfill_chunk_t::delete_key_t *delete_key
+        = boost::get<backfill_chunk_t::delete_key_t>(&chunk.val);
+    const backfill_chunk_t::key_value_pairs_t *pairs
+        = boost::get<backfill_chunk_t::key_value_pairs_t>(&chunk.val);
+    const backfill_chunk_t::leaf_image_t *image
+        = boost::get<backfill_chunk_t::leaf_image_t>(&chunk.val);
+    if (delete_range != NULL) {
+        return range.is_superset(delete_range->range.inner);
+    } else if (delete_key != NULL) {
+        return range.contains_key(delete_key->key);
+    } else if (pairs != NULL) {
+        for (auto it = pairs->backfill_atoms.begin();
+             it != pairs->backfill_atoms.end();
+             ++it) {
+            if (!range.contains_key(it->key)) {
+                return false;
+            }
+        }
+        return true;
+    } else if (image != NULL) {
+        return range.is_superset(image->range.inner);
+    }
+    return true;
+}
+
+TPTEST(RDBProtocolBackfill, CheckpointAfterEachSlice) {
+    recreate_temporary_directory(base_path_t("."));
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    order_source_t order_source;
+    test_store_t source(&io_backender, &order_source, NULL);
+    for (int i = 0; i < 2000; ++i) {
+        write_backfill_test_row(&source.store,
+                                make_backfill_test_row(i, std::string(100, 'a')));
+    }
+
+    // The checkpoints cover the region slice by slice, each one after the chunks of
+    // its slice.
+    std::vector<backfill_chunk_t> chunks = send_backfill_from_scratch(&source.store);
+    const region_t region = source.store.get_region();
+    store_key_t slice_left = region.inner.left;
+    size_t slice_begin = 0;
+    size_t num_checkpoints = 0;
+    const backfill_chunk_t::checkpoint_t *checkpoint = NULL;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        checkpoint = boost::get<backfill_chunk_t::checkpoint_t>(&chunks[i].val);
+        if (checkpoint == NULL) {
+            continue;
+        }
+        EXPECT_EQ(region.beg, checkpoint->region.beg);
+        EXPECT_EQ(region.end, checkpoint->region.end);
+        EXPECT_EQ(slice_left, checkpoint->region.inner.left);
+        for (size_t j = slice_begin; j < i; ++j) {
+            EXPECT_TRUE(backfill_chunk_lies_in(chunks[j], checkpoint->region.inner));
+        }
+        if (!checkpoint->region.inner.right.unbounded) {
+            slice_left = checkpoint->region.inner.right.key;
+        }
+        slice_begin = i + 1;
+        ++num_checkpoints;
+    }
+    EXPECT_LT(1u, num_checkpoints);
+    EXPECT_EQ(chunks.size(), slice_begin);
+    ASSERT_TRUE(checkpoint != NULL);
+    EXPECT_EQ(region.inner.right, checkpoint->region.inner.right);
+}
+
+TPTEST(RDBProtocolBackfill, ResumeFromCheckpoint) {
+    recreate_temporary_directory(base_path_t("."));
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    order_source_t order_source;
+    test_store_t source(&io_backender, &order_source, NULL);
+    const branch_id_t branch_id = generate_uuid();
+    const transition_timestamp_t first_writes = transition_timestamp_t::starting_from(
+        transition_timestamp_t::starting_from(state_timestamp_t::zero())
+            .timestamp_after());
+    for (int i = 0; i < 2000; ++i) {
+        write_backfill_test_row(&source.store,
+                                make_backfill_test_row(i, std::string(100, 'a')),
+                                first_writes.to_repli_timestamp());
+    }
+
+    // The backfill is interrupted after its first slice.
+    std::vector<backfill_chunk_t> first_chunks
+        = send_backfill_from_scratch(&source.store);
+    const size_t checkpoints_reached = 1;
+    ASSERT_LT(checkpoints_reached,
+              static_cast<size_t>(std::count_if(
+                  first_chunks.begin(), first_chunks.end(),
+                  [](const backfill_chunk_t &chunk) {
+                      return boost::get<backfill_chunk_t::checkpoint_t>(&chunk.val)
+                          != NULL;
+                  })));
+    test_store_t dest(&io_backender, &order_source, NULL);
+    receive_test_backfill_with_checkpoints(
+        &dest.store, first_chunks,
+        version_t(branch_id, first_writes.timestamp_after()), checkpoints_reached);
+
+    // Meanwhile, rows change both in the slices that were checkpointed and in the
+    // ones that weren't.
+    const transition_timestamp_t second_writes
+        = transition_timestamp_t::starting_from(first_writes.timestamp_after());
+    for (int i = 0; i < 2000; i += 7) {
+        write_backfill_test_row(&source.store, make_backfill_test_row(i, "b"),
+                                second_writes.to_repli_timestamp());
+    }
+    for (int i = 0; i < 2000; i += 11) {
+        delete_backfill_test_row(&source.store, i, second_writes.to_repli_timestamp());
+    }
+
+    // The next backfill starts from the checkpoints, so it only sends what changed
+    // in the checkpointed slices.
+    std::vector<backfill_chunk_t> second_chunks
+        = send_test_backfill(&source.store, get_backfill_start_point(&dest.store));
+    EXPECT_GT(count_sent_documents(first_chunks),
+              count_sent_documents(second_chunks));
+    receive_test_backfill_with_checkpoints(
+        &dest.store, second_chunks,
+        version_t(branch_id, second_writes.timestamp_after()), second_chunks.size());
+
+    // It ends up where a complete backfill does.
+    test_store_t complete(&io_backender, &order_source, NULL);
+    receive_test_backfill(&complete.store, send_backfill_from_scratch(&source.store));
+    std::map<store_key_t, std::string> rows = get_primary_values(&complete.store);
+    EXPECT_EQ(get_primary_values(&source.store), rows);
+    EXPECT_EQ(rows, get_primary_values(&dest.store));
+    region_map_t<state_timestamp_t> end_point = get_backfill_start_point(&dest.store);
+    for (auto it = end_point.begin(); it != end_point.end(); ++it) {
+        EXPECT_EQ(second_writes.timestamp_after(), it->second);
+    }
+}
+
 }   /* namespace unittest */
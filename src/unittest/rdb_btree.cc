@@ -1,5 +1,10 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
 #include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "arch/io/disk.hpp"
 #include "arch/runtime/coroutines.hpp"
@@ -11,9 +16,11 @@
 #include "containers/uuid.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/pb_utils.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/shards.hpp"
 #include "rdb_protocol/store.hpp"
 #include "rdb_protocol/sym.hpp"
 #include "stl_utils.hpp"
@@ -26,49 +33,55 @@
 
 namespace unittest {
 
+// Writes `doc` to the primary btree, and to the secondary indexes unless
+// `update_sindexes` is false.
+static void write_row(store_t *store, const ql::datum_t &doc, bool update_sindexes) {
+    cond_t dummy_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+    store->acquire_superblock_for_write(
+        repli_timestamp_t::invalid,
+        1, write_durability_t::SOFT,
+        &token_pair, &txn, &superblock, &dummy_interruptor);
+    block_id_t sindex_block_id = superblock->get_sindex_block_id();
+
+    point_write_response_t response;
+
+    store_key_t pk(doc.get_field("id").print_primary());
+    rdb_modification_report_t mod_report(pk);
+    rdb_live_deletion_context_t deletion_context;
+    rdb_set(pk, doc, true, store->btree.get(), repli_timestamp_t::invalid,
+            superblock.get(), &deletion_context, &response, &mod_report.info,
+            static_cast<profile::trace_t *>(NULL));
+
+    if (update_sindexes) {
+        buf_lock_t sindex_block
+            = store->acquire_sindex_block_for_write(superblock->expose_buf(),
+                                                    sindex_block_id);
+        store_t::sindex_access_vector_t sindexes;
+        store->acquire_post_constructed_sindex_superblocks_for_write(
+                 &sindex_block,
+                 &sindexes);
+        rdb_update_sindexes(sindexes, &mod_report, txn.get(), &deletion_context);
+
+        scoped_ptr_t<new_mutex_in_line_t> acq =
+            store->get_in_line_for_sindex_queue(&sindex_block);
+
+        store->sindex_queue_push(mod_report, acq.get());
+    }
+}
+
 void insert_rows(int start, int finish, store_t *store) {
     ql::configured_limits_t limits;
 
     guarantee(start <= finish);
     for (int i = start; i < finish; ++i) {
-        cond_t dummy_interruptor;
-        scoped_ptr_t<txn_t> txn;
-        scoped_ptr_t<real_superblock_t> superblock;
-        write_token_pair_t token_pair;
-        store->new_write_token_pair(&token_pair);
-        store->acquire_superblock_for_write(
-            repli_timestamp_t::invalid,
-            1, write_durability_t::SOFT,
-            &token_pair, &txn, &superblock, &dummy_interruptor);
-        block_id_t sindex_block_id = superblock->get_sindex_block_id();
-
         std::string data = strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i);
-        point_write_response_t response;
-
-        store_key_t pk(ql::datum_t(static_cast<double>(i))->print_primary());
-        rdb_modification_report_t mod_report(pk);
-        rdb_live_deletion_context_t deletion_context;
-        rdb_set(pk,
-                ql::to_datum(scoped_cJSON_t(cJSON_Parse(data.c_str())).get(), limits),
-                false, store->btree.get(), repli_timestamp_t::invalid,
-                superblock.get(), &deletion_context, &response, &mod_report.info,
-                static_cast<profile::trace_t *>(NULL));
-
-        {
-            buf_lock_t sindex_block
-                = store->acquire_sindex_block_for_write(superblock->expose_buf(),
-                                                        sindex_block_id);
-            store_t::sindex_access_vector_t sindexes;
-            store->acquire_post_constructed_sindex_superblocks_for_write(
-                     &sindex_block,
-                     &sindexes);
-            rdb_update_sindexes(sindexes, &mod_report, txn.get(), &deletion_context);
-
-            scoped_ptr_t<new_mutex_in_line_t> acq =
-                store->get_in_line_for_sindex_queue(&sindex_block);
-
-            store->sindex_queue_push(mod_report, acq.get());
-        }
+        write_row(store,
+                  ql::to_datum(scoped_cJSON_t(cJSON_Parse(data.c_str())).get(), limits),
+                  true);
     }
 }
 
@@ -78,7 +91,9 @@ void insert_rows_and_pulse_when_done(int start, int finish,
     pulse_when_done->pulse();
 }
 
-sindex_name_t create_sindex(store_t *store) {
+sindex_name_t create_sindex(store_t *store,
+                           const boost::optional<std::vector<std::string> > &cover
+                               = boost::none) {
     cond_t dummy_interruptor;
     sindex_name_t sindex_name(uuid_to_str(generate_uuid()));
     write_token_pair_t token_pair;
@@ -100,7 +115,7 @@ sindex_name_t create_sindex(store_t *store) {
 
     write_message_t wm;
     sindex_disk_info_t sindex_info(m, sindex_reql_version_info_t::LATEST(),
-                                   multi_bool, sindex_geo_bool_t::REGULAR);
+                                   multi_bool, sindex_geo_bool_t::REGULAR, cover);
     serialize_sindex_info(&wm, sindex_info);
 
     vector_stream_t stream;
@@ -534,4 +549,310 @@ TPTEST(RDBBtree, SindexInterruptionViaStoreDelete) {
     store.reset();
 }
 
+// The functions below take a single row argument, `row`.
+static const ql::sym_t row_var(1);
+
+static ql::r::reql_t row(const std::string &field) {
+    return ql::r::var(row_var)[field];
+}
+
+static counted_t<const ql::func_t> make_func(ql::r::reql_t &&body) {
+    ql::protob_t<const Term> term = body.release_counted();
+    return ql::map_wire_func_t(term, make_vector(row_var),
+                               ql::get_backtrace(term)).compile_wire_func();
+}
+
+TPTEST(FuncTest, ReadsOnlyFields) {
+    std::set<std::string> fields;
+    fields.insert("a");
+    fields.insert("b");
+    EXPECT_TRUE(make_func(row("a") + row("b"))->reads_only_fields(fields));
+    EXPECT_TRUE(make_func(ql::r::var(row_var).pluck(std::string("a")))
+                ->reads_only_fields(fields));
+    EXPECT_FALSE(make_func(row("a") + row("age"))->reads_only_fields(fields));
+    EXPECT_FALSE(make_func(ql::r::var(row_var).pluck(std::string("age")))
+                 ->reads_only_fields(fields));
+    // The whole row, and a field we don't know until the function runs.
+    EXPECT_FALSE(make_func(ql::r::var(row_var))->reads_only_fields(fields));
+    EXPECT_FALSE(make_func(
+        ql::r::var(row_var).bracket(row("a")))->reads_only_fields(fields));
+}
+
+TPTEST(FuncTest, TransformsReadOnlyFields) {
+    std::set<std::string> fields;
+    fields.insert("a");
+    const boost::optional<ql::terminal_variant_t> no_terminal;
+    const ql::terminal_variant_t count = ql::count_wire_func_t();
+    std::vector<ql::transform_variant_t> filter_a(
+        1, ql::filter_wire_func_t(make_func(row("a") > 1.0), boost::none));
+    std::vector<ql::transform_variant_t> filter_b(
+        1, ql::filter_wire_func_t(make_func(row("b") > 1.0), boost::none));
+    std::vector<ql::transform_variant_t> map_a(
+        1, ql::map_wire_func_t(make_func(row("a"))));
+
+    // Without a terminal the rows themselves are returned, unless they're mapped
+    // to something else first.
+    EXPECT_FALSE(ql::reads_only_fields(filter_a, no_terminal, fields));
+    EXPECT_TRUE(ql::reads_only_fields(map_a, no_terminal, fields));
+    EXPECT_TRUE(ql::reads_only_fields(filter_a, count, fields));
+    EXPECT_FALSE(ql::reads_only_fields(filter_b, count, fields));
+
+    // `map` replaces the rows, so whatever comes after it doesn't matter.
+    std::vector<ql::transform_variant_t> map_then_filter = map_a;
+    map_then_filter.push_back(filter_b[0]);
+    EXPECT_TRUE(ql::reads_only_fields(map_then_filter, no_terminal, fields));
+
+    ql::protob_t<const Term> bt_term = ql::r::expr(0.0).release_counted();
+    EXPECT_TRUE(ql::reads_only_fields(
+        filter_a,
+        ql::terminal_variant_t(ql::sum_wire_func_t(ql::get_backtrace(bt_term),
+                                                   make_func(row("a")))),
+        fields));
+    EXPECT_FALSE(ql::reads_only_fields(
+        filter_a,
+        ql::terminal_variant_t(ql::sum_wire_func_t(ql::get_backtrace(bt_term),
+                                                   make_func(row("b")))),
+        fields));
+}
+
+TPTEST(FuncTest, TransformsAreDeterministic) {
+    std::vector<ql::transform_variant_t> transforms(
+        1, ql::filter_wire_func_t(make_func(row("a") > 1.0), boost::none));
+    transforms.push_back(ql::map_wire_func_t(make_func(row("a"))));
+    EXPECT_TRUE(ql::transforms_are_deterministic(transforms));
+
+    // `r.js` could do anything, so a stream that calls it must not read ahead.
+    transforms.push_back(ql::map_wire_func_t(make_func(
+        ql::r::reql_t(Term::JAVASCRIPT, ql::r::expr(std::string("1"))))));
+    EXPECT_FALSE(ql::transforms_are_deterministic(transforms));
+}
+
+// Waits for `sindex_name` to finish post-construction.
+static void wait_for_sindex_post_construct(store_t *store,
+                                           const sindex_name_t &sindex_name) {
+    for (;;) {
+        cond_t dummy_interruptor;
+        read_token_pair_t token_pair;
+        store->new_read_token_pair(&token_pair);
+
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> super_block;
+        store->acquire_superblock_for_read(
+                &token_pair.main_read_token, &txn, &super_block,
+                &dummy_interruptor, true);
+
+        scoped_ptr_t<real_superblock_t> sindex_sb;
+        std::vector<char> opaque_definition;
+        uuid_u sindex_uuid;
+        try {
+            bool sindex_exists = store->acquire_sindex_superblock_for_read(
+                    sindex_name,
+                    "",
+                    super_block.get(),
+                    &sindex_sb,
+                    &opaque_definition,
+                    &sindex_uuid);
+            guarantee(sindex_exists);
+            return;
+        } catch (const sindex_not_ready_exc_t &) { }
+        nap(100);
+    }
+}
+
+// Reads the rows whose `sid` is `sid` through the compact index `sindex_name`,
+// applying `transforms`, and returns the results in primary key order.
+static std::vector<ql::datum_t> read_compact_sindex(
+        store_t *store, const sindex_name_t &sindex_name, double sid,
+        const std::vector<ql::transform_variant_t> &transforms) {
+    cond_t dummy_interruptor;
+    read_token_pair_t token_pair;
+    store->new_read_token_pair(&token_pair);
+
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> super_block;
+    store->acquire_superblock_for_read(
+            &token_pair.main_read_token, &txn, &super_block,
+            &dummy_interruptor, true);
+
+    scoped_ptr_t<real_superblock_t> sindex_sb;
+    uuid_u sindex_uuid;
+    sindex_disk_info_t sindex_info;
+    {
+        std::vector<char> opaque_definition;
+        bool sindex_exists = store->acquire_sindex_superblock_for_read(
+                sindex_name,
+                "",
+                super_block.get(),
+                &sindex_sb,
+                &opaque_definition,
+                &sindex_uuid,
+                release_superblock_t::KEEP);
+        guarantee(sindex_exists);
+        deserialize_sindex_info(opaque_definition, &sindex_info);
+        guarantee(static_cast<bool>(sindex_info.cover));
+    }
+
+    rget_read_response_t res;
+    ql::env_t dummy_env(&dummy_interruptor, reql_version_t::LATEST);
+    const store_key_t sid_key(ql::datum_t(sid).print_primary());
+    rdb_rget_secondary_slice(
+        store->get_sindex_slice(sindex_uuid),
+        datum_range_t(ql::datum_t(sid)),
+        region_t(rdb_protocol::sindex_key_range(sid_key, sid_key)),
+        sindex_sb.get(),
+        store->btree.get(),
+        super_block.get(),
+        &dummy_env,
+        ql::batchspec_t::user(ql::batch_type_t::NORMAL, ql::datum_t()),
+        transforms,
+        boost::optional<ql::terminal_variant_t>(),
+        key_range_t::universe(),
+        sorting_t::ASCENDING,
+        sindex_info,
+        &res);
+
+    auto groups = boost::get<ql::grouped_t<ql::stream_t> >(&res.result);
+    guarantee(groups != NULL);
+    std::vector<ql::datum_t> results;
+    for (auto it = groups->begin(ql::grouped::order_doesnt_matter_t());
+         it != groups->end(ql::grouped::order_doesnt_matter_t());
+         ++it) {
+        for (auto jt = it->second.begin(); jt != it->second.end(); ++jt) {
+            results.push_back(jt->data);
+        }
+    }
+    return results;
+}
+
+static ql::datum_t make_compact_test_row(int id, int a, int b) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        {datum_string_t("id"), ql::datum_t(static_cast<double>(id))},
+        {datum_string_t("sid"), ql::datum_t(static_cast<double>(id % 10))},
+        {datum_string_t("a"), ql::datum_t(static_cast<double>(a))},
+        {datum_string_t("b"), ql::datum_t(static_cast<double>(b))}});
+}
+
+// The `id`s of the rows with `sid` 3, in primary key order.
+static std::vector<ql::datum_t> compact_test_sid3_ids() {
+    std::vector<ql::datum_t> ids;
+    for (int id = 3; id < 100; id += 10) {
+        ids.push_back(ql::datum_t(static_cast<double>(id)));
+    }
+    return ids;
+}
+
+TPTEST(RDBBtree, CompactSindexCoveredRead) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t("."),
+            NULL);
+
+    sindex_name_t sindex_name
+        = create_sindex(&store, make_vector(std::string("a")));
+    bring_sindexes_up_to_date(&store, sindex_name);
+    wait_for_sindex_post_construct(&store, sindex_name);
+    for (int i = 0; i < 100; ++i) {
+        write_row(&store, make_compact_test_row(i, i, i), true);
+    }
+
+    // Change the document behind the index's back.  A query that only needs the
+    // covered field is answered from the index entry, and one that needs more
+    // reads the document.
+    write_row(&store, make_compact_test_row(3, 1000, 1000), false);
+
+    std::vector<ql::datum_t> expected = compact_test_sid3_ids();
+    std::vector<ql::transform_variant_t> map_a(
+        1, ql::map_wire_func_t(make_func(row("a"))));
+    EXPECT_EQ(expected, read_compact_sindex(&store, sindex_name, 3, map_a));
+
+    expected[0] = ql::datum_t(1000.0);
+    std::vector<ql::transform_variant_t> map_b(
+        1, ql::map_wire_func_t(make_func(row("b"))));
+    EXPECT_EQ(expected, read_compact_sindex(&store, sindex_name, 3, map_b));
+}
+
+TPTEST(RDBBtree, CompactSindexCoveredUpdate) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t("."),
+            NULL);
+
+    // Post-constructing the index writes the entries of the existing rows.
+    for (int i = 0; i < 100; ++i) {
+        write_row(&store, make_compact_test_row(i, i, i), true);
+    }
+    sindex_name_t sindex_name
+        = create_sindex(&store, make_vector(std::string("a")));
+    bring_sindexes_up_to_date(&store, sindex_name);
+    wait_for_sindex_post_construct(&store, sindex_name);
+
+    std::vector<ql::transform_variant_t> map_a(
+        1, ql::map_wire_func_t(make_func(row("a"))));
+    std::vector<ql::datum_t> expected = compact_test_sid3_ids();
+    EXPECT_EQ(expected, read_compact_sindex(&store, sindex_name, 3, map_a));
+
+    // Updating a covered field rewrites the entry, even though the indexed value
+    // stays the same.
+    write_row(&store, make_compact_test_row(3, 1000, 3), true);
+    expected[0] = ql::datum_t(1000.0);
+    EXPECT_EQ(expected, read_compact_sindex(&store, sindex_name, 3, map_a));
+
+    // Changing the indexed value moves the entry.
+    write_row(&store,
+              ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+                  {datum_string_t("id"), ql::datum_t(13.0)},
+                  {datum_string_t("sid"), ql::datum_t(4.0)},
+                  {datum_string_t("a"), ql::datum_t(-13.0)},
+                  {datum_string_t("b"), ql::datum_t(13.0)}}),
+              true);
+    expected.erase(expected.begin() + 1);
+    EXPECT_EQ(expected, read_compact_sindex(&store, sindex_name, 3, map_a));
+    std::vector<ql::datum_t> sid4 = read_compact_sindex(&store, sindex_name, 4, map_a);
+    EXPECT_NE(sid4.end(), std::find(sid4.begin(), sid4.end(), ql::datum_t(-13.0)));
+}
+
 } //namespace unittest
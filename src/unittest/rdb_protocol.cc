@@ -176,7 +176,9 @@ TEST(RDBProtocol, OvershardedGetSet) {
 }
 
 std::string create_sindex(namespace_interface_t *nsi,
-                          order_source_t *osource) {
+                          order_source_t *osource,
+                          const boost::optional<std::vector<std::string> > &cover
+                              = boost::none) {
     std::string id = uuid_to_str(generate_uuid());
 
     const ql::sym_t arg(1);
@@ -185,7 +187,7 @@ std::string create_sindex(namespace_interface_t *nsi,
     ql::map_wire_func_t m(mapping, make_vector(arg), get_backtrace(mapping));
 
     write_t write(sindex_create_t(id, m, sindex_multi_bool_t::SINGLE,
-                                  sindex_geo_bool_t::REGULAR),
+                                  sindex_geo_bool_t::REGULAR, cover),
                   profile_bool_t::PROFILE, ql::configured_limits_t());
     write_response_t response;
 
@@ -248,9 +250,10 @@ bool drop_sindex(namespace_interface_t *nsi,
     return res->success;
 }
 
-void run_create_drop_sindex_test(namespace_interface_t *nsi, order_source_t *osource) {
+void create_drop_sindex(namespace_interface_t *nsi, order_source_t *osource,
+                        const boost::optional<std::vector<std::string> > &cover) {
     /* Create a secondary index. */
-    std::string id = create_sindex(nsi, osource);
+    std::string id = create_sindex(nsi, osource, cover);
     wait_for_sindex(nsi, osource, id);
 
     std::shared_ptr<const scoped_cJSON_t> data(
@@ -351,6 +354,17 @@ void run_create_drop_sindex_test(namespace_interface_t *nsi, order_source_t *oso
     }
 }
 
+void run_create_drop_sindex_test(namespace_interface_t *nsi, order_source_t *osource) {
+    create_drop_sindex(nsi, osource, boost::none);
+}
+
+/* A compact index that doesn't cover `id`, so reading the row through it has to
+get the document from the primary btree. */
+void run_create_drop_compact_sindex_test(namespace_interface_t *nsi,
+                                         order_source_t *osource) {
+    create_drop_sindex(nsi, osource, make_vector(std::string("sid")));
+}
+
 void populate_sindex(namespace_interface_t *nsi,
                      order_source_t *osource,
                      int num_docs) {
@@ -435,6 +449,11 @@ TEST(RDBProtocol, OvershardedSindexCreateDrop) {
     run_in_thread_pool_with_namespace_interface(&run_create_drop_sindex_test, true);
 }
 
+TEST(RDBProtocol, CompactSindexCreateDrop) {
+    run_in_thread_pool_with_namespace_interface(
+        &run_create_drop_compact_sindex_test, false);
+}
+
 void rename_sindex(namespace_interface_t *nsi,
                    order_source_t *osource,
                    std::string old_name,
@@ -1,10 +1,16 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <limits.h>
+
 #include <functional>
+#include <string>
+#include <vector>
 
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
 #include "containers/archive/socket_stream.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "unittest/clustering_utils.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "rpc/connectivity/cluster.hpp"
@@ -453,6 +459,163 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, BinaryData, 3) {
     EXPECT_TRUE(a2.got_spectrum);
 }
 
+/* `string_test_application_t` sends strings, and keeps the ones it receives in the
+order they arrived. */
+class string_test_application_t :
+    public home_thread_mixin_t,
+    public cluster_message_handler_t
+{
+public:
+    explicit string_test_application_t(connectivity_cluster_t *cm) :
+        cluster_message_handler_t(cm, 'S') { }
+    void send(const std::string &message, peer_id_t peer) {
+        class writer_t : public cluster_send_message_write_callback_t {
+        public:
+            explicit writer_t(const std::string &_data) : data(_data) { }
+            virtual ~writer_t() { }
+            void write(cluster_version_t, write_stream_t *stream) {
+                write_message_t wm;
+                serialize<cluster_version_t::CLUSTER>(&wm, data);
+                int res = send_write_message(stream, std::move(wm));
+                if (res) { throw fake_archive_exc_t(); }
+            }
+            const std::string &data;
+        } writer(message);
+        auto_drainer_t::lock_t connection_keepalive;
+        connectivity_cluster_t::connection_t *connection =
+            get_connectivity_cluster()->get_connection(peer, &connection_keepalive);
+        ASSERT_TRUE(connection != NULL);
+        get_connectivity_cluster()->send_message(connection, connection_keepalive,
+                                                 get_message_tag(), &writer);
+    }
+    std::vector<std::string> inbox;
+
+private:
+    void on_message(connectivity_cluster_t::connection_t *,
+                    auto_drainer_t::lock_t,
+                    read_stream_t *stream) {
+        std::string s;
+        archive_result_t res = deserialize<cluster_version_t::CLUSTER>(stream, &s);
+        if (bad(res)) { throw fake_archive_exc_t(); }
+        on_thread_t th(home_thread());
+        inbox.push_back(s);
+    }
+};
+
+/* `Compression` sends small and large messages over compressed connections, and
+over a connection where only one side asks for compression. */
+TPTEST_MULTITHREAD(RPCConnectivityTest, Compression, 3) {
+    connectivity_cluster_t c1, c2, c3;
+    string_test_application_t a1(&c1), a2(&c2), a3(&c3);
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0, cluster_compression_t::zlib);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0, cluster_compression_t::zlib);
+    connectivity_cluster_t::run_t cr3(&c3, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0, cluster_compression_t::none);
+    cr2.join(get_cluster_local_address(&c1));
+    cr3.join(get_cluster_local_address(&c1));
+
+    let_stuff_happen();
+
+    std::vector<std::string> messages;
+    for (int i = 0; i < 20; ++i) {
+        // Alternate between messages that are sent raw and compressible ones that
+        // are big enough to be compressed.
+        std::string large;
+        for (int j = 0; j < 1000 * i; ++j) {
+            large += strprintf("row %d of message %d; ", j % 50, i);
+        }
+        messages.push_back(strprintf("small %d", i));
+        messages.push_back(large);
+    }
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        a1.send(*it, c2.get_me());
+        a2.send(*it, c1.get_me());
+        a3.send(*it, c1.get_me());
+    }
+
+    let_stuff_happen();
+
+    EXPECT_TRUE(messages == a2.inbox);
+    ASSERT_EQ(2 * messages.size(), a1.inbox.size());
+}
+
+/* A message of about `size` bytes whose contents depend on `seed` and on where in the
+message they are, so that data that gets lost or reordered shows. */
+std::string make_patterned_message(int seed, size_t size) {
+    std::string message;
+    message.reserve(size + 32);
+    for (int i = 0; message.size() < size; ++i) {
+        message += strprintf("%d:%d;", seed, i);
+    }
+    return message;
+}
+
+/* Waits for `app` to receive `count` messages, or for ten seconds. */
+void wait_for_messages(string_test_application_t *app, size_t count) {
+    for (int i = 0; i < 200 && app->inbox.size() < count; ++i) {
+        nap(50);
+    }
+}
+
+/* `LargeMessages` sends messages that are made of more buffers than `writev()` takes
+at once (`IOV_MAX`), and that are too big for the socket's send buffer, so that
+each of them takes several partial writes. */
+TPTEST_MULTITHREAD(RPCConnectivityTest, LargeMessages, 3) {
+    connectivity_cluster_t c1, c2;
+    string_test_application_t a1(&c1), a2(&c2);
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0);
+    cr1.join(get_cluster_local_address(&c2));
+
+    let_stuff_happen();
+
+    const size_t message_size = 4 * IOV_MAX * write_buffer_t::DATA_SIZE;
+    std::vector<std::string> messages;
+    for (int i = 0; i < 3; ++i) {
+        messages.push_back(make_patterned_message(i, message_size + i * 1000));
+    }
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        a1.send(*it, c2.get_me());
+    }
+
+    wait_for_messages(&a2, messages.size());
+    EXPECT_TRUE(messages == a2.inbox);
+}
+
+/* `CoalescedMessages` sends many messages to the same peer at once, so that they go
+out together in one batch.  Large ones between the small ones make the batch longer
+than `IOV_MAX` buffers, with message boundaries in the middle of a `writev()`. */
+TPTEST(RPCConnectivityTest, CoalescedMessages) {
+    connectivity_cluster_t c1, c2;
+    string_test_application_t a1(&c1), a2(&c2);
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0);
+    cr1.join(get_cluster_local_address(&c2));
+
+    let_stuff_happen();
+
+    std::vector<std::string> messages;
+    for (int i = 0; i < 60; ++i) {
+        messages.push_back(i % 10 == 0
+            ? make_patterned_message(i, IOV_MAX * write_buffer_t::DATA_SIZE / 3)
+            : strprintf("small %d", i));
+    }
+    // All of them are sent from this thread, which is the connection's, so each one
+    // joins the batch that the first one started while it yields.
+    pmap(messages.size(), [&](int i) {
+        a1.send(messages[i], c2.get_me());
+    });
+
+    wait_for_messages(&a2, messages.size());
+    EXPECT_TRUE(messages == a2.inbox);
+}
+
 /* `PeerIDSemantics` makes sure that `peer_id_t::is_nil()` works as expected. */
 TPTEST_MULTITHREAD(RPCConnectivityTest, PeerIDSemantics, 3) {
     peer_id_t nil_peer;
@@ -717,6 +880,86 @@ TPTEST(RPCConnectivityTest, DifferentBuildMode) {
     check_tcp_closed(&stream);
 }
 
+// Reads a string the way the handshake sends them: a fixed-size length followed by
+// the characters.
+std::string read_handshake_string(socket_stream_t *stream) {
+    uint64_t size;
+    archive_result_t res = deserialize<cluster_version_t::CLUSTER>(stream, &size);
+    if (bad(res) || size > 4096) {
+        return "";
+    }
+    scoped_array_t<char> data(size);
+    if (force_read(stream, data.data(), size) != static_cast<int64_t>(size)) {
+        return "";
+    }
+    return std::string(data.data(), size);
+}
+
+void append_handshake_string(write_message_t *msg, const std::string &str) {
+    serialize<cluster_version_t::CLUSTER>(msg, str.length());
+    msg->append(str.data(), str.length());
+}
+
+/* `OlderVersion` connects the way a 1.15 node does.  Those nodes can't read the
+messages we send, so the handshake must fail even though they would accept us. */
+TPTEST(RPCConnectivityTest, OlderVersion) {
+    // Set up a cluster node.
+    connectivity_cluster_t c1;
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0);
+
+    // Manually connect to the cluster.
+    peer_address_t addr = get_cluster_local_address(&c1);
+    scoped_fd_t sock(connect_to_node(*addr.ips().begin()));
+    socket_stream_t stream(sock.get());
+    signal_timer_t interruptor;
+    interruptor.start(6000);
+    stream.set_interruptor(&interruptor);
+
+    // Read & check its side of the handshake.
+    const int64_t len = connectivity_cluster_t::cluster_proto_header.length();
+    {
+        scoped_array_t<char> data(len + 1);
+        int64_t read = force_read(&stream, data.data(), len);
+        ASSERT_GE(read, 0);
+        data[read] = 0;         // null-terminate
+        ASSERT_STREQ(connectivity_cluster_t::cluster_proto_header.c_str(), data.data());
+    }
+    EXPECT_EQ(connectivity_cluster_t::cluster_version_string,
+              read_handshake_string(&stream));
+    EXPECT_EQ(connectivity_cluster_t::cluster_arch_bitsize,
+              read_handshake_string(&stream));
+    EXPECT_EQ(connectivity_cluster_t::cluster_build_mode,
+              read_handshake_string(&stream));
+    peer_id_t id;
+    ASSERT_FALSE(bad(deserialize_universal(&stream, &id)));
+    EXPECT_TRUE(id == c1.get_me());
+    std::set<host_and_port_t> hosts;
+    ASSERT_FALSE(bad(deserialize_universal(&stream, &hosts)));
+
+    // Send our side of the handshake, the way a 1.15 node does.  We stop after the
+    // version string: the node doesn't read any further, and closing a socket with
+    // unread data resets the connection, which could discard the error message.
+    write_message_t msg;
+    msg.append(connectivity_cluster_t::cluster_proto_header.c_str(),
+               connectivity_cluster_t::cluster_proto_header.length());
+    append_handshake_string(&msg, "1.15");
+    ASSERT_FALSE(send_write_message(&stream, &msg));
+
+    // The node tells us why it refuses us, and hangs up.
+    uint8_t result_code;
+    std::string error_code_string, additional_info;
+    ASSERT_FALSE(bad(deserialize_universal(&stream, &result_code)));
+    ASSERT_FALSE(bad(deserialize_universal(&stream, &error_code_string)));
+    ASSERT_FALSE(bad(deserialize_universal(&stream, &additional_info)));
+    EXPECT_NE(0, result_code);
+    EXPECT_NE(std::string::npos, additional_info.find("remote: 1.15"))
+        << additional_info;
+    let_stuff_happen();
+
+    check_tcp_closed(&stream);
+}
+
 std::set<host_and_port_t> convert_from_any_port(const std::set<host_and_port_t> &addresses,
                                                 port_t actual_port) {
     std::set<host_and_port_t> result;
@@ -90,5 +90,74 @@ TEST(SerializerTest, AddDeleteRepeatedlyWithIndex) {
     run_in_thread_pool(std::bind(run_AddDeleteRepeatedly, true), 4);
 }
 
+void run_CompressedWriteRead() {
+    mock_file_opener_t file_opener;
+    standard_serializer_t::static_config_t static_config;
+    static_config.block_compression_ = block_compression_t::zlib;
+    standard_serializer_t::create(&file_opener, static_config);
+
+    // Block 0 compresses well, block 1 (pseudo-random bytes) doesn't compress at all
+    // and has to be stored as it is.
+    std::vector<buf_ptr_t> bufs;
+    {
+        standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                                  &file_opener,
+                                  &get_global_perfmon_collection());
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+
+        bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+        bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+        char *compressible = static_cast<char *>(bufs[0].cache_data());
+        char *incompressible = static_cast<char *>(bufs[1].cache_data());
+        uint32_t state = 12345;
+        for (uint32_t i = 0; i < ser.max_block_size().value(); ++i) {
+            compressible[i] = 'a' + (i / 64) % 4;
+            state = state * 1103515245 + 12345;
+            incompressible[i] = static_cast<char>(state >> 16);
+        }
+
+        std::vector<buf_write_info_t> infos;
+        for (size_t i = 0; i < bufs.size(); ++i) {
+            infos.push_back(buf_write_info_t(bufs[i].ser_buffer(), bufs[i].block_size(), i));
+        }
+
+        struct : public iocallback_t, public cond_t {
+            void on_io_complete() {
+                pulse();
+            }
+        } cb;
+
+        std::vector<counted_t<standard_block_token_t> > tokens
+            = ser.block_writes(infos, account.get(), &cb);
+        cb.wait();
+
+        std::vector<index_write_op_t> write_ops;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            ASSERT_EQ(ser.max_block_size(), tokens[i]->block_size());
+            write_ops.push_back(index_write_op_t(i, tokens[i], repli_timestamp_t::distant_past));
+        }
+        new_mutex_in_line_t dummy_acq;
+        ser.index_write(&dummy_acq, write_ops, account.get());
+    }
+
+    // Read the blocks back after reopening the file, so that we go through the LBA.
+    standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                              &file_opener,
+                              &get_global_perfmon_collection());
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        counted_t<standard_block_token_t> token = ser.index_read(i);
+        ASSERT_TRUE(token.has());
+        ASSERT_EQ(ser.max_block_size(), token->block_size());
+        buf_ptr_t buf = ser.block_read(token, account.get());
+        ASSERT_EQ(bufs[i].block_size(), buf.block_size());
+        EXPECT_EQ(0, memcmp(bufs[i].cache_data(), buf.cache_data(),
+                            buf.block_size().value()));
+    }
+}
+
+TEST(SerializerTest, CompressedWriteRead) {
+    run_in_thread_pool(run_CompressedWriteRead, 4);
+}
 
 }  // namespace unittest
@@ -0,0 +1,179 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/interruptor.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/stream_cache.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+static const int READ_AHEAD_BATCH_SIZE = 3;
+
+// A stream of `num_batches` batches of numbers counting up from zero, which can be
+// told to fail or block when it reads a given batch.
+class read_ahead_stream_t : public ql::datum_stream_t {
+public:
+    explicit read_ahead_stream_t(int _num_batches)
+        : ql::datum_stream_t(ql::make_counted_backtrace()),
+          num_batches(_num_batches), batches_read(0),
+          fail_at(-1), block_at(-1), was_interrupted(false) { }
+
+    bool is_array() { return false; }
+    ql::datum_t as_array(ql::env_t *) { return ql::datum_t(); }
+    bool is_exhausted() const { return batches_read >= num_batches; }
+    bool is_cfeed() const { return false; }
+    bool can_read_ahead() const { return true; }
+
+    void add_transformation(ql::transform_variant_t &&,
+                            const ql::protob_t<const Backtrace> &) {
+        unreachable();
+    }
+    void accumulate(ql::env_t *, ql::eager_acc_t *, const ql::terminal_variant_t &) {
+        unreachable();
+    }
+    void accumulate_all(ql::env_t *, ql::eager_acc_t *) {
+        unreachable();
+    }
+
+    const int num_batches;
+    int batches_read;
+    int fail_at;
+    int block_at;
+    cond_t unblock;
+    bool was_interrupted;
+
+private:
+    std::vector<ql::datum_t> next_batch_impl(ql::env_t *env,
+                                             const ql::batchspec_t &) {
+        if (batches_read == block_at) {
+            try {
+                wait_interruptible(&unblock, env->interruptor);
+            } catch (const interrupted_exc_t &) {
+                was_interrupted = true;
+                throw;
+            }
+        }
+        if (batches_read == fail_at) {
+            throw ql::datum_exc_t(ql::base_exc_t::GENERIC, "Read failed.");
+        }
+        std::vector<ql::datum_t> batch;
+        if (batches_read < num_batches) {
+            for (int i = 0; i < READ_AHEAD_BATCH_SIZE; ++i) {
+                batch.push_back(ql::datum_t(static_cast<double>(
+                    batches_read * READ_AHEAD_BATCH_SIZE + i)));
+            }
+            ++batches_read;
+        }
+        return batch;
+    }
+};
+
+static void insert_stream(ql::stream_cache_t *cache, read_ahead_stream_t *stream) {
+    cache->insert(1, ql::use_json_t::NO, std::map<std::string, ql::wire_func_t>(),
+                  profile_bool_t::DONT_PROFILE, counted_t<ql::datum_stream_t>(stream));
+}
+
+// Gives the read-ahead coroutine a chance to read `num_batches` batches.
+static void wait_for_batches(read_ahead_stream_t *stream, int num_batches) {
+    for (int i = 0; i < 100 && stream->batches_read < num_batches; ++i) {
+        coro_t::yield();
+    }
+}
+
+TPTEST(StreamCacheTest, ReadAheadInOrder) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+    const int num_batches = 4;
+    counted_t<read_ahead_stream_t> stream = make_counted<read_ahead_stream_t>(
+        num_batches);
+    insert_stream(&cache, stream.get());
+
+    cond_t interruptor;
+    int next_value = 0;
+    for (int i = 0; i < num_batches; ++i) {
+        Response res;
+        ASSERT_TRUE(cache.serve(1, &res, &interruptor));
+        ASSERT_EQ(READ_AHEAD_BATCH_SIZE, res.response_size());
+        for (int j = 0; j < res.response_size(); ++j) {
+            EXPECT_EQ(next_value, res.response(j).r_num());
+            ++next_value;
+        }
+        if (i + 1 < num_batches) {
+            EXPECT_EQ(Response::SUCCESS_PARTIAL, res.type());
+            // The next batch gets read before the client asks for it.
+            wait_for_batches(stream.get(), i + 2);
+            EXPECT_EQ(i + 2, stream->batches_read);
+        } else {
+            EXPECT_EQ(Response::SUCCESS_SEQUENCE, res.type());
+        }
+    }
+    EXPECT_FALSE(cache.contains(1));
+}
+
+TPTEST(StreamCacheTest, ReadAheadErrorOnNextServe) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+    counted_t<read_ahead_stream_t> stream = make_counted<read_ahead_stream_t>(4);
+    stream->fail_at = 1;
+    insert_stream(&cache, stream.get());
+
+    cond_t interruptor;
+    Response res;
+    ASSERT_TRUE(cache.serve(1, &res, &interruptor));
+    EXPECT_EQ(Response::SUCCESS_PARTIAL, res.type());
+
+    // The read-ahead fails in the background; the client finds out when it asks for
+    // the batch.
+    Response failed_res;
+    EXPECT_THROW(UNUSED bool served = cache.serve(1, &failed_res, &interruptor),
+                 ql::base_exc_t);
+    EXPECT_FALSE(cache.contains(1));
+}
+
+TPTEST(StreamCacheTest, ReadAheadInterruptedByServe) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+    counted_t<read_ahead_stream_t> stream = make_counted<read_ahead_stream_t>(4);
+    stream->block_at = 1;
+    insert_stream(&cache, stream.get());
+
+    cond_t interruptor;
+    Response res;
+    ASSERT_TRUE(cache.serve(1, &res, &interruptor));
+    coro_t::yield();
+
+    // The next batch doesn't come, so the client gives up on it.
+    interruptor.pulse();
+    Response interrupted_res;
+    EXPECT_THROW(UNUSED bool served = cache.serve(1, &interrupted_res, &interruptor),
+                 interrupted_exc_t);
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_TRUE(stream->was_interrupted);
+}
+
+TPTEST(StreamCacheTest, ReadAheadInterruptedByStop) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+    counted_t<read_ahead_stream_t> stream = make_counted<read_ahead_stream_t>(4);
+    stream->block_at = 1;
+    insert_stream(&cache, stream.get());
+
+    cond_t interruptor;
+    Response res;
+    ASSERT_TRUE(cache.serve(1, &res, &interruptor));
+    coro_t::yield();
+
+    // A STOP erases the stream, which waits for the read-ahead to give up.
+    cache.erase(1);
+    EXPECT_TRUE(stream->was_interrupted);
+    EXPECT_EQ(1, stream->batches_read);
+}
+
+}  // namespace unittest
@@ -19,6 +19,15 @@ delete_queries = [
     }
 ]
 
+index_queries = [
+    {
+        # Building an index on a table that already has all its documents
+        "query": "r.db('test').table(table['name']).index_create('field1_copy', r.row['field1']).do(lambda res: r.db('test').table(table['name']).index_wait('field1_copy'))",
+        "tag": "index_create_wait",
+        "clean": "r.db('test').table(table['name']).index_drop('field1_copy')"
+    }
+]
+
 table_queries = [
     {
         "query": "r.db('test').table(table['name']).get(table['ids'][i])",
@@ -42,6 +51,11 @@ table_queries = [
         "tag": "between_100",
         "imax": 100
     },
+    {
+        "query": "r.db('test').table(table['name']).get_all(*table['ids'][i:i+100])",
+        "tag": "get_all_100_pk",
+        "imax": 100
+    },
     {
         "query": "r.db('test').table(table['name']).filter(r.row['boolean'])",
         "tag": "filter_field_bool"
@@ -62,6 +76,10 @@ table_queries = [
         "query": "r.db('test').table(table['name']).filter(r.row['field0'].gt('5'))",
         "tag": "filter_string_5"
     },
+    {
+        "query": "r.db('test').table(table['name']).filter((r.row['int'] > 100) & r.row['array_num'].contains(5000))",
+        "tag": "filter_compound"
+    },
     {
         "query": "r.db('test').table(table['name']).limit(10).inner_join(r.db('test').table(table['name']), lambda left, right: left['id'] == right['id'])",
         "tag": "inner_join"
@@ -78,6 +96,14 @@ table_queries = [
         "query": "r.db('test').table(table['name']).eq_join('id', r.db('test').table(table['name'])).zip()",
         "tag": "eq_join_zip"
     },
+    {
+        "query": "r.db('test').table(table['name']).limit(1000).eq_join('id', r.db('test').table(table['name'])).count()",
+        "tag": "eq_join_1000"
+    },
+    {
+        "query": "r.db('test').table(table['name']).limit(1000).eq_join('field0', r.db('test').table(table['name']), index='field0').count()",
+        "tag": "eq_join_1000_sindex"
+    },
     {
         "query": "r.db('test').table(table['name']).map(r.row['id'])",
         "tag": "map_id"
@@ -260,6 +286,11 @@ constant_queries = [
     "r.expr({'a': 'aaaa'}).type_of()",
     "r.expr([1,2,3]).type_of()",
     "r.json('[1,2,3]').type_of()",
+    {
+        # Shaped like a bulk import: 2000 documents with nested fields.
+        "query": "r.json(json.dumps([{'id': i, 'name': 'user number %d' % i, 'score': i % 100 + 0.5, 'active': i % 2 == 0, 'tags': ['alpha', 'beta', 'gamma'], 'address': {'street': '%d Main Street' % i, 'city': 'Springfield', 'zip': '%05d' % i}} for i in range(2000)])).count()",
+        "tag": "json_parse_2000_docs"
+    },
     {
         "query": "r.expr([1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1])",
         "tag": "big array"
@@ -12,7 +12,7 @@ import math
 import subprocess
 
 from util import gen_doc, gen_num_docs, compare
-from queries import constant_queries, table_queries, write_queries, delete_queries
+from queries import constant_queries, table_queries, write_queries, delete_queries, index_queries
 
 sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'rql_test')))
 from test_util import RethinkDBTestServers
@@ -236,6 +236,37 @@ def execute_read_write_queries(suffix):
     sys.stdout.flush()
 
 
+    # Execute the index queries
+    print("Running index creation...", end=' ')
+    sys.stdout.flush()
+    for table in tables:
+        for p in xrange(len(index_queries)):
+            count = 0
+
+            durations = []
+            start = time.time()
+            while time.time() - start < time_per_query and count < executions_per_query:
+                start_query = time.time()
+                eval(index_queries[p]["query"]).run(connection)
+                durations.append(time.time() - start_query)
+                count += 1
+
+                # Drop the index so that the next execution builds it again
+                eval(index_queries[p]["clean"]).run(connection)
+
+            durations.sort()
+            results[index_queries[p]["tag"] + "-" + table["name"] + "-" + suffix] = {
+                "average": sum(durations) / count,
+                "min": durations[0],
+                "max": durations[len(durations) - 1],
+                "first_centile": durations[int(math.floor(len(durations) / 100. * 1))],
+                "last_centile": durations[int(math.floor(len(durations) / 100. * 99))]
+            }
+
+    print(" Done.")
+    sys.stdout.flush()
+
+
     # Execute the read queries on every tables
     print("Running reads...", end=' ')
     sys.stdout.flush()